@@ -558,6 +558,107 @@ div_getter (purc_variant_t root, size_t nr_args, purc_variant_t *argv,
     return ret_var;
 }
 
+enum numeric_stat_item {
+    NUMERIC_STAT_SUM,
+    NUMERIC_STAT_MEAN,
+    NUMERIC_STAT_MIN,
+    NUMERIC_STAT_MAX,
+};
+
+static purc_variant_t
+numeric_stat_getter (size_t nr_args, purc_variant_t *argv,
+        enum numeric_stat_item item)
+{
+    struct purc_variant_numeric_stat stat;
+    double number = 0.0;
+
+    GET_PARAM_NUMBER(1);
+    if (argv[0] == PURC_VARIANT_INVALID ||
+            !purc_variant_linear_container_numeric_stat (argv[0], &stat)) {
+        purc_set_error (PURC_ERROR_WRONG_DATA_TYPE);
+        return PURC_VARIANT_INVALID;
+    }
+
+    switch (item) {
+        case NUMERIC_STAT_SUM:
+            number = stat.sum;
+            break;
+        case NUMERIC_STAT_MEAN:
+            number = stat.count ? stat.sum / stat.count : 0.0;
+            break;
+        case NUMERIC_STAT_MIN:
+            number = stat.min;
+            break;
+        case NUMERIC_STAT_MAX:
+            number = stat.max;
+            break;
+    }
+
+    return purc_variant_make_number (number);
+}
+
+static purc_variant_t
+sum_getter (purc_variant_t root, size_t nr_args, purc_variant_t *argv,
+        bool silently)
+{
+    UNUSED_PARAM(root);
+    UNUSED_PARAM(silently);
+
+    return numeric_stat_getter (nr_args, argv, NUMERIC_STAT_SUM);
+}
+
+static purc_variant_t
+mean_getter (purc_variant_t root, size_t nr_args, purc_variant_t *argv,
+        bool silently)
+{
+    UNUSED_PARAM(root);
+    UNUSED_PARAM(silently);
+
+    return numeric_stat_getter (nr_args, argv, NUMERIC_STAT_MEAN);
+}
+
+static purc_variant_t
+min_getter (purc_variant_t root, size_t nr_args, purc_variant_t *argv,
+        bool silently)
+{
+    UNUSED_PARAM(root);
+    UNUSED_PARAM(silently);
+
+    return numeric_stat_getter (nr_args, argv, NUMERIC_STAT_MIN);
+}
+
+static purc_variant_t
+max_getter (purc_variant_t root, size_t nr_args, purc_variant_t *argv,
+        bool silently)
+{
+    UNUSED_PARAM(root);
+    UNUSED_PARAM(silently);
+
+    return numeric_stat_getter (nr_args, argv, NUMERIC_STAT_MAX);
+}
+
+static purc_variant_t
+dot_getter (purc_variant_t root, size_t nr_args, purc_variant_t *argv,
+        bool silently)
+{
+    UNUSED_PARAM(root);
+    UNUSED_PARAM(silently);
+
+    double number = 0.0;
+
+    GET_PARAM_NUMBER(2);
+    if (argv[0] == PURC_VARIANT_INVALID || argv[1] == PURC_VARIANT_INVALID) {
+        purc_set_error (PURC_ERROR_WRONG_DATA_TYPE);
+        return PURC_VARIANT_INVALID;
+    }
+
+    // the error has been set for the different sizes or the wrong types.
+    if (!purc_variant_linear_container_dot (argv[0], argv[1], &number))
+        return PURC_VARIANT_INVALID;
+
+    return purc_variant_make_number (number);
+}
+
 
 static purc_variant_t
 sin_getter (purc_variant_t root, size_t nr_args, purc_variant_t *argv,
@@ -1664,6 +1765,11 @@ static purc_variant_t pcdvobjs_create_math (void)
         {"sub",     sub_getter, NULL},
         {"mul",     mul_getter, NULL},
         {"div",     div_getter, NULL},
+        {"sum",     sum_getter, NULL},
+        {"mean",    mean_getter, NULL},
+        {"min",     min_getter, NULL},
+        {"max",     max_getter, NULL},
+        {"dot",     dot_getter, NULL},
     };
 
     return purc_dvobj_make_from_methods (method, PCA_TABLESIZE(method));
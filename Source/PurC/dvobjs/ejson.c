@@ -461,6 +461,8 @@ enum {
     K_KW_no_trailing_zero,
 #define _KW_no_slash_escape     "no-slash-escape"
     K_KW_no_slash_escape,
+#define _KW_binary          "binary"
+    K_KW_binary,
 };
 
 #define _KW_DELIMITERS  " \t\n\v\f\r"
@@ -485,6 +487,8 @@ static struct keyword_to_atom {
     { _KW_bseq_base64,      PCVARIANT_SERIALIZE_OPT_BSEQUENCE_BASE64, 0 },
     { _KW_no_trailing_zero, PCVARIANT_SERIALIZE_OPT_NOZERO, 0 },
     { _KW_no_slash_escape,  PCVARIANT_SERIALIZE_OPT_NOSLASHESCAPE, 0 },
+    // not a flag; serializes in the binary format instead of eJSON
+    { _KW_binary,           0, 0 },
 };
 
 static purc_variant_t
@@ -497,6 +501,7 @@ serialize_getter(purc_variant_t root, size_t nr_args, purc_variant_t *argv,
     const char *options = NULL;
     size_t options_len;
     unsigned int flags = PCVARIANT_SERIALIZE_OPT_PLAIN;
+    bool binary = false;
 
     purc_variant_t vrt;
 
@@ -553,6 +558,8 @@ serialize_getter(purc_variant_t root, size_t nr_args, purc_variant_t *argv,
                             }
 
                             flags |= keywords2atoms[i].flag;
+                            if (i == K_KW_binary)
+                                binary = true;
                         }
                     }
                 }
@@ -570,17 +577,29 @@ serialize_getter(purc_variant_t root, size_t nr_args, purc_variant_t *argv,
     purc_rwstream_t my_stream;
     ssize_t n;
 
-    my_stream = purc_rwstream_new_buffer(LEN_INI_SERIALIZE_BUF,
-            LEN_MAX_SERIALIZE_BUF);
-    n = purc_variant_serialize(vrt, my_stream, 0, flags, NULL);
+    size_t sz_init = LEN_INI_SERIALIZE_BUF;
+    if (!binary) {
+        /* serialize into a right-sized buffer to avoid the reallocations */
+        sz_init = pcvariant_serialize_size_hint(vrt, flags);
+        if (sz_init < LEN_INI_SERIALIZE_BUF)
+            sz_init = LEN_INI_SERIALIZE_BUF;
+    }
+
+    my_stream = purc_rwstream_new_buffer(sz_init, LEN_MAX_SERIALIZE_BUF);
+    if (binary)
+        n = purc_variant_serialize_binary(vrt, my_stream);
+    else
+        n = purc_variant_serialize(vrt, my_stream, 0, flags, NULL);
     if (nr_args == 0)
         purc_variant_unref(vrt);
 
     if (n == -1) {
+        purc_rwstream_destroy(my_stream);
         goto fatal;
     }
 
-    purc_rwstream_write(my_stream, "\0", 1);
+    if (!binary)
+        purc_rwstream_write(my_stream, "\0", 1);
 
     char *buf = NULL;
     size_t sz_content, sz_buffer;
@@ -588,6 +607,9 @@ serialize_getter(purc_variant_t root, size_t nr_args, purc_variant_t *argv,
             &sz_content, &sz_buffer, true);
     purc_rwstream_destroy(my_stream);
 
+    if (binary)
+        return purc_variant_make_byte_sequence_reuse_buff(buf,
+                sz_content, sz_buffer);
     return purc_variant_make_string_reuse_buff(buf, sz_buffer, false);
 
 fatal:
@@ -607,6 +629,16 @@ parse_getter(purc_variant_t root, size_t nr_args, purc_variant_t *argv,
 
     const char *string;
     size_t length;
+    if (purc_variant_is_bsequence(argv[0])) {
+        // the data serialized by `serialize` with the option `binary`
+        const unsigned char *bytes;
+        bytes = purc_variant_get_bytes_const(argv[0], &length);
+        purc_variant_t retv = purc_variant_load_from_binary(bytes, length);
+        if (retv == PURC_VARIANT_INVALID)
+            goto failed;
+        return retv;
+    }
+
     string = purc_variant_get_string_const_ex(argv[0], &length);
     if (string == NULL) {
         purc_set_error(PURC_ERROR_WRONG_DATA_TYPE);
@@ -1930,9 +1962,7 @@ shuffle_getter(purc_variant_t root, size_t nr_args, purc_variant_t *argv,
         ssize_t sz = purc_variant_array_get_size(argv[0]);
 
         if (sz > 1) {
-            struct pcutils_array_list *al = variant_array_get_data(argv[0]);
-            struct pcutils_array_list_node *p;
-            array_list_for_each(al, p) {
+            for (size_t idx = 0; idx < (size_t)sz; idx++) {
 
                 size_t new_idx;
                 if (sz < RAND_MAX) {
@@ -1943,8 +1973,8 @@ shuffle_getter(purc_variant_t root, size_t nr_args, purc_variant_t *argv,
                     new_idx = new_idx * sz / RAND_MAX;
                 }
 
-                if (new_idx != p->idx)
-                    pcutils_array_list_swap(al, p->idx, new_idx);
+                if (new_idx != idx)
+                    pcvariant_array_swap(argv[0], idx, new_idx);
             }
         }
     }
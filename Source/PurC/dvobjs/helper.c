@@ -133,8 +133,8 @@ purc_dvobj_make_from_methods(const struct purc_dvobj_method *methods,
             goto error;
         }
 
-        if (!purc_variant_object_set_by_static_ckey(ret_var,
-                    methods[i].name, val)) {
+        purc_atom_t key = purc_atom_from_static_string(methods[i].name);
+        if (key == 0 || !purc_variant_object_set_by_atom(ret_var, key, val)) {
             goto error;
         }
 
@@ -0,0 +1,363 @@
+/*
+ * @file feed.c
+ * @date 2026/10/16
+ * @brief The push interface of the eJSON parser over partial buffers.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "private/instance.h"
+#include "private/errors.h"
+#include "private/ejson.h"
+
+#include "purc-variant.h"
+#include "purc-rwstream.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * The bytes fed are scanned by a small state machine which only knows the
+ * strings and the nesting of the brackets, so it can stop at any byte and
+ * resume with the next chunk, even in the middle of a string or a UTF-8
+ * sequence. Only the bytes of the pending top-level value are kept; once
+ * the value is complete, it is parsed by the fast path or the eJSON parser
+ * and passed to the callback, then the buffer is reused for the next one.
+ */
+#define FEED_MIN_BUFFER_SIZE        256
+#define FEED_KEEP_BUFFER_SIZE       (64 * 1024)
+
+enum feed_state {
+    FEED_STATE_BETWEEN_VALUES,
+    FEED_STATE_VALUE,
+    FEED_STATE_DQ_OPENED,           /* after the opening `"` */
+    FEED_STATE_DQ_OPENED_TWICE,     /* after `""` */
+    FEED_STATE_DQ_STRING,
+    FEED_STATE_DQ_ESCAPE,
+    FEED_STATE_SQ_STRING,
+    FEED_STATE_SQ_ESCAPE,
+    FEED_STATE_TRIPLE_DQ_STRING,
+    FEED_STATE_FAILED,
+};
+
+struct pcejson_feeder {
+    enum feed_state state;
+    uint32_t depth;
+    uint32_t flags;
+    uint32_t nr_nested;
+    uint32_t nr_quotes;
+    bool is_container;
+
+    pcejson_value_cb cb;
+    void *ctxt;
+
+    char *buf;
+    size_t len;
+    size_t sz;
+
+    struct pcejson *parser;
+};
+
+struct pcejson_feeder *
+pcejson_feeder_create(uint32_t depth, uint32_t flags,
+        pcejson_value_cb cb, void *ctxt)
+{
+    struct pcejson_feeder *feeder;
+
+    feeder = calloc(1, sizeof(*feeder));
+    if (feeder == NULL) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    feeder->state = FEED_STATE_BETWEEN_VALUES;
+    feeder->depth = depth > 0 ? depth : PCEJSON_DEFAULT_DEPTH;
+    feeder->flags = flags;
+    feeder->cb = cb;
+    feeder->ctxt = ctxt;
+    return feeder;
+}
+
+void
+pcejson_feeder_destroy(struct pcejson_feeder *feeder)
+{
+    if (feeder) {
+        pcejson_destroy(feeder->parser);
+        free(feeder->buf);
+        free(feeder);
+    }
+}
+
+static bool
+append_bytes(struct pcejson_feeder *feeder, const char *bytes, size_t len)
+{
+    if (feeder->len + len > feeder->sz) {
+        size_t sz = feeder->sz ? feeder->sz : FEED_MIN_BUFFER_SIZE;
+        while (sz < feeder->len + len)
+            sz *= 2;
+
+        char *buf = realloc(feeder->buf, sz);
+        if (buf == NULL) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return false;
+        }
+        feeder->buf = buf;
+        feeder->sz = sz;
+    }
+
+    memcpy(feeder->buf + feeder->len, bytes, len);
+    feeder->len += len;
+    return true;
+}
+
+static purc_variant_t
+parse_value(struct pcejson_feeder *feeder)
+{
+    purc_variant_t value;
+
+    value = pcejson_parse_json(feeder->buf, feeder->len, feeder->depth);
+    if (value != PURC_VARIANT_INVALID)
+        return value;
+
+    purc_rwstream_t rws = purc_rwstream_new_from_mem(feeder->buf,
+            feeder->len);
+    if (rws == NULL)
+        return PURC_VARIANT_INVALID;
+
+    if (feeder->parser)
+        pcejson_reset(feeder->parser, feeder->depth, 1);
+
+    struct pcvcm_node *root = NULL;
+    if (pcejson_parse(&root, &feeder->parser, rws, feeder->depth) ==
+            PCEJSON_SUCCESS) {
+        value = pcvcm_eval(root, NULL, false);
+    }
+
+    pcvcm_node_destroy(root);
+    purc_rwstream_destroy(rws);
+    return value;
+}
+
+/* parses the pending value and passes it to the callback. */
+static bool
+emit_value(struct pcejson_feeder *feeder)
+{
+    purc_variant_t value = parse_value(feeder);
+    if (value == PURC_VARIANT_INVALID)
+        return false;
+
+    bool ok = feeder->cb(feeder->ctxt, value);
+    purc_variant_unref(value);
+
+    feeder->len = 0;
+    if (feeder->sz > FEED_KEEP_BUFFER_SIZE) {
+        free(feeder->buf);
+        feeder->buf = NULL;
+        feeder->sz = 0;
+    }
+
+    feeder->state = FEED_STATE_BETWEEN_VALUES;
+    feeder->nr_nested = 0;
+    return ok;
+}
+
+static inline bool
+is_whitespace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static inline bool
+is_value_end(struct pcejson_feeder *feeder, char c)
+{
+    if (feeder->nr_nested > 0)
+        return false;
+
+    if (feeder->flags & PCEJSON_FEED_FLAG_NDJSON)
+        return c == '\n';
+
+    return !feeder->is_container && is_whitespace(c);
+}
+
+int
+pcejson_feed(struct pcejson_feeder *feeder, const char *buf, size_t len)
+{
+    size_t start = 0;
+    size_t i = 0;
+
+    if (feeder->state == FEED_STATE_FAILED)
+        return -1;
+
+    while (i < len) {
+        char c = buf[i];
+
+        switch (feeder->state) {
+        case FEED_STATE_BETWEEN_VALUES:
+            if (is_whitespace(c)) {
+                start = ++i;
+                continue;
+            }
+            feeder->is_container = (c == '{' || c == '[' || c == '(');
+            feeder->state = FEED_STATE_VALUE;
+            /* fall through */
+
+        case FEED_STATE_VALUE:
+            if (is_value_end(feeder, c)) {
+                if (!append_bytes(feeder, buf + start, i - start) ||
+                        !emit_value(feeder))
+                    goto failed;
+                start = ++i;
+                continue;
+            }
+
+            if (c == '"') {
+                feeder->state = FEED_STATE_DQ_OPENED;
+            }
+            else if (c == '\'') {
+                feeder->state = FEED_STATE_SQ_STRING;
+            }
+            else if (c == '{' || c == '[' || c == '(') {
+                feeder->nr_nested++;
+            }
+            else if (c == '}' || c == ']' || c == ')') {
+                if (feeder->nr_nested == 0) {
+                    pcinst_set_error(PCEJSON_ERROR_UNEXPECTED_CHARACTER);
+                    goto failed;
+                }
+
+                feeder->nr_nested--;
+                if (feeder->nr_nested == 0 && feeder->is_container &&
+                        !(feeder->flags & PCEJSON_FEED_FLAG_NDJSON)) {
+                    i++;
+                    if (!append_bytes(feeder, buf + start, i - start) ||
+                            !emit_value(feeder))
+                        goto failed;
+                    start = i;
+                    continue;
+                }
+            }
+            break;
+
+        case FEED_STATE_DQ_OPENED:
+            if (c == '"')
+                feeder->state = FEED_STATE_DQ_OPENED_TWICE;
+            else if (c == '\\')
+                feeder->state = FEED_STATE_DQ_ESCAPE;
+            else
+                feeder->state = FEED_STATE_DQ_STRING;
+            break;
+
+        case FEED_STATE_DQ_OPENED_TWICE:
+            if (c == '"') {
+                feeder->nr_quotes = 0;
+                feeder->state = FEED_STATE_TRIPLE_DQ_STRING;
+                break;
+            }
+            /* it was an empty string; reconsume the character. */
+            feeder->state = FEED_STATE_VALUE;
+            continue;
+
+        case FEED_STATE_DQ_STRING:
+            /* skip to the next special character in the chunk. */
+            while (i < len && buf[i] != '"' && buf[i] != '\\')
+                i++;
+            if (i == len)
+                continue;
+
+            feeder->state = (buf[i] == '"') ?
+                FEED_STATE_VALUE : FEED_STATE_DQ_ESCAPE;
+            break;
+
+        case FEED_STATE_DQ_ESCAPE:
+            feeder->state = FEED_STATE_DQ_STRING;
+            break;
+
+        case FEED_STATE_SQ_STRING:
+            if (c == '\'')
+                feeder->state = FEED_STATE_VALUE;
+            else if (c == '\\')
+                feeder->state = FEED_STATE_SQ_ESCAPE;
+            break;
+
+        case FEED_STATE_SQ_ESCAPE:
+            feeder->state = FEED_STATE_SQ_STRING;
+            break;
+
+        case FEED_STATE_TRIPLE_DQ_STRING:
+            if (c != '"') {
+                feeder->nr_quotes = 0;
+            }
+            else if (++feeder->nr_quotes == 3) {
+                feeder->state = FEED_STATE_VALUE;
+            }
+            break;
+
+        case FEED_STATE_FAILED:
+            return -1;
+        }
+
+        i++;
+    }
+
+    if (!append_bytes(feeder, buf + start, len - start))
+        goto failed;
+    return PCEJSON_SUCCESS;
+
+failed:
+    feeder->state = FEED_STATE_FAILED;
+    return -1;
+}
+
+int
+pcejson_feed_end(struct pcejson_feeder *feeder)
+{
+    switch (feeder->state) {
+    case FEED_STATE_FAILED:
+        return -1;
+
+    case FEED_STATE_BETWEEN_VALUES:
+        return PCEJSON_SUCCESS;
+
+    case FEED_STATE_VALUE:
+    case FEED_STATE_DQ_OPENED_TWICE:
+        if (feeder->nr_nested == 0) {
+            while (feeder->len > 0 &&
+                    is_whitespace(feeder->buf[feeder->len - 1]))
+                feeder->len--;
+            if (feeder->len == 0) {
+                feeder->state = FEED_STATE_BETWEEN_VALUES;
+                return PCEJSON_SUCCESS;
+            }
+
+            if (emit_value(feeder))
+                return PCEJSON_SUCCESS;
+            feeder->state = FEED_STATE_FAILED;
+            return -1;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    pcinst_set_error(PCEJSON_ERROR_UNEXPECTED_EOF);
+    feeder->state = FEED_STATE_FAILED;
+    return -1;
+}
@@ -0,0 +1,491 @@
+/*
+ * @file json.c
+ * @date 2026/10/16
+ * @brief The fast path parsing strict JSON into variants directly.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "private/ejson.h"
+#include "private/errors.h"
+#include "private/utils.h"
+
+#include "purc-variant.h"
+#include "purc-utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Most JSON data (the renderer messages, the fetched JSON files) use no
+ * eJSON extension, so they can be parsed without the tokenizer and the VCM
+ * tree. This parser accepts strict JSON only; for anything else, including
+ * the strings containing `$` which eJSON evaluates, it gives up and the
+ * caller falls back to the eJSON parser, which also reports the errors.
+ *
+ * The result must be the same as the eJSON parser gives, so the escape
+ * sequences in strings are kept the way the eJSON tokenizer keeps them.
+ */
+
+#define MAX_NUMBER_LEN      63
+
+struct json_parser {
+    const char     *p;
+    const char     *end;
+    uint32_t        depth;
+    uint32_t        max_depth;
+
+    // the buffer for the strings with escape sequences
+    char           *buf;
+    size_t          len_buf;
+    size_t          sz_buf;
+};
+
+/*
+ * Scans 8 bytes a time for the bytes ending a run of plain characters in
+ * a string: `"`, `\`, `$`, and the control characters.
+ */
+static const char *
+scan_plain_chars(const char *p, const char *end, bool *non_ascii)
+{
+    uint64_t highs = 0;
+
+    while (end - p >= 8) {
+        uint64_t w;
+        memcpy(&w, p, sizeof(w));
+        if (pcutils_swar_has_byte(w, '"') | pcutils_swar_has_byte(w, '\\') |
+                pcutils_swar_has_byte(w, '$') |
+                pcutils_swar_has_byte_less_than(w, 0x20))
+            break;
+        highs |= w;
+        p += 8;
+    }
+
+    while (p < end) {
+        unsigned char c = (unsigned char)*p;
+        if (c == '"' || c == '\\' || c == '$' || c < 0x20)
+            break;
+        highs |= c;
+        p++;
+    }
+
+    if (highs & PCUTILS_SWAR_HIGHS)
+        *non_ascii = true;
+    return p;
+}
+
+static inline bool
+is_json_whitespace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static inline bool
+is_hex_digit(char c)
+{
+    return purc_isdigit(c) ||
+        (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static inline void
+skip_whitespaces(struct json_parser *jp)
+{
+    while (jp->p < jp->end && is_json_whitespace(*jp->p))
+        jp->p++;
+}
+
+static bool
+buf_append(struct json_parser *jp, const char *bytes, size_t len)
+{
+    if (jp->len_buf + len > jp->sz_buf) {
+        size_t sz = jp->sz_buf ? jp->sz_buf : 128;
+        while (sz < jp->len_buf + len)
+            sz *= 2;
+
+        char *buf = realloc(jp->buf, sz);
+        if (buf == NULL)
+            return false;
+        jp->buf = buf;
+        jp->sz_buf = sz;
+    }
+
+    memcpy(jp->buf + jp->len_buf, bytes, len);
+    jp->len_buf += len;
+    return true;
+}
+
+/* appends an escape sequence the way the eJSON tokenizer keeps it. */
+static bool
+append_escape(struct json_parser *jp)
+{
+    const char *p = jp->p;
+
+    if (jp->end - p < 2)
+        return false;
+
+    switch (p[1]) {
+    case 'b':
+    case 'f':
+    case 'n':
+    case 'r':
+    case 't':
+        jp->p += 2;
+        return buf_append(jp, p, 2);
+
+    case '$':
+    case '{':
+    case '}':
+    case '<':
+    case '>':
+    case '/':
+    case '\\':
+    case '"':
+        jp->p += 2;
+        return buf_append(jp, p + 1, 1);
+
+    case 'u':
+        if (jp->end - p < 6)
+            return false;
+        for (int i = 2; i < 6; i++) {
+            if (!is_hex_digit(p[i]))
+                return false;
+        }
+        jp->p += 6;
+        return buf_append(jp, p, 6);
+
+    default:
+        break;
+    }
+
+    return false;
+}
+
+/* parses a string; the member names with escape sequences are left to
+   the eJSON parser, which handles them differently. */
+static purc_variant_t
+parse_string(struct json_parser *jp, bool is_name)
+{
+    const char *start = ++jp->p;
+    bool non_ascii = false;
+    bool escaped = false;
+
+    jp->len_buf = 0;
+    for (;;) {
+        const char *p = scan_plain_chars(jp->p, jp->end, &non_ascii);
+        if (p >= jp->end || *p == '$' || (unsigned char)*p < 0x20)
+            return PURC_VARIANT_INVALID;
+
+        if (escaped && !buf_append(jp, jp->p, p - jp->p))
+            return PURC_VARIANT_INVALID;
+        jp->p = p;
+
+        if (*p == '"')
+            break;
+
+        // a backslash
+        if (is_name)
+            return PURC_VARIANT_INVALID;
+        if (!escaped) {
+            if (!buf_append(jp, start, p - start))
+                return PURC_VARIANT_INVALID;
+            escaped = true;
+        }
+        if (!append_escape(jp))
+            return PURC_VARIANT_INVALID;
+    }
+
+    const char *str = start;
+    size_t len = jp->p - start;
+    jp->p++;    // the closing quotation mark
+
+    if (escaped) {
+        str = jp->buf;
+        len = jp->len_buf;
+    }
+
+    if (non_ascii && !pcutils_string_check_utf8_len(str, len, NULL, NULL))
+        return PURC_VARIANT_INVALID;
+
+    return purc_variant_make_string_ex(str, len, false);
+}
+
+static inline bool
+is_number_end(struct json_parser *jp)
+{
+    if (jp->p >= jp->end)
+        return true;
+
+    char c = *jp->p;
+    return is_json_whitespace(c) || c == ',' || c == ']' || c == '}' ||
+        c == '\0';
+}
+
+static inline void
+skip_digits(struct json_parser *jp)
+{
+    while (jp->p < jp->end && purc_isdigit(*jp->p))
+        jp->p++;
+}
+
+static purc_variant_t
+parse_number(struct json_parser *jp)
+{
+    const char *start = jp->p;
+
+    if (*jp->p == '-')
+        jp->p++;
+
+    if (jp->p >= jp->end || !purc_isdigit(*jp->p))
+        return PURC_VARIANT_INVALID;
+    if (*jp->p == '0')
+        jp->p++;
+    else
+        skip_digits(jp);
+
+    if (jp->p < jp->end && *jp->p == '.') {
+        jp->p++;
+        if (jp->p >= jp->end || !purc_isdigit(*jp->p))
+            return PURC_VARIANT_INVALID;
+        skip_digits(jp);
+    }
+
+    if (jp->p < jp->end && (*jp->p == 'e' || *jp->p == 'E')) {
+        jp->p++;
+        if (jp->p < jp->end && (*jp->p == '+' || *jp->p == '-'))
+            jp->p++;
+        if (jp->p >= jp->end || !purc_isdigit(*jp->p))
+            return PURC_VARIANT_INVALID;
+        skip_digits(jp);
+    }
+
+    // the suffixes of eJSON (L, UL, FL) and so on
+    if (!is_number_end(jp))
+        return PURC_VARIANT_INVALID;
+
+    size_t len = jp->p - start;
+    if (len > MAX_NUMBER_LEN)
+        return PURC_VARIANT_INVALID;
+
+    char number[MAX_NUMBER_LEN + 1];
+    memcpy(number, start, len);
+    number[len] = '\0';
+
+    // the same conversion as the eJSON parser does.
+    return purc_variant_make_number(strtod(number, NULL));
+}
+
+static purc_variant_t
+parse_literal(struct json_parser *jp)
+{
+    static const struct {
+        const char *literal;
+        size_t      len;
+    } literals[] = {
+        { "true",   4 },
+        { "false",  5 },
+        { "null",   4 },
+    };
+
+    for (size_t i = 0; i < PCA_TABLESIZE(literals); i++) {
+        size_t len = literals[i].len;
+        if ((size_t)(jp->end - jp->p) >= len &&
+                memcmp(jp->p, literals[i].literal, len) == 0) {
+            jp->p += len;
+            if (!is_number_end(jp))
+                return PURC_VARIANT_INVALID;
+
+            if (i == 2)
+                return purc_variant_make_null();
+            return purc_variant_make_boolean(i == 0);
+        }
+    }
+
+    return PURC_VARIANT_INVALID;
+}
+
+static purc_variant_t
+parse_value(struct json_parser *jp);
+
+static purc_variant_t
+parse_array(struct json_parser *jp)
+{
+    purc_variant_t arr = purc_variant_make_array_0();
+    if (arr == PURC_VARIANT_INVALID)
+        return PURC_VARIANT_INVALID;
+
+    jp->p++;
+    skip_whitespaces(jp);
+    if (jp->p < jp->end && *jp->p == ']') {
+        jp->p++;
+        return arr;
+    }
+
+    for (;;) {
+        purc_variant_t v = parse_value(jp);
+        if (v == PURC_VARIANT_INVALID)
+            goto failed;
+
+        bool ok = purc_variant_array_append(arr, v);
+        purc_variant_unref(v);
+        if (!ok)
+            goto failed;
+
+        skip_whitespaces(jp);
+        if (jp->p >= jp->end)
+            goto failed;
+        if (*jp->p == ']') {
+            jp->p++;
+            break;
+        }
+        if (*jp->p != ',')
+            goto failed;
+        jp->p++;
+    }
+
+    return arr;
+
+failed:
+    purc_variant_unref(arr);
+    return PURC_VARIANT_INVALID;
+}
+
+static purc_variant_t
+parse_object(struct json_parser *jp)
+{
+    purc_variant_t obj = purc_variant_make_object_0();
+    if (obj == PURC_VARIANT_INVALID)
+        return PURC_VARIANT_INVALID;
+
+    jp->p++;
+    skip_whitespaces(jp);
+    if (jp->p < jp->end && *jp->p == '}') {
+        jp->p++;
+        return obj;
+    }
+
+    for (;;) {
+        if (jp->p >= jp->end || *jp->p != '"')
+            goto failed;
+
+        purc_variant_t k = parse_string(jp, true);
+        if (k == PURC_VARIANT_INVALID)
+            goto failed;
+
+        skip_whitespaces(jp);
+        if (jp->p >= jp->end || *jp->p != ':') {
+            purc_variant_unref(k);
+            goto failed;
+        }
+        jp->p++;
+
+        purc_variant_t v = parse_value(jp);
+        if (v == PURC_VARIANT_INVALID) {
+            purc_variant_unref(k);
+            goto failed;
+        }
+
+        bool ok = purc_variant_object_set(obj, k, v);
+        purc_variant_unref(k);
+        purc_variant_unref(v);
+        if (!ok)
+            goto failed;
+
+        skip_whitespaces(jp);
+        if (jp->p >= jp->end)
+            goto failed;
+        if (*jp->p == '}') {
+            jp->p++;
+            break;
+        }
+        if (*jp->p != ',')
+            goto failed;
+        jp->p++;
+        skip_whitespaces(jp);
+    }
+
+    return obj;
+
+failed:
+    purc_variant_unref(obj);
+    return PURC_VARIANT_INVALID;
+}
+
+static purc_variant_t
+parse_value(struct json_parser *jp)
+{
+    purc_variant_t v = PURC_VARIANT_INVALID;
+
+    skip_whitespaces(jp);
+    if (jp->p >= jp->end)
+        return PURC_VARIANT_INVALID;
+
+    switch (*jp->p) {
+    case '{':
+    case '[':
+        if (jp->depth >= jp->max_depth)
+            return PURC_VARIANT_INVALID;
+
+        jp->depth++;
+        if (*jp->p == '{')
+            v = parse_object(jp);
+        else
+            v = parse_array(jp);
+        jp->depth--;
+        break;
+
+    case '"':
+        v = parse_string(jp, false);
+        break;
+
+    default:
+        if (*jp->p == '-' || purc_isdigit(*jp->p))
+            v = parse_number(jp);
+        else
+            v = parse_literal(jp);
+        break;
+    }
+
+    return v;
+}
+
+purc_variant_t
+pcejson_parse_json(const char *json, size_t len, uint32_t depth)
+{
+    struct json_parser jp = { };
+    purc_variant_t v;
+
+    jp.p = json;
+    jp.end = json + len;
+    jp.max_depth = depth;
+
+    v = parse_value(&jp);
+    free(jp.buf);
+
+    if (v != PURC_VARIANT_INVALID) {
+        // the data may be followed by a null terminator.
+        skip_whitespaces(&jp);
+        if (jp.p < jp.end && *jp.p != '\0') {
+            purc_variant_unref(v);
+            v = PURC_VARIANT_INVALID;
+        }
+    }
+
+    return v;
+}
@@ -41,7 +41,6 @@
 #endif
 
 #define ERROR_BUF_SIZE  100
-#define NR_CONSUMED_LIST_LIMIT   10
 
 #define INVALID_CHARACTER    0xFFFFFFFF
 
@@ -277,23 +276,6 @@ enum tokenizer_state {
     LAST_STATE = TKZ_STATE_EJSON_CJSONEE_FINISHED,
 };
 
-#define print_uc_list(uc_list, tag)                                         \
-    do {                                                                    \
-        PC_DEBUG( "begin print %s list\n|", tag);                           \
-        struct list_head *p, *n;                                            \
-        list_for_each_safe(p, n, uc_list) {                                 \
-            struct tkz_uc *puc = list_entry(p, struct tkz_uc, list);        \
-            PC_DEBUG( "%c", puc->character);                                \
-        }                                                                   \
-        PC_DEBUG( "|\nend print %s list\n", tag);                           \
-    } while(0)
-
-#define PRINT_CONSUMED_LIST(wrap)    \
-        print_uc_list(&wrap->consumed_list, "consumed")
-
-#define PRINT_RECONSUM_LIST(wrap)    \
-        print_uc_list(&wrap->reconsume_list, "reconsume")
-
 struct pcejson {
     int state;
     int return_state;
@@ -435,7 +417,7 @@ struct pcvcm_node *create_byte_sequenct(struct tkz_buffer *buffer)
 }
 
 #define PCEJSON_PARSER_BEGIN                                                \
-int pcejson_parse(struct pcvcm_node **vcm_tree,                             \
+static int parse_stream(struct pcvcm_node **vcm_tree,                       \
         struct pcejson **parser_param,                                      \
         purc_rwstream_t rws,                                                \
         uint32_t depth)                                                     \
@@ -2713,5 +2695,18 @@ END_STATE()
 
 
 PCEJSON_PARSER_END
+
+int pcejson_parse(struct pcvcm_node **vcm_tree,
+        struct pcejson **parser_param,
+        purc_rwstream_t rws,
+        uint32_t depth)
+{
+    int ret = parse_stream(vcm_tree, parser_param, rws, depth);
+
+    /* the caller may go on reading the stream after the value */
+    if (*parser_param)
+        tkz_reader_put_back_decoded((*parser_param)->tkz_reader);
+    return ret;
+}
 #endif
 
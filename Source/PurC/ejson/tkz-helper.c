@@ -32,6 +32,7 @@
 #include "purc-errors.h"
 #include "private/errors.h"
 #include "private/tkz-helper.h"
+#include "private/rwstream.h"
 
 #if HAVE(GLIB)
 #include <gmodule.h>
@@ -39,7 +40,19 @@
 #include <stdlib.h>
 #endif
 
-#define NR_CONSUMED_LIST_LIMIT   10
+/*
+ * The last consumed characters are kept in a ring, so that they can be
+ * reconsumed; the reconsumed ones are moved to a stack, and they are read
+ * again before the characters in the stream. Both are embedded in the
+ * reader, so that no allocation is needed for reading a character.
+ *
+ * The characters are decoded from the stream by blocks, so the stream is
+ * read ahead of the characters consumed by the tokenizer; the characters
+ * not consumed are put back to the stream by tkz_reader_put_back_decoded().
+ */
+#define NR_CONSUMED_CHARS        16     /* must be a power of 2 */
+#define CONSUMED_INDEX_MASK      (NR_CONSUMED_CHARS - 1)
+#define NR_DECODED_CHARS         256
 #define MIN_BUFFER_CAPACITY      32
 
 #if HAVE(GLIB)
@@ -52,167 +65,129 @@
 
 struct tkz_reader {
     purc_rwstream_t rws;
-    struct list_head reconsume_list;
-    struct list_head consumed_list;
-    size_t nr_consumed_list;
+
+    /* the characters decoded from the stream in a block but not read yet */
+    uint32_t decoded[NR_DECODED_CHARS];
+    size_t decoded_pos;
+    size_t nr_decoded;
+
+    /* the ring of the consumed characters; the last one is at
+       consumed[(consumed_end - 1) & CONSUMED_INDEX_MASK] */
+    struct tkz_uc consumed[NR_CONSUMED_CHARS];
+    size_t consumed_end;
+    size_t nr_consumed;
+
+    /* the stack of the characters to reconsume */
+    struct tkz_uc reconsume[NR_CONSUMED_CHARS];
+    size_t nr_reconsume;
 
     struct tkz_uc curr_uc;
     int line;
     int column;
-    int consumed;
+    int consumed_chars;
 };
 
-struct tkz_uc *tkz_uc_new(void)
-{
-    return PCHVML_ALLOC(sizeof(struct tkz_uc));
-}
-
-void tkz_uc_destroy(struct tkz_uc *uc)
-{
-    if (uc) {
-        PCHVML_FREE(uc);
-    }
-}
-
 struct tkz_reader *tkz_reader_new(void)
 {
     struct tkz_reader *reader = PCHVML_ALLOC(sizeof(struct tkz_reader));
     if (!reader) {
         return NULL;
     }
-    INIT_LIST_HEAD(&reader->reconsume_list);
-    INIT_LIST_HEAD(&reader->consumed_list);
     reader->line = 1;
     reader->column = 0;
-    reader->consumed = 0;
+    reader->consumed_chars = 0;
     return reader;
 }
 
 void tkz_reader_set_rwstream(struct tkz_reader *reader,
         purc_rwstream_t rws)
 {
+    if (reader->rws != rws) {
+        reader->decoded_pos = 0;
+        reader->nr_decoded = 0;
+    }
     reader->rws = rws;
 }
 
-static struct tkz_uc*
+static void
 tkz_reader_read_from_rwstream(struct tkz_reader *reader)
 {
-    char c[8] = {0};
     uint32_t uc = 0;
-    int nr_c = purc_rwstream_read_utf8_char(reader->rws, c, &uc);
-    if (nr_c < 0) {
-        uc = TKZ_INVALID_CHARACTER;
+    if (reader->decoded_pos == reader->nr_decoded) {
+        ssize_t nr = purc_rwstream_read_utf8_chars(reader->rws,
+                reader->decoded, NR_DECODED_CHARS);
+        reader->decoded_pos = 0;
+        if (nr < 0) {
+            reader->nr_decoded = 0;
+            uc = TKZ_INVALID_CHARACTER;
+        }
+        else {
+            reader->nr_decoded = nr;
+        }
+    }
+
+    if (reader->decoded_pos < reader->nr_decoded) {
+        uc = reader->decoded[reader->decoded_pos++];
     }
     reader->column++;
-    reader->consumed++;
+    reader->consumed_chars++;
 
     reader->curr_uc.character = uc;
     reader->curr_uc.line = reader->line;
     reader->curr_uc.column = reader->column;
-    reader->curr_uc.position = reader->consumed;
+    reader->curr_uc.position = reader->consumed_chars;
     if (uc == '\n') {
         reader->line++;
         reader->column = 0;
     }
-    return &reader->curr_uc;
-}
-
-static struct tkz_uc*
-tkz_reader_read_from_reconsume_list(struct tkz_reader *reader)
-{
-    struct tkz_uc *puc = list_entry(reader->reconsume_list.next,
-            struct tkz_uc, list);
-    reader->curr_uc = *puc;
-    list_del_init(&puc->list);
-    tkz_uc_destroy(puc);
-    return &reader->curr_uc;
-}
-
-#define print_uc_list(uc_list, tag)                                         \
-    do {                                                                    \
-        PC_DEBUG("begin print %s list\n|", tag);                            \
-        struct list_head *p, *n;                                            \
-        list_for_each_safe(p, n, uc_list) {                                 \
-            struct tkz_uc *puc = list_entry(p, struct tkz_uc, list);        \
-            PC_DEBUG("%c", puc->character);                                 \
-        }                                                                   \
-        PC_DEBUG("|\nend print %s list\n", tag);                            \
-    } while(0)
-
-#define PRINT_CONSUMED_LIST(reader)    \
-        print_uc_list(&reader->consumed_list, "consumed")
-
-#define PRINT_RECONSUM_LIST(reader)    \
-        print_uc_list(&reader->reconsume_list, "reconsume")
-
-static bool
-tkz_reader_add_consumed(struct tkz_reader *reader, struct tkz_uc *uc)
-{
-    struct tkz_uc *p = tkz_uc_new();
-    if (!p) {
-        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
-        return false;
-    }
-
-    *p = *uc;
-    list_add_tail(&p->list, &reader->consumed_list);
-    reader->nr_consumed_list++;
-
-    if (reader->nr_consumed_list > NR_CONSUMED_LIST_LIMIT) {
-        struct tkz_uc *first = list_first_entry(
-                &reader->consumed_list, struct tkz_uc, list);
-        list_del_init(&first->list);
-        tkz_uc_destroy(first);
-        reader->nr_consumed_list--;
-    }
-    return true;
 }
 
 bool tkz_reader_reconsume_last_char(struct tkz_reader *reader)
 {
-    if (!reader->nr_consumed_list) {
+    if (!reader->nr_consumed) {
         return true;
     }
 
-    struct tkz_uc *last = list_last_entry(
-            &reader->consumed_list, struct tkz_uc, list);
-    list_del_init(&last->list);
-    reader->nr_consumed_list--;
-
-    list_add(&last->list, &reader->reconsume_list);
+    /* the consumed and the reconsumed are never more than the ring holds */
+    reader->consumed_end--;
+    reader->nr_consumed--;
+    reader->reconsume[reader->nr_reconsume++] =
+        reader->consumed[reader->consumed_end & CONSUMED_INDEX_MASK];
     return true;
 }
 
 struct tkz_uc *tkz_reader_next_char(struct tkz_reader *reader)
 {
-    struct tkz_uc *ret = NULL;
-    if (list_empty(&reader->reconsume_list)) {
-        ret = tkz_reader_read_from_rwstream(reader);
+    if (reader->nr_reconsume) {
+        reader->curr_uc = reader->reconsume[--reader->nr_reconsume];
     }
     else {
-        ret = tkz_reader_read_from_reconsume_list(reader);
+        tkz_reader_read_from_rwstream(reader);
     }
 
-    if (tkz_reader_add_consumed(reader, ret)) {
-        return ret;
+    reader->consumed[reader->consumed_end & CONSUMED_INDEX_MASK] =
+        reader->curr_uc;
+    reader->consumed_end++;
+    if (reader->nr_consumed < NR_CONSUMED_CHARS)
+        reader->nr_consumed++;
+
+    return &reader->curr_uc;
+}
+
+void tkz_reader_put_back_decoded(struct tkz_reader *reader)
+{
+    if (reader->rws && reader->decoded_pos < reader->nr_decoded) {
+        pcrwstream_unread_utf8_chars(reader->rws,
+                reader->decoded + reader->decoded_pos,
+                reader->nr_decoded - reader->decoded_pos);
     }
-    return NULL;
+    reader->decoded_pos = 0;
+    reader->nr_decoded = 0;
 }
 
 void tkz_reader_destroy(struct tkz_reader *reader)
 {
     if (reader) {
-        struct list_head *p, *n;
-        list_for_each_safe(p, n, &reader->reconsume_list) {
-            struct tkz_uc *puc = list_entry(p, struct tkz_uc, list);
-            list_del_init(&puc->list);
-            tkz_uc_destroy(puc);
-        }
-        list_for_each_safe(p, n, &reader->consumed_list) {
-            struct tkz_uc *puc = list_entry(p, struct tkz_uc, list);
-            list_del_init(&puc->list);
-            tkz_uc_destroy(puc);
-        }
         PCHVML_FREE(reader);
     }
 }
@@ -500,6 +500,28 @@ exe_range_reduce(purc_exec_inst_t inst, const char* rule)
         return false;
     }
 
+    struct range_rule *range = &exe_range_inst->param.rule;
+    if (it && (!isfinite(range->advance) || range->advance >= 1)) {
+        // the selected members are evenly spaced in the result set.
+        struct purc_variant_numeric_stat stat;
+        variant_arr_t data;
+        size_t stride, last;
+
+        data = variant_array_get_data(exe_range_inst->result_set);
+        stride = isfinite(range->advance) ? (size_t)range->advance : 1;
+        last = data->nr - 1;
+        if (isfinite(range->to) && range->to < last)
+            last = (size_t)range->to;
+
+        pcvariant_numeric_stat(data->vals + it->curr,
+                (last - it->curr) / stride + 1, stride, &stat);
+        count = stat.count;
+        sum = stat.sum;
+        max = stat.max;
+        min = stat.min;
+        it = NULL;
+    }
+
     for(; it; it = it_next(exe_range_inst, NULL)) {
         purc_variant_t v = it_value(exe_range_inst);
         double d = purc_variant_numberify(v);
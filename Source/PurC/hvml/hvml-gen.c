@@ -406,6 +406,11 @@ pcvdom_gen_end(struct pcvdom_gen *gen)
 {
     struct pcvdom_document *doc = gen->doc;
     gen->doc  = NULL; // transfer ownership
+
+    if (doc) {
+        pcvdom_document_fold_constants(doc);
+        pcvdom_document_compile_vcm(doc);
+    }
     gen->curr = NULL;
 
     gen->eof = 1;
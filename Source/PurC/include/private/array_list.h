@@ -173,6 +173,12 @@ pcutils_array_list_remove(struct pcutils_array_list *al,
         size_t idx,
         struct pcutils_array_list_node **old);
 
+// removes all the nodes for which `pred` returns true, keeping the order
+// of the others; returns the number of the nodes removed
+size_t
+pcutils_array_list_remove_if(struct pcutils_array_list *al,
+        bool (*pred)(struct pcutils_array_list_node *node, void *ud), void *ud);
+
 struct pcutils_array_list_node*
 pcutils_array_list_get(struct pcutils_array_list *al,
         size_t idx);
@@ -62,6 +62,47 @@ void pcejson_reset (struct pcejson* parser, uint32_t depth, uint32_t flags);
 int pcejson_parse (struct pcvcm_node** vcm_tree, struct pcejson** parser,
                    purc_rwstream_t rwstream, uint32_t depth);
 
+/*
+ * Parse strict JSON in a buffer into a variant directly, without the
+ * VCM tree. Returns PURC_VARIANT_INVALID if the data is not strict JSON
+ * (including the strings need to be evaluated by eJSON) or any error
+ * occurred; the caller should fall back to pcejson_parse() then.
+ */
+purc_variant_t pcejson_parse_json (const char *json, size_t len,
+                   uint32_t depth);
+
+/*
+ * The push interface of the parser: the data can be fed in chunks split
+ * at any byte, and the callback is called with each top-level value once
+ * it is complete. The callback does not own the value; it returns false
+ * to stop the parsing.
+ *
+ * By default, the top-level values are the containers, or the scalars
+ * separated by whitespaces. With PCEJSON_FEED_FLAG_NDJSON, every line
+ * holds one value (newline-delimited JSON).
+ */
+#define PCEJSON_FEED_FLAG_NDJSON    0x0001
+
+struct pcejson_feeder;
+
+typedef bool (*pcejson_value_cb) (void *ctxt, purc_variant_t value);
+
+struct pcejson_feeder* pcejson_feeder_create (uint32_t depth, uint32_t flags,
+                   pcejson_value_cb cb, void *ctxt);
+
+void pcejson_feeder_destroy (struct pcejson_feeder* feeder);
+
+/*
+ * Feed a chunk of data. Returns PCEJSON_SUCCESS, or -1 if the data is bad
+ * or the callback stopped the parsing.
+ */
+int pcejson_feed (struct pcejson_feeder* feeder, const char *buf, size_t len);
+
+/*
+ * Tell the end of the data, so the pending top-level scalar is complete.
+ */
+int pcejson_feed_end (struct pcejson_feeder* feeder);
+
 #ifdef __cplusplus
 }
 #endif  /* __cplusplus */
@@ -118,6 +118,12 @@ struct pcintr_heap {
     purc_cond_handler    cond_handler;
     unsigned int         keep_alive:1;
     double               timestamp;
+
+    // the values of the folded vcm nodes evaluated by this instance
+    struct pcvcm_consts  *vcm_consts;
+
+    // bumped whenever a variable manager of this instance changes
+    uint64_t              vars_gen;
 };
 
 struct pcintr_stack_frame;
@@ -548,6 +554,23 @@ pcintr_get_scope_variable(purc_coroutine_t cor, pcvdom_element_t elem,
 purc_variant_t
 pcintr_find_named_var(pcintr_stack_t stack, const char* name);
 
+/*
+ * The variable found at the coroutine or the runner level by a reference,
+ * which is valid until any variable manager of the instance changes; the
+ * value is not referenced.
+ */
+struct pcintr_var_cache {
+    purc_coroutine_t    co;
+    uint64_t            gen;
+    purc_variant_t      value;
+};
+
+/* the same as pcintr_find_named_var(), with the name interned as an atom
+   and an optional cache */
+purc_variant_t
+pcintr_find_named_var_by_atom(pcintr_stack_t stack, purc_atom_t name,
+        struct pcintr_var_cache *cache);
+
 purc_variant_t
 pcintr_get_symbolized_var (pcintr_stack_t stack, unsigned int number,
         char symbol);
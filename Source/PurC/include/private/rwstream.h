@@ -25,5 +25,30 @@
 #ifndef PURC_PRIVATE_RWSTREAM_H
 #define PURC_PRIVATE_RWSTREAM_H
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include "purc-rwstream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  /* __cplusplus */
+
+/*
+ * Puts the characters decoded by the last call of
+ * purc_rwstream_read_utf8_chars() but not used by the caller back to the
+ * stream, so that they are read again by the next read. The characters
+ * must be the tail of the ones returned by the call.
+ *
+ * Returns 0 on success, or -1 if the characters can not be put back.
+ */
+int
+pcrwstream_unread_utf8_chars (purc_rwstream_t rws, const uint32_t* chars,
+        size_t nr);
+
+#ifdef __cplusplus
+}
+#endif  /* __cplusplus */
+
 #endif /* not defined PURC_PRIVATE_RWSTREAM_H */
 
@@ -43,7 +43,6 @@
 
 struct tkz_reader;
 struct tkz_uc {
-    struct list_head list;
     uint32_t character;
     int line;
     int column;
@@ -250,6 +249,10 @@ struct tkz_uc *tkz_reader_next_char(struct tkz_reader *reader);
 
 bool tkz_reader_reconsume_last_char(struct tkz_reader *reader);
 
+/* puts the characters decoded from the stream but not consumed yet back
+   to the stream; call it before the stream is used by others */
+void tkz_reader_put_back_decoded(struct tkz_reader *reader);
+
 void tkz_reader_destroy(struct tkz_reader *reader);
 
 
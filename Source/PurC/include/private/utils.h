@@ -231,6 +231,41 @@ int pcutils_parse_uint64(const char *buf, size_t len, uint64_t *retval);
 int pcutils_parse_double(const char *buf, size_t len, double *retval);
 int pcutils_parse_long_double(const char *buf, size_t len, long double *retval);
 
+#define PCUTILS_DTOA_MAX_DIGITS     17
+
+/*
+ * Converts a finite double to the shortest decimal digits which round-trip,
+ * with the position of the decimal point relative to the first digit
+ * (the value is 0.DIGITS * 10^point). The buffer for the digits must have
+ * PCUTILS_DTOA_MAX_DIGITS + 1 bytes; returns the number of the digits.
+ */
+size_t pcutils_dtoa_shortest(double d, char *digits, bool *negative,
+        int *point) WTF_INTERNAL;
+
+/*
+ * The word-at-a-time (SWAR) tests for the bytes in a 64-bit word; the
+ * results are nonzero if any byte matches. The one for `less than` works
+ * for the bytes not greater than 0x80.
+ */
+#define PCUTILS_SWAR_ONES           0x0101010101010101ULL
+#define PCUTILS_SWAR_HIGHS          0x8080808080808080ULL
+
+static inline uint64_t pcutils_swar_has_zero_byte(uint64_t w)
+{
+    return (w - PCUTILS_SWAR_ONES) & ~w & PCUTILS_SWAR_HIGHS;
+}
+
+static inline uint64_t pcutils_swar_has_byte(uint64_t w, unsigned char c)
+{
+    return pcutils_swar_has_zero_byte(w ^ (PCUTILS_SWAR_ONES * c));
+}
+
+static inline uint64_t
+pcutils_swar_has_byte_less_than(uint64_t w, unsigned char c)
+{
+    return (w - PCUTILS_SWAR_ONES * c) & ~w & PCUTILS_SWAR_HIGHS;
+}
+
 struct pcutils_mystring {
     char *buff;
     size_t nr_bytes;
@@ -40,6 +40,8 @@ PCA_EXTERN_C_BEGIN
 #define PCVARIANT_FLAG_NOFREE          PCVARIANT_FLAG_CONSTANT
 #define PCVARIANT_FLAG_EXTRA_SIZE      (0x01 << 1)  // when use extra space
 #define PCVARIANT_FLAG_STRING_STATIC   (0x01 << 2)  // make_string_static
+#define PCVARIANT_FLAG_LISTENED       (0x01 << 3)  // having listeners
+#define PCVARIANT_FLAG_FROZEN         (0x01 << 4)  // in the frozen heap
 
 #define PVT(t)          (PURC_VARIANT_TYPE##t)
 #define IS_CONTAINER(t) (t == PURC_VARIANT_TYPE_OBJECT || \
@@ -77,6 +79,11 @@ PCA_EXTERN_C_BEGIN
 #define PCVAR_LISTENER_PRE   (0x00)
 #define PCVAR_LISTENER_POST  (0x01)
 
+/* The listeners are not stored in the variants, because only a few
+   containers have them. Instead, the variants having listeners are
+   flagged with PCVARIANT_FLAG_LISTENED, and the lists of listeners are
+   kept in a table of the instance, keyed by the addresses of the
+   variants. */
 struct pcvar_listener {
     // the operation in which this listener is intersted.
     pcvar_op_t          op;
@@ -111,16 +118,12 @@ struct purc_variant {
     /* reference count */
     unsigned int refc;
 
+    /* value */
     union {
-        /* the list head for listeners. */
-        struct list_head    listeners;
-
-        /* the list node for reserved variants. */
+        /* the list node for reserved variants; a reserved variant
+           has no value. */
         struct list_head    reserved;
-    };
 
-    /* value */
-    union {
         /* for boolean */
         bool        b;
 
@@ -190,6 +193,60 @@ struct purc_variant {
 
 #define MAX_RESERVED_VARIANTS           32
 #define USE_LOOP_BUFFER_FOR_RESERVED    0
+#define USE_SLAB_FOR_VARIANTS           1
+
+/* On 64-bit platforms, the extra field of a string is split into two
+   double words: extra_dwords[0] stores the number of characters and
+   extra_dwords[1] caches the hash value of the string (0 if not calculated
+   yet). If a string has UINT32_MAX or more characters, extra_dwords[0]
+   is UINT32_MAX, and the number will be counted on demand. */
+#if CPU(ADDRESS64)
+#define USE_HASH_CACHE_FOR_STRINGS      1
+#endif
+
+/* The numbers, long integers and unsigned long integers having small
+   integral values are shared by the heap like null and booleans, so that
+   making them does not allocate anything. The shared values are allocated
+   on demand, and they are not counted in the statistics of the heap. */
+#define USE_SHARED_SMALL_INTEGERS       1
+#define PCVARIANT_MIN_SHARED_INT        (-128)
+#define PCVARIANT_MAX_SHARED_INT        1023
+#define PCVARIANT_NR_SHARED_INTS        \
+    (PCVARIANT_MAX_SHARED_INT - PCVARIANT_MIN_SHARED_INT + 1)
+
+/* A clone of an array or an object shares the storage of the members with
+   the source until one of them is going to change the members; the first
+   change splits the storage. The containers which belong to sets are always
+   cloned member by member, for the storage carries the reverse update nodes
+   of the members. */
+#define USE_COW_CONTAINER_CLONES        1
+
+/* The slab pages are aligned to their size, so that we can locate the page
+   of a slot by masking the address of the slot. */
+#define PCVARIANT_SLAB_PAGE_SIZE        (16 * 1024)
+#define PCVARIANT_SLAB_SLOT_ALIGN       16
+#define PCVARIANT_SLAB_NR_CLASSES       8       // 16, 32, ..., 128 bytes
+#define PCVARIANT_SLAB_MAX_SLOT_SIZE    \
+    (PCVARIANT_SLAB_SLOT_ALIGN * PCVARIANT_SLAB_NR_CLASSES)
+
+/* The hash values of the object keys looked up by atoms are cached by
+   the heap in a direct-mapped table, so that the lookup in an indexed
+   object does not hash the key string again. */
+#define PCVARIANT_NR_ATOM_HASHES        64
+
+struct pcvariant_atom_hash {
+    purc_atom_t         atom;
+    uint32_t            hash;
+};
+
+struct pcvariant_slab_class {
+    // the pages which have at least one free slot.
+    struct list_head    partial;
+    // the pages which have no free slot.
+    struct list_head    full;
+    // the number of pages in this class.
+    size_t              nr_pages;
+};
 
 struct pcvariant_heap {
     // the constant values.
@@ -198,9 +255,27 @@ struct pcvariant_heap {
     struct purc_variant v_false;
     struct purc_variant v_true;
 
+#if USE(SHARED_SMALL_INTEGERS)
+    // the shared numbers, long integers, and unsigned long integers.
+    struct purc_variant *v_ints[3];
+#endif
+
+    // the lists of listeners (struct list_head *) keyed by the variants.
+    struct pchash_table *listeners;
+
+    // the nesting level of the mutation batches, the changed containers
+    // whose sets are to be adjusted at the end of the outermost batch, and
+    // the changes of the sets whose listeners are to be told then.
+    unsigned int        batch_level;
+    pcutils_map        *batch_changed;
+    pcutils_map        *batch_set_changes;
+
     // the statistics of memory usage of variant values
     struct purc_variant_stat stat;
 
+    // the hash values of the object keys, cached by the atoms.
+    struct pcvariant_atom_hash atom_hashes[PCVARIANT_NR_ATOM_HASHES];
+
 #if USE(LOOP_BUFFER_FOR_RESERVED)
     // the loop buffer for reserved values.
     purc_variant_t      v_reserved[MAX_RESERVED_VARIANTS];
@@ -209,14 +284,37 @@ struct pcvariant_heap {
 #else
     struct list_head    v_reserved;
 #endif
+
+#if USE(SLAB_FOR_VARIANTS)
+    // the size-class pages of the slab allocator.
+    struct pcvariant_slab_class slab[PCVARIANT_SLAB_NR_CLASSES];
+#endif
 };
 
-// internal interfaces for moving variant.
-purc_variant_t pcvariant_move_heap_in(purc_variant_t v) WTF_INTERNAL;
-purc_variant_t pcvariant_move_heap_out(purc_variant_t v) WTF_INTERNAL;
+// internal interfaces for the slab allocator of a variant heap.
+void pcvariant_slab_init(struct pcvariant_heap *heap) WTF_INTERNAL;
+void pcvariant_slab_cleanup(struct pcvariant_heap *heap) WTF_INTERNAL;
+void *pcvariant_slab_alloc(struct pcvariant_heap *heap,
+        size_t size) WTF_INTERNAL;
+void pcvariant_slab_free(struct pcvariant_heap *heap, void *ptr) WTF_INTERNAL;
+void pcvariant_slab_stat(struct pcvariant_heap *heap,
+        struct purc_variant_stat *stat) WTF_INTERNAL;
+
+// internal interfaces for moving variant; every move buffer has a move heap.
+struct pcvariant_move_heap;
+
+struct pcvariant_move_heap *pcvariant_move_heap_new(void) WTF_INTERNAL;
+void pcvariant_move_heap_delete(struct pcvariant_move_heap *mvheap)
+    WTF_INTERNAL;
 
-void pcvariant_use_move_heap(void) WTF_INTERNAL;
-void pcvariant_use_norm_heap(void) WTF_INTERNAL;
+purc_variant_t pcvariant_move_heap_in(struct pcvariant_move_heap *mvheap,
+        purc_variant_t v) WTF_INTERNAL;
+purc_variant_t pcvariant_move_heap_out(struct pcvariant_move_heap *mvheap,
+        purc_variant_t v) WTF_INTERNAL;
+
+// release the variants in the move heap between the two calls.
+void pcvariant_use_move_heap(struct pcvariant_move_heap *mvheap) WTF_INTERNAL;
+void pcvariant_use_norm_heap(struct pcvariant_move_heap *mvheap) WTF_INTERNAL;
 
 purc_variant *pcvariant_alloc(void) WTF_INTERNAL;
 purc_variant *pcvariant_alloc_0(void) WTF_INTERNAL;
@@ -238,10 +336,10 @@ struct pcvar_rev_update_edge {
 typedef struct variant_set      *variant_set_t;
 
 struct set_node {
-    struct rb_node                       rbnode;
     struct pcutils_array_list_node       alnode;
     purc_variant_t   val;  // actual variant-element
-    char             md5[33];
+    uint64_t         hash; // see pcvariant_hash64_by_set()
+    size_t           ord;  // the position in the ordered view
 };
 
 struct variant_set {
@@ -249,9 +347,17 @@ struct variant_set {
     const char            **keynames;
     size_t                  nr_keynames;
     bool                    caseless;
-    struct rb_root          elems;  // multiple-variant-elements stored in set
+    bool                    ordered;    // whether `order` is up to date
     struct pcutils_array_list al;    // struct set_node
 
+    // open-addressing hash table of the elements keyed on their hashes
+    struct set_node       **index;
+    size_t                  sz_index;   // always a power of 2
+
+    // the elements sorted by comparing, built on demand
+    struct set_node       **order;
+    size_t                  sz_order;
+
     // key: arr_node/obj_node/set_node
     // val: parent
     pcutils_map                     *rev_update_chain;
@@ -260,15 +366,45 @@ struct variant_set {
 // internal struct used by variant-obj object
 typedef struct variant_obj      *variant_obj_t;
 
+/* The members are stored in a dense vector in the order of insertion.
+   Removing a member leaves a hole (the key is PURC_VARIANT_INVALID) which
+   will be squeezed out when the vector is going to grow.
+
+   The objects which have used PCVAR_OBJ_MIN_INDEXED slots or more are
+   indexed by an open-addressing hash table; the smaller ones are scanned
+   linearly. The node of a member is only materialized when the object
+   belongs to a set, for it is the key of the reverse update edge. */
+#define PCVAR_OBJ_MIN_INDEXED           8
+
 struct obj_node {
-    struct rb_node   node;
+    size_t           idx;   // the index of the member in kvs
+};
+
+struct obj_kv {
     purc_variant_t   key;
     purc_variant_t   val;
+    struct obj_node *node;
+    uint32_t         hash;  // the hash value of the key
+    purc_atom_t      atom;  // the atom of the key if known, or 0
 };
 
 struct variant_obj {
-    struct rb_root          kvs;  // struct obj_node*
-    size_t                  size;
+    struct obj_kv          *kvs;        // the slots of the members
+    size_t                  nr_kvs;     // the number of the used slots
+    size_t                  sz_kvs;     // the capacity of kvs
+    size_t                  size;       // the number of the members
+    size_t                  nr_nodes;   // the number of the nodes
+
+    // NULL or the hash table of (the index of a slot + 1); 0 for empty.
+    uint32_t               *index;
+    size_t                  sz_index;   // always a power of 2
+
+    // NULL or the number of the objects sharing kvs and index.
+    size_t                 *cow;
+
+    // 0 or the stamp of the members for the inline caches; see
+    // pcvar_obj_stamp().
+    uint64_t                stamp;
 
     // key: arr_node/obj_node/set_node
     // val: parent
@@ -278,13 +414,23 @@ struct variant_obj {
 // internal struct used by variant-arr
 typedef struct variant_arr      *variant_arr_t;
 
+/* The member values are stored in a contiguous vector. The nodes are only
+   materialized when the array belongs to a set, for they are the keys of
+   the reverse update edges of the members. */
 struct arr_node {
-    struct pcutils_array_list_node       node;
-    purc_variant_t   val;
+    size_t           idx;
 };
 
 struct variant_arr {
-    struct pcutils_array_list     al;  // struct arr_node*
+    purc_variant_t         *vals;   // the member values
+    size_t                  nr;     // the number of the member values
+    size_t                  sz;     // the capacity of vals (and nodes)
+
+    // NULL or parallel to vals; see above.
+    struct arr_node       **nodes;
+
+    // NULL or the number of the arrays sharing vals.
+    size_t                 *cow;
 
     // key: arr_node/obj_node/set_node
     // val: parent
@@ -297,6 +443,8 @@ struct variant_arr {
 
 int pcvariant_array_sort(purc_variant_t value, void *ud,
         int (*cmp)(purc_variant_t l, purc_variant_t r, void *ud));
+// swap two members of an array silently.
+int pcvariant_array_swap(purc_variant_t value, size_t i, size_t j);
 int pcvariant_set_sort(purc_variant_t value, void *ud,
         int (*cmp)(purc_variant_t l, purc_variant_t r, void *ud));
 
@@ -352,8 +500,23 @@ char* pcvariant_serialize_alloc(char *buf, size_t sz, purc_variant_t val);
 
 char* pcvariant_to_string(purc_variant_t v);
 
+/* estimates the size of the buffer for serializing a variant. */
+size_t pcvariant_serialize_size_hint(purc_variant_t value,
+        unsigned int flags) WTF_INTERNAL;
+
 purc_variant_t pcvariant_make_object(size_t nr_kvs, ...);
 
+/* the same as purc_variant_object_get_by_atom(), but no error is set if
+   the object has no such member, for the lookups which may miss often. */
+purc_variant_t
+pcvariant_object_get_by_atom_quietly(purc_variant_t obj, purc_atom_t key);
+
+/* Returns the stamp of the members of an object for the inline caches of
+   the lookups; the stamp is dropped whenever a member is added, removed or
+   replaced, and no stamp is given twice in the process. Returns 0 for a
+   frozen object, which may be read by the other instances. */
+uint64_t pcvar_obj_stamp(purc_variant_t obj);
+
 WTF_ATTRIBUTE_PRINTF(1, 2)
 purc_variant_t pcvariant_make_with_printf(const char *fmt, ...);
 
@@ -415,6 +578,12 @@ purc_variant_t *tuple_members(purc_variant_t tuple, size_t *sz)
     return tuple->vrt_vrt;
 }
 
+/* summarizes `nr` members starting from `members` with the stride `stride`
+   as numbers; see purc_variant_linear_container_numeric_stat(). */
+void
+pcvariant_numeric_stat(const purc_variant_t *members, size_t nr,
+        size_t stride, struct purc_variant_numeric_stat *stat) WTF_INTERNAL;
+
 // md5 shall be at least 33 bytes long
 void pcvariant_md5_ex(char *md5, purc_variant_t val, const char *salt,
     bool caseless, unsigned int serialize_flags) WTF_INTERNAL;
@@ -428,14 +597,28 @@ pcvariant_md5(char *md5, purc_variant_t val)
     pcvariant_md5_ex(md5, val, salt, caseless, serialize_flags);
 }
 
-// md5 shall be at least 33 bytes long
-void
-pcvariant_md5_by_set(char *md5, purc_variant_t val,
-        purc_variant_t set) WTF_INTERNAL;
-
-int
-pcvariant_diff_by_set(const char *md5l, purc_variant_t l,
-        const char *md5r, purc_variant_t r, purc_variant_t set);
+/* The structural hash of a variant, which walks the variant directly
+   without serializing it. Two variants which are equal according to
+   pcvar_compare_ex(l, r, caseless, true) have the same hash value. */
+uint64_t
+pcvariant_hash64(purc_variant_t val, bool caseless) WTF_INTERNAL;
+
+/* The hash value of an element of the set: the structural hash of
+   the element for a generic set, or the combined hash of the values
+   of the unique keys. */
+uint64_t
+pcvariant_hash64_by_set(purc_variant_t val, purc_variant_t set) WTF_INTERNAL;
+
+/* The same hash value as pcvariant_hash64_by_set() of the elements having
+   the given values of the unique keys; undefined stands for a missing key. */
+uint64_t
+pcvariant_hash64_by_key_values(purc_variant_t set,
+        purc_variant_t *kvs) WTF_INTERNAL;
+
+/* Gets the elements of a set in the order of comparing; the result is
+   cached in the set until the set changes. */
+struct set_node**
+pcvar_set_ordered_nodes(purc_variant_t set, size_t *nr) WTF_INTERNAL;
 
 PCA_EXTERN_C_END
 
@@ -450,79 +633,66 @@ PCA_EXTERN_C_END
 
 // purc_variant_t _arr;
 #define variant_array_get_data(_arr)        \
-    &(((variant_arr_t)_arr->sz_ptr[1])->al)
-
-// purc_variant_t _arr;
-// struct arr_node *_p;
-#define foreach_in_variant_array(_arr, _p)                               \
-    array_list_for_each_entry(variant_array_get_data(_arr),              \
-            _p, node)
-
-// purc_variant_t _arr;
-// struct arr_node *_p, *_n;
-#define foreach_in_variant_array_safe(_arr, _p, _n)                      \
-    array_list_for_each_entry_safe(variant_array_get_data(_arr),         \
-            _p, _n, node)
-
-// purc_variant_t _arr;
-// struct arr_node *_p;
-#define foreach_in_variant_array_reverse(_arr, _p)                       \
-    array_list_for_each_entry_reverse(variant_array_get_data(_arr),      \
-            _p, node)
-
-// purc_variant_t _arr;
-// struct arr_node *_p, *_n;
-#define foreach_in_variant_array_reverse_safe(_arr, _p, _n)              \
-    array_list_for_each_entry_reverse_safe(variant_array_get_data(_arr), \
-            _p, _n, node)
+    ((variant_arr_t)_arr->sz_ptr[1])
 
+// purc_variant_t _arr, _val;
+// size_t _idx;
+// purc_variant_t *_p; /* the slot of _val */
 #define foreach_value_in_variant_array(_arr, _val, _idx)              \
     do {                                                              \
-        struct arr_node *_p;                                          \
-        foreach_in_variant_array(_arr, _p) {                          \
-            _val = _p->val;                                           \
-            _idx = _p->node.idx;                                      \
+        variant_arr_t _data = variant_array_get_data(_arr);           \
+        purc_variant_t *_p;                                           \
+        size_t _i;                                                    \
+        for (_i = 0; _i < _data->nr; _i++) {                          \
+            _p = _data->vals + _i;                                    \
+            _val = *_p;                                               \
+            _idx = _i;                                                \
      /* } */                                                          \
  /* } while (0) */
 
+// the current member can be removed in the iteration.
 #define foreach_value_in_variant_array_safe(_arr, _val, _idx)      \
     do {                                                           \
-        struct arr_node *_p, *_n;                                  \
-        foreach_in_variant_array_safe(_arr, _p, _n) {              \
-            _val = _p->val;                                        \
-            _idx = _p->node.idx;                                   \
+        variant_arr_t _data = variant_array_get_data(_arr);        \
+        purc_variant_t *_p;                                        \
+        size_t _i, _nr;                                            \
+        for (_i = 0; (_nr = _data->nr, _i < _nr);                  \
+             _i = (_data->nr < _nr) ? _i : _i + 1) {               \
+            _p = _data->vals + _i;                                 \
+            _val = *_p;                                            \
+            _idx = _i;                                             \
      /* } */                                                       \
  /* } while (0) */
 
 #define foreach_value_in_variant_array_reverse(_arr, _val, _idx)      \
     do {                                                              \
-        struct arr_node *_p;                                          \
-        foreach_in_variant_array_reverse(_arr, _p) {                  \
-            _val = _p->val;                                           \
-            _idx = _p->node.idx;                                      \
+        variant_arr_t _data = variant_array_get_data(_arr);           \
+        purc_variant_t *_p;                                           \
+        size_t _i;                                                    \
+        for (_i = _data->nr; _i > 0; _i--) {                          \
+            if (_i > _data->nr)                                       \
+                continue;                                             \
+            _p = _data->vals + _i - 1;                                \
+            _val = *_p;                                               \
+            _idx = _i - 1;                                            \
      /* } */                                                          \
  /* } while (0) */
 
+// removing the current member does not move the members before it.
 #define foreach_value_in_variant_array_reverse_safe(_arr, _val, _idx)   \
-    do {                                                                \
-        struct arr_node *_p, *_n;                                       \
-        foreach_in_variant_array_reverse_safe(_arr, _p, _n) {           \
-            _val = _p->val;                                             \
-            _idx = _p->node.idx;                                        \
-     /* } */                                                            \
- /* } while (0) */
+    foreach_value_in_variant_array_reverse(_arr, _val, _idx)
 
 #define foreach_value_in_variant_object(_obj, _val)                 \
     do {                                                            \
         variant_obj_t _data;                                        \
         _data = (variant_obj_t)_obj->sz_ptr[1];                     \
-        struct rb_root *_root = &_data->kvs;                        \
-        struct rb_node *_p = pcutils_rbtree_first(_root);           \
-        for (; _p; _p = pcutils_rbtree_next(_p))                    \
-        {                                                           \
-            struct obj_node *_node;                                 \
-            _node = container_of(_p, struct obj_node, node);        \
-            _val = _node->val;                                      \
+        struct obj_kv *_kv;                                         \
+        size_t _i;                                                  \
+        for (_i = 0; _i < _data->nr_kvs; _i++) {                    \
+            _kv = _data->kvs + _i;                                  \
+            if (_kv->key == PURC_VARIANT_INVALID)                   \
+                continue;                                           \
+            _val = _kv->val;                                        \
      /* } */                                                        \
  /* } while (0) */
 
@@ -530,33 +700,20 @@ PCA_EXTERN_C_END
     do {                                                            \
         variant_obj_t _data;                                        \
         _data = (variant_obj_t)_obj->sz_ptr[1];                     \
-        struct rb_root *_root = &_data->kvs;                        \
-        struct rb_node *_p = pcutils_rbtree_first(_root);           \
-        for (; _p; _p = pcutils_rbtree_next(_p))                    \
-        {                                                           \
-            struct obj_node *_node;                                 \
-            _node = container_of(_p, struct obj_node, node);        \
-            _key = _node->key;                                      \
-            _val = _node->val;                                      \
+        struct obj_kv *_kv;                                         \
+        size_t _i;                                                  \
+        for (_i = 0; _i < _data->nr_kvs; _i++) {                    \
+            _kv = _data->kvs + _i;                                  \
+            if (_kv->key == PURC_VARIANT_INVALID)                   \
+                continue;                                           \
+            _key = _kv->key;                                        \
+            _val = _kv->val;                                        \
      /* } */                                                        \
  /* } while (0) */
 
+// removing a member does not move the other members.
 #define foreach_in_variant_object_safe_x(_obj, _key, _val)          \
-    do {                                                            \
-        variant_obj_t _data;                                        \
-        _data = (variant_obj_t)_obj->sz_ptr[1];                     \
-        struct rb_root *_root = &_data->kvs;                        \
-        struct rb_node *_p, *_next;                                 \
-        for (_p = pcutils_rbtree_first(_root);                      \
-            ({_next = _p ? pcutils_rbtree_next(_p) : NULL; _p;});   \
-            _p = _next)                                             \
-        {                                                           \
-            struct obj_node *_node;                                 \
-            _node = container_of(_p, struct obj_node, node);        \
-            _key = _node->key;                                      \
-            _val = _node->val;                                      \
-     /* } */                                                        \
- /* } while (0) */
+    foreach_key_value_in_variant_object(_obj, _key, _val)
 
 #define foreach_value_in_variant_set(_set, _val)                        \
     do {                                                                \
@@ -628,73 +785,33 @@ PCA_EXTERN_C_END
      /* } */                                                                  \
   /* } while (0) */
 
+// the elements are visited in the order of comparing.
 #define foreach_value_in_variant_set_order(_set, _val)                  \
     do {                                                                \
-        variant_set_t _data;                                            \
-        struct rb_node *_first;                                         \
-        _data = (variant_set_t)_set->sz_ptr[1];                         \
-        _first = pcutils_rbtree_first(&_data->elems);                   \
-        if (!_first)                                                    \
-            break;                                                      \
-        struct rb_node *_p;                                             \
-        pcutils_rbtree_for_each(_first, _p)                             \
-        {                                                               \
-            struct set_node *_sn;                                       \
-            _sn = container_of(_p, struct set_node, rbnode);            \
-            _val = _sn->val;                                            \
+        struct set_node **_nodes;                                       \
+        size_t _nr, _i;                                                 \
+        _nodes = pcvar_set_ordered_nodes(_set, &_nr);                   \
+        for (_i = 0; _i < _nr; _i++) {                                  \
+            _val = _nodes[_i]->val;                                     \
      /* } */                                                            \
   /* } while (0) */
 
 #define foreach_value_in_variant_set_order_reverse(_set, _val)          \
     do {                                                                \
-        variant_set_t _data;                                            \
-        struct rb_node *_first;                                         \
-        _data = (variant_set_t)_set->sz_ptr[1];                         \
-        _first = pcutils_rbtree_last(&_data->elems);                    \
-        if (!_first)                                                    \
-            break;                                                      \
-        struct rb_node *_p;                                             \
-        pcutils_rbtree_for_each_reverse(_first, _p)                     \
-        {                                                               \
-            struct set_node *_sn;                                       \
-            _sn = container_of(_p, struct set_node, rbnode);            \
-            _val = _sn->val;                                            \
+        struct set_node **_nodes;                                       \
+        size_t _nr, _i;                                                 \
+        _nodes = pcvar_set_ordered_nodes(_set, &_nr);                   \
+        for (_i = _nr; _i > 0; _i--) {                                  \
+            _val = _nodes[_i - 1]->val;                                 \
      /* } */                                                            \
   /* } while (0) */
 
+// removing the current element does not change the ordered nodes.
 #define foreach_value_in_variant_set_order_safe(_set, _val)             \
-    do {                                                                \
-        variant_set_t _data;                                            \
-        struct rb_node *_first;                                         \
-        _data = (variant_set_t)_set->sz_ptr[1];                         \
-        _first = pcutils_rbtree_first(&_data->elems);                   \
-        if (!_first)                                                    \
-            break;                                                      \
-        struct rb_node *_p, *_n;                                        \
-        pcutils_rbtree_for_each_safe(_first, _p, _n)                    \
-        {                                                               \
-            struct set_node *_sn;                                       \
-            _sn = container_of(_p, struct set_node, rbnode);            \
-            _val = _sn->val;                                            \
-     /* } */                                                            \
-  /* } while (0) */
+    foreach_value_in_variant_set_order(_set, _val)
 
 #define foreach_value_in_variant_set_order_reverse_safe(_set, _val)     \
-    do {                                                                \
-        variant_set_t _data;                                            \
-        struct rb_node *_last;                                          \
-        _data = (variant_set_t)_set->sz_ptr[1];                         \
-        _last = pcutils_rbtree_last(&_data->elems);                     \
-        if (!_last)                                                     \
-            break;                                                      \
-        struct rb_node *_p, *_n;                                        \
-        pcutils_rbtree_for_each_reverse_safe(_last, _p, _n)             \
-        {                                                               \
-            struct set_node *_sn;                                       \
-            _sn = container_of(_p, struct set_node, rbnode);            \
-            _val = _sn->val;                                            \
-     /* } */                                                            \
-  /* } while (0) */
+    foreach_value_in_variant_set_order_reverse(_set, _val)
 
 #define end_foreach                                                     \
  /* do { */                                                             \
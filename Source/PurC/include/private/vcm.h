@@ -71,6 +71,7 @@ struct pcvcm_node {
     enum pcvcm_node_type type;
     uint32_t extra;
     uintptr_t attach;
+    uintptr_t const_id;     /* nonzero if the subtree is folded */
     bool is_closed;
     union {
         bool        b;
@@ -195,6 +196,53 @@ struct pcintr_stack;
 purc_variant_t pcvcm_eval(struct pcvcm_node *tree, struct pcintr_stack *stack,
         bool silently);
 
+/*
+ * Marks the subtrees without side effects (the literals and the containers
+ * and the concatenations of them) as constants, so that they are evaluated
+ * once for each instance. Returns the number of the nodes folded.
+ */
+size_t pcvcm_node_fold_constants(struct pcvcm_node *root);
+
+/*
+ * The values of the folded subtrees evaluated by an instance; the values
+ * of the containers are cloned when used, since they are mutable.
+ */
+struct pcvcm_consts;
+struct pcvcm_consts *pcvcm_consts_new(void);
+
+void pcvcm_consts_destroy(struct pcvcm_consts *consts);
+
+purc_variant_t pcvcm_eval_with_consts(struct pcvcm_node *tree,
+        struct pcvcm_consts *consts, cb_find_var find_var, void *ctxt,
+        bool silently);
+
+/*
+ * The vcm tree compiled to a linear code for a register machine, which
+ * gives the same results as the tree walker (pcvcm_eval()). The code
+ * refers to the nodes of the tree, so the tree must outlive the code.
+ * The constant names of the variables are parsed when compiled, and the
+ * variables found out of the scopes are cached by the code. The last value
+ * is reused while the variables it was computed from are bound to the same
+ * values and the objects it read are not changed.
+ */
+struct pcvcm_code;
+
+/* Returns NULL if out of memory. */
+struct pcvcm_code *pcvcm_compile(struct pcvcm_node *tree);
+
+void pcvcm_code_destroy(struct pcvcm_code *code);
+
+size_t pcvcm_code_nr_insns(struct pcvcm_code *code);
+
+purc_variant_t pcvcm_code_eval(struct pcvcm_code *code,
+        struct pcintr_stack *stack, bool silently);
+
+purc_variant_t pcvcm_code_eval_ex(struct pcvcm_code *code,
+        cb_find_var find_var, void *ctxt, bool silently);
+
+/* the vcm trees of a vdom are not compiled if this is set to 1 or true */
+#define PURC_ENVV_VCM_TREE_WALKER   "PURC_VCM_TREE_WALKER"
+
 purc_variant_t
 pcvcm_to_expression_variable(struct pcvcm_node *vcm, bool release_vcm);
 
@@ -138,6 +138,19 @@ pcvdom_document_set_root(struct pcvdom_document *doc,
 struct pcvdom_element*
 pcvdom_document_get_root(struct pcvdom_document *doc);
 
+// fold the constant vcm trees of the attributes and the contents,
+// see pcvcm_node_fold_constants()
+size_t
+pcvdom_document_fold_constants(struct pcvdom_document *doc);
+
+size_t
+pcvdom_document_nr_folded_vcm_nodes(struct pcvdom_document *doc);
+
+// compile the vcm trees of the attributes and the contents, see
+// pcvcm_compile(); nothing is done if PURC_VCM_TREE_WALKER is set
+void
+pcvdom_document_compile_vcm(struct pcvdom_document *doc);
+
 int
 pcvdom_document_append_comment(struct pcvdom_document *doc,
         struct pcvdom_comment *comment);
@@ -267,6 +280,15 @@ purc_variant_t
 pcvdom_element_eval_attr_val(struct pcintr_stack* stack,
         pcvdom_element_t element, const char *key);
 
+// evaluate the compiled vcm if there is, otherwise walk the vcm tree
+purc_variant_t
+pcvdom_attr_eval(struct pcintr_stack* stack, struct pcvdom_attr *attr,
+        bool silently);
+
+purc_variant_t
+pcvdom_content_eval(struct pcintr_stack* stack,
+        struct pcvdom_content *content, bool silently);
+
 struct pcvdom_pos {
     uint32_t        c;
     int             line;
@@ -187,9 +187,10 @@ enum {
     PCVARIANT_ERROR_INVALID_TYPE    = PCVARIANT_ERROR_FIRST,
     PCVARIANT_ERROR_OUT_OF_BOUNDS,
     PCVARIANT_ERROR_NOT_FOUND,
+    PCVARIANT_ERROR_FROZEN,
 
     /* XXX: change this when you append a new error code */
-    PCVARIANT_ERROR_LAST            = PCVARIANT_ERROR_NOT_FOUND,
+    PCVARIANT_ERROR_LAST            = PCVARIANT_ERROR_FROZEN,
 };
 
 #define PCVARIANT_ERROR_NR \
@@ -284,6 +284,32 @@ PCA_EXPORT int
 purc_rwstream_read_utf8_char (purc_rwstream_t rws,
         char* buf_utf8, uint32_t* buf_wc);
 
+/**
+ * Reads characters(UTF-8) from purc_rwstream_t and convert to wchat_t
+ * in bulk.
+ *
+ * @param rws: purc_rwstream_t
+ * @param chars: the buffer to convert the characters into
+ * @param max: the maximal number of the characters to read
+ *
+ * The characters are checked in the same way as
+ * purc_rwstream_read_utf8_char(). Only the characters available are
+ * returned, so less than @max characters may be returned before the end
+ * of the stream; the call only waits for a stream such as a pipe when no
+ * character is available. If an error occurred after some characters
+ * were read, the characters are returned, and the error is reported by
+ * the next call.
+ *
+ * @return the number of the characters read, 0 for the end of the stream,
+ *         or -1 on error and the error code is set to indicate the error.
+ *         The error code is the same as purc_rwstream_read_utf8_char().
+ *
+ * Since: 0.8.0
+ */
+PCA_EXPORT ssize_t
+purc_rwstream_read_utf8_chars (purc_rwstream_t rws,
+        uint32_t* chars, size_t max);
+
 
 /**
  * Write data to purc_rwstream_t
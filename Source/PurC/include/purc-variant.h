@@ -886,6 +886,39 @@ purc_variant_object_set_by_static_ckey(purc_variant_t obj, const char* key,
     return b;
 }
 
+/**
+ * Gets the value by key from an object with key as an atom
+ *
+ * @param obj: the variant value of obj type
+ * @param key: the atom of the key of key-value pair
+ *
+ * The atoms are compared as integers, so it is cheaper than
+ * purc_variant_object_get_by_ckey() when the same key is used repeatedly.
+ *
+ * Returns: A purc_variant_t on success, or PURC_VARIANT_INVALID on failure.
+ *
+ * Since: 0.8.0
+ */
+PCA_EXPORT purc_variant_t
+purc_variant_object_get_by_atom(purc_variant_t obj, purc_atom_t key);
+
+/**
+ * Sets the value by key in an object with key as an atom
+ *
+ * @param obj: the variant value of obj type
+ * @param key: the atom of the key of key-value pair
+ * @param value: the value of key-value pair
+ *
+ * No string variant is made for the key unless the key-value pair is new.
+ *
+ * Returns: @true on success, otherwise @false.
+ *
+ * Since: 0.8.0
+ */
+PCA_EXPORT bool
+purc_variant_object_set_by_atom(purc_variant_t obj, purc_atom_t key,
+        purc_variant_t value);
+
 /**
  * Remove a key-value pair from an object by key with key as c string
  *
@@ -1568,6 +1601,53 @@ PCA_EXPORT bool
 purc_variant_linear_container_set(purc_variant_t container,
         size_t idx, purc_variant_t value);
 
+struct purc_variant_numeric_stat {
+    /* the number of members */
+    size_t  count;
+    /* the sum of the members which are not NaN after being numberified */
+    double  sum;
+    /* the minimum and maximum; NaN if all members are NaN */
+    double  min;
+    double  max;
+};
+
+/**
+ * Summarizes the members of a linear container as numbers.
+ *
+ * @param container: the linear container variant, must be one of array,
+ *      set, or tuple.
+ * @param stat: the buffer receiving the count, sum, minimum, and maximum
+ *      of the members.
+ *
+ * The members are numberified like \purc_variant_numberify() does, and
+ *  the members which are NaN are counted but not summed, the same as the
+ *  built-in executors do for `reduce`. The mean is `stat->sum / stat->count`.
+ *
+ * Returns: @true on success, otherwise @false.
+ *
+ * Since: 0.8.0
+ */
+PCA_EXPORT bool
+purc_variant_linear_container_numeric_stat(purc_variant_t container,
+        struct purc_variant_numeric_stat *stat);
+
+/**
+ * Calculates the dot product of two linear containers.
+ *
+ * @param c1: the first linear container variant.
+ * @param c2: the second linear container variant, must have the same size
+ *      as @c1.
+ * @param dot: the buffer receiving the dot product of the members
+ *      numberified.
+ *
+ * Returns: @true on success, otherwise @false.
+ *
+ * Since: 0.8.0
+ */
+PCA_EXPORT bool
+purc_variant_linear_container_dot(purc_variant_t c1, purc_variant_t c2,
+        double *dot);
+
 /**
  * Creates a variant value from a string which contains JSON data.
  *
@@ -1919,6 +1999,54 @@ PCA_EXPORT ssize_t
 purc_variant_serialize(purc_variant_t value, purc_rwstream_t stream,
         int indent_level, unsigned int flags, size_t *len_expected);
 
+/**
+ * Serializes a variant value in the binary format.
+ *
+ * @param value: the variant value to be serialized.
+ * @param stream: the stream to which the serialized data write.
+ *
+ * The binary format keeps the types which eJSON can not carry exactly,
+ * such as long double, byte sequence, tuple, and the unique keys of a set.
+ * The keys of objects are stored once in a string table. The dynamic and
+ * native values are serialized as null.
+ *
+ * Returns:
+ * The size of the serialized data written to the stream;
+ * On error, -1 is returned, and error code is set to indicate
+ * the cause of the error.
+ *
+ * Since: 0.8.0
+ */
+PCA_EXPORT ssize_t
+purc_variant_serialize_binary(purc_variant_t value, purc_rwstream_t stream);
+
+/**
+ * Loads a variant value from the data serialized in the binary format.
+ *
+ * @param buf: the pointer to the data.
+ * @param sz: the size of the data in bytes.
+ *
+ * Returns: A purc_variant_t on success, or PURC_VARIANT_INVALID on failure;
+ *  the error code is PURC_ERROR_BAD_ENCODING if the data is malformed.
+ *
+ * Since: 0.8.0
+ */
+PCA_EXPORT purc_variant_t
+purc_variant_load_from_binary(const void *buf, size_t sz);
+
+/**
+ * Loads a variant value from a file which contains the data serialized
+ * in the binary format. The file is mapped into memory if possible.
+ *
+ * @param file: the file name.
+ *
+ * Returns: A purc_variant_t on success, or PURC_VARIANT_INVALID on failure.
+ *
+ * Since: 0.8.0
+ */
+PCA_EXPORT purc_variant_t
+purc_variant_load_from_binary_file(const char *file);
+
 
 #define PURC_ENVV_DVOBJS_PATH   "PURC_DVOBJS_PATH"
 #define PURC_ENVV_DVOBJS_PATH   "PURC_DVOBJS_PATH"
@@ -2183,6 +2311,8 @@ purc_variant_object_remove(purc_variant_t obj, purc_variant_t key,
 }
 
 
+#define PURC_VARIANT_SLAB_OCCUPANCY_LEVELS  4
+
 struct purc_variant_stat {
     size_t nr_values[PURC_VARIANT_TYPE_NR];
     size_t sz_mem[PURC_VARIANT_TYPE_NR];
@@ -2190,6 +2320,28 @@ struct purc_variant_stat {
     size_t sz_total_mem;
     size_t nr_reserved;
     size_t nr_max_reserved;
+
+    /* the number of slab pages and the memory occupied by them. */
+    size_t nr_slab_pages;
+    size_t sz_slab_mem;
+    /* the number of used slots and all slots in the slab pages. */
+    size_t nr_slab_used_slots;
+    size_t nr_slab_slots;
+    /* the number of slab pages whose occupancy falls in
+       (0, 25%], (25%, 50%], (50%, 75%], and (75%, 100%] respectively;
+       empty pages are counted in the first level. */
+    size_t nr_slab_pages_by_occupancy[PURC_VARIANT_SLAB_OCCUPANCY_LEVELS];
+
+    /* the number of the lookups of set members by the values of
+       the unique keys which found a member and which did not. */
+    size_t nr_set_key_hits;
+    size_t nr_set_key_misses;
+
+    /* the number of the lookups of the members of objects and the methods
+       of native entities by the inline caches of the compiled vcm code,
+       which hit and which missed. */
+    size_t nr_member_cache_hits;
+    size_t nr_member_cache_misses;
 };
 
 /**
@@ -2322,6 +2474,13 @@ typedef enum {
     PCVAR_OPERATION_ALL          = ((0x01 << 4) - 1),
 } pcvar_op_t;
 
+/*
+ * Generally, an event carries one child variant for `grow` and `shrink`,
+ * and the old one and the new one for `change`. But the set algebra
+ * (purc_variant_set_unite() and the like) fires one event for each kind
+ * of change with all the relevant children: the grown or shrunk members,
+ * or the pairs of the old and the new members changed.
+ */
 typedef bool (*pcvar_op_handler) (
         purc_variant_t src,  // the source variant.
         pcvar_op_t op,       // the operation identifier.
@@ -2633,6 +2792,69 @@ purc_variant_container_clone(purc_variant_t ctnr);
 PCA_EXPORT purc_variant_t
 purc_variant_container_clone_recursively(purc_variant_t ctnr);
 
+/**
+ * Freeze a variant: make a deep copy of the variant which can not be
+ * changed any more and can be shared by all instances in the process.
+ *
+ * @param value: the variant to freeze.
+ *
+ * Changing a frozen variant or registering a listener on it fails with
+ * the error code PCVARIANT_ERROR_FROZEN. A frozen variant is passed by
+ * pointer when it is moved to another instance. Freezing a frozen variant
+ * returns the variant itself with a new reference. Native entities can not
+ * be frozen.
+ *
+ * Returns: the frozen variant on success, otherwise PURC_VARIANT_INVALID.
+ *
+ * Since: 0.8.0
+ */
+PCA_EXPORT purc_variant_t
+purc_variant_freeze(purc_variant_t value);
+
+/**
+ * Check whether a variant is frozen.
+ *
+ * @param value: the variant to check.
+ *
+ * Returns: @true if the variant is frozen, otherwise @false.
+ *
+ * Since: 0.8.0
+ */
+PCA_EXPORT bool
+purc_variant_is_frozen(purc_variant_t value);
+
+/**
+ * Begin a batch of mutations in the current instance.
+ *
+ * When a container which is a member of a set (or a descendant of such
+ * a member) changes in a batch, the set is not adjusted for the new value
+ * of the member at once but at the end of the outermost batch, once for
+ * every container changed, however many times it changed. The set is also
+ * adjusted before any member of it is looked up in the batch.
+ *
+ * The post listeners of a set for PCVAR_OPERATION_CHANGE are also told at
+ * the end of the outermost batch, once for every set with the pairs of the
+ * old and the new members of all the changes in the batch. The changes are
+ * still checked against the uniqueness of the members of the sets at once,
+ * and so are the pre listeners told, for both can reject a change; the
+ * other post events are not deferred.
+ *
+ * The batches can be nested; every call of this function shall be paired
+ * with a call of purc_variant_end_batch().
+ *
+ * Since: 0.8.0
+ */
+PCA_EXPORT void
+purc_variant_begin_batch(void);
+
+/**
+ * End a batch of mutations in the current instance.
+ *
+ * Since: 0.8.0
+ */
+PCA_EXPORT void
+purc_variant_end_batch(void);
+
 struct purc_ejson_parse_tree;
 
 /**
@@ -53,6 +53,9 @@ struct pcinst_move_buffer {
     struct purc_rwlock  lock;
     struct list_head    msgs;
 
+    /* the variants in the messages are held by the move heap */
+    struct pcvariant_move_heap *mvheap;
+
     unsigned int        flags;
     size_t              max_nr_msgs;
     size_t              nr_msgs;
@@ -203,12 +206,18 @@ purc_inst_create_move_buffer(unsigned int flags, size_t max_msgs)
         goto done;
     }
 
+    mb->mvheap = NULL;
     purc_rwlock_init(&mb->lock);
     if (mb->lock.native_impl == NULL) {
         errcode = PURC_ERROR_BAD_SYSTEM_CALL;
         goto done;
     }
 
+    if ((mb->mvheap = pcvariant_move_heap_new()) == NULL) {
+        errcode = PURC_ERROR_OUT_OF_MEMORY;
+        goto done;
+    }
+
     if (pcutils_sorted_array_add(mb_atom2buff_map,
                 (void *)(uintptr_t)atom, mb) < 0) {
         errcode = PURC_ERROR_OUT_OF_MEMORY;
@@ -229,6 +238,10 @@ done:
                 purc_rwlock_clear(&mb->lock);
             }
 
+            if (mb->mvheap) {
+                pcvariant_move_heap_delete(mb->mvheap);
+            }
+
             free(mb);
         }
 
@@ -292,7 +305,7 @@ purc_inst_destroy_move_buffer(void)
 
     struct list_head *p, *n;
     purc_rwlock_writer_lock(&mb->lock);
-    pcvariant_use_move_heap();
+    pcvariant_use_move_heap(mb->mvheap);
     list_for_each_safe(p, n, &mb->msgs) {
 
         struct pcrdr_msg_hdr *hdr;
@@ -305,11 +318,12 @@ purc_inst_destroy_move_buffer(void)
         pcinst_grind_message((pcrdr_msg *)hdr);
         nr++;
     }
-    pcvariant_use_norm_heap();
+    pcvariant_use_norm_heap(mb->mvheap);
     purc_rwlock_writer_unlock(&mb->lock);
 
     pcutils_sorted_array_remove(mb_atom2buff_map, (void *)(uintptr_t)atom);
     purc_rwlock_clear(&mb->lock);
+    pcvariant_move_heap_delete(mb->mvheap);
     free(mb);
 
 done:
@@ -324,7 +338,8 @@ done:
 }
 
 static void
-do_move_message(struct pcinst* inst, pcrdr_msg *msg)
+do_move_message(struct pcinst* inst, struct pcinst_move_buffer *mb,
+        pcrdr_msg *msg)
 {
     struct pcrdr_msg_hdr *hdr = (struct pcrdr_msg_hdr *)msg;
 
@@ -332,7 +347,8 @@ do_move_message(struct pcinst* inst, pcrdr_msg *msg)
 
         for (int i = 0; i < PCRDR_NR_MSG_VARIANTS; i++) {
             if (msg->variants[i])
-                msg->variants[i] = pcvariant_move_heap_in(msg->variants[i]);
+                msg->variants[i] = pcvariant_move_heap_in(mb->mvheap,
+                        msg->variants[i]);
         }
     }
     else {
@@ -341,7 +357,8 @@ do_move_message(struct pcinst* inst, pcrdr_msg *msg)
 }
 
 static void
-do_take_message(struct pcinst* inst, pcrdr_msg *msg)
+do_take_message(struct pcinst* inst, struct pcinst_move_buffer *mb,
+        pcrdr_msg *msg)
 {
     unsigned int mb_owner = 0;
     struct pcrdr_msg_hdr *hdr = (struct pcrdr_msg_hdr *)msg;
@@ -350,7 +367,8 @@ do_take_message(struct pcinst* inst, pcrdr_msg *msg)
                 inst->endpoint_atom)) {
         for (int i = 0; i < PCRDR_NR_MSG_VARIANTS; i++) {
             if (msg->variants[i])
-                msg->variants[i] = pcvariant_move_heap_out(msg->variants[i]);
+                msg->variants[i] = pcvariant_move_heap_out(mb->mvheap,
+                        msg->variants[i]);
         }
     }
     else {
@@ -389,7 +407,7 @@ purc_inst_move_message(purc_atom_t inst_to, pcrdr_msg *msg)
             goto done;
         }
 
-        do_move_message(inst, msg);
+        do_move_message(inst, mb, msg);
 
         purc_rwlock_writer_lock(&mb->lock);
         struct pcrdr_msg_hdr *hdr = (struct pcrdr_msg_hdr *)msg;
@@ -411,7 +429,7 @@ purc_inst_move_message(purc_atom_t inst_to, pcrdr_msg *msg)
 
                 if (i == count - 1) {
                     my_msg = msg;
-                    do_move_message(inst, msg);
+                    do_move_message(inst, mb, msg);
                     // FIXME: if count > 1 and flags without PCINST_MOVE_BUFFER_BROADCAST
                     // not reatch here
                     msg = NULL;
@@ -419,7 +437,7 @@ purc_inst_move_message(purc_atom_t inst_to, pcrdr_msg *msg)
                 else {
                     my_msg = pcrdr_clone_message(msg);
                     if (my_msg) {
-                        do_move_message(inst, my_msg);
+                        do_move_message(inst, mb, my_msg);
                         pcrdr_release_message(my_msg);
                     }
                     else {
@@ -580,7 +598,7 @@ purc_inst_take_away_message(size_t index)
     purc_rwlock_writer_unlock(&mb->lock);
 
     if (msg)
-        do_take_message(inst, msg);
+        do_take_message(inst, mb, msg);
 
 done:
     purc_rwlock_reader_unlock(&mb_lock);
@@ -146,15 +146,9 @@ pcintr_get_scoped_variables(purc_coroutine_t cor, struct pcvdom_node *node)
         return cor->variables;
     }
 
-    struct rb_node *p;
-    struct rb_node *first = pcutils_rbtree_first(&stack->scoped_variables);
-    pcutils_rbtree_for_each(first, p) {
-        pcvarmgr_t mgr = container_of(p, struct pcvarmgr, node);
-        if (mgr->vdom_node == node)
-            return mgr;
-    }
-
-    return NULL;
+    struct rb_node *p = pcutils_rbtree_find(&stack->scoped_variables, node,
+            cmp_f);
+    return p ? container_of(p, struct pcvarmgr, node) : NULL;
 }
 
 bool
@@ -210,7 +210,7 @@ match_id(pcintr_coroutine_t co,
         return false;
 
     bool silently = false;
-    purc_variant_t v = pcvcm_eval(attr->val, &co->stack, silently);
+    purc_variant_t v = pcvdom_attr_eval(&co->stack, attr, silently);
     purc_clr_error();
     if (v == PURC_VARIANT_INVALID)
         return false;
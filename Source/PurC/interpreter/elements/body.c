@@ -190,7 +190,7 @@ on_content(pcintr_coroutine_t co, struct pcintr_stack_frame *frame,
     }
 
     pcintr_stack_t stack = &co->stack;
-    purc_variant_t v = pcvcm_eval(vcm, stack, frame->silently);
+    purc_variant_t v = pcvdom_content_eval(stack, content, frame->silently);
     if (v == PURC_VARIANT_INVALID) {
         return;
     }
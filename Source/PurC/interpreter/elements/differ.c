@@ -150,7 +150,7 @@ on_content(pcintr_coroutine_t co, struct pcintr_stack_frame *frame,
     if (!vcm)
         return;
 
-    purc_variant_t v = pcvcm_eval(vcm, stack, frame->silently);
+    purc_variant_t v = pcvdom_content_eval(stack, content, frame->silently);
     PC_ASSERT(v != PURC_VARIANT_INVALID);
     purc_clr_error();
 
@@ -169,7 +169,8 @@ on_content(pcintr_coroutine_t co, struct pcintr_stack_frame *frame,
         return;
     }
 
-    purc_variant_t v = pcvcm_eval(vcm, &co->stack, frame->silently);
+    purc_variant_t v = pcvdom_content_eval(&co->stack, content,
+            frame->silently);
     if (v == PURC_VARIANT_INVALID) {
         return;
     }
@@ -257,7 +257,7 @@ match_id(pcintr_coroutine_t co,
         return false;
 
     bool silently = false;
-    purc_variant_t v = pcvcm_eval(attr->val, &co->stack, silently);
+    purc_variant_t v = pcvdom_attr_eval(&co->stack, attr, silently);
     purc_clr_error();
     if (v == PURC_VARIANT_INVALID)
         return false;
@@ -1546,7 +1546,8 @@ on_content(pcintr_coroutine_t co, struct pcintr_stack_frame *frame,
     }
 
     // NOTE: element is still the owner of vcm_content
-    purc_variant_t v = pcvcm_eval(vcm, &co->stack, frame->silently);
+    purc_variant_t v = pcvdom_content_eval(&co->stack, content,
+            frame->silently);
     if (v == PURC_VARIANT_INVALID)
         return -1;
 
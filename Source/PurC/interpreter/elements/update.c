@@ -571,14 +571,20 @@ process(pcintr_coroutine_t co, struct pcintr_stack_frame *frame,
         // PC_ASSERT(to != PURC_VARIANT_INVALID);
         return update_elements(&co->stack, on, at, to, src, with_eval);
     }
-    if (type == PURC_VARIANT_TYPE_OBJECT) {
-        return update_object(&co->stack, on, at, to, src, with_eval);
-    }
-    if (type == PURC_VARIANT_TYPE_ARRAY) {
-        return update_array(co, frame, src, with_eval);
-    }
-    if (type == PURC_VARIANT_TYPE_SET) {
-        return update_set(co, frame, src, with_eval);
+    if (type == PURC_VARIANT_TYPE_OBJECT ||
+            type == PURC_VARIANT_TYPE_ARRAY ||
+            type == PURC_VARIANT_TYPE_SET) {
+        int r;
+        /* the sets holding the changed containers are adjusted once */
+        purc_variant_begin_batch();
+        if (type == PURC_VARIANT_TYPE_OBJECT)
+            r = update_object(&co->stack, on, at, to, src, with_eval);
+        else if (type == PURC_VARIANT_TYPE_ARRAY)
+            r = update_array(co, frame, src, with_eval);
+        else
+            r = update_set(co, frame, src, with_eval);
+        purc_variant_end_batch();
+        return r;
     }
     if (type == PURC_VARIANT_TYPE_STRING) {
         const char *s = purc_variant_get_string_const(on);
@@ -990,7 +996,7 @@ on_content(pcintr_coroutine_t co, struct pcintr_stack_frame *frame,
 
     // NOTE: element is still the owner of vcm_content
     // TODO: silently
-    purc_variant_t v = pcvcm_eval(vcm, &co->stack, false);
+    purc_variant_t v = pcvdom_content_eval(&co->stack, content, false);
     if (v == PURC_VARIANT_INVALID)
         return -1;
 
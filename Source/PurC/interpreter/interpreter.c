@@ -500,6 +500,11 @@ static void _cleanup_instance(struct pcinst* inst)
         heap->event_timer = NULL;
     }
 
+    if (heap->vcm_consts) {
+        pcvcm_consts_destroy(heap->vcm_consts);
+        heap->vcm_consts = NULL;
+    }
+
     free(heap);
     inst->intr_heap = NULL;
 }
@@ -794,7 +799,7 @@ pcintr_calc_and_set_caret_symbol(pcintr_stack_t stack,
         return 0;
     }
 
-    purc_variant_t v = pcvcm_eval(vcm, stack, frame->silently);
+    purc_variant_t v = pcvdom_content_eval(stack, content, frame->silently);
     if (v == PURC_VARIANT_INVALID) {
         purc_clr_error();
         return 0;
@@ -1032,7 +1037,7 @@ eval_vdom_attr(pcintr_stack_t stack, struct pcvdom_attr *attr)
 
     struct pcintr_stack_frame *frame;
     frame = pcintr_stack_get_bottom_frame(stack);
-    return pcvcm_eval(attr->val, stack, frame->silently ? true : false);
+    return pcvdom_attr_eval(stack, attr, frame->silently ? true : false);
 }
 
 int
@@ -2747,9 +2752,16 @@ pcintr_inc_percent_var(struct pcintr_stack_frame *frame)
     v = pcintr_get_symbol_var(frame, PURC_SYMBOL_VAR_PERCENT_SIGN);
     PC_ASSERT(v != PURC_VARIANT_INVALID);
     PC_ASSERT(purc_variant_is_ulongint(v));
-    v->u64 += 1;
 
-    return 0;
+    /* the small integers are shared, so never change the value in place */
+    v = purc_variant_make_ulongint(v->u64 + 1);
+    if (v == PURC_VARIANT_INVALID)
+        return -1;
+
+    int r = pcintr_set_symbol_var(frame, PURC_SYMBOL_VAR_PERCENT_SIGN, v);
+    purc_variant_unref(v);
+
+    return r;
 }
 
 purc_variant_t
@@ -191,9 +191,21 @@ static bool mgr_change_handler(purc_variant_t source, pcvar_op_t msg_type,
     return true;
 }
 
+/* invalidates the variables cached by pcintr_find_named_var_by_atom() */
+static inline void
+bump_vars_gen(void)
+{
+    struct pcintr_heap *heap = pcintr_get_heap();
+    if (heap) {
+        heap->vars_gen++;
+    }
+}
+
 static bool mgr_handler(purc_variant_t source, pcvar_op_t msg_type,
         void* ctxt, size_t nr_args, purc_variant_t* argv)
 {
+    bump_vars_gen();
+
     switch (msg_type) {
     case PCVAR_OPERATION_GROW:
         return mgr_grow_handler(source, msg_type, ctxt, nr_args, argv);
@@ -261,6 +273,7 @@ int pcvarmgr_destroy(pcvarmgr_t mgr)
 {
     if (mgr) {
         PC_ASSERT(mgr->node.rb_parent == NULL);
+        bump_vars_gen();
         if (mgr->listener) {
             purc_variant_revoke_listener(mgr->object, mgr->listener);
         }
@@ -283,15 +296,16 @@ bool pcvarmgr_add(pcvarmgr_t mgr, const char* name,
         return false;
     }
 
-    purc_variant_t k = purc_variant_make_string(name, true);
-    if (k == PURC_VARIANT_INVALID) {
+    purc_atom_t k = purc_atom_from_string(name);
+    if (k == 0) {
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
         return false;
     }
     bool ret = false;
-    purc_variant_t v = purc_variant_object_get(mgr->object, k);
+    purc_variant_t v = purc_variant_object_get_by_atom(mgr->object, k);
     if (v == PURC_VARIANT_INVALID) {
         purc_clr_error();
-        ret = purc_variant_object_set(mgr->object, k, variant);
+        ret = purc_variant_object_set_by_atom(mgr->object, k, variant);
     }
     else {
         enum purc_variant_type type = purc_variant_get_type(v);
@@ -305,12 +319,11 @@ bool pcvarmgr_add(pcvarmgr_t mgr, const char* name,
 
         default:
             // XXX: observe on=$name
-            ret = purc_variant_object_set(mgr->object, k, variant);
+            ret = purc_variant_object_set_by_atom(mgr->object, k, variant);
             break;
         }
     }
 
-    purc_variant_unref(k);
     return ret;
 }
 
@@ -359,91 +372,73 @@ bool pcvarmgr_dispatch_except(pcvarmgr_t mgr, const char* name,
     return true;
 }
 
-static purc_variant_t
-_find_named_scope_var_in_vdom(purc_coroutine_t cor,
-        pcvdom_element_t elem, const char* name, pcvarmgr_t* mgr)
+/*
+ * The lookups of the named variables in the levels below do not set the
+ * error if the name is not found, since the variable is usually found in
+ * a level after missing in some levels.
+ */
+static inline purc_variant_t
+find_mgr_var(pcvarmgr_t mgr, purc_atom_t name)
 {
-    if (!elem || !name) {
-        PC_ASSERT(name); // FIXME: still recoverable???
-        purc_set_error_with_info(PCVARIANT_ERROR_NOT_FOUND, "name:%s", name);
-        return PURC_VARIANT_INVALID;
-    }
-
-    purc_variant_t v;
+    return mgr ? pcvariant_object_get_by_atom_quietly(mgr->object, name) :
+        PURC_VARIANT_INVALID;
+}
 
-again:
+static purc_variant_t
+find_scope_var_in_vdom(purc_coroutine_t cor, pcvdom_element_t elem,
+        purc_atom_t name)
+{
+    while (elem) {
+        pcvarmgr_t mgr = pcintr_get_scoped_variables(cor,
+                pcvdom_ele_cast_to_node(elem));
+        purc_variant_t v = find_mgr_var(mgr, name);
+        if (v)
+            return v;
 
-    v = pcintr_get_scope_variable(cor, elem, name);
-    if (v) {
-        if (mgr) {
-            *mgr = pcintr_get_scope_variables(cor, elem);
-        }
-        return v;
+        elem = pcvdom_element_parent(elem);
     }
 
-    elem = pcvdom_element_parent(elem);
-    if (elem)
-        goto again;
-
-    purc_set_error_with_info(PCVARIANT_ERROR_NOT_FOUND, "name:%s", name);
     return PURC_VARIANT_INVALID;
 }
 
 static purc_variant_t
-_find_named_scope_var(purc_coroutine_t cor,
-        struct pcintr_stack_frame *frame, const char* name, pcvarmgr_t* mgr)
+find_scope_var(purc_coroutine_t cor, struct pcintr_stack_frame *frame,
+        purc_atom_t name)
 {
-    if (frame->scope)
-        return _find_named_scope_var_in_vdom(cor, frame->scope, name, mgr);
-
-    pcvdom_element_t elem = frame->pos;
-
-    if (!elem || !name) {
-        PC_ASSERT(name); // FIXME: still recoverable???
-        purc_set_error_with_info(PCVARIANT_ERROR_NOT_FOUND, "name:%s", name);
-        return PURC_VARIANT_INVALID;
-    }
-
-    purc_variant_t v;
-
-again:
+    while (frame) {
+        if (frame->scope)
+            return find_scope_var_in_vdom(cor, frame->scope, name);
 
-    v = pcintr_get_scope_variable(cor, elem, name);
-    if (v) {
-        if (mgr) {
-            *mgr = pcintr_get_scope_variables(cor, elem);
-        }
-        return v;
-    }
+        pcvdom_element_t elem = frame->pos;
+        if (!elem)
+            break;
 
-    frame = pcintr_stack_frame_get_parent(frame);
-    if (frame) {
-        if (frame->scope)
-            return _find_named_scope_var_in_vdom(cor, frame->scope, name, mgr);
+        pcvarmgr_t mgr = pcintr_get_scoped_variables(cor,
+                pcvdom_ele_cast_to_node(elem));
+        purc_variant_t v = find_mgr_var(mgr, name);
+        if (v)
+            return v;
 
-        elem = frame->pos;
-        if (elem)
-            goto again;
+        frame = pcintr_stack_frame_get_parent(frame);
     }
 
-    purc_set_error_with_info(PCVARIANT_ERROR_NOT_FOUND, "name:%s", name);
     return PURC_VARIANT_INVALID;
 }
 
 static purc_variant_t
-find_cor_level_var(purc_coroutine_t cor, const char* name)
+find_temp_var(struct pcintr_stack_frame *frame, purc_atom_t name)
 {
-    PC_ASSERT(name);
-    if (!cor) {
-        purc_set_error_with_info(PCVARIANT_ERROR_NOT_FOUND, "name:%s", name);
-        return PURC_VARIANT_INVALID;
-    }
+    while (frame) {
+        purc_variant_t tmp = pcintr_get_exclamation_var(frame);
+        if (tmp != PURC_VARIANT_INVALID) {
+            purc_variant_t v = pcvariant_object_get_by_atom_quietly(tmp, name);
+            if (v)
+                return v;
+        }
 
-    purc_variant_t v = purc_coroutine_get_variable(cor, name);
-    if (v) {
-        return v;
+        frame = pcintr_stack_frame_get_parent(frame);
     }
-    purc_set_error_with_info(PCVARIANT_ERROR_NOT_FOUND, "name:%s", name);
+
     return PURC_VARIANT_INVALID;
 }
 
@@ -467,48 +462,32 @@ purc_get_runner_variable(const char* name)
     return PURC_VARIANT_INVALID;
 }
 
-static inline purc_variant_t
-find_inst_var(const char *name)
-{
-    return purc_get_runner_variable(name);
-}
-
-static purc_variant_t
-_find_named_temp_var(struct pcintr_stack_frame *frame, const char *name)
+/* whether any scoped variable of the coroutine has the name */
+static bool
+has_scope_var(purc_coroutine_t cor, purc_atom_t name)
 {
-    struct pcintr_stack_frame *p = frame;
-
-again:
-
-    if (p == NULL) {
-        purc_set_error(PURC_ERROR_ENTITY_NOT_FOUND);
-        return PURC_VARIANT_INVALID;
+    struct rb_node *p;
+    struct rb_node *first = pcutils_rbtree_first(&cor->stack.scoped_variables);
+    pcutils_rbtree_for_each(first, p) {
+        pcvarmgr_t mgr = container_of(p, struct pcvarmgr, node);
+        if (find_mgr_var(mgr, name))
+            return true;
     }
 
-    do {
-        purc_variant_t tmp;
-        tmp = pcintr_get_exclamation_var(p);
-        if (tmp == PURC_VARIANT_INVALID)
-            break;
-
-        if (purc_variant_is_object(tmp) == false)
-            break;
-
-        purc_variant_t v;
-        v = purc_variant_object_get_by_ckey(tmp, name);
-        if (v == PURC_VARIANT_INVALID)
-            break;
-
-        return v;
-    } while (0);
-
-    p = pcintr_stack_frame_get_parent(p);
+    return false;
+}
 
-    goto again;
+static inline purc_variant_t
+found_named_var(purc_variant_t v)
+{
+    if (purc_get_last_error())
+        purc_clr_error();
+    return v;
 }
 
 purc_variant_t
-pcintr_find_named_var(pcintr_stack_t stack, const char* name)
+pcintr_find_named_var_by_atom(pcintr_stack_t stack, purc_atom_t name,
+        struct pcintr_var_cache *cache)
 {
     if (!stack || !name) {
         PC_ASSERT(0); // FIXME: still recoverable???
@@ -518,33 +497,61 @@ pcintr_find_named_var(pcintr_stack_t stack, const char* name)
     struct pcintr_stack_frame* frame = pcintr_stack_get_bottom_frame(stack);
     PC_ASSERT(frame);
 
+    // the temporary variables are changed without the variable managers
     purc_variant_t v;
-    v = _find_named_temp_var(frame, name);
+    v = find_temp_var(frame, name);
     if (v) {
-        purc_clr_error();
-        return v;
+        return found_named_var(v);
     }
 
-    v = _find_named_scope_var(stack->co, frame, name, NULL);
-    if (v) {
-        purc_clr_error();
-        return v;
+    purc_coroutine_t cor = stack->co;
+    struct pcintr_heap *heap = pcintr_get_heap();
+    if (cache && heap && cache->co == cor && cache->gen == heap->vars_gen) {
+        return found_named_var(cache->value);
     }
 
-    v = find_cor_level_var(stack->co, name);
+    v = find_scope_var(cor, frame, name);
     if (v) {
-        purc_clr_error();
-        return v;
+        return found_named_var(v);
     }
 
-    v = find_inst_var(name);
-    if (v) {
-        purc_clr_error();
-        return v;
+    v = cor ? find_mgr_var(cor->variables, name) : PURC_VARIANT_INVALID;
+    if (v == PURC_VARIANT_INVALID) {
+        v = find_mgr_var(pcinst_get_variables(), name);
     }
 
-    purc_set_error_with_info(PCVARIANT_ERROR_NOT_FOUND, "name:%s", name);
-    return PURC_VARIANT_INVALID;
+    if (v == PURC_VARIANT_INVALID) {
+        purc_set_error_with_info(PCVARIANT_ERROR_NOT_FOUND, "name:%s",
+                purc_atom_to_string(name));
+        return PURC_VARIANT_INVALID;
+    }
+
+    /* the variables out of the scopes are cached only if no scope has
+       the name, then the result does not depend on the frames */
+    if (cache && heap && cor && !has_scope_var(cor, name)) {
+        cache->co = cor;
+        cache->gen = heap->vars_gen;
+        cache->value = v;
+    }
+
+    return found_named_var(v);
+}
+
+purc_variant_t
+pcintr_find_named_var(pcintr_stack_t stack, const char* name)
+{
+    if (!stack || !name) {
+        PC_ASSERT(0); // FIXME: still recoverable???
+        return PURC_VARIANT_INVALID;
+    }
+
+    purc_atom_t atom = purc_atom_from_string(name);
+    if (atom == 0) {
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return PURC_VARIANT_INVALID;
+    }
+
+    return pcintr_find_named_var_by_atom(stack, atom, NULL);
 }
 
 enum purc_symbol_var _to_symbol(char symbol)
@@ -26,6 +26,7 @@
 #include "config.h"
 #include "private/pcrdr.h"
 #include "private/instance.h"
+#include "private/variant.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -800,7 +801,13 @@ serialize_message_data(const pcrdr_msg *msg, pcrdr_cb_write fn, void *ctxt)
     }
     else if (msg->dataType == PCRDR_MSG_DATA_TYPE_JSON) {
         purc_rwstream_t buffer = NULL;
-        buffer = purc_rwstream_new_buffer(PCRDR_MIN_PACKET_BUFF_SIZE,
+        size_t sz_init = pcvariant_serialize_size_hint(msg->data,
+                PCVARIANT_SERIALIZE_OPT_PLAIN);
+        if (sz_init < PCRDR_MIN_PACKET_BUFF_SIZE)
+            sz_init = PCRDR_MIN_PACKET_BUFF_SIZE;
+        else if (sz_init > PCRDR_MAX_INMEM_PAYLOAD_SIZE)
+            sz_init = PCRDR_MAX_INMEM_PAYLOAD_SIZE;
+        buffer = purc_rwstream_new_buffer(sz_init,
                 PCRDR_MAX_INMEM_PAYLOAD_SIZE);
 
         /* always serialize as a standard JSON */
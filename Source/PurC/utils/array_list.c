@@ -173,6 +173,36 @@ pcutils_array_list_remove(struct pcutils_array_list *al,
     return 0;
 }
 
+size_t
+pcutils_array_list_remove_if(struct pcutils_array_list *al,
+        bool (*pred)(struct pcutils_array_list_node *node, void *ud), void *ud)
+{
+    size_t i, j;
+
+    /* compact the survivors in one pass instead of shifting once for
+       every node removed */
+    for (i = 0, j = 0; i < al->nr; ++i) {
+        struct pcutils_array_list_node *node = al->nodes[i];
+        if (pred(node, ud)) {
+            list_del(&node->node);
+            node->idx = -1;
+            continue;
+        }
+
+        al->nodes[j] = node;
+        node->idx = j;
+        ++j;
+    }
+
+    size_t nr_removed = al->nr - j;
+    for (; j < al->nr; ++j)
+        al->nodes[j] = NULL;
+
+    al->nr -= nr_removed;
+
+    return nr_removed;
+}
+
 struct pcutils_array_list_node*
 pcutils_array_list_get(struct pcutils_array_list *al,
         size_t idx)
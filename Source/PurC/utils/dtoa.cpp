@@ -0,0 +1,41 @@
+/*
+ * @file dtoa.cpp
+ * @date 2026/10/16
+ * @brief The shortest round-trip conversion of doubles to decimal digits.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "private/utils.h"
+
+#include "wtf/dtoa/double-conversion.h"
+
+using PurCWTF::double_conversion::DoubleToStringConverter;
+
+size_t
+pcutils_dtoa_shortest(double d, char *digits, bool *negative, int *point)
+{
+    bool sign;
+    int length;
+
+    DoubleToStringConverter::DoubleToAscii(d, DoubleToStringConverter::SHORTEST,
+            0, digits, PCUTILS_DTOA_MAX_DIGITS + 1, &sign, &length, point);
+
+    *negative = sign;
+    return (size_t)length;
+}
@@ -28,6 +28,8 @@
 #include "purc-utils.h"
 #include "private/errors.h"
 #include "private/instance.h"
+#include "private/utils.h"
+#include "private/rwstream.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -44,6 +46,7 @@
 
 #define BUFFER_SIZE 4096
 #define MIN_BUFFER_SIZE 32
+#define READ_AHEAD_SIZE 4096
 
 /* Make sure the number of error messages matches the number of error codes */
 #define _COMPILE_TIME_ASSERT(name, x)               \
@@ -87,9 +90,22 @@ typedef struct rwstream_funcs
             size_t *sz_buffer, bool res_buff);
 } rwstream_funcs;
 
+/*
+ * The characters are decoded from a window of the bytes: the content itself
+ * for the memory and buffer streams, or a read-ahead buffer filled by blocks
+ * for the other streams. The read-ahead buffer is only filled when it is
+ * empty, with the bytes the stream has already, so that a pipe or a socket
+ * is never waited for the bytes not needed yet. The bytes pending in the
+ * read-ahead buffer are taken into account by all the other operations, so
+ * the buffer is transparent to the users of the stream.
+ */
 struct purc_rwstream
 {
     rwstream_funcs* funcs;
+
+    uint8_t* ra_buf;
+    size_t ra_pos;
+    size_t ra_len;
 };
 
 struct stdio_rwstream
@@ -130,6 +146,8 @@ struct fd_rwstream
 static off_t stdio_seek (purc_rwstream_t rws, off_t offset, int whence);
 static off_t stdio_tell (purc_rwstream_t rws);
 static ssize_t stdio_read (purc_rwstream_t rws, void* buf, size_t count);
+static ssize_t stdio_read_ahead (purc_rwstream_t rws, uint8_t* buf,
+        size_t count);
 static ssize_t stdio_write (purc_rwstream_t rws, const void* buf, size_t count);
 static ssize_t stdio_flush (purc_rwstream_t rws);
 static int stdio_destroy (purc_rwstream_t rws);
@@ -410,6 +428,17 @@ purc_rwstream_new_for_read (void *ctxt, pcrws_cb_read fn)
     return (purc_rwstream_t)rws;
 }
 
+static inline size_t ra_pending (purc_rwstream_t rws)
+{
+    return rws->ra_len - rws->ra_pos;
+}
+
+static inline void ra_drop (purc_rwstream_t rws)
+{
+    rws->ra_pos = 0;
+    rws->ra_len = 0;
+}
+
 int purc_rwstream_destroy (purc_rwstream_t rws)
 {
     if (rws == NULL) {
@@ -417,6 +446,7 @@ int purc_rwstream_destroy (purc_rwstream_t rws)
         return -1;
     }
 
+    free(rws->ra_buf);
     if (rws->funcs->destroy)
         return rws->funcs->destroy(rws);
 
@@ -431,8 +461,12 @@ off_t purc_rwstream_seek (purc_rwstream_t rws, off_t offset, int whence)
         return -1;
     }
 
-    if (rws->funcs->seek)
+    if (rws->funcs->seek) {
+        if (whence == SEEK_CUR)
+            offset -= (off_t)ra_pending(rws);
+        ra_drop(rws);
         return rws->funcs->seek(rws, offset, whence);
+    }
 
     pcinst_set_error(PURC_ERROR_NOT_SUPPORTED);
     return -1;
@@ -445,8 +479,12 @@ off_t purc_rwstream_tell (purc_rwstream_t rws)
         return -1;
     }
 
-    if (rws->funcs->tell)
-        return rws->funcs->tell(rws);
+    if (rws->funcs->tell) {
+        off_t pos = rws->funcs->tell(rws);
+        if (pos >= 0)
+            pos -= (off_t)ra_pending(rws);
+        return pos;
+    }
 
     pcinst_set_error(PURC_ERROR_NOT_SUPPORTED);
     return -1;
@@ -459,6 +497,15 @@ ssize_t purc_rwstream_read (purc_rwstream_t rws, void* buf, size_t count)
         return -1;
     }
 
+    size_t pending = ra_pending(rws);
+    if (pending > 0) {
+        if (count > pending)
+            count = pending;
+        memcpy(buf, rws->ra_buf + rws->ra_pos, count);
+        rws->ra_pos += count;
+        return count;
+    }
+
     if (rws->funcs->read)
         return rws->funcs->read(rws, buf, count);
 
@@ -484,6 +531,90 @@ static uint32_t utf8_to_uint32_t (const unsigned char* utf8_char,
     return wc;
 }
 
+/*
+ * Makes at least `min` bytes available in the window unless the end of
+ * the stream is reached, and returns the number of the bytes available,
+ * or -1 on error. The stream is only read when the window has less than
+ * `min` bytes.
+ */
+static ssize_t window_fill (purc_rwstream_t rws, const uint8_t** bytes,
+        size_t min)
+{
+    if (rws->funcs == &mem_funcs) {
+        struct mem_rwstream* mem = (struct mem_rwstream *)rws;
+        *bytes = mem->here;
+        return mem->stop - mem->here;
+    }
+    else if (rws->funcs == &buffer_funcs) {
+        struct buffer_rwstream* buffer = (struct buffer_rwstream *)rws;
+        *bytes = buffer->here;
+        return buffer->stop - buffer->here;
+    }
+
+    if (rws->funcs->read == NULL) {
+        pcinst_set_error(PURC_ERROR_NOT_SUPPORTED);
+        return -1;
+    }
+
+    if (rws->ra_buf == NULL) {
+        rws->ra_buf = (uint8_t*) malloc(READ_AHEAD_SIZE);
+        if (rws->ra_buf == NULL) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return -1;
+        }
+    }
+
+    if (ra_pending(rws) < min && rws->ra_pos > 0) {
+        memmove(rws->ra_buf, rws->ra_buf + rws->ra_pos, ra_pending(rws));
+        rws->ra_len -= rws->ra_pos;
+        rws->ra_pos = 0;
+    }
+
+    while (ra_pending(rws) < min) {
+        ssize_t ret;
+        if (rws->funcs == &stdio_funcs)
+            ret = stdio_read_ahead(rws, rws->ra_buf + rws->ra_len,
+                    min - ra_pending(rws));
+        else
+            ret = rws->funcs->read(rws, rws->ra_buf + rws->ra_len,
+                    READ_AHEAD_SIZE - rws->ra_len);
+        if (ret < 0)
+            return -1;
+        if (ret == 0)
+            break;
+        rws->ra_len += ret;
+    }
+
+    *bytes = rws->ra_buf + rws->ra_pos;
+    return ra_pending(rws);
+}
+
+static inline void window_consume (purc_rwstream_t rws, size_t count)
+{
+    if (rws->funcs == &mem_funcs)
+        ((struct mem_rwstream *)rws)->here += count;
+    else if (rws->funcs == &buffer_funcs)
+        ((struct buffer_rwstream *)rws)->here += count;
+    else
+        rws->ra_pos += count;
+}
+
+/* Returns the length of the UTF-8 sequence led by the byte, or 0 if the
+   byte can not lead a sequence. */
+static inline int utf8_seq_len (uint8_t c)
+{
+    int n = 1;
+
+    if (c & 0x80) {
+        while (c & (0x80 >> n))
+            n++;
+        if (n < 2)
+            return 0;
+    }
+
+    return n;
+}
+
 int purc_rwstream_read_utf8_char (purc_rwstream_t rws, char* buf_utf8,
         uint32_t* buf_wc)
 {
@@ -492,51 +623,50 @@ int purc_rwstream_read_utf8_char (purc_rwstream_t rws, char* buf_utf8,
         return -1;
     }
 
-    ssize_t ret =  purc_rwstream_read (rws, buf_utf8, 1);
-    if (ret != 1) {
-        return ret;
+    const uint8_t* bytes;
+    ssize_t avail = window_fill (rws, &bytes, 1);
+    if (avail <= 0) {
+        return avail;
     }
 
-    int n = 1;
-    int ch_len = 0;
-    uint8_t c = buf_utf8[0];
+    uint8_t c = bytes[0];
     if (c > 0xFD) {
+        window_consume (rws, 1);
         pcinst_set_error(PCRWSTREAM_ERROR_IO);
         return -1;
     }
 
-    if (c & 0x80) {
-        while (c & (0x80 >> n))
-            n++;
+    int ch_len = utf8_seq_len (c);
+    if (ch_len == 0) {
+        window_consume (rws, 1);
+        pcinst_set_error(PURC_ERROR_BAD_ENCODING);
+        return -1;
+    }
 
-        if (n < 2) {
-            pcinst_set_error(PURC_ERROR_BAD_ENCODING);
+    if (avail < ch_len) {
+        avail = window_fill (rws, &bytes, ch_len);
+        if (avail < 0) {
             return -1;
         }
-        ch_len = n;
-    }
-    else {
-        ch_len = 1;
     }
 
-    int read_len = ch_len - 1;
-    char* p = buf_utf8 + 1;
-    while (read_len > 0) {
-        ret =  purc_rwstream_read (rws, p, 1);
-        if (ret != 1)
-        {
+    /* the bytes are consumed up to the bad one as reading them one by one */
+    for (int i = 1; i < ch_len; i++) {
+        if (i >= avail) {
+            window_consume (rws, avail);
             pcinst_set_error(PCRWSTREAM_ERROR_IO);
             return -1;
         }
-        c = *p;
-        if ((c & 0xC0) != 0x80) {
+        if ((bytes[i] & 0xC0) != 0x80) {
+            window_consume (rws, i + 1);
             pcinst_set_error(PCRWSTREAM_ERROR_IO);
             return -1;
         }
-        p++;
-        read_len--;
     }
 
+    memcpy(buf_utf8, bytes, ch_len);
+    window_consume (rws, ch_len);
+
     // FIXME
     if (ch_len > 3) {
         pcinst_set_error(PURC_ERROR_BAD_ENCODING);
@@ -557,6 +687,101 @@ int purc_rwstream_read_utf8_char (purc_rwstream_t rws, char* buf_utf8,
     return ch_len;
 }
 
+ssize_t purc_rwstream_read_utf8_chars (purc_rwstream_t rws, uint32_t* chars,
+        size_t max)
+{
+    if (rws == NULL || chars == NULL) {
+        pcinst_set_error(PURC_ERROR_INVALID_VALUE);
+        return -1;
+    }
+
+    if (max == 0)
+        return 0;
+
+    /* only the characters in the window are decoded */
+    const uint8_t* bytes;
+    ssize_t avail = window_fill (rws, &bytes, 1);
+    if (avail <= 0) {
+        return avail;
+    }
+
+    size_t n = avail;
+    size_t nr = 0;
+    size_t i = 0;
+    while (nr < max && i < n) {
+        /* the ASCII characters, eight bytes at a time */
+        while (nr + 8 <= max && i + 8 <= n) {
+            uint64_t w;
+            memcpy(&w, bytes + i, sizeof(w));
+            if (w & PCUTILS_SWAR_HIGHS)
+                break;
+            for (int j = 0; j < 8; j++)
+                chars[nr + j] = bytes[i + j];
+            nr += 8;
+            i += 8;
+        }
+        while (nr < max && i < n && bytes[i] < 0x80) {
+            chars[nr++] = bytes[i++];
+        }
+        if (nr == max || i == n)
+            break;
+
+        /* a multi-byte character complete and valid in the window */
+        int ch_len = utf8_seq_len (bytes[i]);
+        size_t nr_chars;
+        if (ch_len < 2 || ch_len > 3 || i + ch_len > n ||
+                !pcutils_string_check_utf8_len((const char*)bytes + i,
+                    ch_len, &nr_chars, NULL))
+            break;
+
+        chars[nr++] = utf8_to_uint32_t(bytes + i, ch_len);
+        i += ch_len;
+    }
+
+    window_consume (rws, i);
+    if (nr > 0)
+        return nr;
+
+    /* leave the others to the one by one way for the errors */
+    char utf8[8];
+    int ret = purc_rwstream_read_utf8_char (rws, utf8, chars);
+    if (ret < 0)
+        return -1;
+    return ret > 0 ? 1 : 0;
+}
+
+int pcrwstream_unread_utf8_chars (purc_rwstream_t rws, const uint32_t* chars,
+        size_t nr)
+{
+    /* the characters decoded are never longer than three bytes */
+    size_t len = 0;
+    for (size_t i = 0; i < nr; i++) {
+        len += (chars[i] < 0x80) ? 1 : ((chars[i] < 0x800) ? 2 : 3);
+    }
+
+    if (rws->funcs == &mem_funcs) {
+        struct mem_rwstream* mem = (struct mem_rwstream *)rws;
+        if ((size_t)(mem->here - mem->base) >= len) {
+            mem->here -= len;
+            return 0;
+        }
+    }
+    else if (rws->funcs == &buffer_funcs) {
+        struct buffer_rwstream* buffer = (struct buffer_rwstream *)rws;
+        if ((size_t)(buffer->here - buffer->base) >= len) {
+            buffer->here -= len;
+            return 0;
+        }
+    }
+    else if (rws->ra_pos >= len) {
+        rws->ra_pos -= len;
+        return 0;
+    }
+
+    pcinst_set_error(PURC_ERROR_INVALID_VALUE);
+    return -1;
+}
+
 ssize_t purc_rwstream_write (purc_rwstream_t rws, const void* buf, size_t count)
 {
     if (rws == NULL) {
@@ -564,6 +789,14 @@ ssize_t purc_rwstream_write (purc_rwstream_t rws, const void* buf, size_t count)
         return -1;
     }
 
+    /* write at the position of the reader if the stream is seekable;
+       otherwise, the reading and the writing are independent. */
+    if (ra_pending(rws) > 0 && rws->funcs->seek) {
+        if (rws->funcs->seek(rws, -(off_t)ra_pending(rws), SEEK_CUR) < 0)
+            return -1;
+        ra_drop(rws);
+    }
+
     if (rws->funcs->write)
         return rws->funcs->write(rws, buf, count);
 
@@ -679,6 +912,26 @@ static ssize_t stdio_read (purc_rwstream_t rws, void* buf, size_t count)
 
 }
 
+/* fread() waits for all the bytes asked for, so the read-ahead buffer only
+   takes the bytes needed from a stdio stream, which is buffered anyway. */
+static ssize_t stdio_read_ahead (purc_rwstream_t rws, uint8_t* buf,
+        size_t count)
+{
+    struct stdio_rwstream* stdio = (struct stdio_rwstream *)rws;
+    size_t nread = 0;
+    while (nread < count) {
+        int c = getc(stdio->fp);
+        if (c == EOF) {
+            if (nread == 0 && ferror(stdio->fp)) {
+                pcinst_set_error(PCRWSTREAM_ERROR_IO);
+            }
+            break;
+        }
+        buf[nread++] = (uint8_t)c;
+    }
+    return nread;
+}
+
 static ssize_t stdio_write (purc_rwstream_t rws, const void* buf, size_t count)
 {
     struct stdio_rwstream* stdio = (struct stdio_rwstream *)rws;
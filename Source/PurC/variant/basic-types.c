@@ -32,9 +32,11 @@
 #include "private/tls.h"
 #include "private/variant.h"
 #include "private/utf8.h"
+#include "private/hashtable.h"
 
 #include "variant-internals.h"
 
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -44,6 +46,59 @@
 
 #define IS_TYPE(v, t)   (v->type == t)
 
+/* Sets the number of characters of a string, an atom string, or
+   an exception; this also resets the cached hash value. */
+static inline void
+set_nr_chars(purc_variant_t value, size_t nr_chars)
+{
+#if USE(HASH_CACHE_FOR_STRINGS)
+    value->extra_dwords[0] = (nr_chars < UINT32_MAX) ?
+        (uint32_t)nr_chars : UINT32_MAX;
+    value->extra_dwords[1] = 0;
+#else
+    value->extra_size = nr_chars;
+#endif
+}
+
+static inline size_t
+get_nr_chars(purc_variant_t value)
+{
+#if USE(HASH_CACHE_FOR_STRINGS)
+    if (value->extra_dwords[0] == UINT32_MAX) {
+        const char *str = purc_variant_get_string_const(value);
+        return pcutils_string_utf8_chars(str, -1);
+    }
+
+    return value->extra_dwords[0];
+#else
+    return value->extra_size;
+#endif
+}
+
+uint32_t pcvariant_cstr_hash(const char *str)
+{
+    uint32_t hash = (uint32_t)pchash_default_char_hash(str);
+
+    /* 0 is reserved for the hash value not calculated yet. */
+    return hash ? hash : 1;
+}
+
+uint32_t pcvariant_string_hash(purc_variant_t string)
+{
+    PC_ASSERT(IS_TYPE(string, PURC_VARIANT_TYPE_STRING));
+
+#if USE(HASH_CACHE_FOR_STRINGS)
+    if (string->extra_dwords[1] == 0) {
+        string->extra_dwords[1] =
+            pcvariant_cstr_hash(purc_variant_get_string_const(string));
+    }
+
+    return string->extra_dwords[1];
+#else
+    return pcvariant_cstr_hash(purc_variant_get_string_const(string));
+#endif
+}
+
 // API for variant
 purc_variant_t purc_variant_make_undefined (void)
 {
@@ -98,8 +153,8 @@ purc_variant_t purc_variant_make_exception(purc_atom_t except_atom)
     value->flags = 0;
     value->refc = 1;
     value->atom = except_atom;
-    value->extra_size = pcutils_string_utf8_chars(
-            purc_atom_to_string(except_atom), -1);
+    set_nr_chars(value, pcutils_string_utf8_chars(
+            purc_atom_to_string(except_atom), -1));
     return value;
 }
 
@@ -119,7 +174,18 @@ const char* purc_variant_get_exception_string_const (purc_variant_t v)
 
 purc_variant_t purc_variant_make_number (double d)
 {
-    purc_variant_t value = pcvariant_get (PURC_VARIANT_TYPE_NUMBER);
+    purc_variant_t value;
+
+    /* -0.0 is not shared for keeping the sign */
+    if (d >= PCVARIANT_MIN_SHARED_INT && d <= PCVARIANT_MAX_SHARED_INT &&
+            d == (double)(int64_t)d && (d != 0 || !signbit(d))) {
+        value = pcvariant_get_shared_int(PURC_VARIANT_TYPE_NUMBER,
+                (int64_t)d);
+        if (value)
+            return value;
+    }
+
+    value = pcvariant_get (PURC_VARIANT_TYPE_NUMBER);
 
     if (value == NULL) {
         pcinst_set_error (PURC_ERROR_OUT_OF_MEMORY);
@@ -137,7 +203,16 @@ purc_variant_t purc_variant_make_number (double d)
 
 purc_variant_t purc_variant_make_ulongint (uint64_t u64)
 {
-    purc_variant_t value = pcvariant_get (PURC_VARIANT_TYPE_ULONGINT);
+    purc_variant_t value;
+
+    if (u64 <= PCVARIANT_MAX_SHARED_INT) {
+        value = pcvariant_get_shared_int(PURC_VARIANT_TYPE_ULONGINT,
+                (int64_t)u64);
+        if (value)
+            return value;
+    }
+
+    value = pcvariant_get (PURC_VARIANT_TYPE_ULONGINT);
 
     if (value == NULL) {
         pcinst_set_error (PURC_ERROR_OUT_OF_MEMORY);
@@ -155,7 +230,12 @@ purc_variant_t purc_variant_make_ulongint (uint64_t u64)
 
 purc_variant_t purc_variant_make_longint (int64_t i64)
 {
-    purc_variant_t value = pcvariant_get (PURC_VARIANT_TYPE_LONGINT);
+    purc_variant_t value = pcvariant_get_shared_int(PURC_VARIANT_TYPE_LONGINT,
+            i64);
+    if (value)
+        return value;
+
+    value = pcvariant_get (PURC_VARIANT_TYPE_LONGINT);
 
     if (value == NULL) {
         pcinst_set_error (PURC_ERROR_OUT_OF_MEMORY);
@@ -228,7 +308,7 @@ purc_variant_make_string_ex(const char* str_utf8, size_t len,
     value->type = PURC_VARIANT_TYPE_STRING;
     value->flags = 0;
     value->refc = 1;
-    value->extra_size = nr_chars;
+    set_nr_chars(value, nr_chars);
 
     if (len < sz_bytes) {
         memcpy(value->bytes, str_utf8, len);
@@ -295,7 +375,7 @@ purc_variant_t purc_variant_make_string_reuse_buff(char* str_utf8,
     value->type = PURC_VARIANT_TYPE_STRING;
     value->flags = PCVARIANT_FLAG_EXTRA_SIZE;
     value->refc = 1;
-    value->extra_size = nr_chars;
+    set_nr_chars(value, nr_chars);
 
     value->sz_ptr[1] = (uintptr_t)(str_utf8);
     pcvariant_stat_set_extra_size(value, len);
@@ -332,7 +412,7 @@ purc_variant_t purc_variant_make_string_static(const char* str_utf8,
     value->type = PURC_VARIANT_TYPE_STRING;
     value->flags = PCVARIANT_FLAG_STRING_STATIC;
     value->refc = 1;
-    value->extra_size = nr_chars;
+    set_nr_chars(value, nr_chars);
     value->sz_ptr[0] = (uintptr_t)strlen(str_utf8) + 1;
     value->sz_ptr[1] = (uintptr_t)str_utf8;
 
@@ -402,7 +482,7 @@ bool purc_variant_string_chars(purc_variant_t string, size_t *nr_chars)
         IS_TYPE(string, PURC_VARIANT_TYPE_ATOMSTRING) ||
         IS_TYPE(string, PURC_VARIANT_TYPE_EXCEPTION)) {
 
-        *nr_chars = string->extra_size;
+        *nr_chars = get_nr_chars(string);
         return true;
     }
 
@@ -462,7 +542,7 @@ purc_variant_make_atom_string (const char* str_utf8, bool check_encoding)
     value->flags = 0;
     value->refc = 1;
     value->atom = atom;
-    value->extra_size = nr_chars;
+    set_nr_chars(value, nr_chars);
 
     return value;
 }
@@ -506,7 +586,7 @@ purc_variant_make_atom_string_static(const char* str_utf8,
     value->flags = PCVARIANT_FLAG_STRING_STATIC;
     value->refc = 1;
     value->atom = atom;
-    value->extra_size = nr_chars;
+    set_nr_chars(value, nr_chars);
 
     return value;
 }
@@ -0,0 +1,923 @@
+/*
+ * @file binary.c
+ * @date 2026/10/16
+ * @brief The binary serialization of variants.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "private/variant.h"
+#include "private/errors.h"
+#include "private/map.h"
+
+#include "variant-internals.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#if HAVE(MMAP)
+#include <sys/mman.h>
+#endif
+
+/*
+ * The layout of the binary data:
+ *
+ *  - the magic `PCVB` and a byte for the version;
+ *  - the string table: the number of strings, then the strings, each of
+ *    which is the length followed by the bytes without the terminating
+ *    null character;
+ *  - the root value.
+ *
+ * A value begins with a byte for its type (enum bin_tag), followed by:
+ *
+ *  - nothing for undefined, null, true, and false;
+ *  - the index in the string table for an exception and an atom string;
+ *  - 8 bytes in little endian for a number;
+ *  - a zigzag varint for a longint, and a varint for a ulongint;
+ *  - two numbers (the high and low parts) for a long double;
+ *  - the length and the bytes for a string and a byte sequence;
+ *  - the number of members and the members for an array and a tuple;
+ *  - the number of members and the pairs of the key index and the member
+ *    for an object;
+ *  - a byte for the flags, the index of the unique keys (only if the set
+ *    is not a generic one), the number of members, and the members for
+ *    a set.
+ *
+ * All lengths, numbers, and indexes are unsigned LEB128 varints. The keys
+ * of the objects and the unique keys of the sets are stored in the string
+ * table once, however many times they are used.
+ */
+#define BIN_MAGIC               "PCVB"
+#define BIN_VERSION             1
+#define BIN_MAX_DEPTH           512
+
+enum bin_tag {
+    BIN_TAG_UNDEFINED = 0,
+    BIN_TAG_NULL,
+    BIN_TAG_FALSE,
+    BIN_TAG_TRUE,
+    BIN_TAG_EXCEPTION,
+    BIN_TAG_NUMBER,
+    BIN_TAG_LONGINT,
+    BIN_TAG_ULONGINT,
+    BIN_TAG_LONGDOUBLE,
+    BIN_TAG_ATOMSTRING,
+    BIN_TAG_STRING,
+    BIN_TAG_BSEQUENCE,
+    BIN_TAG_OBJECT,
+    BIN_TAG_ARRAY,
+    BIN_TAG_SET,
+    BIN_TAG_TUPLE,
+};
+
+#define BIN_SET_FLAG_KEYED      0x01
+#define BIN_SET_FLAG_CASELESS   0x02
+
+struct bin_buf {
+    unsigned char  *bytes;
+    size_t          len;
+    size_t          sz;
+};
+
+struct bin_writer {
+    struct bin_buf  values;
+
+    // key: the string; val: the index in the table
+    pcutils_map    *str_map;
+    const char    **strs;
+    size_t          nr_strs;
+    size_t          sz_strs;
+};
+
+static int
+buf_reserve(struct bin_buf *buf, size_t n)
+{
+    if (buf->len + n <= buf->sz)
+        return 0;
+
+    size_t sz = buf->sz ? buf->sz : 256;
+    while (sz < buf->len + n)
+        sz *= 2;
+
+    unsigned char *bytes = realloc(buf->bytes, sz);
+    if (bytes == NULL) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+
+    buf->bytes = bytes;
+    buf->sz = sz;
+    return 0;
+}
+
+static int
+buf_write(struct bin_buf *buf, const void *data, size_t n)
+{
+    if (buf_reserve(buf, n))
+        return -1;
+
+    memcpy(buf->bytes + buf->len, data, n);
+    buf->len += n;
+    return 0;
+}
+
+static int
+buf_write_byte(struct bin_buf *buf, unsigned char byte)
+{
+    return buf_write(buf, &byte, 1);
+}
+
+static int
+buf_write_varint(struct bin_buf *buf, uint64_t u)
+{
+    unsigned char bytes[10];
+    size_t n = 0;
+
+    do {
+        bytes[n] = u & 0x7F;
+        u >>= 7;
+        if (u)
+            bytes[n] |= 0x80;
+        n++;
+    } while (u);
+
+    return buf_write(buf, bytes, n);
+}
+
+static int
+buf_write_double(struct bin_buf *buf, double d)
+{
+    uint64_t u;
+    unsigned char bytes[8];
+
+    memcpy(&u, &d, sizeof(u));
+    for (int i = 0; i < 8; i++) {
+        bytes[i] = (unsigned char)(u & 0xFF);
+        u >>= 8;
+    }
+
+    return buf_write(buf, bytes, sizeof(bytes));
+}
+
+static int
+buf_write_bytes(struct bin_buf *buf, const void *data, size_t n)
+{
+    if (buf_write_varint(buf, n))
+        return -1;
+    return buf_write(buf, data, n);
+}
+
+/* writes the index of a string in the table, adds it if it is new. */
+static int
+write_str_index(struct bin_writer *wr, const char *str)
+{
+    pcutils_map_entry *entry = pcutils_map_find(wr->str_map, str);
+    if (entry)
+        return buf_write_varint(&wr->values, (uintptr_t)entry->val);
+
+    if (wr->nr_strs == wr->sz_strs) {
+        size_t sz = wr->sz_strs ? wr->sz_strs * 2 : 16;
+        const char **strs = realloc(wr->strs, sizeof(*strs) * sz);
+        if (strs == NULL) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return -1;
+        }
+        wr->strs = strs;
+        wr->sz_strs = sz;
+    }
+
+    size_t idx = wr->nr_strs;
+    if (pcutils_map_insert(wr->str_map, str, (void *)(uintptr_t)idx)) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+
+    wr->strs[wr->nr_strs++] = str;
+    return buf_write_varint(&wr->values, idx);
+}
+
+static int
+write_value(struct bin_writer *wr, purc_variant_t v);
+
+static int
+write_members(struct bin_writer *wr, purc_variant_t *members, size_t nr)
+{
+    if (buf_write_varint(&wr->values, nr))
+        return -1;
+
+    for (size_t i = 0; i < nr; i++) {
+        if (write_value(wr, members[i]))
+            return -1;
+    }
+
+    return 0;
+}
+
+static int
+write_object(struct bin_writer *wr, purc_variant_t obj)
+{
+    purc_variant_t k, v;
+    size_t nr;
+
+    purc_variant_object_size(obj, &nr);
+    if (buf_write_varint(&wr->values, nr))
+        return -1;
+
+    foreach_key_value_in_variant_object(obj, k, v) {
+        if (write_str_index(wr, purc_variant_get_string_const(k)))
+            return -1;
+        if (write_value(wr, v))
+            return -1;
+    } end_foreach;
+
+    return 0;
+}
+
+static int
+write_set(struct bin_writer *wr, purc_variant_t set)
+{
+    variant_set_t data = pcvar_set_get_data(set);
+    unsigned char flags = 0;
+    purc_variant_t v;
+    size_t nr;
+
+    if (data->unique_key)
+        flags |= BIN_SET_FLAG_KEYED;
+    if (data->caseless)
+        flags |= BIN_SET_FLAG_CASELESS;
+
+    if (buf_write_byte(&wr->values, flags))
+        return -1;
+    if (data->unique_key && write_str_index(wr, data->unique_key))
+        return -1;
+
+    purc_variant_set_size(set, &nr);
+    if (buf_write_varint(&wr->values, nr))
+        return -1;
+
+    foreach_value_in_variant_set(set, v) {
+        if (write_value(wr, v))
+            return -1;
+    } end_foreach;
+
+    return 0;
+}
+
+static int
+write_value(struct bin_writer *wr, purc_variant_t v)
+{
+    struct bin_buf *buf = &wr->values;
+
+    switch (v->type) {
+    case PURC_VARIANT_TYPE_UNDEFINED:
+        return buf_write_byte(buf, BIN_TAG_UNDEFINED);
+
+    case PURC_VARIANT_TYPE_NULL:
+    // the runtime values are serialized as null, like the eJSON does.
+    case PURC_VARIANT_TYPE_DYNAMIC:
+    case PURC_VARIANT_TYPE_NATIVE:
+        return buf_write_byte(buf, BIN_TAG_NULL);
+
+    case PURC_VARIANT_TYPE_BOOLEAN:
+        return buf_write_byte(buf, v->b ? BIN_TAG_TRUE : BIN_TAG_FALSE);
+
+    case PURC_VARIANT_TYPE_EXCEPTION:
+    case PURC_VARIANT_TYPE_ATOMSTRING:
+        if (buf_write_byte(buf, v->type == PURC_VARIANT_TYPE_EXCEPTION ?
+                    BIN_TAG_EXCEPTION : BIN_TAG_ATOMSTRING))
+            return -1;
+        return write_str_index(wr, purc_atom_to_string(v->atom));
+
+    case PURC_VARIANT_TYPE_NUMBER:
+        if (buf_write_byte(buf, BIN_TAG_NUMBER))
+            return -1;
+        return buf_write_double(buf, v->d);
+
+    case PURC_VARIANT_TYPE_LONGINT:
+        if (buf_write_byte(buf, BIN_TAG_LONGINT))
+            return -1;
+        return buf_write_varint(buf,
+                ((uint64_t)v->i64 << 1) ^ (uint64_t)(v->i64 >> 63));
+
+    case PURC_VARIANT_TYPE_ULONGINT:
+        if (buf_write_byte(buf, BIN_TAG_ULONGINT))
+            return -1;
+        return buf_write_varint(buf, v->u64);
+
+    case PURC_VARIANT_TYPE_LONGDOUBLE: {
+        // the layout of long double differs between the platforms.
+        double hi = (double)v->ld;
+        double lo = (double)(v->ld - hi);
+        if (buf_write_byte(buf, BIN_TAG_LONGDOUBLE) ||
+                buf_write_double(buf, hi))
+            return -1;
+        return buf_write_double(buf, lo);
+    }
+
+    case PURC_VARIANT_TYPE_STRING: {
+        size_t len;
+        const char *str = purc_variant_get_string_const_ex(v, &len);
+        if (buf_write_byte(buf, BIN_TAG_STRING))
+            return -1;
+        return buf_write_bytes(buf, str, len);
+    }
+
+    case PURC_VARIANT_TYPE_BSEQUENCE: {
+        size_t nr;
+        const unsigned char *bytes = purc_variant_get_bytes_const(v, &nr);
+        if (buf_write_byte(buf, BIN_TAG_BSEQUENCE))
+            return -1;
+        return buf_write_bytes(buf, bytes, nr);
+    }
+
+    case PURC_VARIANT_TYPE_OBJECT:
+        if (buf_write_byte(buf, BIN_TAG_OBJECT))
+            return -1;
+        return write_object(wr, v);
+
+    case PURC_VARIANT_TYPE_ARRAY: {
+        variant_arr_t data = variant_array_get_data(v);
+        if (buf_write_byte(buf, BIN_TAG_ARRAY))
+            return -1;
+        return write_members(wr, data->vals, data->nr);
+    }
+
+    case PURC_VARIANT_TYPE_SET:
+        if (buf_write_byte(buf, BIN_TAG_SET))
+            return -1;
+        return write_set(wr, v);
+
+    case PURC_VARIANT_TYPE_TUPLE: {
+        size_t nr;
+        purc_variant_t *members = tuple_members(v, &nr);
+        if (buf_write_byte(buf, BIN_TAG_TUPLE))
+            return -1;
+        return write_members(wr, members, nr);
+    }
+
+    default:
+        break;
+    }
+
+    pcinst_set_error(PCVARIANT_ERROR_INVALID_TYPE);
+    return -1;
+}
+
+ssize_t
+purc_variant_serialize_binary(purc_variant_t value, purc_rwstream_t stream)
+{
+    PCVARIANT_CHECK_FAIL_RET(value && stream, -1);
+
+    struct bin_writer wr = { };
+    struct bin_buf head = { };
+    ssize_t ret = -1;
+
+    wr.str_map = pcutils_map_create(NULL, NULL, NULL, NULL,
+            comp_key_string, false);
+    if (wr.str_map == NULL) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+
+    if (write_value(&wr, value))
+        goto done;
+
+    // the string table is known after all values are written.
+    if (buf_write(&head, BIN_MAGIC, sizeof(BIN_MAGIC) - 1) ||
+            buf_write_byte(&head, BIN_VERSION) ||
+            buf_write_varint(&head, wr.nr_strs))
+        goto done;
+
+    for (size_t i = 0; i < wr.nr_strs; i++) {
+        if (buf_write_bytes(&head, wr.strs[i], strlen(wr.strs[i])))
+            goto done;
+    }
+
+    if (purc_rwstream_write(stream, head.bytes, head.len) !=
+                (ssize_t)head.len ||
+            purc_rwstream_write(stream, wr.values.bytes, wr.values.len) !=
+                (ssize_t)wr.values.len) {
+        pcinst_set_error(PURC_ERROR_OUTPUT);
+        goto done;
+    }
+
+    ret = (ssize_t)(head.len + wr.values.len);
+
+done:
+    pcutils_map_destroy(wr.str_map);
+    free(wr.strs);
+    free(wr.values.bytes);
+    free(head.bytes);
+    return ret;
+}
+
+struct bin_reader {
+    const unsigned char    *p;
+    const unsigned char    *end;
+
+    // the strings in the table, not null-terminated.
+    const unsigned char   **strs;
+    size_t                 *lens;
+    size_t                  nr_strs;
+
+    unsigned int            depth;
+};
+
+static int
+read_varint(struct bin_reader *rd, uint64_t *u)
+{
+    unsigned int shift = 0;
+
+    *u = 0;
+    while (rd->p < rd->end && shift < 64) {
+        unsigned char byte = *rd->p++;
+        *u |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return 0;
+        shift += 7;
+    }
+
+    pcinst_set_error(PURC_ERROR_BAD_ENCODING);
+    return -1;
+}
+
+/* reads a length or a number of members, which must fit in the rest. */
+static int
+read_size(struct bin_reader *rd, size_t *sz)
+{
+    uint64_t u;
+    if (read_varint(rd, &u))
+        return -1;
+
+    if (u > (uint64_t)(rd->end - rd->p)) {
+        pcinst_set_error(PURC_ERROR_BAD_ENCODING);
+        return -1;
+    }
+
+    *sz = (size_t)u;
+    return 0;
+}
+
+static int
+read_double(struct bin_reader *rd, double *d)
+{
+    uint64_t u = 0;
+
+    if (rd->end - rd->p < 8) {
+        pcinst_set_error(PURC_ERROR_BAD_ENCODING);
+        return -1;
+    }
+
+    for (int i = 7; i >= 0; i--)
+        u = (u << 8) | rd->p[i];
+    rd->p += 8;
+
+    memcpy(d, &u, sizeof(*d));
+    return 0;
+}
+
+/* reads the index of a string and copies the string to a null-terminated
+   one, which should be freed if it is not `buf`. */
+static char *
+read_str(struct bin_reader *rd, char *buf, size_t sz_buf)
+{
+    uint64_t idx;
+    if (read_varint(rd, &idx))
+        return NULL;
+
+    if (idx >= rd->nr_strs) {
+        pcinst_set_error(PURC_ERROR_BAD_ENCODING);
+        return NULL;
+    }
+
+    size_t len = rd->lens[idx];
+    char *str = buf;
+    if (len >= sz_buf) {
+        str = malloc(len + 1);
+        if (str == NULL) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return NULL;
+        }
+    }
+
+    memcpy(str, rd->strs[idx], len);
+    str[len] = '\0';
+    return str;
+}
+
+#define STR_BUF_SIZE    64
+
+static purc_variant_t
+read_value(struct bin_reader *rd);
+
+static purc_variant_t
+read_atom(struct bin_reader *rd, bool exception)
+{
+    char buf[STR_BUF_SIZE];
+    char *str = read_str(rd, buf, sizeof(buf));
+    if (str == NULL)
+        return PURC_VARIANT_INVALID;
+
+    purc_variant_t retv = PURC_VARIANT_INVALID;
+    if (exception) {
+        purc_atom_t atom;
+        atom = purc_atom_try_string_ex(PURC_ATOM_BUCKET_EXCEPT, str);
+        if (atom)
+            retv = purc_variant_make_exception(atom);
+        else
+            pcinst_set_error(PURC_ERROR_BAD_ENCODING);
+    }
+    else {
+        retv = purc_variant_make_atom_string(str, false);
+    }
+
+    if (str != buf)
+        free(str);
+    return retv;
+}
+
+static purc_variant_t
+read_object(struct bin_reader *rd)
+{
+    size_t nr;
+    if (read_size(rd, &nr))
+        return PURC_VARIANT_INVALID;
+
+    purc_variant_t obj = pcvar_make_obj();
+    if (obj == PURC_VARIANT_INVALID)
+        return PURC_VARIANT_INVALID;
+
+    for (size_t i = 0; i < nr; i++) {
+        char buf[STR_BUF_SIZE];
+        char *str = read_str(rd, buf, sizeof(buf));
+        if (str == NULL)
+            goto failed;
+
+        purc_variant_t k = purc_variant_make_string(str, false);
+        if (str != buf)
+            free(str);
+        if (k == PURC_VARIANT_INVALID)
+            goto failed;
+
+        purc_variant_t v = read_value(rd);
+        if (v == PURC_VARIANT_INVALID) {
+            purc_variant_unref(k);
+            goto failed;
+        }
+
+        int r = pcvar_obj_set(obj, k, v);
+        purc_variant_unref(k);
+        purc_variant_unref(v);
+        if (r)
+            goto failed;
+    }
+
+    return obj;
+
+failed:
+    purc_variant_unref(obj);
+    return PURC_VARIANT_INVALID;
+}
+
+static purc_variant_t
+read_array(struct bin_reader *rd)
+{
+    size_t nr;
+    if (read_size(rd, &nr))
+        return PURC_VARIANT_INVALID;
+
+    purc_variant_t arr = pcvar_make_arr();
+    if (arr == PURC_VARIANT_INVALID)
+        return PURC_VARIANT_INVALID;
+
+    for (size_t i = 0; i < nr; i++) {
+        purc_variant_t v = read_value(rd);
+        if (v == PURC_VARIANT_INVALID)
+            goto failed;
+
+        int r = pcvar_arr_append(arr, v);
+        purc_variant_unref(v);
+        if (r)
+            goto failed;
+    }
+
+    return arr;
+
+failed:
+    purc_variant_unref(arr);
+    return PURC_VARIANT_INVALID;
+}
+
+static purc_variant_t
+read_set(struct bin_reader *rd)
+{
+    if (rd->p >= rd->end) {
+        pcinst_set_error(PURC_ERROR_BAD_ENCODING);
+        return PURC_VARIANT_INVALID;
+    }
+
+    unsigned char flags = *rd->p++;
+    char buf[STR_BUF_SIZE];
+    char *unique_key = NULL;
+    if (flags & BIN_SET_FLAG_KEYED) {
+        unique_key = read_str(rd, buf, sizeof(buf));
+        if (unique_key == NULL)
+            return PURC_VARIANT_INVALID;
+    }
+
+    purc_variant_t set = purc_variant_make_set_by_ckey_ex(0, unique_key,
+            (flags & BIN_SET_FLAG_CASELESS) ? true : false,
+            PURC_VARIANT_INVALID);
+    if (unique_key && unique_key != buf)
+        free(unique_key);
+    if (set == PURC_VARIANT_INVALID)
+        return PURC_VARIANT_INVALID;
+
+    size_t nr;
+    if (read_size(rd, &nr))
+        goto failed;
+
+    for (size_t i = 0; i < nr; i++) {
+        purc_variant_t v = read_value(rd);
+        if (v == PURC_VARIANT_INVALID)
+            goto failed;
+
+        int r = pcvar_set_add(set, v);
+        purc_variant_unref(v);
+        if (r)
+            goto failed;
+    }
+
+    return set;
+
+failed:
+    purc_variant_unref(set);
+    return PURC_VARIANT_INVALID;
+}
+
+static purc_variant_t
+read_tuple(struct bin_reader *rd)
+{
+    size_t nr;
+    if (read_size(rd, &nr))
+        return PURC_VARIANT_INVALID;
+
+    purc_variant_t tuple = purc_variant_make_tuple(nr, NULL);
+    if (tuple == PURC_VARIANT_INVALID)
+        return PURC_VARIANT_INVALID;
+
+    for (size_t i = 0; i < nr; i++) {
+        purc_variant_t v = read_value(rd);
+        if (v == PURC_VARIANT_INVALID)
+            goto failed;
+
+        purc_variant_tuple_set(tuple, i, v);
+        purc_variant_unref(v);
+    }
+
+    return tuple;
+
+failed:
+    purc_variant_unref(tuple);
+    return PURC_VARIANT_INVALID;
+}
+
+static purc_variant_t
+read_container(struct bin_reader *rd, enum bin_tag tag)
+{
+    purc_variant_t retv = PURC_VARIANT_INVALID;
+
+    if (rd->depth >= BIN_MAX_DEPTH) {
+        pcinst_set_error(PURC_ERROR_BAD_ENCODING);
+        return PURC_VARIANT_INVALID;
+    }
+
+    rd->depth++;
+    switch (tag) {
+    case BIN_TAG_OBJECT:
+        retv = read_object(rd);
+        break;
+    case BIN_TAG_ARRAY:
+        retv = read_array(rd);
+        break;
+    case BIN_TAG_SET:
+        retv = read_set(rd);
+        break;
+    case BIN_TAG_TUPLE:
+        retv = read_tuple(rd);
+        break;
+    default:
+        PC_ASSERT(0);
+        break;
+    }
+    rd->depth--;
+
+    return retv;
+}
+
+static purc_variant_t
+read_value(struct bin_reader *rd)
+{
+    if (rd->p >= rd->end) {
+        pcinst_set_error(PURC_ERROR_BAD_ENCODING);
+        return PURC_VARIANT_INVALID;
+    }
+
+    enum bin_tag tag = (enum bin_tag)*rd->p++;
+    uint64_t u;
+    double d, lo;
+    size_t len;
+
+    switch (tag) {
+    case BIN_TAG_UNDEFINED:
+        return purc_variant_make_undefined();
+
+    case BIN_TAG_NULL:
+        return purc_variant_make_null();
+
+    case BIN_TAG_FALSE:
+    case BIN_TAG_TRUE:
+        return purc_variant_make_boolean(tag == BIN_TAG_TRUE);
+
+    case BIN_TAG_EXCEPTION:
+    case BIN_TAG_ATOMSTRING:
+        return read_atom(rd, tag == BIN_TAG_EXCEPTION);
+
+    case BIN_TAG_NUMBER:
+        if (read_double(rd, &d))
+            return PURC_VARIANT_INVALID;
+        return purc_variant_make_number(d);
+
+    case BIN_TAG_LONGINT:
+        if (read_varint(rd, &u))
+            return PURC_VARIANT_INVALID;
+        return purc_variant_make_longint((int64_t)(u >> 1) ^ -(int64_t)(u & 1));
+
+    case BIN_TAG_ULONGINT:
+        if (read_varint(rd, &u))
+            return PURC_VARIANT_INVALID;
+        return purc_variant_make_ulongint(u);
+
+    case BIN_TAG_LONGDOUBLE:
+        if (read_double(rd, &d) || read_double(rd, &lo))
+            return PURC_VARIANT_INVALID;
+        return purc_variant_make_longdouble((long double)d + lo);
+
+    case BIN_TAG_STRING:
+        if (read_size(rd, &len))
+            return PURC_VARIANT_INVALID;
+        rd->p += len;
+        return purc_variant_make_string_ex((const char *)rd->p - len, len,
+                true);
+
+    case BIN_TAG_BSEQUENCE:
+        if (read_size(rd, &len))
+            return PURC_VARIANT_INVALID;
+        rd->p += len;
+        if (len == 0)
+            return purc_variant_make_byte_sequence_empty();
+        return purc_variant_make_byte_sequence(rd->p - len, len);
+
+    case BIN_TAG_OBJECT:
+    case BIN_TAG_ARRAY:
+    case BIN_TAG_SET:
+    case BIN_TAG_TUPLE:
+        return read_container(rd, tag);
+
+    default:
+        break;
+    }
+
+    pcinst_set_error(PURC_ERROR_BAD_ENCODING);
+    return PURC_VARIANT_INVALID;
+}
+
+purc_variant_t
+purc_variant_load_from_binary(const void *buf, size_t sz)
+{
+    PCVARIANT_CHECK_FAIL_RET(buf, PURC_VARIANT_INVALID);
+
+    struct bin_reader rd = { };
+    purc_variant_t retv = PURC_VARIANT_INVALID;
+    size_t nr_strs;
+
+    rd.p = buf;
+    rd.end = rd.p + sz;
+
+    if (sz < sizeof(BIN_MAGIC) ||
+            memcmp(rd.p, BIN_MAGIC, sizeof(BIN_MAGIC) - 1) ||
+            rd.p[sizeof(BIN_MAGIC) - 1] != BIN_VERSION) {
+        pcinst_set_error(PURC_ERROR_BAD_ENCODING);
+        return PURC_VARIANT_INVALID;
+    }
+    rd.p += sizeof(BIN_MAGIC);
+
+    if (read_size(&rd, &nr_strs))
+        return PURC_VARIANT_INVALID;
+
+    if (nr_strs > 0) {
+        rd.strs = malloc(sizeof(*rd.strs) * nr_strs);
+        rd.lens = malloc(sizeof(*rd.lens) * nr_strs);
+        if (rd.strs == NULL || rd.lens == NULL) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            goto done;
+        }
+
+        for (; rd.nr_strs < nr_strs; rd.nr_strs++) {
+            if (read_size(&rd, rd.lens + rd.nr_strs))
+                goto done;
+            rd.strs[rd.nr_strs] = rd.p;
+            rd.p += rd.lens[rd.nr_strs];
+        }
+    }
+
+    retv = read_value(&rd);
+    if (retv != PURC_VARIANT_INVALID && rd.p != rd.end) {
+        pcinst_set_error(PURC_ERROR_BAD_ENCODING);
+        purc_variant_unref(retv);
+        retv = PURC_VARIANT_INVALID;
+    }
+
+done:
+    free(rd.strs);
+    free(rd.lens);
+    return retv;
+}
+
+purc_variant_t
+purc_variant_load_from_binary_file(const char *file)
+{
+    PCVARIANT_CHECK_FAIL_RET(file, PURC_VARIANT_INVALID);
+
+    purc_variant_t retv = PURC_VARIANT_INVALID;
+    struct stat st;
+    void *buf;
+
+    int fd = open(file, O_RDONLY);
+    if (fd < 0) {
+        purc_set_error(purc_error_from_errno(errno));
+        return PURC_VARIANT_INVALID;
+    }
+
+    if (fstat(fd, &st)) {
+        purc_set_error(purc_error_from_errno(errno));
+        goto done;
+    }
+
+    if (st.st_size == 0) {
+        purc_set_error(PURC_ERROR_BAD_ENCODING);
+        goto done;
+    }
+
+#if HAVE(MMAP)
+    // the members are decoded from the mapped pages without a copy.
+    buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (buf == MAP_FAILED) {
+        purc_set_error(purc_error_from_errno(errno));
+        goto done;
+    }
+
+    retv = purc_variant_load_from_binary(buf, st.st_size);
+    munmap(buf, st.st_size);
+#else
+    buf = malloc(st.st_size);
+    if (buf == NULL) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        goto done;
+    }
+
+    if (read(fd, buf, st.st_size) != st.st_size) {
+        purc_set_error(PURC_ERROR_BAD_SYSTEM_CALL);
+        free(buf);
+        goto done;
+    }
+
+    retv = purc_variant_load_from_binary(buf, st.st_size);
+    free(buf);
+#endif
+
+done:
+    close(fd);
+    return retv;
+}
@@ -25,6 +25,7 @@
 #include "purc-errors.h"
 #include "private/debug.h"
 #include "private/errors.h"
+#include "private/instance.h"
 #include "variant-internals.h"
 
 #include <stdlib.h>
@@ -226,7 +227,8 @@ rebuild_ex(purc_variant_t val, pcutils_map *cache)
 }
 
 static int
-reverse_check_chain(pcutils_map *chain, struct reverse_checker *checker)
+reverse_check_chain(pcutils_map *chain, purc_variant_t _old,
+        purc_variant_t _new, struct reverse_checker *checker)
 {
     int r = 0;
     do {
@@ -244,6 +246,14 @@ reverse_check_chain(pcutils_map *chain, struct reverse_checker *checker)
             purc_variant_t parent;
             parent = (purc_variant_t)entry->val;
 
+            // the member keeps its identity in a top-level keyed set
+            if (purc_variant_is_set(parent) &&
+                    !pcvar_container_belongs_to_set(parent) &&
+                    pcvar_set_keys_unchanged(parent, _old, _new)) {
+                pcutils_map_it_next(&it);
+                continue;
+            }
+
             // rebuild _new value for edge parent
             purc_variant_t _new = rebuild_ex(parent, checker->cache);
             if (_new == PURC_VARIANT_INVALID) {
@@ -310,15 +320,18 @@ again:
         switch (_old->type) {
             case PURC_VARIANT_TYPE_ARRAY:
                 arr_data = pcvar_arr_get_data(_old);
-                r = reverse_check_chain(arr_data->rev_update_chain, checker);
+                r = reverse_check_chain(arr_data->rev_update_chain,
+                        _old, _new, checker);
                 break;
             case PURC_VARIANT_TYPE_OBJECT:
                 obj_data = pcvar_obj_get_data(_old);
-                r = reverse_check_chain(obj_data->rev_update_chain, checker);
+                r = reverse_check_chain(obj_data->rev_update_chain,
+                        _old, _new, checker);
                 break;
             case PURC_VARIANT_TYPE_SET:
                 set_data = pcvar_set_get_data(_old);
-                r = reverse_check_chain(set_data->rev_update_chain, checker);
+                r = reverse_check_chain(set_data->rev_update_chain,
+                        _old, _new, checker);
                 break;
             default:
                 PC_ASSERT(0);
@@ -503,8 +516,8 @@ wind_up(struct reverse_checker *checker)
     return r ? -1 : 0;
 }
 
-void
-pcvar_adjust_set_by_descendant(purc_variant_t val)
+static void
+adjust_set_by_descendant(purc_variant_t val)
 {
     copy_key_fn copy_key = ref;
     free_key_fn free_key = unref;
@@ -559,3 +572,168 @@ pcvar_adjust_set_by_descendant(purc_variant_t val)
     PC_ASSERT(r == 0);
 }
 
+
+void
+pcvar_adjust_set_by_descendant(purc_variant_t val)
+{
+    struct pcvariant_heap *heap = pcinst_current()->variant_heap;
+
+    if (heap->batch_level > 0) {
+        if (heap->batch_changed == NULL) {
+            heap->batch_changed = pcutils_map_create(ref, unref,
+                    NULL, NULL, comp, false);
+        }
+
+        /* adjusted once at the end of the batch, however many times
+           the container changes in the batch */
+        if (heap->batch_changed &&
+                pcutils_map_find_replace_or_insert(heap->batch_changed,
+                    val, NULL, NULL) == 0)
+            return;
+    }
+
+    adjust_set_by_descendant(val);
+}
+
+void
+pcvar_adjust_sets_in_batch(void)
+{
+    struct pcvariant_heap *heap = pcinst_current()->variant_heap;
+    pcutils_map *changed = heap->batch_changed;
+
+    if (changed == NULL || pcutils_map_get_size(changed) == 0)
+        return;
+
+    struct pcutils_map_entry *entry;
+    struct pcutils_map_iterator it;
+    it = pcutils_map_it_begin_first(changed);
+    while ((entry = pcutils_map_it_value(&it))) {
+        adjust_set_by_descendant((purc_variant_t)entry->key);
+        pcutils_map_it_next(&it);
+    }
+    pcutils_map_it_end(&it);
+
+    pcutils_map_clear(changed);
+}
+
+/* the pairs of the old and the new members of a set changed in a batch */
+struct set_changes {
+    size_t          nr_vals;
+    size_t          sz_vals;
+    purc_variant_t *vals;
+};
+
+static void
+free_set_changes(void *val)
+{
+    struct set_changes *changes = (struct set_changes *)val;
+
+    for (size_t i = 0; i < changes->nr_vals; i++)
+        purc_variant_unref(changes->vals[i]);
+    free(changes->vals);
+    free(changes);
+}
+
+static struct set_changes *
+get_set_changes(struct pcvariant_heap *heap, purc_variant_t set)
+{
+    if (heap->batch_set_changes == NULL) {
+        heap->batch_set_changes = pcutils_map_create(ref, unref,
+                NULL, free_set_changes, comp, false);
+        if (heap->batch_set_changes == NULL)
+            return NULL;
+    }
+
+    struct pcutils_map_entry *entry;
+    entry = pcutils_map_find(heap->batch_set_changes, set);
+    if (entry)
+        return (struct set_changes *)entry->val;
+
+    struct set_changes *changes = calloc(1, sizeof(*changes));
+    if (changes && pcutils_map_insert(heap->batch_set_changes,
+                set, changes)) {
+        free(changes);
+        changes = NULL;
+    }
+    return changes;
+}
+
+void
+pcvar_set_post_changed(purc_variant_t set, size_t nr_vals,
+        purc_variant_t *vals)
+{
+    struct pcvariant_heap *heap = pcinst_current()->variant_heap;
+
+    if (heap->batch_level == 0 || !(set->flags & PCVARIANT_FLAG_LISTENED))
+        goto fire;
+
+    struct set_changes *changes = get_set_changes(heap, set);
+    if (changes == NULL)
+        goto fire;
+
+    if (changes->nr_vals + nr_vals > changes->sz_vals) {
+        size_t sz = changes->sz_vals ? changes->sz_vals * 2 : 8;
+        while (sz < changes->nr_vals + nr_vals)
+            sz *= 2;
+
+        purc_variant_t *p = realloc(changes->vals, sz * sizeof(*p));
+        if (p == NULL)
+            goto fire;
+        changes->vals = p;
+        changes->sz_vals = sz;
+    }
+
+    for (size_t i = 0; i < nr_vals; i++)
+        changes->vals[changes->nr_vals++] = purc_variant_ref(vals[i]);
+    return;
+
+fire:
+    pcvariant_on_post_fired(set, PCVAR_OPERATION_CHANGE, nr_vals, vals);
+}
+
+/* tells the listeners of every set changed in the batch once */
+static void
+post_set_changes_in_batch(struct pcvariant_heap *heap)
+{
+    pcutils_map *set_changes = heap->batch_set_changes;
+
+    if (set_changes == NULL)
+        return;
+
+    // the listeners may change the sets again
+    heap->batch_set_changes = NULL;
+
+    struct pcutils_map_entry *entry;
+    struct pcutils_map_iterator it;
+    it = pcutils_map_it_begin_first(set_changes);
+    while ((entry = pcutils_map_it_value(&it))) {
+        struct set_changes *changes = (struct set_changes *)entry->val;
+        if (changes->nr_vals) {
+            pcvariant_on_post_fired((purc_variant_t)entry->key,
+                    PCVAR_OPERATION_CHANGE, changes->nr_vals, changes->vals);
+        }
+        pcutils_map_it_next(&it);
+    }
+    pcutils_map_it_end(&it);
+
+    pcutils_map_destroy(set_changes);
+}
+
+void
+purc_variant_begin_batch(void)
+{
+    struct pcvariant_heap *heap = pcinst_current()->variant_heap;
+    heap->batch_level++;
+}
+
+void
+purc_variant_end_batch(void)
+{
+    struct pcvariant_heap *heap = pcinst_current()->variant_heap;
+    PC_ASSERT(heap->batch_level > 0);
+
+    if (--heap->batch_level == 0) {
+        pcvar_adjust_sets_in_batch();
+        post_set_changes_in_batch(heap);
+    }
+}
@@ -382,20 +382,6 @@ remove_set_member(void* ctxt, purc_variant_t member,
     return purc_variant_set_remove((purc_variant_t)ctxt, member, silently);
 }
 
-static bool
-add_set_member_override(void* ctxt, purc_variant_t member,
-        purc_variant_t member_extra, bool silently)
-{
-    UNUSED_PARAM(member_extra);
-    UNUSED_PARAM(silently);
-    purc_variant_t cloned = clone_if_necessary(member);
-    if (cloned == PURC_VARIANT_INVALID)
-        return false;
-    bool ok = purc_variant_set_add((purc_variant_t)ctxt, cloned, true);
-    purc_variant_unref(cloned);
-    return ok;
-}
-
 static bool
 set_member_overwrite(void* ctxt, purc_variant_t value,
         purc_variant_t value_extra, bool silently)
@@ -411,58 +397,6 @@ set_member_overwrite(void* ctxt, purc_variant_t value,
     return ok;
 }
 
-static bool
-subtract_set(void* ctxt, purc_variant_t value,
-        purc_variant_t member_extra, bool silently)
-{
-    UNUSED_PARAM(member_extra);
-
-    purc_variant_t set = (purc_variant_t) ctxt;
-
-    if (pcvariant_is_in_set(set, value)) {
-        return purc_variant_set_remove(set, value, silently);
-    }
-    return true;
-}
-
-static bool
-intersect_set(void* ctxt, purc_variant_t value,
-        purc_variant_t member_extra, bool silently)
-{
-    UNUSED_PARAM(member_extra);
-    UNUSED_PARAM(silently);
-    struct complex_ctxt* c_ctxt = (struct complex_ctxt*) ctxt;
-    purc_variant_t set = (purc_variant_t) c_ctxt->ctxt;
-    purc_variant_t result = (purc_variant_t) c_ctxt->extra;
-
-    purc_variant_t cloned = clone_if_necessary(value);
-    if (cloned == PURC_VARIANT_INVALID)
-        return false;
-    bool ok = pcvariant_is_in_set(set, value) ?
-        purc_variant_array_append(result, cloned) : true;
-    purc_variant_unref(cloned);
-    return ok;
-}
-
-static bool
-xor_set(void* ctxt, purc_variant_t value,
-        purc_variant_t member_extra, bool silently)
-{
-    UNUSED_PARAM(member_extra);
-
-    purc_variant_t set = (purc_variant_t) ctxt;
-
-    if (pcvariant_is_in_set(set, value)) {
-        return purc_variant_set_remove(set, value, silently);
-    }
-    purc_variant_t cloned = clone_if_necessary(value);
-    if (cloned == PURC_VARIANT_INVALID)
-        return false;
-    bool ok = purc_variant_set_add(set, cloned, silently);
-    purc_variant_unref(cloned);
-    return ok;
-}
-
 static bool
 object_displace(purc_variant_t dst, purc_variant_t src, bool silently)
 {
@@ -887,11 +821,8 @@ purc_variant_set_unite(purc_variant_t set,
         goto end;
     }
 
-    if (purc_variant_is_set(src)) {
-        ret = set_foreach(src, add_set_member_override, set, silently);
-    }
-    else if (purc_variant_is_array(src)) {
-        ret = array_foreach(src, add_set_member_override, set, silently);
+    if (purc_variant_is_set(src) || purc_variant_is_array(src)) {
+        ret = pcvar_set_join(set, src, PCVAR_SET_JOIN_UNITE) == 0;
     }
     else {
         SET_SILENT_ERROR(PURC_ERROR_WRONG_DATA_TYPE);
@@ -923,31 +854,14 @@ purc_variant_set_intersect(purc_variant_t set,
         goto end;
     }
 
-    purc_variant_t result = purc_variant_make_array(0, PURC_VARIANT_INVALID);
-    if (result == PURC_VARIANT_INVALID) {
-        goto end;
-    }
-
-    struct complex_ctxt c_ctxt;
-    c_ctxt.ctxt = (uintptr_t) set;
-    c_ctxt.extra = (uintptr_t) result;
-
-    if (purc_variant_is_set(src)) {
-        if(set_foreach(src, intersect_set, &c_ctxt, silently)) {
-            ret = set_displace(set, result, silently);
-        }
-    }
-    else if (purc_variant_is_array(src)) {
-        if(array_foreach(src, intersect_set, &c_ctxt, silently)) {
-            ret = set_displace(set, result, silently);
-        }
+    if (purc_variant_is_set(src) || purc_variant_is_array(src)) {
+        ret = pcvar_set_join(set, src, PCVAR_SET_JOIN_INTERSECT) == 0;
     }
     else {
         SET_SILENT_ERROR(PURC_ERROR_WRONG_DATA_TYPE);
         ret = false;
     }
 
-    purc_variant_unref(result);
 end:
     return ret;
 }
@@ -973,11 +887,8 @@ purc_variant_set_subtract(purc_variant_t set,
         goto end;
     }
 
-    if (purc_variant_is_set(src)) {
-        ret = set_foreach(src, subtract_set, set, silently);
-    }
-    else if (purc_variant_is_array(src)) {
-        ret = array_foreach(src, subtract_set, set, silently);
+    if (purc_variant_is_set(src) || purc_variant_is_array(src)) {
+        ret = pcvar_set_join(set, src, PCVAR_SET_JOIN_SUBTRACT) == 0;
     }
     else {
         SET_SILENT_ERROR(PURC_ERROR_WRONG_DATA_TYPE);
@@ -1009,11 +920,8 @@ purc_variant_set_xor(purc_variant_t set,
         goto end;
     }
 
-    if (purc_variant_is_set(src)) {
-        ret = set_foreach(src, xor_set, set, silently);
-    }
-    else if (purc_variant_is_array(src)) {
-        ret = array_foreach(src, xor_set, set, silently);
+    if (purc_variant_is_set(src) || purc_variant_is_array(src)) {
+        ret = pcvar_set_join(set, src, PCVAR_SET_JOIN_XOR) == 0;
     }
     else {
         SET_SILENT_ERROR(PURC_ERROR_WRONG_DATA_TYPE);
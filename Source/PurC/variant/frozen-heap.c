@@ -0,0 +1,367 @@
+/*
+ * @file frozen-heap.c
+ * @date 2026/10/16
+ * @brief The implementation of frozen variants shared by all instances.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "private/instance.h"
+#include "private/variant.h"
+#include "private/errors.h"
+
+#include "variant-internals.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * A frozen variant is a deep copy of a variant tree made in the frozen
+ * heap, which is owned by the process instead of any instance. The frozen
+ * variants can not be changed, and their reference counts are changed
+ * atomically, so they can be used by all instances without being moved
+ * or cloned.
+ *
+ * The frozen heap is only used to make and release the frozen variants,
+ * under the lock; reading a frozen variant does not need the lock. So
+ * everything cached lazily by the readers (the hash values of the strings,
+ * the order of the members in a set) is prepared when freezing, and no
+ * reverse update edge is built in a frozen variant, even if it is a member
+ * of a set.
+ */
+static struct purc_mutex        fh_lock;
+static struct pcvariant_heap    frozen_heap;
+
+static void frzheap_cleanup_once(void)
+{
+    if (fh_lock.native_impl)
+        purc_mutex_clear(&fh_lock);
+
+    struct purc_variant_stat *stat = &frozen_heap.stat;
+
+    PC_DEBUG("refc of v_undefined in frozen heap: %u\n",
+            frozen_heap.v_undefined.refc);
+    PC_DEBUG("refc of v_null in frozen heap: %u\n", frozen_heap.v_null.refc);
+    PC_DEBUG("refc of v_true in frozen heap: %u\n", frozen_heap.v_true.refc);
+    PC_DEBUG("refc of v_false in frozen heap: %u\n", frozen_heap.v_false.refc);
+    PC_DEBUG("total values in frozen heap: %u\n",
+            (unsigned int)stat->nr_total_values);
+    PC_DEBUG("total memory used by frozen heap: %u\n",
+            (unsigned int)stat->sz_total_mem);
+
+#if USE(SLAB_FOR_VARIANTS)
+    pcvariant_slab_cleanup(&frozen_heap);
+#endif
+}
+
+static int frzheap_init_once(void)
+{
+    /* the constants are referenced by all instances too */
+    frozen_heap.v_undefined.type = PURC_VARIANT_TYPE_UNDEFINED;
+    frozen_heap.v_undefined.refc = 0;
+    frozen_heap.v_undefined.flags =
+        PCVARIANT_FLAG_NOFREE | PCVARIANT_FLAG_FROZEN;
+
+    frozen_heap.v_null.type = PURC_VARIANT_TYPE_NULL;
+    frozen_heap.v_null.refc = 0;
+    frozen_heap.v_null.flags = PCVARIANT_FLAG_NOFREE | PCVARIANT_FLAG_FROZEN;
+
+    frozen_heap.v_false.type = PURC_VARIANT_TYPE_BOOLEAN;
+    frozen_heap.v_false.refc = 0;
+    frozen_heap.v_false.flags = PCVARIANT_FLAG_NOFREE | PCVARIANT_FLAG_FROZEN;
+    frozen_heap.v_false.b = false;
+
+    frozen_heap.v_true.type = PURC_VARIANT_TYPE_BOOLEAN;
+    frozen_heap.v_true.refc = 0;
+    frozen_heap.v_true.flags = PCVARIANT_FLAG_NOFREE | PCVARIANT_FLAG_FROZEN;
+    frozen_heap.v_true.b = true;
+
+    struct purc_variant_stat *stat = &frozen_heap.stat;
+    stat->sz_mem[PURC_VARIANT_TYPE_UNDEFINED] = sizeof(purc_variant);
+    stat->sz_mem[PURC_VARIANT_TYPE_NULL] = sizeof(purc_variant);
+    stat->sz_mem[PURC_VARIANT_TYPE_BOOLEAN] = sizeof(purc_variant) * 2;
+    stat->nr_total_values = 4;
+    stat->sz_total_mem = 4 * sizeof(purc_variant);
+
+    stat->nr_reserved = 0;
+    stat->nr_max_reserved = 0;  // no need to reserve variants for frozen heap.
+
+#if !USE(LOOP_BUFFER_FOR_RESERVED)
+    INIT_LIST_HEAD(&frozen_heap.v_reserved);
+#endif
+
+#if USE(SLAB_FOR_VARIANTS)
+    pcvariant_slab_init(&frozen_heap);
+#endif
+
+    purc_mutex_init(&fh_lock);
+    if (fh_lock.native_impl == NULL)
+        return -1;
+
+    int r;
+    r = atexit(frzheap_cleanup_once);
+    if (r)
+        goto fail_atexit;
+
+    return 0;
+
+fail_atexit:
+    purc_mutex_clear(&fh_lock);
+
+    return -1;
+}
+
+struct pcmodule _module_frzheap = {
+    .id              = PURC_HAVE_VARIANT,
+    .module_inited   = 0,
+
+    .init_once       = frzheap_init_once,
+    .init_instance   = NULL,
+};
+
+struct pcvariant_heap *
+pcvariant_use_frozen_heap(void)
+{
+    struct pcinst *inst = pcinst_current();
+    struct pcvariant_heap *heap = inst->variant_heap;
+
+    if (heap != &frozen_heap) {
+        purc_mutex_lock(&fh_lock);
+        inst->variant_heap = &frozen_heap;
+    }
+
+    return heap;
+}
+
+void
+pcvariant_restore_heap(struct pcvariant_heap *heap)
+{
+    if (heap != &frozen_heap) {
+        struct pcinst *inst = pcinst_current();
+        inst->variant_heap = heap;
+        purc_mutex_unlock(&fh_lock);
+    }
+}
+
+static purc_variant_t
+freeze_variant(purc_variant_t v);
+
+static purc_variant_t
+freeze_scalar(purc_variant_t v)
+{
+    purc_variant_t retv = PURC_VARIANT_INVALID;
+
+    switch (v->type) {
+    case PURC_VARIANT_TYPE_UNDEFINED:
+        retv = purc_variant_make_undefined();
+        break;
+
+    case PURC_VARIANT_TYPE_NULL:
+        retv = purc_variant_make_null();
+        break;
+
+    case PURC_VARIANT_TYPE_BOOLEAN:
+        retv = purc_variant_make_boolean(v->b);
+        break;
+
+    case PURC_VARIANT_TYPE_STRING: {
+        size_t len;
+        const char *str = purc_variant_get_string_const_ex(v, &len);
+        retv = purc_variant_make_string_ex(str, len, false);
+        if (retv)
+            pcvariant_string_hash(retv);
+        break;
+    }
+
+    case PURC_VARIANT_TYPE_BSEQUENCE: {
+        size_t nr;
+        const unsigned char *bytes = purc_variant_get_bytes_const(v, &nr);
+        if (nr)
+            retv = purc_variant_make_byte_sequence(bytes, nr);
+        else
+            retv = purc_variant_make_byte_sequence_empty();
+        break;
+    }
+
+    case PURC_VARIANT_TYPE_NATIVE:
+        // the native entity belongs to the instance.
+        pcinst_set_error(PCVARIANT_ERROR_NOT_SUPPORTED);
+        break;
+
+    default:
+        // the other values are held in the variant structure.
+        retv = pcvariant_get(v->type);
+        if (retv == PURC_VARIANT_INVALID) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            break;
+        }
+
+        memcpy(retv, v, sizeof(*retv));
+        retv->flags &= ~PCVARIANT_FLAG_NOFREE;  // a shared small integer
+        retv->refc = 1;
+        break;
+    }
+
+    return retv;
+}
+
+static purc_variant_t
+freeze_container(purc_variant_t v)
+{
+    purc_variant_t retv = PURC_VARIANT_INVALID;
+    purc_variant_t m, fm;
+    int r = 0;
+
+    switch (v->type) {
+    case PURC_VARIANT_TYPE_ARRAY: {
+        size_t idx;
+        retv = pcvar_make_arr();
+        if (retv == PURC_VARIANT_INVALID)
+            break;
+
+        foreach_value_in_variant_array(v, m, idx) {
+            UNUSED_PARAM(idx);
+            fm = freeze_variant(m);
+            if (fm == PURC_VARIANT_INVALID)
+                goto failed;
+            r = pcvar_arr_append(retv, fm);
+            purc_variant_unref(fm);
+            if (r)
+                goto failed;
+        } end_foreach;
+        break;
+    }
+
+    case PURC_VARIANT_TYPE_OBJECT: {
+        purc_variant_t k, fk;
+        retv = pcvar_make_obj();
+        if (retv == PURC_VARIANT_INVALID)
+            break;
+
+        foreach_key_value_in_variant_object(v, k, m) {
+            fk = freeze_variant(k);
+            if (fk == PURC_VARIANT_INVALID)
+                goto failed;
+            fm = freeze_variant(m);
+            if (fm == PURC_VARIANT_INVALID) {
+                purc_variant_unref(fk);
+                goto failed;
+            }
+            r = pcvar_obj_set(retv, fk, fm);
+            purc_variant_unref(fk);
+            purc_variant_unref(fm);
+            if (r)
+                goto failed;
+        } end_foreach;
+        break;
+    }
+
+    case PURC_VARIANT_TYPE_SET: {
+        retv = pcvar_set_clone_struct(v);
+        if (retv == PURC_VARIANT_INVALID)
+            break;
+
+        // NOTE: keep document-order
+        foreach_value_in_variant_set(v, m) {
+            fm = freeze_variant(m);
+            if (fm == PURC_VARIANT_INVALID)
+                goto failed;
+            r = pcvar_set_add(retv, fm);
+            purc_variant_unref(fm);
+            if (r)
+                goto failed;
+        } end_foreach;
+
+        size_t sz, nr;
+        purc_variant_set_size(retv, &sz);
+        if (sz > 0 && pcvar_set_ordered_nodes(retv, &nr) == NULL)
+            goto failed;
+        break;
+    }
+
+    case PURC_VARIANT_TYPE_TUPLE: {
+        size_t sz, idx;
+        purc_variant_tuple_size(v, &sz);
+        retv = purc_variant_make_tuple(sz, NULL);
+        if (retv == PURC_VARIANT_INVALID)
+            break;
+
+        for (idx = 0; idx < sz; idx++) {
+            fm = freeze_variant(purc_variant_tuple_get(v, idx));
+            if (fm == PURC_VARIANT_INVALID)
+                goto failed;
+            purc_variant_tuple_set(retv, idx, fm);
+            purc_variant_unref(fm);
+        }
+        break;
+    }
+
+    default:
+        PC_ASSERT(0);
+        break;
+    }
+
+    return retv;
+
+failed:
+    purc_variant_unref(retv);
+    return PURC_VARIANT_INVALID;
+}
+
+static purc_variant_t
+freeze_variant(purc_variant_t v)
+{
+    if (v->flags & PCVARIANT_FLAG_FROZEN)
+        return purc_variant_ref(v);
+
+    purc_variant_t retv;
+    if (pcvariant_is_mutable(v))
+        retv = freeze_container(v);
+    else
+        retv = freeze_scalar(v);
+
+    // the constants of the frozen heap have been flagged.
+    if (retv != PURC_VARIANT_INVALID && !(retv->flags & PCVARIANT_FLAG_FROZEN))
+        retv->flags |= PCVARIANT_FLAG_FROZEN;
+    return retv;
+}
+
+purc_variant_t
+purc_variant_freeze(purc_variant_t value)
+{
+    PCVARIANT_CHECK_FAIL_RET(value, PURC_VARIANT_INVALID);
+
+    if (value->flags & PCVARIANT_FLAG_FROZEN)
+        return purc_variant_ref(value);
+
+    struct pcvariant_heap *heap = pcvariant_use_frozen_heap();
+    purc_variant_t retv = freeze_variant(value);
+    pcvariant_restore_heap(heap);
+
+    return retv;
+}
+
+bool
+purc_variant_is_frozen(purc_variant_t value)
+{
+    PCVARIANT_CHECK_FAIL_RET(value, false);
+
+    return (value->flags & PCVARIANT_FLAG_FROZEN) ? true : false;
+}
@@ -32,70 +32,117 @@
 
 #include "variant-internals.h"
 
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
 
-static struct purc_mutex        mh_lock;
-static struct pcvariant_heap    move_heap;
+/* A move heap holds the variants in transit to an instance; every move
+   buffer has its own one, so the instances sending messages to different
+   instances never contend with each other.
+
+   The variants are moved by travelling the trees without holding the move
+   heap: the clones are allocated by the sender (the slab pages allow remote
+   frees), and the statistics moved are summed up in the travel context.
+   The sums and the references of the constants are merged into the move
+   heap at last, which is the only section needing the ownership of it. */
+struct pcvariant_move_heap {
+    struct pcvariant_heap   heap;
+    atomic_flag             busy;
+};
+
+enum {
+    MH_CONST_UNDEFINED = 0,
+    MH_CONST_NULL,
+    MH_CONST_FALSE,
+    MH_CONST_TRUE,
+    MH_NR_CONSTS,
+};
 
-static void mvheap_cleanup_once(void)
+struct travel_context {
+    struct pcinst *inst;
+    struct pcvariant_move_heap *mvheap;
+    struct pcutils_arrlist *vrts_to_unref;
+
+    // the statistics of the variants moved in or out.
+    struct purc_variant_stat delta;
+    // the references of the constants of the move heap taken or released.
+    unsigned int nr_consts[MH_NR_CONSTS];
+};
+
+static void
+take_move_heap(struct pcvariant_move_heap *mvheap)
 {
-    if (mh_lock.native_impl)
-        purc_mutex_clear(&mh_lock);
+    /* the holders only merge the statistics in general; spin. */
+    while (atomic_flag_test_and_set_explicit(&mvheap->busy,
+                memory_order_acquire))
+        ;
+}
 
-    struct purc_variant_stat *stat = &move_heap.stat;
+static void
+give_move_heap(struct pcvariant_move_heap *mvheap)
+{
+    atomic_flag_clear_explicit(&mvheap->busy, memory_order_release);
+}
 
-    PC_DEBUG("refc of v_undefined in move heap: %u\n", move_heap.v_undefined.refc);
-    PC_DEBUG("refc of v_null in move heap: %u\n", move_heap.v_null.refc);
-    PC_DEBUG("refc of v_true in move heap: %u\n", move_heap.v_true.refc);
-    PC_DEBUG("refc of v_false in move heap: %u\n", move_heap.v_false.refc);
-    PC_DEBUG("refc of v_false in move heap: %u\n", move_heap.v_false.refc);
-    PC_DEBUG("total values in move heap: %u\n", (unsigned int)stat->nr_total_values);
-    PC_DEBUG("total memory used by move heap: %u\n", (unsigned int)stat->sz_total_mem);
+static purc_variant_t
+constant_of(struct pcvariant_heap *heap, int idx)
+{
+    switch (idx) {
+    case MH_CONST_UNDEFINED:
+        return &heap->v_undefined;
+    case MH_CONST_NULL:
+        return &heap->v_null;
+    case MH_CONST_FALSE:
+        return &heap->v_false;
+    case MH_CONST_TRUE:
+        return &heap->v_true;
+    default:
+        break;
+    }
 
-    PC_ASSERT(move_heap.v_undefined.refc == 0);
-    PC_ASSERT(move_heap.v_null.refc == 0);
-    PC_ASSERT(move_heap.v_true.refc == 0);
-    PC_ASSERT(move_heap.v_false.refc == 0);
+    return PURC_VARIANT_INVALID;
+}
 
-    for (int t = PURC_VARIANT_TYPE_FIRST; t < PURC_VARIANT_TYPE_LAST; t++) {
-        PC_DEBUG("values of type (%s): %u\n", purc_variant_typename(t),
-                (unsigned int)stat->nr_values[t]);
+/* Returns the index of the constant in the heap, or -1 if it is not. */
+static int
+constant_index(struct pcvariant_heap *heap, purc_variant_t v)
+{
+    for (int i = 0; i < MH_NR_CONSTS; i++) {
+        if (v == constant_of(heap, i))
+            return i;
     }
 
-    PC_ASSERT(stat->nr_total_values == 4);
-    PC_ASSERT(stat->sz_total_mem == 4 * sizeof(purc_variant));
+    return -1;
 }
 
-static int mvheap_init_once(void)
+struct pcvariant_move_heap *
+pcvariant_move_heap_new(void)
 {
-    move_heap.v_undefined.type = PURC_VARIANT_TYPE_UNDEFINED;
-    move_heap.v_undefined.refc = 0;
-    move_heap.v_undefined.flags = PCVARIANT_FLAG_NOFREE;
-    INIT_LIST_HEAD(&move_heap.v_undefined.listeners);
-
-    move_heap.v_null.type = PURC_VARIANT_TYPE_NULL;
-    move_heap.v_null.refc = 0;
-    move_heap.v_null.flags = PCVARIANT_FLAG_NOFREE;
-    INIT_LIST_HEAD(&move_heap.v_null.listeners);
-
-    move_heap.v_false.type = PURC_VARIANT_TYPE_BOOLEAN;
-    move_heap.v_false.refc = 0;
-    move_heap.v_false.flags = PCVARIANT_FLAG_NOFREE;
-    move_heap.v_false.b = false;
-    INIT_LIST_HEAD(&move_heap.v_false.listeners);
-
-    move_heap.v_true.type = PURC_VARIANT_TYPE_BOOLEAN;
-    move_heap.v_true.refc = 0;
-    move_heap.v_true.flags = PCVARIANT_FLAG_NOFREE;
-    move_heap.v_true.b = true;
-
-    struct purc_variant_stat *stat = &move_heap.stat;
-    stat->nr_values[PURC_VARIANT_TYPE_UNDEFINED] = 0;
+    struct pcvariant_move_heap *mvheap;
+    mvheap = (struct pcvariant_move_heap *)calloc(1, sizeof(*mvheap));
+    if (mvheap == NULL) {
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    struct pcvariant_heap *heap = &mvheap->heap;
+    heap->v_undefined.type = PURC_VARIANT_TYPE_UNDEFINED;
+    heap->v_undefined.flags = PCVARIANT_FLAG_NOFREE;
+
+    heap->v_null.type = PURC_VARIANT_TYPE_NULL;
+    heap->v_null.flags = PCVARIANT_FLAG_NOFREE;
+
+    heap->v_false.type = PURC_VARIANT_TYPE_BOOLEAN;
+    heap->v_false.flags = PCVARIANT_FLAG_NOFREE;
+    heap->v_false.b = false;
+
+    heap->v_true.type = PURC_VARIANT_TYPE_BOOLEAN;
+    heap->v_true.flags = PCVARIANT_FLAG_NOFREE;
+    heap->v_true.b = true;
+
+    struct purc_variant_stat *stat = &heap->stat;
     stat->sz_mem[PURC_VARIANT_TYPE_UNDEFINED] = sizeof(purc_variant);
-    stat->nr_values[PURC_VARIANT_TYPE_NULL] = 0;
     stat->sz_mem[PURC_VARIANT_TYPE_NULL] = sizeof(purc_variant);
-    stat->nr_values[PURC_VARIANT_TYPE_BOOLEAN] = 0;
     stat->sz_mem[PURC_VARIANT_TYPE_BOOLEAN] = sizeof(purc_variant) * 2;
     stat->nr_total_values = 4;
     stat->sz_total_mem = 4 * sizeof(purc_variant);
@@ -104,109 +151,201 @@ static int mvheap_init_once(void)
     stat->nr_max_reserved = 0;  // no need to reserve variants for move heap.
 
 #if !USE(LOOP_BUFFER_FOR_RESERVED)
-    INIT_LIST_HEAD(&move_heap.v_reserved);
+    INIT_LIST_HEAD(&heap->v_reserved);
 #endif
 
-    purc_mutex_init(&mh_lock);
-    if (mh_lock.native_impl == NULL)
-        return -1;
+#if USE(SLAB_FOR_VARIANTS)
+    pcvariant_slab_init(heap);
+#endif
+
+    atomic_flag_clear(&mvheap->busy);
+    return mvheap;
+}
 
-    int r;
-    r = atexit(mvheap_cleanup_once);
-    if (r)
-        goto fail_atexit;
+void
+pcvariant_move_heap_delete(struct pcvariant_move_heap *mvheap)
+{
+    struct pcvariant_heap *heap = &mvheap->heap;
+    struct purc_variant_stat *stat = &heap->stat;
+
+    PC_DEBUG("refc of v_undefined in move heap: %u\n", heap->v_undefined.refc);
+    PC_DEBUG("refc of v_null in move heap: %u\n", heap->v_null.refc);
+    PC_DEBUG("refc of v_true in move heap: %u\n", heap->v_true.refc);
+    PC_DEBUG("refc of v_false in move heap: %u\n", heap->v_false.refc);
+    PC_DEBUG("total values in move heap: %u\n",
+            (unsigned int)stat->nr_total_values);
+    PC_DEBUG("total memory used by move heap: %u\n",
+            (unsigned int)stat->sz_total_mem);
+
+    PC_ASSERT(heap->v_undefined.refc == 0);
+    PC_ASSERT(heap->v_null.refc == 0);
+    PC_ASSERT(heap->v_true.refc == 0);
+    PC_ASSERT(heap->v_false.refc == 0);
 
-    return 0;
+    for (int t = PURC_VARIANT_TYPE_FIRST; t < PURC_VARIANT_TYPE_LAST; t++) {
+        PC_DEBUG("values of type (%s): %u\n", purc_variant_typename(t),
+                (unsigned int)stat->nr_values[t]);
+    }
 
-fail_atexit:
-    purc_mutex_clear(&mh_lock);
+#if USE(SLAB_FOR_VARIANTS)
+    pcvariant_slab_cleanup(heap);
+#endif
 
-    return -1;
+    free(mvheap);
 }
 
-struct pcmodule _module_mvheap = {
-    .id              = PURC_HAVE_VARIANT,
-    .module_inited   = 0,
+static void
+merge_stat(struct purc_variant_stat *stat,
+        const struct purc_variant_stat *delta, bool in)
+{
+    for (int t = PURC_VARIANT_TYPE_FIRST; t < PURC_VARIANT_TYPE_LAST; t++) {
+        if (in) {
+            stat->nr_values[t] += delta->nr_values[t];
+            stat->sz_mem[t] += delta->sz_mem[t];
+        }
+        else {
+            stat->nr_values[t] -= delta->nr_values[t];
+            stat->sz_mem[t] -= delta->sz_mem[t];
+        }
+    }
 
-    .init_once       = mvheap_init_once,
-    .init_instance   = NULL,
-};
+    if (in) {
+        stat->nr_total_values += delta->nr_total_values;
+        stat->sz_total_mem += delta->sz_total_mem;
+    }
+    else {
+        stat->nr_total_values -= delta->nr_total_values;
+        stat->sz_total_mem -= delta->sz_total_mem;
+    }
+}
 
+/* Merges the statistics and the references of the constants summed up in
+   the travel into the move heap. */
 static void
-move_variant_in(struct pcinst *inst, purc_variant_t v)
+merge_travel(struct travel_context *ctxt, bool in)
 {
-    /* move directly and change the stat info */
+    struct pcvariant_heap *heap = &ctxt->mvheap->heap;
+
+    take_move_heap(ctxt->mvheap);
+
+    merge_stat(&heap->stat, &ctxt->delta, in);
+    for (int i = 0; i < MH_NR_CONSTS; i++) {
+        purc_variant_t v = constant_of(heap, i);
+        if (in)
+            v->refc += ctxt->nr_consts[i];
+        else
+            v->refc -= ctxt->nr_consts[i];
+    }
+
+    give_move_heap(ctxt->mvheap);
+}
 
+static void
+count_variant(struct purc_variant_stat *stat, purc_variant_t v)
+{
     if (IS_CONTAINER(v->type) ||
             ((v->type == PURC_VARIANT_TYPE_STRING ||
                 v->type == PURC_VARIANT_TYPE_BSEQUENCE) &&
             (v->flags & PCVARIANT_FLAG_EXTRA_SIZE))) {
-        inst->org_vrt_heap->stat.sz_mem[v->type] -= v->sz_ptr[0];
-        inst->org_vrt_heap->stat.sz_total_mem -= v->sz_ptr[0];
+        stat->sz_mem[v->type] += v->sz_ptr[0];
+        stat->sz_total_mem += v->sz_ptr[0];
+    }
 
-        move_heap.stat.sz_mem[v->type] += v->sz_ptr[0];
-        move_heap.stat.sz_total_mem += v->sz_ptr[0];
+    stat->nr_values[v->type]++;
+    stat->nr_total_values++;
+    stat->sz_mem[v->type] += sizeof(purc_variant);
+    stat->sz_total_mem += sizeof(purc_variant);
+}
+
+static void
+discount_variant(struct purc_variant_stat *stat, purc_variant_t v)
+{
+    if (IS_CONTAINER(v->type) ||
+            ((v->type == PURC_VARIANT_TYPE_STRING ||
+                v->type == PURC_VARIANT_TYPE_BSEQUENCE) &&
+            (v->flags & PCVARIANT_FLAG_EXTRA_SIZE))) {
+        stat->sz_mem[v->type] -= v->sz_ptr[0];
+        stat->sz_total_mem -= v->sz_ptr[0];
     }
 
-    inst->org_vrt_heap->stat.nr_values[v->type]--;
-    inst->org_vrt_heap->stat.nr_total_values--;
-    move_heap.stat.nr_values[v->type]++;
-    move_heap.stat.nr_total_values++;
+    stat->nr_values[v->type]--;
+    stat->nr_total_values--;
+    stat->sz_mem[v->type] -= sizeof(purc_variant);
+    stat->sz_total_mem -= sizeof(purc_variant);
+}
+
+static bool
+move_variant_in(struct travel_context *ctxt, purc_variant_t v)
+{
+    /* move directly and change the stat info */
+
+    /* the listeners belong to the instance */
+    if (v->flags & PCVARIANT_FLAG_LISTENED)
+        pcvariant_drop_listeners(v);
+
+    /* the storage shared with the clones would be changed by the others */
+    if (v->type == PURC_VARIANT_TYPE_ARRAY) {
+        if (pcvar_arr_unshare(v))
+            return false;
+    }
+    else if (v->type == PURC_VARIANT_TYPE_OBJECT) {
+        if (pcvar_obj_unshare(v))
+            return false;
+        /* the stamps are given by the instance */
+        pcvar_obj_get_data(v)->stamp = 0;
+    }
 
-    inst->org_vrt_heap->stat.sz_mem[v->type] -= sizeof(purc_variant);
-    inst->org_vrt_heap->stat.sz_total_mem -= sizeof(purc_variant);
-    move_heap.stat.sz_mem[v->type] += sizeof(purc_variant);
-    move_heap.stat.sz_total_mem += sizeof(purc_variant);
+    discount_variant(&ctxt->inst->org_vrt_heap->stat, v);
+    count_variant(&ctxt->delta, v);
+    return true;
 }
 
 static purc_variant_t
-move_or_clone_immutable(struct pcinst *inst, purc_variant_t v)
+move_or_clone_immutable(struct travel_context *ctxt, purc_variant_t v)
 {
     purc_variant_t retv = PURC_VARIANT_INVALID;
 
     if (IS_CONTAINER(v->type))
         return retv;
 
-    if (v == &inst->org_vrt_heap->v_undefined) {
-        retv = &move_heap.v_undefined;
-        v->refc--;
-        retv->refc++;
-    }
-    else if (v == &inst->org_vrt_heap->v_null) {
-        retv = &move_heap.v_null;
-        v->refc--;
-        retv->refc++;
-    }
-    else if (v == &inst->org_vrt_heap->v_false) {
-        retv = &move_heap.v_false;
-        v->refc--;
-        retv->refc++;
-    }
-    else if (v == &inst->org_vrt_heap->v_true) {
-        retv = &move_heap.v_true;
+    // a frozen variant is passed by pointer.
+    if (v->flags & PCVARIANT_FLAG_FROZEN)
+        return v;
+
+    int c = constant_index(ctxt->inst->org_vrt_heap, v);
+    if (c >= 0) {
+        retv = constant_of(&ctxt->mvheap->heap, c);
         v->refc--;
-        retv->refc++;
+        ctxt->nr_consts[c]++;
     }
-    else if (v->refc == 1) {
-        PC_DEBUG("Move in variant type %s (%u): %s\n",
+    else if (v->refc == 1 && !(v->flags & PCVARIANT_FLAG_NOFREE)) {
+        PC_DEBUG("Move in variant type %s: %s\n",
                 purc_variant_typename(v->type),
-                (unsigned)move_heap.stat.nr_values[v->type],
                 purc_variant_get_string_const(v));
 
         retv = v;
-        move_variant_in(inst, v);
+        move_variant_in(ctxt, v);
     }
     else {
         // clone the immutable variant
-        PC_DEBUG("Clone a variant type %s (%u): %s\n",
+        PC_DEBUG("Clone a variant type %s: %s\n",
                 purc_variant_typename(v->type),
-                (unsigned)move_heap.stat.nr_values[v->type],
                 purc_variant_get_string_const(v));
 
         retv = pcvariant_alloc();
+        if (retv == NULL)
+            return PURC_VARIANT_INVALID;
+
         memcpy(retv, v, sizeof(*retv));
         retv->refc = 1;
 
+        /* a shared small integer is cloned, and the reference is
+           released here since the caller never releases a constant. */
+        if (v->flags & PCVARIANT_FLAG_NOFREE) {
+            retv->flags &= ~PCVARIANT_FLAG_NOFREE;
+            v->refc--;
+        }
+
         /* copy the extra space */
         if ((v->type == PURC_VARIANT_TYPE_STRING ||
                 v->type == PURC_VARIANT_TYPE_BSEQUENCE) &&
@@ -214,150 +353,61 @@ move_or_clone_immutable(struct pcinst *inst, purc_variant_t v)
 
             retv->sz_ptr[1] = (uintptr_t)malloc(v->sz_ptr[0]);
             memcpy((void *)retv->sz_ptr[1], (void *)v->sz_ptr[1], v->sz_ptr[0]);
-
-            move_heap.stat.sz_mem[v->type] += v->sz_ptr[0];
-            move_heap.stat.sz_total_mem += v->sz_ptr[0];
         }
 
-        move_heap.stat.nr_values[v->type]++;
-        move_heap.stat.nr_total_values++;
-        move_heap.stat.sz_mem[v->type] += sizeof(purc_variant);
-        move_heap.stat.sz_total_mem += sizeof(purc_variant);
+        // the clone is counted by the move heap only.
+        count_variant(&ctxt->delta, retv);
     }
 
     return retv;
 }
 
-struct travel_context {
-    struct pcinst *inst;
-    struct pcutils_arrlist *vrts_to_unref;
-};
-
-static bool
-move_keys_in_cloned_array(struct travel_context *ctxt, purc_variant_t arr);
-static bool
-move_keys_in_cloned_object(struct travel_context *ctxt, purc_variant_t arr);
-static bool
-move_keys_in_cloned_set(struct travel_context *ctxt, purc_variant_t arr);
-
-static bool
-move_keys_in_cloned_array(struct travel_context *ctxt, purc_variant_t arr)
-{
-    size_t idx;
-    purc_variant_t v;
-    foreach_value_in_variant_array(arr, v, idx) {
-        UNUSED_PARAM(idx);
-
-        switch (v->type) {
-        case PURC_VARIANT_TYPE_ARRAY:
-            move_keys_in_cloned_array(ctxt, v);
-            break;
-
-        case PURC_VARIANT_TYPE_OBJECT:
-            move_keys_in_cloned_array(ctxt, v);
-            break;
-
-        case PURC_VARIANT_TYPE_SET:
-            move_keys_in_cloned_set(ctxt, v);
-            break;
-
-        default:
-            // immutable element
-            break;
-        }
-
-    } end_foreach;
-
-    return true;
-}
-
-static bool
-move_keys_in_cloned_object(struct travel_context *ctxt, purc_variant_t obj)
-{
-    purc_variant_t k,v;
-    foreach_key_value_in_variant_object(obj, k, v) {
-
-        if (IS_CONTAINER(v->type)) {
-            PC_DEBUG("Move in a key %s (%u): %s\n",
-                    purc_variant_typename(k->type),
-                    (unsigned)move_heap.stat.nr_values[k->type],
-                    purc_variant_get_string_const(k));
-        }
-
-        switch (v->type) {
-        case PURC_VARIANT_TYPE_ARRAY:
-            move_variant_in(ctxt->inst, k);
-            move_keys_in_cloned_array(ctxt, v);
-            break;
-
-        case PURC_VARIANT_TYPE_OBJECT:
-            move_variant_in(ctxt->inst, k);
-            move_keys_in_cloned_object(ctxt, v);
-            break;
-
-        case PURC_VARIANT_TYPE_SET:
-            move_variant_in(ctxt->inst, k);
-            move_keys_in_cloned_set(ctxt, v);
-            break;
-
-        default:
-            break;
-        }
-
-    } end_foreach;
-
-    return true;
-}
-
-static bool
-move_keys_in_cloned_set(struct travel_context *ctxt, purc_variant_t set)
-{
-    purc_variant_t v;
-    foreach_value_in_variant_set(set, v) {
-
-        switch (v->type) {
-        case PURC_VARIANT_TYPE_ARRAY:
-            move_keys_in_cloned_array(ctxt, v);
-            break;
-
-        case PURC_VARIANT_TYPE_OBJECT:
-            move_keys_in_cloned_object(ctxt, v);
-            break;
-
-        case PURC_VARIANT_TYPE_SET:
-            move_keys_in_cloned_set(ctxt, v);
-            break;
-
-        default:
-            // immutable element
-            break;
-        }
-
-    } end_foreach;
-
-    return true;
-}
-
+/* Moves in a container cloned by purc_variant_container_clone_recursively()
+   and the containers in it; they were allocated and counted by the instance.
+   The keys of the container members in the objects are still referenced
+   by the source, so they are cloned too. The other immutable members are
+   handled by move_or_clone_immutable_descendants(). */
 static bool
-move_keys_in_cloned_container(struct travel_context *ctxt,
-        purc_variant_t cntr)
+move_cloned_container_in(struct travel_context *ctxt, purc_variant_t cntr)
 {
-    switch (cntr->type) {
-        case PURC_VARIANT_TYPE_ARRAY:
-            move_keys_in_cloned_array(ctxt, cntr);
-            break;
-
-        case PURC_VARIANT_TYPE_OBJECT:
-            move_keys_in_cloned_object(ctxt, cntr);
-            break;
-
-        case PURC_VARIANT_TYPE_SET:
-            move_keys_in_cloned_set(ctxt, cntr);
-            break;
+    if (!move_variant_in(ctxt, cntr))
+        return false;
+
+    if (cntr->type == PURC_VARIANT_TYPE_ARRAY) {
+        size_t idx;
+        purc_variant_t v;
+        foreach_value_in_variant_array(cntr, v, idx) {
+            UNUSED_PARAM(idx);
+            if (IS_CONTAINER(v->type) && !move_cloned_container_in(ctxt, v))
+                return false;
+        } end_foreach;
+    }
+    else if (cntr->type == PURC_VARIANT_TYPE_OBJECT) {
+        purc_variant_t k, v;
+        foreach_key_value_in_variant_object(cntr, k, v) {
+            if (!IS_CONTAINER(v->type))
+                continue;
+
+            purc_variant_t retk = move_or_clone_immutable(ctxt, k);
+            if (retk == PURC_VARIANT_INVALID) {
+                purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+                return false;
+            }
+            if (retk != k) {
+                _kv->key = retk;
+                pcutils_arrlist_append(ctxt->vrts_to_unref, k);
+            }
 
-        default:
-            assert(0);
-            break;
+            if (!move_cloned_container_in(ctxt, v))
+                return false;
+        } end_foreach;
+    }
+    else if (cntr->type == PURC_VARIANT_TYPE_SET) {
+        purc_variant_t v;
+        foreach_value_in_variant_set(cntr, v) {
+            if (IS_CONTAINER(v->type) && !move_cloned_container_in(ctxt, v))
+                return false;
+        } end_foreach;
     }
 
     return true;
@@ -379,28 +429,39 @@ move_or_clone_mutable_descendants_in_array(struct travel_context *ctxt,
 {
     size_t idx;
     purc_variant_t v;
+
+    // the members will be replaced, so they can not be shared by clones.
+    if (pcvar_arr_unshare(arr))
+        return false;
+
     foreach_value_in_variant_array(arr, v, idx) {
         purc_variant_t retv;
 
         UNUSED_PARAM(idx);
+        if (v->flags & PCVARIANT_FLAG_FROZEN)
+            continue;
+
         switch (v->type) {
         case PURC_VARIANT_TYPE_ARRAY:
             if (v->refc == 1) {
-                move_variant_in(ctxt->inst, v);
+                if (!move_variant_in(ctxt, v))
+                    return false;
                 move_or_clone_mutable_descendants_in_array(ctxt, v);
             }
             break;
 
         case PURC_VARIANT_TYPE_OBJECT:
             if (v->refc == 1) {
-                move_variant_in(ctxt->inst, v);
+                if (!move_variant_in(ctxt, v))
+                    return false;
                 move_or_clone_mutable_descendants_in_object(ctxt, v);
             }
             break;
 
         case PURC_VARIANT_TYPE_SET:
             if (v->refc == 1) {
-                move_variant_in(ctxt->inst, v);
+                if (!move_variant_in(ctxt, v))
+                    return false;
                 move_or_clone_mutable_descendants_in_set(ctxt, v);
             }
             break;
@@ -417,9 +478,12 @@ move_or_clone_mutable_descendants_in_array(struct travel_context *ctxt,
                 return false;
             }
 
-            move_keys_in_cloned_container(ctxt, retv);
+            if (!move_cloned_container_in(ctxt, retv)) {
+                pcutils_arrlist_append(ctxt->vrts_to_unref, retv);
+                return false;
+            }
 
-            _p->val = retv;
+            *_p = retv;
             pcutils_arrlist_append(ctxt->vrts_to_unref, v);
         }
 
@@ -433,30 +497,39 @@ move_or_clone_mutable_descendants_in_object(struct travel_context *ctxt,
         purc_variant_t obj)
 {
     purc_variant_t k,v;
+
+    if (pcvar_obj_unshare(obj))
+        return false;
+
     foreach_key_value_in_variant_object(obj, k, v) {
         purc_variant_t retk, retv;
+        // a frozen value is passed by pointer, but not the key.
+        bool frozen = v->flags & PCVARIANT_FLAG_FROZEN;
 
         PC_DEBUG("a key when handling mutable variant: %s (%u)\n",
                 purc_variant_get_string_const(k), (unsigned)v->refc);
 
         switch (v->type) {
         case PURC_VARIANT_TYPE_ARRAY:
-            if (v->refc == 1) {
-                move_variant_in(ctxt->inst, v);
+            if (!frozen && v->refc == 1) {
+                if (!move_variant_in(ctxt, v))
+                    return false;
                 move_or_clone_mutable_descendants_in_array(ctxt, v);
             }
             break;
 
         case PURC_VARIANT_TYPE_OBJECT:
-            if (v->refc == 1) {
-                move_variant_in(ctxt->inst, v);
+            if (!frozen && v->refc == 1) {
+                if (!move_variant_in(ctxt, v))
+                    return false;
                 move_or_clone_mutable_descendants_in_object(ctxt, v);
             }
             break;
 
         case PURC_VARIANT_TYPE_SET:
-            if (v->refc == 1) {
-                move_variant_in(ctxt->inst, v);
+            if (!frozen && v->refc == 1) {
+                if (!move_variant_in(ctxt, v))
+                    return false;
                 move_or_clone_mutable_descendants_in_set(ctxt, v);
             }
             break;
@@ -467,29 +540,29 @@ move_or_clone_mutable_descendants_in_object(struct travel_context *ctxt,
         }
 
         if (IS_CONTAINER(v->type)) {
-            retk = move_or_clone_immutable(ctxt->inst, k);
+            retk = move_or_clone_immutable(ctxt, k);
             if (retk != k) {
-                _node->key = retk;
+                _kv->key = retk;
                 pcutils_arrlist_append(ctxt->vrts_to_unref, k);
             }
 
-            if (v->refc > 1) {
+            if (!frozen && v->refc > 1) {
                 retv = purc_variant_container_clone_recursively(v);
                 if (retv == PURC_VARIANT_INVALID) {
                     purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
                     return false;
                 }
 
-                /* XXX: for cloned object, we need to move in the cloned keys,
-                 * cause purc_variant_container_clone_recursively() only
-                 * references the keys */
                 PC_DEBUG("a container cloned for key %s: %s (%u)\n",
                         purc_variant_get_string_const(k),
                         purc_variant_typename(retv->type),
                         (unsigned)retv->refc);
-                move_keys_in_cloned_object(ctxt, retv);
+                if (!move_cloned_container_in(ctxt, retv)) {
+                    pcutils_arrlist_append(ctxt->vrts_to_unref, retv);
+                    return false;
+                }
 
-                _node->val = retv;
+                _kv->val = retv;
                 pcutils_arrlist_append(ctxt->vrts_to_unref, v);
             }
         }
@@ -507,24 +580,30 @@ move_or_clone_mutable_descendants_in_set(struct travel_context *ctxt,
     foreach_value_in_variant_set(set, v) {
         purc_variant_t retv;
 
+        if (v->flags & PCVARIANT_FLAG_FROZEN)
+            continue;
+
         switch (v->type) {
         case PURC_VARIANT_TYPE_ARRAY:
             if (v->refc == 1) {
-                move_variant_in(ctxt->inst, v);
+                if (!move_variant_in(ctxt, v))
+                    return false;
                 move_or_clone_mutable_descendants_in_array(ctxt, v);
             }
             break;
 
         case PURC_VARIANT_TYPE_OBJECT:
             if (v->refc == 1) {
-                move_variant_in(ctxt->inst, v);
+                if (!move_variant_in(ctxt, v))
+                    return false;
                 move_or_clone_mutable_descendants_in_object(ctxt, v);
             }
             break;
 
         case PURC_VARIANT_TYPE_SET:
             if (v->refc == 1) {
-                move_variant_in(ctxt->inst, v);
+                if (!move_variant_in(ctxt, v))
+                    return false;
                 move_or_clone_mutable_descendants_in_set(ctxt, v);
             }
             break;
@@ -541,7 +620,10 @@ move_or_clone_mutable_descendants_in_set(struct travel_context *ctxt,
                 return false;
             }
 
-            move_keys_in_cloned_container(ctxt, retv);
+            if (!move_cloned_container_in(ctxt, retv)) {
+                pcutils_arrlist_append(ctxt->vrts_to_unref, retv);
+                return false;
+            }
 
             _sn->val = retv;
             pcutils_arrlist_append(ctxt->vrts_to_unref, v);
@@ -584,8 +666,16 @@ static bool
 move_or_clone_immutable_descendants_in_array(struct travel_context *ctxt,
         purc_variant_t arr)
 {
+    if (arr->flags & PCVARIANT_FLAG_FROZEN)
+        return true;
+
     size_t idx;
     purc_variant_t v;
+
+    // the members will be replaced, so they can not be shared by clones.
+    if (pcvar_arr_unshare(arr))
+        return false;
+
     foreach_value_in_variant_array(arr, v, idx) {
         purc_variant_t retv;
 
@@ -607,7 +697,7 @@ move_or_clone_immutable_descendants_in_array(struct travel_context *ctxt,
             break;
 
         default:
-            retv = move_or_clone_immutable(ctxt->inst, v);
+            retv = move_or_clone_immutable(ctxt, v);
             if (retv == PURC_VARIANT_INVALID) {
                 purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
                 return false;
@@ -616,7 +706,7 @@ move_or_clone_immutable_descendants_in_array(struct travel_context *ctxt,
         }
 
         if (retv != v) {
-            _p->val = retv;
+            *_p = retv;
             if (!(v->flags & PCVARIANT_FLAG_NOFREE))
                 pcutils_arrlist_append(ctxt->vrts_to_unref, v);
         }
@@ -630,7 +720,14 @@ static bool
 move_or_clone_immutable_descendants_in_object(struct travel_context *ctxt,
         purc_variant_t obj)
 {
+    if (obj->flags & PCVARIANT_FLAG_FROZEN)
+        return true;
+
     purc_variant_t k,v;
+
+    if (pcvar_obj_unshare(obj))
+        return false;
+
     foreach_key_value_in_variant_object(obj, k, v) {
         purc_variant_t retk, retv;
 
@@ -648,15 +745,15 @@ move_or_clone_immutable_descendants_in_object(struct travel_context *ctxt,
             break;
 
         default:
-            retk = move_or_clone_immutable(ctxt->inst, k);
+            retk = move_or_clone_immutable(ctxt, k);
             if (retk != k) {
-                _node->key = retk;
+                _kv->key = retk;
                 pcutils_arrlist_append(ctxt->vrts_to_unref, k);
             }
 
-            retv = move_or_clone_immutable(ctxt->inst, v);
+            retv = move_or_clone_immutable(ctxt, v);
             if (retv != v) {
-                _node->val = retv;
+                _kv->val = retv;
                 if (!(v->flags & PCVARIANT_FLAG_NOFREE))
                     pcutils_arrlist_append(ctxt->vrts_to_unref, v);
             }
@@ -672,6 +769,9 @@ static bool
 move_or_clone_immutable_descendants_in_set(struct travel_context *ctxt,
         purc_variant_t set)
 {
+    if (set->flags & PCVARIANT_FLAG_FROZEN)
+        return true;
+
     purc_variant_t v;
     foreach_value_in_variant_set(set, v) {
         purc_variant_t retv;
@@ -693,7 +793,7 @@ move_or_clone_immutable_descendants_in_set(struct travel_context *ctxt,
             break;
 
         default:
-            retv = move_or_clone_immutable(ctxt->inst, v);
+            retv = move_or_clone_immutable(ctxt, v);
             if (retv == PURC_VARIANT_INVALID) {
                 purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
                 return false;
@@ -736,45 +836,45 @@ static void cb_free_element(void *data)
 }
 
 // move the variant from the current instance to the move heap.
-purc_variant_t pcvariant_move_heap_in(purc_variant_t v)
+purc_variant_t
+pcvariant_move_heap_in(struct pcvariant_move_heap *mvheap, purc_variant_t v)
 {
     purc_variant_t retv = PURC_VARIANT_INVALID;
-    struct pcinst *inst = pcinst_current();
     struct travel_context ctxt;
 
+    // a frozen variant is shared by all instances.
+    if (v->flags & PCVARIANT_FLAG_FROZEN)
+        return v;
+
+    memset(&ctxt, 0, sizeof(ctxt));
     ctxt.inst = pcinst_current();
+    ctxt.mvheap = mvheap;
     ctxt.vrts_to_unref = pcutils_arrlist_new(cb_free_element);
     if (ctxt.vrts_to_unref == NULL) {
         purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
         return retv;
     }
 
-    pcvariant_use_move_heap();
-
     if (IS_CONTAINER(v->type)) {
         if (v->refc == 1) {
             retv = v;
-            move_variant_in(inst, v);
+            move_variant_in(&ctxt, v);
             move_or_clone_mutable_descendants(&ctxt, v);
-
         }
         else {
             retv = purc_variant_container_clone_recursively(v);
-
-            /* XXX: for cloned container, we need to move in the cloned keys
-             * of descendant objects,
-             * cause purc_variant_container_clone_recursively() only
-             * references the keys */
-            move_keys_in_cloned_container(&ctxt, retv);
+            if (retv != PURC_VARIANT_INVALID)
+                move_cloned_container_in(&ctxt, retv);
         }
 
-        move_or_clone_immutable_descendants(&ctxt, retv);
+        if (retv != PURC_VARIANT_INVALID)
+            move_or_clone_immutable_descendants(&ctxt, retv);
     }
     else {
-        retv = move_or_clone_immutable(inst, v);
+        retv = move_or_clone_immutable(&ctxt, v);
     }
 
-    pcvariant_use_norm_heap();
+    merge_travel(&ctxt, true);
 
     if (retv != PURC_VARIANT_INVALID && retv != v &&
             !(v->flags & PCVARIANT_FLAG_NOFREE)) {
@@ -789,239 +889,81 @@ purc_variant_t pcvariant_move_heap_in(purc_variant_t v)
 
 // move the variant from the move heap to the current instance.
 // we only need to update the stat information.
-static void move_container_self_out(purc_variant_t v)
-{
-    struct pcinst *inst = pcinst_current();
-
-    inst->org_vrt_heap->stat.sz_mem[v->type] += v->sz_ptr[0];
-    inst->org_vrt_heap->stat.sz_total_mem += v->sz_ptr[0];
-
-    move_heap.stat.sz_mem[v->type] -= v->sz_ptr[0];
-    move_heap.stat.sz_total_mem -= v->sz_ptr[0];
-
-    inst->org_vrt_heap->stat.nr_values[v->type]++;
-    inst->org_vrt_heap->stat.nr_total_values++;
-
-    move_heap.stat.nr_values[v->type]--;
-    move_heap.stat.nr_total_values--;
-
-    inst->org_vrt_heap->stat.sz_mem[v->type] += sizeof(purc_variant);
-    inst->org_vrt_heap->stat.sz_total_mem += sizeof(purc_variant);
-    move_heap.stat.sz_mem[v->type] -= sizeof(purc_variant);
-    move_heap.stat.sz_total_mem -= sizeof(purc_variant);
-}
-
-static purc_variant_t move_variant_out(purc_variant_t v);
-static purc_variant_t move_array_descendants_out(purc_variant_t v);
-static purc_variant_t move_object_descendants_out(purc_variant_t v);
-static purc_variant_t move_set_descendants_out(purc_variant_t v);
-
-static purc_variant_t move_array_descendants_out(purc_variant_t arr)
-{
-    size_t idx;
-    purc_variant_t v;
-
-    foreach_value_in_variant_array(arr, v, idx) {
-        purc_variant_t retv;
-
-        UNUSED_PARAM(idx);
-        switch (v->type) {
-        case PURC_VARIANT_TYPE_ARRAY:
-            retv = move_array_descendants_out(v);
-            move_container_self_out(retv);
-            break;
-
-        case PURC_VARIANT_TYPE_OBJECT:
-            retv = move_object_descendants_out(v);
-            move_container_self_out(retv);
-            break;
-
-        case PURC_VARIANT_TYPE_SET:
-            retv = move_set_descendants_out(v);
-            move_container_self_out(retv);
-            break;
-
-        default:
-            retv = move_variant_out(v);
-            break;
-        }
-
-        _p->val = retv;
-
-    } end_foreach;
-
-    return arr;
-}
-
-static purc_variant_t move_object_descendants_out(purc_variant_t obj)
-{
-    purc_variant_t k,v;
-    foreach_key_value_in_variant_object(obj, k, v) {
-        purc_variant_t retk, retv;
-
-        retk = move_variant_out(k);
-        switch (v->type) {
-        case PURC_VARIANT_TYPE_ARRAY:
-            retv = move_array_descendants_out(v);
-            move_container_self_out(retv);
-            break;
-
-        case PURC_VARIANT_TYPE_OBJECT:
-            retv = move_object_descendants_out(v);
-            move_container_self_out(retv);
-            break;
-
-        case PURC_VARIANT_TYPE_SET:
-            retv = move_set_descendants_out(v);
-            move_container_self_out(retv);
-            break;
-
-        default:
-            retv = move_variant_out(v);
-            break;
-        }
-
-        _node->key = retk;
-        _node->val = retv;
-
-    } end_foreach;
-
-    return obj;
-}
-
-static purc_variant_t move_set_descendants_out(purc_variant_t set)
+static purc_variant_t
+move_variant_out(struct travel_context *ctxt, purc_variant_t v)
 {
-    purc_variant_t v;
-    foreach_value_in_variant_set(set, v) {
-        purc_variant_t retv;
-
-        switch (v->type) {
-        case PURC_VARIANT_TYPE_ARRAY:
-            retv = move_array_descendants_out(v);
-            move_container_self_out(retv);
-            break;
+    struct pcvariant_heap *heap = ctxt->inst->org_vrt_heap;
 
-        case PURC_VARIANT_TYPE_OBJECT:
-            retv = move_object_descendants_out(v);
-            move_container_self_out(retv);
-            break;
-
-        case PURC_VARIANT_TYPE_SET:
-            retv = move_set_descendants_out(v);
-            move_container_self_out(retv);
-            break;
-
-        default:
-            retv = move_variant_out(v);
-            break;
-        }
-
-        _sn->val = retv;
-    } end_foreach;
+    if (v->flags & PCVARIANT_FLAG_FROZEN)
+        return v;
 
-    return set;
-}
-
-static purc_variant_t move_variant_out(purc_variant_t v)
-{
-    purc_variant_t retv = v;
-    struct pcinst *inst = pcinst_current();
-
-    if (v == &move_heap.v_undefined) {
-        retv = &inst->org_vrt_heap->v_undefined;
-        v->refc--;
-        retv->refc++;
-        return retv;
-    }
-    else if (v == &move_heap.v_null) {
-        retv = &inst->org_vrt_heap->v_null;
-        v->refc--;
-        retv->refc++;
-        return retv;
-    }
-    else if (v == &move_heap.v_false) {
-        retv = &inst->org_vrt_heap->v_false;
-        v->refc--;
+    int c = constant_index(&ctxt->mvheap->heap, v);
+    if (c >= 0) {
+        purc_variant_t retv = constant_of(heap, c);
         retv->refc++;
+        ctxt->nr_consts[c]++;
         return retv;
     }
-    else if (v == &move_heap.v_true) {
-        retv = &inst->org_vrt_heap->v_true;
-        v->refc--;
-        retv->refc++;
-        return retv;
+
+    if (v->type == PURC_VARIANT_TYPE_ARRAY) {
+        size_t idx;
+        purc_variant_t m;
+        foreach_value_in_variant_array(v, m, idx) {
+            UNUSED_PARAM(idx);
+            *_p = move_variant_out(ctxt, m);
+        } end_foreach;
     }
-    else if ((v->type == PURC_VARIANT_TYPE_STRING ||
-                  v->type == PURC_VARIANT_TYPE_BSEQUENCE) &&
-                 (v->flags & PCVARIANT_FLAG_EXTRA_SIZE)) {
-        inst->org_vrt_heap->stat.sz_mem[v->type] += v->sz_ptr[0];
-        inst->org_vrt_heap->stat.sz_total_mem += v->sz_ptr[0];
-
-        move_heap.stat.sz_mem[v->type] -= v->sz_ptr[0];
-        move_heap.stat.sz_total_mem -= v->sz_ptr[0];
+    else if (v->type == PURC_VARIANT_TYPE_OBJECT) {
+        purc_variant_t k, m;
+        foreach_key_value_in_variant_object(v, k, m) {
+            _kv->key = move_variant_out(ctxt, k);
+            _kv->val = move_variant_out(ctxt, m);
+        } end_foreach;
+        pcvar_obj_get_data(v)->stamp = 0;
     }
-    else if (IS_CONTAINER(v->type)) {
-        inst->org_vrt_heap->stat.sz_mem[v->type] += v->sz_ptr[0];
-        inst->org_vrt_heap->stat.sz_total_mem += v->sz_ptr[0];
-
-        move_heap.stat.sz_mem[v->type] -= v->sz_ptr[0];
-        move_heap.stat.sz_total_mem -= v->sz_ptr[0];
-
-        if (v->type == PURC_VARIANT_TYPE_ARRAY) {
-            retv = move_array_descendants_out(v);
-        }
-        else if (v->type == PURC_VARIANT_TYPE_OBJECT) {
-            retv = move_object_descendants_out(v);
-        }
-        else if (v->type == PURC_VARIANT_TYPE_SET) {
-            retv = move_set_descendants_out(v);
-        }
+    else if (v->type == PURC_VARIANT_TYPE_SET) {
+        purc_variant_t m;
+        foreach_value_in_variant_set(v, m) {
+            _sn->val = move_variant_out(ctxt, m);
+        } end_foreach;
     }
 
-    inst->org_vrt_heap->stat.nr_values[v->type]++;
-    inst->org_vrt_heap->stat.nr_total_values++;
-
-    PC_DEBUG("Move out a variant type: %s (%u): %s\n",
+    PC_DEBUG("Move out a variant type: %s: %s\n",
             purc_variant_typename(v->type),
-            (unsigned)move_heap.stat.nr_values[v->type],
             purc_variant_get_string_const(v));
 
-    assert(move_heap.stat.nr_values[v->type] > 0);
-    assert(move_heap.stat.nr_total_values > 0);
-
-    move_heap.stat.nr_values[v->type]--;
-    move_heap.stat.nr_total_values--;
-
-    inst->org_vrt_heap->stat.sz_mem[v->type] += sizeof(purc_variant);
-    inst->org_vrt_heap->stat.sz_total_mem += sizeof(purc_variant);
-    move_heap.stat.sz_mem[v->type] -= sizeof(purc_variant);
-    move_heap.stat.sz_total_mem -= sizeof(purc_variant);
-
-    return retv;
+    count_variant(&heap->stat, v);
+    count_variant(&ctxt->delta, v);
+    return v;
 }
 
-purc_variant_t pcvariant_move_heap_out(purc_variant_t v)
+purc_variant_t
+pcvariant_move_heap_out(struct pcvariant_move_heap *mvheap, purc_variant_t v)
 {
-    purc_variant_t retv = PURC_VARIANT_INVALID;
+    struct travel_context ctxt;
 
-    pcvariant_use_move_heap();
-    retv = move_variant_out(v);
-    pcvariant_use_norm_heap();
+    memset(&ctxt, 0, sizeof(ctxt));
+    ctxt.inst = pcinst_current();
+    ctxt.mvheap = mvheap;
+
+    purc_variant_t retv = move_variant_out(&ctxt, v);
+    merge_travel(&ctxt, false);
 
     return retv;
 }
 
-void pcvariant_use_move_heap(void)
+void
+pcvariant_use_move_heap(struct pcvariant_move_heap *mvheap)
 {
     struct pcinst *inst = pcinst_current();
-    purc_mutex_lock(&mh_lock);
-    inst->variant_heap = &move_heap;
+    take_move_heap(mvheap);
+    inst->variant_heap = &mvheap->heap;
 }
 
-void pcvariant_use_norm_heap(void)
+void
+pcvariant_use_norm_heap(struct pcvariant_move_heap *mvheap)
 {
     struct pcinst *inst = pcinst_current();
     inst->variant_heap = inst->org_vrt_heap;
-    purc_mutex_unlock(&mh_lock);
+    give_move_heap(mvheap);
 }
-
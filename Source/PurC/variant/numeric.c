@@ -0,0 +1,330 @@
+/*
+ * @file numeric.c
+ * @date 2026/10/16
+ * @brief The numeric reductions over the members of linear containers.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "private/variant.h"
+#include "private/errors.h"
+
+#include "variant-internals.h"
+
+#include <math.h>
+
+/*
+ * The members are unboxed into a chunk of doubles on the stack first, then
+ * the chunk is reduced by the kernels below. The kernels keep NR_LANES
+ * independent accumulators and have no branch in the loop, so the compiler
+ * can vectorize them; the NaNs are skipped by comparisons instead of
+ * isnan(), like exe_range_reduce() does.
+ */
+#define NR_LANES                4
+#define NR_CHUNK_NUMBERS        256
+
+struct numeric_acc {
+    double  sum[NR_LANES];
+    double  min[NR_LANES];
+    double  max[NR_LANES];
+    size_t  nr_numbers[NR_LANES];
+    size_t  count;
+};
+
+static inline double
+unbox_number(purc_variant_t v)
+{
+    switch (v->type) {
+    case PURC_VARIANT_TYPE_NUMBER:
+        return v->d;
+
+    case PURC_VARIANT_TYPE_LONGINT:
+        return (double)v->i64;
+
+    case PURC_VARIANT_TYPE_ULONGINT:
+        return (double)v->u64;
+
+    default:
+        return purc_variant_numberify(v);
+    }
+}
+
+static void
+acc_init(struct numeric_acc *acc)
+{
+    for (int i = 0; i < NR_LANES; i++) {
+        acc->sum[i] = 0;
+        acc->min[i] = INFINITY;
+        acc->max[i] = -INFINITY;
+        acc->nr_numbers[i] = 0;
+    }
+    acc->count = 0;
+}
+
+static void
+acc_chunk(struct numeric_acc *acc, const double *x, size_t nr)
+{
+    size_t i = 0;
+
+    for (; i + NR_LANES <= nr; i += NR_LANES) {
+        for (int l = 0; l < NR_LANES; l++) {
+            double d = x[i + l];
+            bool is_number = (d == d);
+            acc->sum[l] += is_number ? d : 0;
+            acc->min[l] = (d < acc->min[l]) ? d : acc->min[l];
+            acc->max[l] = (d > acc->max[l]) ? d : acc->max[l];
+            acc->nr_numbers[l] += is_number;
+        }
+    }
+
+    for (; i < nr; i++) {
+        double d = x[i];
+        if (d == d) {
+            acc->sum[0] += d;
+            acc->min[0] = (d < acc->min[0]) ? d : acc->min[0];
+            acc->max[0] = (d > acc->max[0]) ? d : acc->max[0];
+            acc->nr_numbers[0]++;
+        }
+    }
+
+    acc->count += nr;
+}
+
+static void
+acc_finish(struct numeric_acc *acc, struct purc_variant_numeric_stat *stat)
+{
+    size_t nr_numbers = 0;
+
+    stat->count = acc->count;
+    stat->sum = 0;
+    stat->min = INFINITY;
+    stat->max = -INFINITY;
+    for (int i = 0; i < NR_LANES; i++) {
+        stat->sum += acc->sum[i];
+        if (acc->min[i] < stat->min)
+            stat->min = acc->min[i];
+        if (acc->max[i] > stat->max)
+            stat->max = acc->max[i];
+        nr_numbers += acc->nr_numbers[i];
+    }
+
+    if (nr_numbers == 0) {
+        stat->min = NAN;
+        stat->max = NAN;
+    }
+}
+
+static double
+dot_chunk(const double *x, const double *y, size_t nr)
+{
+    double s[NR_LANES] = { 0 };
+    size_t i = 0;
+
+    for (; i + NR_LANES <= nr; i += NR_LANES) {
+        for (int l = 0; l < NR_LANES; l++)
+            s[l] += x[i + l] * y[i + l];
+    }
+
+    for (; i < nr; i++)
+        s[0] += x[i] * y[i];
+
+    return (s[0] + s[1]) + (s[2] + s[3]);
+}
+
+void
+pcvariant_numeric_stat(const purc_variant_t *members, size_t nr,
+        size_t stride, struct purc_variant_numeric_stat *stat)
+{
+    struct numeric_acc acc;
+    double chunk[NR_CHUNK_NUMBERS];
+
+    acc_init(&acc);
+    while (nr > 0) {
+        size_t n = (nr < NR_CHUNK_NUMBERS) ? nr : NR_CHUNK_NUMBERS;
+        for (size_t i = 0; i < n; i++) {
+            chunk[i] = unbox_number(*members);
+            members += stride;
+        }
+
+        acc_chunk(&acc, chunk, n);
+        nr -= n;
+    }
+
+    acc_finish(&acc, stat);
+}
+
+static void
+set_numeric_stat(purc_variant_t set, struct purc_variant_numeric_stat *stat)
+{
+    struct numeric_acc acc;
+    double chunk[NR_CHUNK_NUMBERS];
+    purc_variant_t v;
+    size_t n = 0;
+
+    acc_init(&acc);
+    foreach_value_in_variant_set(set, v) {
+        chunk[n++] = unbox_number(v);
+        if (n == NR_CHUNK_NUMBERS) {
+            acc_chunk(&acc, chunk, n);
+            n = 0;
+        }
+    } end_foreach;
+
+    acc_chunk(&acc, chunk, n);
+    acc_finish(&acc, stat);
+}
+
+/* gets the members of an array or a tuple, which are contiguous. */
+static bool
+contiguous_members(purc_variant_t container,
+        const purc_variant_t **members, size_t *nr)
+{
+    if (container->type == PURC_VARIANT_TYPE_ARRAY) {
+        variant_arr_t data = variant_array_get_data(container);
+        *members = data->vals;
+        *nr = data->nr;
+        return true;
+    }
+    else if (container->type == PURC_VARIANT_TYPE_TUPLE) {
+        *members = tuple_members(container, nr);
+        return true;
+    }
+
+    return false;
+}
+
+bool
+purc_variant_linear_container_numeric_stat(purc_variant_t container,
+        struct purc_variant_numeric_stat *stat)
+{
+    PCVARIANT_CHECK_FAIL_RET(container && stat, false);
+
+    const purc_variant_t *members;
+    size_t nr;
+
+    if (contiguous_members(container, &members, &nr)) {
+        pcvariant_numeric_stat(members, nr, 1, stat);
+    }
+    else if (container->type == PURC_VARIANT_TYPE_SET) {
+        set_numeric_stat(container, stat);
+    }
+    else {
+        pcinst_set_error(PURC_ERROR_WRONG_DATA_TYPE);
+        return false;
+    }
+
+    return true;
+}
+
+/* unboxes all the members of a set into a new buffer. */
+static double *
+unbox_set_members(purc_variant_t set, size_t *nr)
+{
+    purc_variant_t v;
+    double *numbers;
+    size_t n = 0;
+
+    purc_variant_set_size(set, nr);
+    numbers = malloc(sizeof(double) * (*nr ? *nr : 1));
+    if (numbers == NULL) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    foreach_value_in_variant_set(set, v) {
+        numbers[n++] = unbox_number(v);
+    } end_foreach;
+
+    return numbers;
+}
+
+bool
+purc_variant_linear_container_dot(purc_variant_t c1, purc_variant_t c2,
+        double *dot)
+{
+    PCVARIANT_CHECK_FAIL_RET(c1 && c2 && dot, false);
+
+    const purc_variant_t *m1 = NULL, *m2 = NULL;
+    double *set1 = NULL, *set2 = NULL;
+    size_t nr1 = 0, nr2 = 0;
+    bool ret = false;
+
+    if (c1->type == PURC_VARIANT_TYPE_SET) {
+        if ((set1 = unbox_set_members(c1, &nr1)) == NULL)
+            goto done;
+    }
+    else if (!contiguous_members(c1, &m1, &nr1)) {
+        pcinst_set_error(PURC_ERROR_WRONG_DATA_TYPE);
+        goto done;
+    }
+
+    if (c2->type == PURC_VARIANT_TYPE_SET) {
+        if ((set2 = unbox_set_members(c2, &nr2)) == NULL)
+            goto done;
+    }
+    else if (!contiguous_members(c2, &m2, &nr2)) {
+        pcinst_set_error(PURC_ERROR_WRONG_DATA_TYPE);
+        goto done;
+    }
+
+    if (nr1 != nr2) {
+        pcinst_set_error(PURC_ERROR_INVALID_VALUE);
+        goto done;
+    }
+
+    double x[NR_CHUNK_NUMBERS], y[NR_CHUNK_NUMBERS];
+    size_t off = 0;
+
+    *dot = 0;
+    while (off < nr1) {
+        size_t n = nr1 - off;
+        if (n > NR_CHUNK_NUMBERS)
+            n = NR_CHUNK_NUMBERS;
+
+        const double *px, *py;
+        if (set1) {
+            px = set1 + off;
+        }
+        else {
+            for (size_t i = 0; i < n; i++)
+                x[i] = unbox_number(m1[off + i]);
+            px = x;
+        }
+
+        if (set2) {
+            py = set2 + off;
+        }
+        else {
+            for (size_t i = 0; i < n; i++)
+                y[i] = unbox_number(m2[off + i]);
+            py = y;
+        }
+
+        *dot += dot_chunk(px, py, n);
+        off += n;
+    }
+
+    ret = true;
+
+done:
+    free(set1);
+    free(set2);
+    return ret;
+}
@@ -25,16 +25,99 @@
 #include "purc-errors.h"
 #include "private/debug.h"
 #include "private/errors.h"
+#include "private/hashtable.h"
+#include "private/instance.h"
 #include "variant-internals.h"
 
 #include <stdlib.h>
 
+#define LISTENERS_TABLE_SIZE    16
+
+static void
+free_listeners_entry(struct pchash_entry *e)
+{
+    struct list_head *listeners;
+    listeners = (struct list_head *)pchash_entry_v(e);
+
+    struct list_head *p, *n;
+    list_for_each_safe(p, n, listeners) {
+        list_del(p);
+        free(container_of(p, struct pcvar_listener, list_node));
+    }
+
+    free(listeners);
+}
+
+/* Returns the list of the listeners of the variant, or NULL if the variant
+   has no listener and create is false. */
+static struct list_head *
+get_listeners(purc_variant_t v, bool create)
+{
+    if (!create && !(v->flags & PCVARIANT_FLAG_LISTENED))
+        return NULL;
+
+    /* VWNOTE: always use the original heap of the instance,
+       the move heap never has any listener. */
+    struct pcvariant_heap *heap = pcinst_current()->org_vrt_heap;
+    struct list_head *listeners = NULL;
+
+    if (v->flags & PCVARIANT_FLAG_LISTENED) {
+        PC_ASSERT(heap->listeners);
+        pchash_table_lookup_ex(heap->listeners, v, (void **)&listeners);
+        PC_ASSERT(listeners);
+        return listeners;
+    }
+
+    if (heap->listeners == NULL) {
+        heap->listeners = pchash_kptr_table_new(LISTENERS_TABLE_SIZE,
+                free_listeners_entry);
+        if (heap->listeners == NULL)
+            goto failed;
+    }
+
+    listeners = (struct list_head *)malloc(sizeof(*listeners));
+    if (listeners == NULL)
+        goto failed;
+
+    INIT_LIST_HEAD(listeners);
+    if (pchash_table_insert(heap->listeners, v, listeners)) {
+        free(listeners);
+        goto failed;
+    }
+
+    v->flags |= PCVARIANT_FLAG_LISTENED;
+    return listeners;
+
+failed:
+    pcinst_set_error(PCVARIANT_ERROR_OUT_OF_MEMORY);
+    return NULL;
+}
+
+/* VWNOTE: the list of the listeners is kept even if it becomes empty,
+   because a handler may revoke a listener while the list is being walked;
+   it is dropped when the variant is released or moved out of
+   the instance. */
+void
+pcvariant_drop_listeners(purc_variant_t v)
+{
+    struct pcvariant_heap *heap = pcinst_current()->org_vrt_heap;
+
+    if (heap->listeners)
+        pchash_table_delete(heap->listeners, v);
+    v->flags &= ~PCVARIANT_FLAG_LISTENED;
+}
+
 static pcvar_listener*
 register_listener(purc_variant_t v, unsigned int flags,
         pcvar_op_t op, pcvar_op_handler handler, void *ctxt)
 {
+    // a frozen variant never changes and is shared by other instances.
+    PCVARIANT_CHECK_NOT_FROZEN_RET(v, NULL);
+
     struct list_head *listeners;
-    listeners = &v->listeners;
+    listeners = get_listeners(v, true);
+    if (!listeners)
+        return NULL;
 
     struct pcvar_listener *listener;
     listener = (struct pcvar_listener*)calloc(1, sizeof(*listener));
@@ -116,7 +199,9 @@ purc_variant_revoke_listener(purc_variant_t v,
     }
 
     struct list_head *listeners;
-    listeners = &v->listeners;
+    listeners = get_listeners(v, false);
+    if (!listeners)
+        return false;
 
     struct list_head *p, *n;
     list_for_each_safe(p, n, listeners) {
@@ -144,7 +229,9 @@ bool pcvariant_on_pre_fired(
     PC_ASSERT(op != PCVAR_OPERATION_ALL);
 
     struct list_head *listeners;
-    listeners = &source->listeners;
+    listeners = get_listeners(source, false);
+    if (!listeners)
+        return true;
 
     struct list_head *p, *n;
     list_for_each_safe(p, n, listeners) {
@@ -175,7 +262,9 @@ void pcvariant_on_post_fired(
     PC_ASSERT(op != PCVAR_OPERATION_ALL);
 
     struct list_head *listeners;
-    listeners = &source->listeners;
+    listeners = get_listeners(source, false);
+    if (!listeners)
+        return;
 
     struct pcvar_listener *p, *n;
     list_for_each_entry_reverse_safe(p, n, listeners, list_node) {
@@ -196,6 +285,9 @@ void
 pcvar_break_rue_downward(purc_variant_t val)
 {
     PC_ASSERT(val != PURC_VARIANT_INVALID);
+    if (val->flags & PCVARIANT_FLAG_FROZEN)
+        return;
+
     switch (val->type) {
         case PURC_VARIANT_TYPE_ARRAY:
             if (pcvar_container_belongs_to_set(val))
@@ -232,7 +324,8 @@ pcvar_break_edge_to_parent(purc_variant_t val,
         struct pcvar_rev_update_edge *edge)
 {
     PC_ASSERT(val != PURC_VARIANT_INVALID);
-    if (pcvariant_is_mutable(val) == false)
+    if (pcvariant_is_mutable(val) == false ||
+            (val->flags & PCVARIANT_FLAG_FROZEN))
         return;
 
     switch (val->type) {
@@ -254,6 +347,11 @@ int
 pcvar_build_rue_downward(purc_variant_t val)
 {
     PC_ASSERT(val != PURC_VARIANT_INVALID);
+    /* A frozen variant never changes, so no reverse update edge is needed
+       in it; nor can it be changed for it is shared by other instances. */
+    if (val->flags & PCVARIANT_FLAG_FROZEN)
+        return 0;
+
     switch (val->type) {
         case PURC_VARIANT_TYPE_ARRAY:
             return pcvar_array_build_rue_downward(val);
@@ -287,7 +385,8 @@ pcvar_build_edge_to_parent(purc_variant_t val,
         struct pcvar_rev_update_edge *edge)
 {
     PC_ASSERT(val != PURC_VARIANT_INVALID);
-    if (pcvariant_is_mutable(val) == false)
+    if (pcvariant_is_mutable(val) == false ||
+            (val->flags & PCVARIANT_FLAG_FROZEN))
         return 0;
 
     switch (val->type) {
@@ -46,6 +46,7 @@
 #include "private/instance.h"
 #include "private/errors.h"
 #include "private/debug.h"
+#include "private/utils.h"
 
 #include "variant/variant-internals.h"
 
@@ -96,93 +97,90 @@ static const char *hex_chars = "0123456789abcdefABCDEF";
         }                                                               \
     } while (0)
 
+/* whether a character needs to be escaped in a JSON string. */
+static inline bool
+needs_escape(unsigned char c, bool escape_slash)
+{
+    return c == '"' || c == '\\' || c < 0x20 || (c == '/' && escape_slash);
+}
+
+/*
+ * Scans 8 bytes a time for the end of a run of the characters which need
+ * no escaping, so the clean runs can be written in bulk.
+ */
+static const char *
+scan_clean_run(const char *p, const char *end, bool escape_slash)
+{
+    while (end - p >= 8) {
+        uint64_t w;
+        memcpy(&w, p, sizeof(w));
+        if (pcutils_swar_has_byte(w, '"') | pcutils_swar_has_byte(w, '\\') |
+                pcutils_swar_has_byte_less_than(w, 0x20) |
+                (escape_slash ? pcutils_swar_has_byte(w, '/') : 0))
+            break;
+        p += 8;
+    }
+
+    while (p < end && !needs_escape((unsigned char)*p, escape_slash))
+        p++;
+
+    return p;
+}
+
 static ssize_t
 serialize_string(purc_rwstream_t rws, const char* str,
         size_t len, unsigned int flags, size_t *len_expected)
 {
     int nr_written = 0;
-    size_t pos = 0, start_offset = 0;
-    unsigned char c;
-    char buff[3];
+    bool escape_slash = !(flags & PCVARIANT_SERIALIZE_OPT_NOSLASHESCAPE);
+    const char *p = str, *end = str + len;
+    char buff[6];
+
+    while (p < end) {
+        const char *run = p;
+        p = scan_clean_run(p, end, escape_slash);
+        if (p > run)
+            MY_WRITE(rws, run, p - run);
+        if (p == end)
+            break;
 
-    while (len--) {
-        c = str[pos];
+        unsigned char c = (unsigned char)*p++;
+        size_t len_esc = 2;
+
+        buff[0] = '\\';
         switch (c) {
         case '\b':
+            buff[1] = 'b';
+            break;
         case '\n':
+            buff[1] = 'n';
+            break;
         case '\r':
+            buff[1] = 'r';
+            break;
         case '\t':
+            buff[1] = 't';
+            break;
         case '\f':
+            buff[1] = 'f';
+            break;
         case '"':
         case '\\':
         case '/':
-            if ((flags & PCVARIANT_SERIALIZE_OPT_NOSLASHESCAPE) && c == '/') {
-                pos++;
-                break;
-            }
-
-            if (pos - start_offset > 0)
-                MY_WRITE(rws, str + start_offset, pos - start_offset);
-
-            buff[0] = 0;
-            if (c == '\b') {
-                buff[0] = '\\';
-                buff[1] = 'b';
-            }
-            else if (c == '\n') {
-                buff[0] = '\\';
-                buff[1] = 'n';
-            }
-            else if (c == '\r') {
-                buff[0] = '\\';
-                buff[1] = 'r';
-            }
-            else if (c == '\t') {
-                buff[0] = '\\';
-                buff[1] = 't';
-            }
-            else if (c == '\f') {
-                buff[0] = '\\';
-                buff[1] = 'f';
-            }
-            else if (c == '"') {
-                buff[0] = '\\';
-                buff[1] = '\"';
-            }
-            else if (c == '\\') {
-                buff[0] = '\\';
-                buff[1] = '\\';
-            }
-            else if (c == '/') {
-                buff[0] = '\\';
-                buff[1] = '/';
-            }
-
-            if (buff[0])
-                MY_WRITE(rws, buff, 2);
-
-            start_offset = ++pos;
+            buff[1] = c;
             break;
-
         default:
-            if (c < ' ') {
-                char sbuf[7];
-                if (pos - start_offset > 0)
-                    MY_WRITE(rws, str + start_offset, pos - start_offset);
-
-                if (snprintf(sbuf, sizeof(sbuf), "\\u00%c%c",
-                            hex_chars[c >> 4], hex_chars[c & 0xf]) < 0)
-                    goto failed;
-
-                MY_WRITE(rws, sbuf, sizeof(sbuf) - 1);
-                start_offset = ++pos;
-            }
-            else
-                pos++;
+            buff[1] = 'u';
+            buff[2] = '0';
+            buff[3] = '0';
+            buff[4] = hex_chars[c >> 4];
+            buff[5] = hex_chars[c & 0xf];
+            len_esc = 6;
+            break;
         }
+
+        MY_WRITE(rws, buff, len_esc);
     }
-    if (pos - start_offset > 0)
-        MY_WRITE(rws, str + start_offset, pos - start_offset);
 
     return nr_written;
 
@@ -520,6 +518,101 @@ serialize_double(purc_rwstream_t rws, double d, int flags,
     return purc_rwstream_write(rws, buf, size);
 }
 
+/* integral doubles are written with all digits, like `%.0f` does */
+#define LEN_BUFF_DOUBLE     (DBL_MAX_10_EXP + 16)
+
+/*
+ * Formats a finite double with the shortest digits which round-trip;
+ * the layout is the one of `%.17g`, except the integral values are
+ * written without exponent.
+ */
+static size_t
+format_double_shortest(double d, char *buf)
+{
+    char digits[PCUTILS_DTOA_MAX_DIGITS + 1];
+    bool negative;
+    int point;
+    int nr_digits = (int)pcutils_dtoa_shortest(d, digits, &negative, &point);
+    char *p = buf;
+
+    if (negative)
+        *p++ = '-';
+
+    if (nr_digits <= point) {
+        /* integral: ddd000 */
+        memcpy(p, digits, nr_digits);
+        p += nr_digits;
+        memset(p, '0', point - nr_digits);
+        p += point - nr_digits;
+    }
+    else if (point > 0) {
+        /* ddd.ddd */
+        memcpy(p, digits, point);
+        p += point;
+        *p++ = '.';
+        memcpy(p, digits + point, nr_digits - point);
+        p += nr_digits - point;
+    }
+    else if (point > -4) {
+        /* 0.000ddd */
+        *p++ = '0';
+        *p++ = '.';
+        memset(p, '0', -point);
+        p += -point;
+        memcpy(p, digits, nr_digits);
+        p += nr_digits;
+    }
+    else {
+        /* d.ddde-XX */
+        int exp = 1 - point;
+
+        *p++ = digits[0];
+        if (nr_digits > 1) {
+            *p++ = '.';
+            memcpy(p, digits + 1, nr_digits - 1);
+            p += nr_digits - 1;
+        }
+
+        *p++ = 'e';
+        *p++ = '-';
+        if (exp >= 100)
+            *p++ = '0' + exp / 100;
+        *p++ = '0' + (exp / 10) % 10;
+        *p++ = '0' + exp % 10;
+    }
+
+    return p - buf;
+}
+
+static ssize_t
+serialize_double_shortest(purc_rwstream_t rws, double d, size_t *len_expected)
+{
+    char buf[LEN_BUFF_DOUBLE];
+    size_t size;
+
+    if (isnan(d)) {
+        strcpy(buf, "NaN");
+        size = static_strlen("NaN");
+    }
+    else if (isinf(d)) {
+        if (d > 0) {
+            strcpy(buf, "Infinity");
+            size = static_strlen("Infinity");
+        }
+        else {
+            strcpy(buf, "-Infinity");
+            size = static_strlen("-Infinity");
+        }
+    }
+    else {
+        size = format_double_shortest(d, buf);
+    }
+
+    if (len_expected)
+        *len_expected += size;
+    return purc_rwstream_write(rws, buf, size);
+}
+
 static ssize_t
 serialize_long_double(purc_rwstream_t rws, long double ld, int flags,
         const char *format, size_t *len_expected)
@@ -672,6 +765,8 @@ ssize_t purc_variant_serialize(purc_variant_t value, purc_rwstream_t rws,
     char buff [256];
     purc_variant_t member = NULL;
     purc_variant_t key;
+    struct obj_kv *kvs_buf[PCVAR_OBJ_NR_KVS_ON_STACK];
+    struct obj_kv **kvs = NULL;
     char* format_double = NULL;
     char* format_long_double = NULL;
     variant_set_t data;
@@ -717,6 +812,16 @@ ssize_t purc_variant_serialize(purc_variant_t value, purc_rwstream_t rws,
             break;
 
         case PURC_VARIANT_TYPE_NUMBER:
+            if (format_double == NULL) {
+                n = serialize_double_shortest(rws, value->d, len_expected);
+                if (n < 0)
+                    goto failed;
+                nr_written += n;
+
+                content = NULL;
+                break;
+            }
+
             /* try to serialize the number as an integer first */
             n = serialize_number(rws, value->d, len_expected);
             if (n < 0)
@@ -836,8 +941,16 @@ ssize_t purc_variant_serialize(purc_variant_t value, purc_rwstream_t rws,
             n = print_newline(rws, flags, len_expected);
             MY_CHECK(n);
 
-            i = 0;
-            foreach_key_value_in_variant_object(value, key, member)
+            /* Serialize the members in the order of keys, so that the
+               result does not depend on the order of insertion. */
+            kvs = pcvar_obj_sorted_kvs(value, kvs_buf,
+                    PCVAR_OBJ_NR_KVS_ON_STACK);
+            if (kvs == NULL)
+                goto failed;
+
+            for (i = 0; i < pcvar_obj_get_data(value)->size; i++) {
+                key = kvs[i]->key;
+                member = kvs[i]->val;
                 if (i > 0) {
                     MY_WRITE(rws, ",", 1);
                     n = print_newline(rws, flags, len_expected);
@@ -867,9 +980,11 @@ ssize_t purc_variant_serialize(purc_variant_t value, purc_rwstream_t rws,
                 n = purc_variant_serialize(member,
                         rws, level + 1, flags, len_expected);
                 MY_CHECK(n);
+            }
 
-                i++;
-            end_foreach;
+            if (kvs != kvs_buf)
+                free(kvs);
+            kvs = NULL;
 
             if (i > 0) {
                 n = print_newline(rws, flags, len_expected);
@@ -1063,6 +1178,121 @@ ssize_t purc_variant_serialize(purc_variant_t value, purc_rwstream_t rws,
     return nr_written;
 
 failed:
+    if (kvs && kvs != kvs_buf)
+        free(kvs);
     return -1;
 }
 
+
+/* the length of a member separator, and the indent and spaces around */
+static size_t
+member_overhead(int level, unsigned int flags)
+{
+    size_t n = 1;
+
+    if (flags & PCVARIANT_SERIALIZE_OPT_PRETTY) {
+        n += 1;
+        if (level > 0 && level <= MAX_EMBEDDED_LEVELS)
+            n += (flags & PCVARIANT_SERIALIZE_OPT_PRETTY_TAB) ?
+                level : level * 2;
+    }
+    else if (flags & PCVARIANT_SERIALIZE_OPT_SPACED) {
+        n += 1;
+    }
+
+    return n;
+}
+
+static size_t
+bsequence_length(size_t nr_bytes, unsigned int flags)
+{
+    switch (flags & PCVARIANT_SERIALIZE_OPT_BSEQUENCE_MASK) {
+    case PCVARIANT_SERIALIZE_OPT_BSEQUENCE_HEX_STRING:
+    case PCVARIANT_SERIALIZE_OPT_BSEQUENCE_HEX:
+        return nr_bytes * 2 + 2;
+
+    case PCVARIANT_SERIALIZE_OPT_BSEQUENCE_BIN:
+    case PCVARIANT_SERIALIZE_OPT_BSEQUENCE_BIN_DOT:
+        return nr_bytes * 10 + 2;
+
+    default:
+        return (nr_bytes + 2) / 3 * 4 + 3;
+    }
+}
+
+static size_t
+serialize_size_hint(purc_variant_t value, int level, unsigned int flags)
+{
+    purc_variant_t member, key;
+    size_t len, hint = 0;
+
+    switch (value->type) {
+    case PURC_VARIANT_TYPE_EXCEPTION:
+    case PURC_VARIANT_TYPE_ATOMSTRING:
+        return strlen(purc_atom_to_string(value->atom)) + 2;
+
+    case PURC_VARIANT_TYPE_NUMBER:
+    case PURC_VARIANT_TYPE_LONGINT:
+    case PURC_VARIANT_TYPE_ULONGINT:
+    case PURC_VARIANT_TYPE_LONGDOUBLE:
+        return 24;
+
+    case PURC_VARIANT_TYPE_STRING:
+        purc_variant_get_string_const_ex(value, &len);
+        return len + 2;
+
+    case PURC_VARIANT_TYPE_BSEQUENCE:
+        purc_variant_get_bytes_const(value, &len);
+        return bsequence_length(len, flags);
+
+    case PURC_VARIANT_TYPE_OBJECT:
+        foreach_key_value_in_variant_object(value, key, member)
+            purc_variant_get_string_const_ex(key, &len);
+            hint += member_overhead(level + 1, flags) + len + 4 +
+                serialize_size_hint(member, level + 1, flags);
+        end_foreach;
+        return hint + member_overhead(level, flags) + 2;
+
+    case PURC_VARIANT_TYPE_ARRAY:
+    {
+        size_t idx;
+        foreach_value_in_variant_array(value, member, idx)
+            (void)idx;
+            hint += member_overhead(level + 1, flags) +
+                serialize_size_hint(member, level + 1, flags);
+        end_foreach;
+        return hint + member_overhead(level, flags) + 2;
+    }
+
+    case PURC_VARIANT_TYPE_SET:
+        foreach_value_in_variant_set_order(value, member)
+            hint += member_overhead(level + 1, flags) +
+                serialize_size_hint(member, level + 1, flags);
+        end_foreach;
+        return hint + member_overhead(level, flags) + 2;
+
+    case PURC_VARIANT_TYPE_TUPLE:
+    {
+        purc_variant_t *members;
+        size_t sz;
+
+        members = tuple_members(value, &sz);
+        for (size_t idx = 0; idx < sz; idx++) {
+            hint += member_overhead(level + 1, flags) +
+                serialize_size_hint(members[idx], level + 1, flags);
+        }
+        return hint + member_overhead(level, flags) + 2;
+    }
+
+    default:
+        /* undefined, null, boolean, dynamic, and native */
+        return 12;
+    }
+}
+
+size_t
+pcvariant_serialize_size_hint(purc_variant_t value, unsigned int flags)
+{
+    /* one more byte for the terminating null character */
+    return serialize_size_hint(value, 0, flags) + 1;
+}
@@ -0,0 +1,363 @@
+/*
+ * @file slab.c
+ * @date 2026/10/16
+ * @brief The slab allocator of the variant heap.
+ *
+ * Copyright (C) 2026 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Every variant heap (the heap of an instance or the move heap) owns a list
+ * of pages for each size class. A page is aligned to its size and starts
+ * with a header, so the page of a slot can be located by masking the address.
+ *
+ * Variants may be moved to other instances (see move-heap.c), so a slot can
+ * be released by a heap other than its owner, maybe in another thread.
+ * Such a slot is pushed onto the lock-free remote list of its page, and the
+ * owner collects the remote list lazily.
+ *
+ * When the owner heap is cleaned up, the pages having no used slots are
+ * released in one pass. The other pages are abandoned: the last remote
+ * release of an abandoned page frees the page.
+ */
+
+#include "config.h"
+
+#include "private/variant.h"
+#include "private/debug.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* this feature needs C11 (stdatomic.h) or above */
+#include <stdatomic.h>
+
+#if USE(SLAB_FOR_VARIANTS)
+
+#define REMOTE_ABANDONED        ((uintptr_t)0x01)
+
+/* the max number of full pages to check before allocating a new page */
+#define MAX_FULL_PAGES_TO_CHECK 8
+
+struct slab_slot {
+    struct slab_slot               *next;
+};
+
+struct slab_page {
+    // the list node in the partial or full list of the class.
+    struct list_head                node;
+
+    // the owner heap; NULL if the page was abandoned.
+    _Atomic(struct pcvariant_heap *) heap;
+
+    // the slots released by the owner heap.
+    struct slab_slot               *free;
+
+    // the slots released by other heaps, tagged by REMOTE_ABANDONED.
+    atomic_uintptr_t                remote;
+
+    // the number of live slots after the page was abandoned.
+    atomic_uint                     nr_live;
+
+    unsigned int                    cls;
+    unsigned int                    slot_size;
+    unsigned int                    nr_slots;
+    unsigned int                    nr_used;
+
+    // the number of slots which have been carved from the page.
+    unsigned int                    nr_carved;
+};
+
+#define PAGE_HEADER_SIZE                                                \
+    ((sizeof(struct slab_page) + PCVARIANT_SLAB_SLOT_ALIGN - 1) &       \
+        ~(size_t)(PCVARIANT_SLAB_SLOT_ALIGN - 1))
+
+static inline struct slab_page *
+page_of_slot(void *ptr)
+{
+    return (struct slab_page *)
+        ((uintptr_t)ptr & ~(uintptr_t)(PCVARIANT_SLAB_PAGE_SIZE - 1));
+}
+
+static inline unsigned int
+class_of_size(size_t size)
+{
+    if (size == 0)
+        size = 1;
+    return (unsigned int)((size - 1) / PCVARIANT_SLAB_SLOT_ALIGN);
+}
+
+void pcvariant_slab_init(struct pcvariant_heap *heap)
+{
+    for (int i = 0; i < PCVARIANT_SLAB_NR_CLASSES; i++) {
+        INIT_LIST_HEAD(&heap->slab[i].partial);
+        INIT_LIST_HEAD(&heap->slab[i].full);
+        heap->slab[i].nr_pages = 0;
+    }
+}
+
+static struct slab_page *
+new_page(struct pcvariant_heap *heap, unsigned int cls)
+{
+    void *mem;
+    if (posix_memalign(&mem, PCVARIANT_SLAB_PAGE_SIZE,
+                PCVARIANT_SLAB_PAGE_SIZE))
+        return NULL;
+
+    struct slab_page *page = mem;
+    atomic_init(&page->heap, heap);
+    page->free = NULL;
+    atomic_init(&page->remote, 0);
+    atomic_init(&page->nr_live, 0);
+    page->cls = cls;
+    page->slot_size = (cls + 1) * PCVARIANT_SLAB_SLOT_ALIGN;
+    page->nr_slots = (PCVARIANT_SLAB_PAGE_SIZE - PAGE_HEADER_SIZE) /
+        page->slot_size;
+    page->nr_used = 0;
+    page->nr_carved = 0;
+
+    list_add(&page->node, &heap->slab[cls].partial);
+    heap->slab[cls].nr_pages++;
+    return page;
+}
+
+static void
+release_page(struct pcvariant_heap *heap, struct slab_page *page)
+{
+    list_del(&page->node);
+    heap->slab[page->cls].nr_pages--;
+    free(page);
+}
+
+/* Moves the slots released by other heaps to the local free list. */
+static inline void
+collect_remote_slots(struct slab_page *page)
+{
+    if (atomic_load_explicit(&page->remote, memory_order_relaxed) == 0)
+        return;
+
+    struct slab_slot *slot = (struct slab_slot *)
+        atomic_exchange_explicit(&page->remote, 0, memory_order_acquire);
+    while (slot) {
+        struct slab_slot *next = slot->next;
+        slot->next = page->free;
+        page->free = slot;
+        page->nr_used--;
+        slot = next;
+    }
+}
+
+/* Checks some full pages for the slots released by other heaps. */
+static void
+reclaim_full_pages(struct pcvariant_slab_class *sc)
+{
+    for (int i = 0; i < MAX_FULL_PAGES_TO_CHECK && !list_empty(&sc->full);
+            i++) {
+        struct slab_page *page;
+        page = list_first_entry(&sc->full, struct slab_page, node);
+
+        collect_remote_slots(page);
+        if (page->free) {
+            list_move(&page->node, &sc->partial);
+        }
+        else {
+            list_move_tail(&page->node, &sc->full);
+        }
+    }
+}
+
+void *pcvariant_slab_alloc(struct pcvariant_heap *heap, size_t size)
+{
+    PC_ASSERT(size <= PCVARIANT_SLAB_MAX_SLOT_SIZE);
+
+    unsigned int cls = class_of_size(size);
+    struct pcvariant_slab_class *sc = &heap->slab[cls];
+    struct slab_page *page;
+
+    if (list_empty(&sc->partial)) {
+        reclaim_full_pages(sc);
+    }
+
+    if (list_empty(&sc->partial)) {
+        page = new_page(heap, cls);
+        if (page == NULL)
+            return NULL;
+    }
+    else {
+        page = list_first_entry(&sc->partial, struct slab_page, node);
+    }
+
+    void *ptr;
+    if (page->free) {
+        ptr = page->free;
+        page->free = page->free->next;
+    }
+    else {
+        PC_ASSERT(page->nr_carved < page->nr_slots);
+        ptr = (char *)page + PAGE_HEADER_SIZE +
+            (size_t)page->nr_carved * page->slot_size;
+        page->nr_carved++;
+    }
+    page->nr_used++;
+
+    if (page->free == NULL && page->nr_carved == page->nr_slots) {
+        collect_remote_slots(page);
+        if (page->free == NULL)
+            list_move(&page->node, &sc->full);
+    }
+
+    return ptr;
+}
+
+static void
+free_remote_slot(struct slab_page *page, struct slab_slot *slot)
+{
+    uintptr_t old = atomic_load_explicit(&page->remote, memory_order_relaxed);
+
+    do {
+        if (old & REMOTE_ABANDONED) {
+            if (atomic_fetch_sub(&page->nr_live, 1) == 1)
+                free(page);
+            return;
+        }
+
+        slot->next = (struct slab_slot *)old;
+    } while (!atomic_compare_exchange_weak_explicit(&page->remote, &old,
+                (uintptr_t)slot, memory_order_release, memory_order_relaxed));
+}
+
+void pcvariant_slab_free(struct pcvariant_heap *heap, void *ptr)
+{
+    struct slab_page *page = page_of_slot(ptr);
+    struct slab_slot *slot = ptr;
+
+    if (atomic_load_explicit(&page->heap, memory_order_relaxed) != heap) {
+        free_remote_slot(page, slot);
+        return;
+    }
+
+    bool was_full = (page->free == NULL && page->nr_carved == page->nr_slots);
+
+    slot->next = page->free;
+    page->free = slot;
+    page->nr_used--;
+    collect_remote_slots(page);
+
+    struct pcvariant_slab_class *sc = &heap->slab[page->cls];
+    if (page->nr_used == 0 && sc->nr_pages > 1) {
+        /* keep at least one page in the class to avoid thrashing. */
+        release_page(heap, page);
+    }
+    else if (was_full) {
+        list_move(&page->node, &sc->partial);
+    }
+}
+
+static void
+cleanup_page(struct pcvariant_heap *heap, struct slab_page *page)
+{
+    list_del(&page->node);
+    heap->slab[page->cls].nr_pages--;
+
+    /* The slots in the remote list are counted by nr_used; so set nr_live
+       before abandoning the page, then discount the collected slots. */
+    unsigned int nr_collected = 0;
+    atomic_store(&page->nr_live, page->nr_used);
+    atomic_store(&page->heap, NULL);
+
+    struct slab_slot *slot = (struct slab_slot *)
+        atomic_exchange(&page->remote, REMOTE_ABANDONED);
+    while (slot) {
+        nr_collected++;
+        slot = slot->next;
+    }
+
+    if (atomic_fetch_sub(&page->nr_live, nr_collected) == nr_collected) {
+        free(page);
+    }
+    else {
+        PC_DEBUG("A slab page abandoned with %u live slot(s)\n",
+                page->nr_used - nr_collected);
+    }
+}
+
+void pcvariant_slab_cleanup(struct pcvariant_heap *heap)
+{
+    for (int i = 0; i < PCVARIANT_SLAB_NR_CLASSES; i++) {
+        struct pcvariant_slab_class *sc = &heap->slab[i];
+        struct slab_page *page, *tmp;
+
+        list_for_each_entry_safe(page, tmp, &sc->partial, node) {
+            cleanup_page(heap, page);
+        }
+
+        list_for_each_entry_safe(page, tmp, &sc->full, node) {
+            cleanup_page(heap, page);
+        }
+
+        PC_ASSERT(sc->nr_pages == 0);
+    }
+}
+
+static void
+stat_page(struct slab_page *page, struct purc_variant_stat *stat)
+{
+    stat->nr_slab_pages++;
+    stat->sz_slab_mem += PCVARIANT_SLAB_PAGE_SIZE;
+    stat->nr_slab_used_slots += page->nr_used;
+    stat->nr_slab_slots += page->nr_slots;
+
+    int level = 0;
+    if (page->nr_used > 0) {
+        level = (int)(((size_t)page->nr_used * PURC_VARIANT_SLAB_OCCUPANCY_LEVELS
+                    - 1) / page->nr_slots);
+    }
+    stat->nr_slab_pages_by_occupancy[level]++;
+}
+
+void pcvariant_slab_stat(struct pcvariant_heap *heap,
+        struct purc_variant_stat *stat)
+{
+    stat->nr_slab_pages = 0;
+    stat->sz_slab_mem = 0;
+    stat->nr_slab_used_slots = 0;
+    stat->nr_slab_slots = 0;
+    memset(stat->nr_slab_pages_by_occupancy, 0,
+            sizeof(stat->nr_slab_pages_by_occupancy));
+
+    for (int i = 0; i < PCVARIANT_SLAB_NR_CLASSES; i++) {
+        struct pcvariant_slab_class *sc = &heap->slab[i];
+        struct slab_page *page;
+
+        struct slab_page *tmp;
+
+        list_for_each_entry(page, &sc->partial, node) {
+            collect_remote_slots(page);
+            stat_page(page, stat);
+        }
+
+        list_for_each_entry_safe(page, tmp, &sc->full, node) {
+            collect_remote_slots(page);
+            stat_page(page, stat);
+            if (page->free)
+                list_move(&page->node, &sc->partial);
+        }
+    }
+}
+
+#endif /* USE(SLAB_FOR_VARIANTS) */
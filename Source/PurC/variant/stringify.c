@@ -24,6 +24,8 @@
 
 #include "variant-internals.h"
 
+#include <stdlib.h>
+
 static int
 _stringify_str(const char *s, void *ctxt, stringify_f cb)
 {
@@ -120,31 +122,42 @@ pcvar_obj_stringify(purc_variant_t val, void *ctxt, stringify_f cb)
     PC_ASSERT(val);
     PC_ASSERT(purc_variant_is_object(val));
 
+    // stringify the members in the order of keys.
+    struct obj_kv *buf[PCVAR_OBJ_NR_KVS_ON_STACK];
+    struct obj_kv **kvs;
+    kvs = pcvar_obj_sorted_kvs(val, buf, PCVAR_OBJ_NR_KVS_ON_STACK);
+    if (kvs == NULL)
+        return -1;
+
     int r = 0;
 
-    purc_variant_t k, v;
-    foreach_key_value_in_variant_object(val, k, v) {
+    size_t sz = pcvar_obj_get_data(val)->size;
+    for (size_t i = 0; i < sz; i++) {
+        purc_variant_t k = kvs[i]->key;
+        purc_variant_t v = kvs[i]->val;
         PC_ASSERT(k != PURC_VARIANT_INVALID);
         PC_ASSERT(purc_variant_is_string(k));
         PC_ASSERT(v != PURC_VARIANT_INVALID);
 
         r = pcvar_stringify(k, ctxt, cb);
         if (r)
-            return r;
+            break;
 
         r = _stringify_str(":", ctxt, cb);
         if (r)
-            return r;
+            break;
 
         r = pcvar_stringify(v, ctxt, cb);
         if (r)
-            return r;
+            break;
 
         r = _stringify_str("\n", ctxt, cb);
         if (r)
-            return r;
+            break;
     }
-    end_foreach;
+
+    if (kvs != buf)
+        free(kvs);
 
     return r;
 }
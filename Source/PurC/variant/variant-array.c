@@ -26,6 +26,7 @@
 
 #include "config.h"
 #include "private/variant.h"
+#include "private/instance.h"
 #include "private/errors.h"
 #include "variant-internals.h"
 #include "purc-errors.h"
@@ -36,11 +37,12 @@
 #include <stdlib.h>
 #include <string.h>
 
+#define ARR_MIN_CAPACITY        4
+
 static size_t
 variant_arr_length(variant_arr_t data)
 {
-    struct pcutils_array_list *al = &data->al;
-    return pcutils_array_list_length(al);
+    return data->nr;
 }
 
 static inline bool
@@ -129,97 +131,247 @@ pcvar_arr_get_data(purc_variant_t arr)
     return (variant_arr_t)arr->sz_ptr[1];
 }
 
+/* The vals shared by the clones is counted once in the statistics, from
+   the time it is shared until an array owns it again. */
 static void
-break_rev_update_chain(purc_variant_t arr, struct arr_node *node)
+count_shared_vals(variant_arr_t data, bool shared)
 {
-    struct pcvar_rev_update_edge edge = {
-        .parent        = arr,
-        .arr_me        = node,
-    };
+    struct purc_variant_stat *stat = &pcinst_current()->variant_heap->stat;
+    size_t size = data->sz * sizeof(*data->vals);
+
+    if (shared) {
+        stat->sz_mem[PVT(_ARRAY)] += size;
+        stat->sz_total_mem += size;
+    }
+    else {
+        stat->sz_mem[PVT(_ARRAY)] -= size;
+        stat->sz_total_mem -= size;
+    }
+}
+
+/* Makes vals owned by the array; it is copied if it is still shared with
+   the other clones. */
+static int
+arr_unshare(variant_arr_t data)
+{
+    if (data->cow == NULL)
+        return 0;
+
+    if (*data->cow > 1) {
+        purc_variant_t *vals = NULL;
+        if (data->sz) {
+            vals = (purc_variant_t *)malloc(data->sz * sizeof(*vals));
+            if (!vals) {
+                pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+                return -1;
+            }
 
-    pcvar_break_edge_to_parent(node->val, &edge);
-    pcvar_break_rue_downward(node->val);
+            for (size_t i = 0; i < data->nr; i++)
+                vals[i] = purc_variant_ref(data->vals[i]);
+        }
+
+        (*data->cow)--;
+        data->vals = vals;
+    }
+    else {
+        // the other clones have gone.
+        count_shared_vals(data, false);
+        free(data->cow);
+    }
+
+    data->cow = NULL;
+    return 0;
+}
+
+static int
+arr_reserve(variant_arr_t data, size_t capacity)
+{
+    if (capacity <= data->sz)
+        return 0;
+
+    size_t sz = data->sz ? data->sz : ARR_MIN_CAPACITY;
+    while (sz < capacity)
+        sz *= 2;
+
+    purc_variant_t *vals;
+    vals = (purc_variant_t *)realloc(data->vals, sz * sizeof(*vals));
+    if (!vals)
+        return -1;
+    data->vals = vals;
+
+    if (data->nodes) {
+        struct arr_node **nodes;
+        nodes = (struct arr_node **)realloc(data->nodes, sz * sizeof(*nodes));
+        if (!nodes)
+            return -1;
+        data->nodes = nodes;
+    }
+
+    data->sz = sz;
+    return 0;
 }
 
 static void
-arr_node_release(purc_variant_t arr, struct arr_node *node)
+arr_release_nodes(variant_arr_t data)
 {
-    if (!node)
+    if (!data->nodes)
         return;
 
-    break_rev_update_chain(arr, node);
+    for (size_t i = 0; i < data->nr; i++)
+        free(data->nodes[i]);
 
-    if (node->node.idx != (size_t)-1) {
-        variant_arr_t data = pcvar_arr_get_data(arr);
-        PC_ASSERT(data);
+    free(data->nodes);
+    data->nodes = NULL;
+}
+
+static int
+arr_materialize_nodes(variant_arr_t data)
+{
+    if (data->nodes)
+        return 0;
 
-        struct pcutils_array_list *al = &data->al;
-        PC_ASSERT(al);
+    if (arr_unshare(data))
+        return -1;
 
-        struct pcutils_array_list_node *p;
-        int r = pcutils_array_list_remove(al, node->node.idx, &p);
-        PC_ASSERT(r == 0);
-        PC_ASSERT(&node->node == p);
-        PC_ASSERT(node->node.idx == (size_t)-1);
+    size_t sz = data->sz ? data->sz : ARR_MIN_CAPACITY;
+    struct arr_node **nodes;
+    nodes = (struct arr_node **)calloc(sz, sizeof(*nodes));
+    if (!nodes)
+        goto failed;
+
+    for (size_t i = 0; i < data->nr; i++) {
+        nodes[i] = (struct arr_node *)malloc(sizeof(struct arr_node));
+        if (!nodes[i]) {
+            while (i-- > 0)
+                free(nodes[i]);
+            free(nodes);
+            goto failed;
+        }
+        nodes[i]->idx = i;
     }
 
-    PURC_VARIANT_SAFE_CLEAR(node->val);
+    data->nodes = nodes;
+    return 0;
+
+failed:
+    pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+    return -1;
 }
 
 static void
-arr_node_destroy(purc_variant_t arr, struct arr_node *node)
+arr_reindex_nodes(variant_arr_t data, size_t from)
 {
-    if (!node)
+    if (!data->nodes)
         return;
 
-    arr_node_release(arr, node);
-    free(node);
+    for (size_t i = from; i < data->nr; i++)
+        data->nodes[i]->idx = i;
 }
 
-static purc_variant_t
-variant_arr_make_pos(variant_arr_t data, size_t idx)
+static void
+break_rev_update_chain(purc_variant_t arr, size_t idx)
 {
-    size_t len = variant_arr_length(data);
-    if (idx > len)
-        idx = len;
+    variant_arr_t data = pcvar_arr_get_data(arr);
+    if (!data->nodes)
+        return;
 
-    return purc_variant_make_longint(idx);
+    struct pcvar_rev_update_edge edge = {
+        .parent        = arr,
+        .arr_me        = data->nodes[idx],
+    };
+
+    pcvar_break_edge_to_parent(data->vals[idx], &edge);
+    pcvar_break_rue_downward(data->vals[idx]);
 }
 
-static struct arr_node*
-arr_node_create(purc_variant_t val)
+/* Inserts the value without any check and holds a reference of it. */
+static int
+arr_insert_at(variant_arr_t data, size_t idx, purc_variant_t val)
 {
-    struct arr_node *node;
-    node = (struct arr_node*)calloc(1, sizeof(*node));
-    if (!node) {
-        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
-        return NULL;
+    struct arr_node *node = NULL;
+
+    if (data->nodes) {
+        node = (struct arr_node *)malloc(sizeof(*node));
+        if (!node)
+            goto failed;
+    }
+
+    if (arr_reserve(data, data->nr + 1)) {
+        free(node);
+        goto failed;
+    }
+
+    size_t nr_moved = data->nr - idx;
+    memmove(data->vals + idx + 1, data->vals + idx,
+            nr_moved * sizeof(*data->vals));
+    data->vals[idx] = purc_variant_ref(val);
+
+    if (node) {
+        memmove(data->nodes + idx + 1, data->nodes + idx,
+                nr_moved * sizeof(*data->nodes));
+        data->nodes[idx] = node;
+    }
+
+    data->nr++;
+    arr_reindex_nodes(data, idx);
+    return 0;
+
+failed:
+    pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+    return -1;
+}
+
+/* Removes the value and returns it; the caller owns the reference. */
+static purc_variant_t
+arr_remove_at(variant_arr_t data, size_t idx)
+{
+    purc_variant_t val = data->vals[idx];
+    size_t nr_moved = data->nr - idx - 1;
+
+    memmove(data->vals + idx, data->vals + idx + 1,
+            nr_moved * sizeof(*data->vals));
+
+    if (data->nodes) {
+        free(data->nodes[idx]);
+        memmove(data->nodes + idx, data->nodes + idx + 1,
+                nr_moved * sizeof(*data->nodes));
     }
 
-    node->node.idx = (size_t)-1;
+    data->nr--;
+    arr_reindex_nodes(data, idx);
+    return val;
+}
 
-    node->val = val;
-    purc_variant_ref(val);
+static purc_variant_t
+variant_arr_make_pos(variant_arr_t data, size_t idx)
+{
+    size_t len = variant_arr_length(data);
+    if (idx > len)
+        idx = len;
 
-    return node;
+    return purc_variant_make_longint(idx);
 }
 
 static int
-build_rev_update_chain(purc_variant_t arr, struct arr_node *node)
+build_rev_update_chain(purc_variant_t arr, size_t idx)
 {
     if (!pcvar_container_belongs_to_set(arr))
         return 0;
 
+    variant_arr_t data = pcvar_arr_get_data(arr);
+    if (arr_materialize_nodes(data))
+        return -1;
+
     int r;
 
     struct pcvar_rev_update_edge edge = {
         .parent        = arr,
-        .arr_me        = node,
+        .arr_me        = data->nodes[idx],
     };
 
-    r = pcvar_build_edge_to_parent(node->val, &edge);
+    r = pcvar_build_edge_to_parent(data->vals[idx], &edge);
     if (r == 0) {
-        r = pcvar_build_rue_downward(node->val);
+        r = pcvar_build_rue_downward(data->vals[idx]);
     }
 
     return r ? -1 : 0;
@@ -240,7 +392,11 @@ check_grow(purc_variant_t arr, size_t idx, purc_variant_t val)
         size_t i;
         purc_variant_t v;
         foreach_value_in_variant_array(arr, v, i) {
-            PC_ASSERT(i < idx);
+            if (i == idx) {
+                r = pcvar_arr_append(_new, val);
+                if (r)
+                    break;
+            }
             r = pcvar_arr_append(_new, v);
             if (r)
                 break;
@@ -249,9 +405,11 @@ check_grow(purc_variant_t arr, size_t idx, purc_variant_t val)
         if (r)
             break;
 
-        r = pcvar_arr_append(_new, val);
-        if (r)
-            break;
+        if (idx >= variant_arr_length(pcvar_arr_get_data(arr))) {
+            r = pcvar_arr_append(_new, val);
+            if (r)
+                break;
+        }
 
         int r = pcvar_reverse_check(arr, _new);
         if (r)
@@ -270,6 +428,8 @@ static int
 variant_arr_insert_before(purc_variant_t arr, size_t idx, purc_variant_t val,
         bool check)
 {
+    PCVARIANT_CHECK_NOT_FROZEN_RET(arr, -1);
+
     if (purc_variant_is_undefined(val)) {
         // FIXME: `undefined` not allowed in arr???
         return 0;
@@ -278,10 +438,10 @@ variant_arr_insert_before(purc_variant_t arr, size_t idx, purc_variant_t val,
     variant_arr_t data = pcvar_arr_get_data(arr);
     PC_ASSERT(data);
 
-    struct pcutils_array_list *al = &data->al;
-    PC_ASSERT(al);
+    if (pcvar_arr_unshare(arr))
+        return -1;
 
-    size_t nr = pcutils_array_list_length(al);
+    size_t nr = variant_arr_length(data);
     if (idx > nr)
         idx = nr;
 
@@ -289,8 +449,6 @@ variant_arr_insert_before(purc_variant_t arr, size_t idx, purc_variant_t val,
     if (pos == PURC_VARIANT_INVALID)
         return -1;
 
-    struct arr_node *node = NULL;
-
     do {
         if (check) {
             if (!grow(arr, pos, val, check))
@@ -300,23 +458,15 @@ variant_arr_insert_before(purc_variant_t arr, size_t idx, purc_variant_t val,
                 break;
         }
 
-        node = arr_node_create(val);
-        if (!node)
-            break;
-
-        int r;
-        PC_ASSERT(node->node.idx == (size_t)-1);
-        r = pcutils_array_list_insert_before(al, idx, &node->node);
-        if (r) {
-            PC_ASSERT(node->node.idx == (size_t)-1);
-            purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        if (arr_insert_at(data, idx, val))
             break;
-        }
-        PC_ASSERT(node->node.idx != (size_t)-1);
 
         if (check) {
-            if (build_rev_update_chain(arr, node))
+            if (build_rev_update_chain(arr, idx)) {
+                break_rev_update_chain(arr, idx);
+                purc_variant_unref(arr_remove_at(data, idx));
                 break;
+            }
 
             pcvar_adjust_set_by_descendant(arr);
             grown(arr, pos, val, check);
@@ -327,7 +477,6 @@ variant_arr_insert_before(purc_variant_t arr, size_t idx, purc_variant_t val,
         return 0;
     } while (0);
 
-    arr_node_destroy(arr, node);
     purc_variant_unref(pos);
 
     return -1;
@@ -340,9 +489,13 @@ refresh_extra(purc_variant_t arr)
     variant_arr_t data = pcvar_arr_get_data(arr);
     if (data) {
         extra += sizeof(*data);
-        struct pcutils_array_list *al = &data->al;
-        extra += al->sz * sizeof(*al->nodes);
-        extra += al->nr * sizeof(struct arr_node);
+        // the shared vals is counted by count_shared_vals().
+        if (data->cow == NULL)
+            extra += data->sz * sizeof(*data->vals);
+        if (data->nodes) {
+            extra += data->sz * sizeof(*data->nodes);
+            extra += data->nr * sizeof(struct arr_node);
+        }
     }
     pcvariant_stat_set_extra_size(arr, extra);
 }
@@ -352,8 +505,7 @@ variant_arr_append(purc_variant_t arr, purc_variant_t val,
         bool check)
 {
     variant_arr_t data = pcvar_arr_get_data(arr);
-    struct pcutils_array_list *al = &data->al;
-    size_t nr = pcutils_array_list_length(al);
+    size_t nr = variant_arr_length(data);
     int r = variant_arr_insert_before(arr, nr, val, check);
     refresh_extra(arr);
     return r ? -1 : 0;
@@ -369,19 +521,14 @@ variant_arr_prepend(purc_variant_t arr, purc_variant_t val,
 static purc_variant_t
 variant_arr_get(variant_arr_t data, size_t idx)
 {
-    struct pcutils_array_list *al = &data->al;
-    struct pcutils_array_list_node *p;
-    p = pcutils_array_list_get(al, idx);
-    if (p == NULL)
+    if (idx >= data->nr)
         return PURC_VARIANT_INVALID;
 
-    struct arr_node *node;
-    node = (struct arr_node*)container_of(p, struct arr_node, node);
-    return node->val;
+    return data->vals[idx];
 }
 
 static int
-check_change(purc_variant_t arr, struct arr_node *node, purc_variant_t val)
+check_change(purc_variant_t arr, size_t idx, purc_variant_t val)
 {
     if (!pcvar_container_belongs_to_set(arr))
         return 0;
@@ -396,10 +543,10 @@ check_change(purc_variant_t arr, struct arr_node *node, purc_variant_t val)
         size_t i;
         purc_variant_t v;
         foreach_value_in_variant_array(arr, v, i) {
-            if (i == node->node.idx) {
+            if (i == idx) {
                 found = true;
             }
-            r = pcvar_arr_append(_new, i == node->node.idx ? val : v);
+            r = pcvar_arr_append(_new, i == idx ? val : v);
             if (r)
                 break;
         } end_foreach;
@@ -426,57 +573,53 @@ static int
 variant_arr_set(purc_variant_t arr, size_t idx, purc_variant_t val,
         bool check)
 {
+    PCVARIANT_CHECK_NOT_FROZEN_RET(arr, -1);
+
     variant_arr_t data = pcvar_arr_get_data(arr);
     PC_ASSERT(data);
 
-    struct pcutils_array_list *al = &data->al;
-    PC_ASSERT(al);
-
-    size_t nr = pcutils_array_list_length(al);
+    size_t nr = variant_arr_length(data);
     if (idx >= nr) {
         purc_set_error(PURC_ERROR_OVERFLOW);
         return -1;
     }
 
-    struct pcutils_array_list_node *p;
-    p = pcutils_array_list_get(al, idx);
-    PC_ASSERT(p);
-
-    struct arr_node *old_node;
-    old_node = (struct arr_node*)container_of(p, struct arr_node, node);
-    PC_ASSERT(old_node->val != PURC_VARIANT_INVALID);
-    if (old_node->val == val) {
+    if (data->vals[idx] == val) {
         // NOTE: keep refc intact
         return 0;
     }
 
+    if (pcvar_arr_unshare(arr))
+        return -1;
+
+    purc_variant_t old = data->vals[idx];
+    PC_ASSERT(old != PURC_VARIANT_INVALID);
+
     purc_variant_t pos = variant_arr_make_pos(data, idx);
     if (pos == PURC_VARIANT_INVALID)
         return -1;
 
     do {
-        purc_variant_t old = old_node->val;
-
         if (check) {
             if (!change(arr, pos, old, val, check))
                 break;
 
-            if (check_change(arr, old_node, val))
+            if (check_change(arr, idx, val))
                 break;
 
-            old_node->val = val;
+            data->vals[idx] = val;
 
-            if (build_rev_update_chain(arr, old_node)) {
-                break_rev_update_chain(arr, old_node);
-                old_node->val = old;
+            if (build_rev_update_chain(arr, idx)) {
+                break_rev_update_chain(arr, idx);
+                data->vals[idx] = old;
                 break;
             }
 
-            old_node->val = old;
-            break_rev_update_chain(arr, old_node);
+            data->vals[idx] = old;
+            break_rev_update_chain(arr, idx);
         }
 
-        old_node->val = purc_variant_ref(val);
+        data->vals[idx] = purc_variant_ref(val);
 
         if (check) {
             pcvar_adjust_set_by_descendant(arr);
@@ -496,7 +639,7 @@ variant_arr_set(purc_variant_t arr, size_t idx, purc_variant_t val,
 }
 
 static int
-check_shrink(purc_variant_t arr, struct arr_node *node)
+check_shrink(purc_variant_t arr, size_t idx)
 {
     if (!pcvar_container_belongs_to_set(arr))
         return 0;
@@ -511,7 +654,7 @@ check_shrink(purc_variant_t arr, struct arr_node *node)
         size_t i;
         purc_variant_t v;
         foreach_value_in_variant_array(arr, v, i) {
-            if (i == node->node.idx) {
+            if (i == idx) {
                 PC_ASSERT(!found);
                 found = true;
                 continue;
@@ -543,54 +686,46 @@ static int
 variant_arr_remove(purc_variant_t arr, size_t idx,
         bool check)
 {
+    PCVARIANT_CHECK_NOT_FROZEN_RET(arr, -1);
+
     variant_arr_t data = pcvar_arr_get_data(arr);
     PC_ASSERT(data);
 
-    struct pcutils_array_list *al = &data->al;
-    PC_ASSERT(al);
-
-    size_t nr = pcutils_array_list_length(al);
+    size_t nr = variant_arr_length(data);
     if (idx >= nr) {
         // FIXME: failure or success???
         return 0;
     }
 
+    if (pcvar_arr_unshare(arr))
+        return -1;
+
     purc_variant_t pos = variant_arr_make_pos(data, idx);
     if (pos == PURC_VARIANT_INVALID)
         return -1;
 
-    struct pcutils_array_list_node *p, *n;
-    p = pcutils_array_list_get(al, idx);
-    PC_ASSERT(p);
-
-    struct arr_node *node;
-    node = (struct arr_node*)container_of(p, struct arr_node, node);
-    PC_ASSERT(node->val);
+    purc_variant_t val = data->vals[idx];
+    PC_ASSERT(val);
 
     do {
         if (check) {
-            if (!shrink(arr, pos, node->val, check))
+            if (!shrink(arr, pos, val, check))
                 break;
 
-            if (check_shrink(arr, node))
+            if (check_shrink(arr, idx))
                 break;
-
-            break_rev_update_chain(arr, node);
         }
 
-        PC_ASSERT(node->node.idx != (size_t)-1);
-        int r = pcutils_array_list_remove(al, idx, &n);
-        PC_ASSERT(r == 0);
-        PC_ASSERT(&node->node == n);
-        PC_ASSERT(node->node.idx == (size_t)-1);
+        break_rev_update_chain(arr, idx);
+        arr_remove_at(data, idx);
 
         if (check) {
             pcvar_adjust_set_by_descendant(arr);
 
-            shrunk(arr, pos, node->val, check);
+            shrunk(arr, pos, val, check);
         }
 
-        arr_node_destroy(arr, node);
+        purc_variant_unref(val);
         purc_variant_unref(pos);
 
         return 0;
@@ -608,13 +743,26 @@ array_release (purc_variant_t arr)
     if (!data)
         return;
 
-    struct pcutils_array_list *al = &data->al;
-    struct arr_node *p, *n;
-    array_list_for_each_entry_reverse_safe(al, p, n, node) {
-        arr_node_destroy(arr, p);
-    };
+    if (data->cow) {
+        if (--*data->cow > 0) {
+            // the members are still held by the other clones.
+            data->vals = NULL;
+            data->nr = 0;
+        }
+        else {
+            count_shared_vals(data, false);
+            free(data->cow);
+        }
+        data->cow = NULL;
+    }
+
+    for (size_t i = data->nr; i > 0; i--) {
+        break_rev_update_chain(arr, i - 1);
+        PURC_VARIANT_SAFE_CLEAR(data->vals[i - 1]);
+    }
 
-    pcutils_array_list_reset(al);
+    arr_release_nodes(data);
+    free(data->vals);
 
     if (data->rev_update_chain) {
         pcvar_destroy_rev_update_chain(data->rev_update_chain);
@@ -640,21 +788,13 @@ make_array(size_t sz)
         var->flags         = PCVARIANT_FLAG_EXTRA_SIZE;
         var->refc          = 1;
 
-        size_t initial_size = ARRAY_LIST_DEFAULT_SIZE;
-        if (sz>initial_size)
-            initial_size = sz;
-
         variant_arr_t data = (variant_arr_t)calloc(1, sizeof(*data));
         if (!data) {
             pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
             break;
         }
 
-        struct pcutils_array_list *al;
-        al = &data->al;
-        pcutils_array_list_init(al);
-        if (pcutils_array_list_expand(al, initial_size)) {
-            pcutils_array_list_reset(al);
+        if (sz > 0 && arr_reserve(data, sz)) {
             free(data);
             pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
             break;
@@ -866,18 +1006,51 @@ bool purc_variant_array_insert_after (purc_variant_t arr, int idx,
 struct arr_user_data {
     int (*cmp)(purc_variant_t l, purc_variant_t r, void *ud);
     void *ud;
+
+    // not NULL when sorting the nodes.
+    purc_variant_t *vals;
 };
 
-static int
-sort_cmp(struct pcutils_array_list_node *l, struct pcutils_array_list_node *r,
-        void *ud)
+static inline int
+sort_cmp(const void *l, const void *r, struct arr_user_data *d)
+{
+    purc_variant_t lv, rv;
+    if (d->vals) {
+        lv = d->vals[(*(struct arr_node **)l)->idx];
+        rv = d->vals[(*(struct arr_node **)r)->idx];
+    }
+    else {
+        lv = *(purc_variant_t *)l;
+        rv = *(purc_variant_t *)r;
+    }
+
+    return d->cmp(lv, rv, d->ud);
+}
+
+#if OS(HURD) || OS(LINUX)
+static int cmp_f(const void *l, const void *r, void *ud)
+{
+    return sort_cmp(l, r, (struct arr_user_data*)ud);
+}
+#elif OS(DARWIN) || OS(FREEBSD) || OS(NETBSD) || OS(OPENBSD) || OS(WINDOWS)
+static int cmp_f(void *ud, const void *l, const void *r)
 {
-    struct arr_node *l_n, *r_n;
-    l_n = container_of(l, struct arr_node, node);
-    r_n = container_of(r, struct arr_node, node);
+    return sort_cmp(l, r, (struct arr_user_data*)ud);
+}
+#else
+#error Unsupported operating system.
+#endif
 
-    struct arr_user_data *d = (struct arr_user_data*)ud;
-    return d->cmp(l_n->val, r_n->val, d->ud);
+static void
+sort_elements(void *base, size_t nr, size_t size, struct arr_user_data *d)
+{
+#if OS(HURD) || OS(LINUX)
+    qsort_r(base, nr, size, cmp_f, d);
+#elif OS(DARWIN) || OS(FREEBSD) || OS(NETBSD) || OS(OPENBSD)
+    qsort_r(base, nr, size, d, cmp_f);
+#elif OS(WINDOWS)
+    qsort_s(base, nr, size, cmp_f, d);
+#endif
 }
 
 static int vrtcmp(purc_variant_t l, purc_variant_t r, void *ud)
@@ -900,6 +1073,8 @@ int pcvariant_array_sort(purc_variant_t arr, void *ud,
     if (!arr || arr->type != PURC_VARIANT_TYPE_ARRAY)
         return -1;
 
+    PCVARIANT_CHECK_NOT_FROZEN_RET(arr, -1);
+
     variant_arr_t data = pcvar_arr_get_data(arr);
 
     struct arr_user_data d = {
@@ -911,14 +1086,143 @@ int pcvariant_array_sort(purc_variant_t arr, void *ud,
         d.cmp = vrtcmp;
     }
 
-    pcutils_array_list_sort(&data->al, &d, sort_cmp);
+    if (data->nr < 2)
+        return 0;
+
+    if (pcvar_arr_unshare(arr))
+        return -1;
+
+    if (data->nodes == NULL) {
+        sort_elements(data->vals, data->nr, sizeof(*data->vals), &d);
+        return 0;
+    }
+
+    /* The nodes are the keys of the reverse update edges, so they have to
+       follow the values: sort the nodes by the values they refer to, then
+       rearrange the values by the old indices of the nodes. */
+    purc_variant_t *vals;
+    vals = (purc_variant_t *)malloc(data->nr * sizeof(*vals));
+    if (!vals) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+
+    d.vals = data->vals;
+    sort_elements(data->nodes, data->nr, sizeof(*data->nodes), &d);
+
+    for (size_t i = 0; i < data->nr; i++) {
+        vals[i] = data->vals[data->nodes[i]->idx];
+    }
+    memcpy(data->vals, vals, data->nr * sizeof(*vals));
+    free(vals);
+
+    arr_reindex_nodes(data, 0);
 
     return 0;
 }
 
+int pcvariant_array_swap(purc_variant_t arr, size_t i, size_t j)
+{
+    if (!arr || arr->type != PURC_VARIANT_TYPE_ARRAY)
+        return -1;
+
+    PCVARIANT_CHECK_NOT_FROZEN_RET(arr, -1);
+
+    variant_arr_t data = pcvar_arr_get_data(arr);
+    if (i >= data->nr || j >= data->nr)
+        return -1;
+
+    if (pcvar_arr_unshare(arr))
+        return -1;
+
+    purc_variant_t v = data->vals[i];
+    data->vals[i] = data->vals[j];
+    data->vals[j] = v;
+
+    if (data->nodes) {
+        struct arr_node *n = data->nodes[i];
+        data->nodes[i] = data->nodes[j];
+        data->nodes[j] = n;
+        data->nodes[i]->idx = i;
+        data->nodes[j]->idx = j;
+    }
+
+    return 0;
+}
+
+int
+pcvar_arr_unshare(purc_variant_t arr)
+{
+    variant_arr_t data = pcvar_arr_get_data(arr);
+    if (!data || !data->cow)
+        return 0;
+
+    int r = arr_unshare(data);
+    refresh_extra(arr);
+    return r;
+}
+
+#if USE(COW_CONTAINER_CLONES)
+static bool
+arr_has_container(variant_arr_t data)
+{
+    for (size_t i = 0; i < data->nr; i++) {
+        enum purc_variant_type type = data->vals[i]->type;
+        if (IS_CONTAINER(type) || type == PURC_VARIANT_TYPE_TUPLE)
+            return true;
+    }
+
+    return false;
+}
+
+/* Makes a clone sharing vals with the array. */
+static purc_variant_t
+arr_clone_shared(purc_variant_t arr)
+{
+    variant_arr_t data = pcvar_arr_get_data(arr);
+    if (data->cow == NULL) {
+        data->cow = (size_t *)malloc(sizeof(*data->cow));
+        if (!data->cow) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return PURC_VARIANT_INVALID;
+        }
+
+        *data->cow = 1;
+        count_shared_vals(data, true);
+        refresh_extra(arr);
+    }
+
+    purc_variant_t var = make_array(0);
+    if (var == PURC_VARIANT_INVALID)
+        return PURC_VARIANT_INVALID;
+
+    variant_arr_t clone = pcvar_arr_get_data(var);
+    clone->vals = data->vals;
+    clone->nr = data->nr;
+    clone->sz = data->sz;
+    clone->cow = data->cow;
+    (*data->cow)++;
+
+    refresh_extra(var);
+    return var;
+}
+#endif
+
 purc_variant_t
 pcvariant_array_clone(purc_variant_t arr, bool recursively)
 {
+#if USE(COW_CONTAINER_CLONES)
+    /* The members of the array in a set hold the reverse update edges
+       keyed by the nodes of the array, and the containers among the members
+       have to be cloned when cloning recursively. The storage of a frozen
+       array is never shared, for it is read by the other instances. */
+    variant_arr_t data = pcvar_arr_get_data(arr);
+    if (data->nr > 0 && data->nodes == NULL &&
+            !(arr->flags & PCVARIANT_FLAG_FROZEN) &&
+            !(recursively && arr_has_container(data)))
+        return arr_clone_shared(arr);
+#endif
+
     purc_variant_t var;
     var = purc_variant_make_array(0, PURC_VARIANT_INVALID);
     if (var == PURC_VARIANT_INVALID)
@@ -958,18 +1262,16 @@ pcvar_array_break_rue_downward(purc_variant_t arr)
     PC_ASSERT(purc_variant_is_array(arr));
 
     variant_arr_t data = pcvar_arr_get_data(arr);
-    if (!data)
+    if (!data || !data->nodes)
         return;
 
-    struct arr_node *p;
-    foreach_in_variant_array(arr, p) {
-        struct pcvar_rev_update_edge edge = {
-            .parent         = arr,
-            .arr_me         = p,
-        };
-        pcvar_break_edge_to_parent(p->val, &edge);
-        pcvar_break_rue_downward(p->val);
+    for (size_t i = 0; i < data->nr; i++) {
+        break_rev_update_chain(arr, i);
     }
+
+    /* not in any set anymore; the nodes are useless now. */
+    arr_release_nodes(data);
+    refresh_extra(arr);
 }
 
 void
@@ -996,16 +1298,19 @@ pcvar_array_build_rue_downward(purc_variant_t arr)
     if (!data)
         return 0;
 
-    struct arr_node *p;
-    foreach_in_variant_array(arr, p) {
+    if (arr_materialize_nodes(data))
+        return -1;
+    refresh_extra(arr);
+
+    for (size_t i = 0; i < data->nr; i++) {
         struct pcvar_rev_update_edge edge = {
             .parent         = arr,
-            .arr_me         = p,
+            .arr_me         = data->nodes[i],
         };
-        int r = pcvar_build_edge_to_parent(p->val, &edge);
+        int r = pcvar_build_edge_to_parent(data->vals[i], &edge);
         if (r)
             return -1;
-        r = pcvar_build_rue_downward(p->val);
+        r = pcvar_build_rue_downward(data->vals[i]);
         if (r)
             return -1;
     }
@@ -1040,66 +1345,17 @@ pcvar_array_build_edge_to_parent(purc_variant_t arr,
     return r ? -1 : 0;
 }
 
-static struct pcutils_array_list_node*
-next_node(struct pcutils_array_list *al, struct pcutils_array_list_node *node)
-{
-    if (!node)
-        return NULL;
-    size_t count = pcutils_array_list_length(al);
-    size_t idx = node->idx + 1;
-    if (idx >= count)
-        return NULL;
-
-    return pcutils_array_list_get(al, idx);
-}
-
-static struct pcutils_array_list_node*
-prev_node(struct pcutils_array_list *al, struct pcutils_array_list_node *node)
-{
-    if (!node)
-        return NULL;
-    if (node->idx == 0)
-        return NULL;
-
-    size_t count = pcutils_array_list_length(al);
-    size_t idx = node->idx - 1;
-    if (idx >= count)
-        return NULL;
-
-    return pcutils_array_list_get(al, idx);
-}
-
 static void
-it_refresh(struct arr_iterator *it,
-        struct pcutils_array_list *al,
-        struct pcutils_array_list_node *curr)
-{
-    struct pcutils_array_list_node *next  = NULL;
-    struct pcutils_array_list_node *prev  = NULL;
-    if (curr) {
-        next  = next_node(al, curr);
-        prev  = prev_node(al, curr);
-    }
-
-    if (curr) {
-        it->curr = container_of(curr, struct arr_node, node);
-    }
-    else {
-        it->curr = NULL;
-    }
-
-    if (next) {
-        it->next = container_of(next, struct arr_node, node);
-    }
-    else {
-        it->next = NULL;
-    }
-
-    if (prev) {
-        it->prev = container_of(prev, struct arr_node, node);
+it_refresh(struct arr_iterator *it, size_t idx)
+{
+    variant_arr_t data = pcvar_arr_get_data(it->arr);
+    if (idx < data->nr) {
+        it->curr = data->vals[idx];
+        it->idx = idx;
     }
     else {
-        it->prev = NULL;
+        it->curr = PURC_VARIANT_INVALID;
+        it->idx = 0;
     }
 }
 
@@ -1112,17 +1368,7 @@ pcvar_arr_it_first(purc_variant_t arr)
     if (arr == PURC_VARIANT_INVALID)
         return it;
 
-    variant_arr_t data = pcvar_arr_get_data(arr);
-    size_t count = variant_arr_length(data);
-    if (count == 0)
-        return it;
-
-    struct pcutils_array_list *al = &data->al;
-
-    struct pcutils_array_list_node *first;
-    first = pcutils_array_list_get_first(al);
-
-    it_refresh(&it, al, first);
+    it_refresh(&it, 0);
 
     return it;
 }
@@ -1141,12 +1387,7 @@ pcvar_arr_it_last(purc_variant_t arr)
     if (count == 0)
         return it;
 
-    struct pcutils_array_list *al = &data->al;
-
-    struct pcutils_array_list_node *last;
-    last = pcutils_array_list_get_last(al);
-
-    it_refresh(&it, al, last);
+    it_refresh(&it, count - 1);
 
     return it;
 }
@@ -1154,45 +1395,23 @@ pcvar_arr_it_last(purc_variant_t arr)
 void
 pcvar_arr_it_next(struct arr_iterator *it)
 {
-    if (it->curr == NULL)
+    if (it->curr == PURC_VARIANT_INVALID)
         return;
 
-    if (it->next) {
-        variant_arr_t data = pcvar_arr_get_data(it->arr);
-        struct pcutils_array_list *al = &data->al;
-
-        struct pcutils_array_list_node *next;
-        next = &it->next->node;
-
-        it_refresh(it, al, next);
-    }
-    else {
-        it->curr = NULL;
-        it->next = NULL;
-        it->prev = NULL;
-    }
+    it_refresh(it, it->idx + 1);
 }
 
 void
 pcvar_arr_it_prev(struct arr_iterator *it)
 {
-    if (it->curr == NULL)
+    if (it->curr == PURC_VARIANT_INVALID)
         return;
 
-    if (it->prev) {
-        variant_arr_t data = pcvar_arr_get_data(it->arr);
-        struct pcutils_array_list *al = &data->al;
-
-        struct pcutils_array_list_node *prev;
-        prev = &it->prev->node;
-
-        it_refresh(it, al, prev);
+    if (it->idx > 0) {
+        it_refresh(it, it->idx - 1);
     }
     else {
-        it->curr = NULL;
-        it->next = NULL;
-        it->prev = NULL;
+        it->curr = PURC_VARIANT_INVALID;
     }
 }
 
-
@@ -36,6 +36,12 @@
         return (ret);                                           \
     }
 
+#define PCVARIANT_CHECK_NOT_FROZEN_RET(v, ret)                  \
+    if ((v)->flags & PCVARIANT_FLAG_FROZEN) {                   \
+        pcinst_set_error(PCVARIANT_ERROR_FROZEN);               \
+        return (ret);                                           \
+    }
+
 #ifdef __cplusplus
 extern "C" {
 #endif  /* __cplusplus */
@@ -52,6 +58,25 @@ void pcvariant_stat_set_extra_size(purc_variant_t v, size_t sz) WTF_INTERNAL;
 /* Allocate a variant for the specific type. */
 purc_variant_t pcvariant_get (enum purc_variant_type type) WTF_INTERNAL;
 
+/*
+ * Get the shared variant of the number, long integer, or unsigned long
+ * integer type for the small integer with a new reference. Returns
+ * PURC_VARIANT_INVALID if the value is not shared.
+ */
+purc_variant_t pcvariant_get_shared_int(enum purc_variant_type type,
+        int64_t i) WTF_INTERNAL;
+
+/*
+ * Make the current instance allocate and release the variants in the
+ * frozen heap, which is shared by all instances. Returns the heap to be
+ * restored by pcvariant_restore_heap(). The calls can be nested.
+ */
+struct pcvariant_heap *pcvariant_use_frozen_heap(void) WTF_INTERNAL;
+void pcvariant_restore_heap(struct pcvariant_heap *heap) WTF_INTERNAL;
+
+/* Drop the listeners of a variant being released or moved. */
+void pcvariant_drop_listeners(purc_variant_t v) WTF_INTERNAL;
+
 /*
  * Release a unused variant.
  *
@@ -72,6 +97,11 @@ void pcvariant_array_release   (purc_variant_t value)    WTF_INTERNAL;
 void pcvariant_set_release     (purc_variant_t value)    WTF_INTERNAL;
 void pcvariant_tuple_release (purc_variant_t value)    WTF_INTERNAL;
 
+// the hash value of a string variant; cached in the variant if possible.
+uint32_t pcvariant_string_hash(purc_variant_t string) WTF_INTERNAL;
+// the hash value of a null-terminated string; same as the above.
+uint32_t pcvariant_cstr_hash(const char *str) WTF_INTERNAL;
+
 variant_arr_t
 pcvar_arr_get_data(purc_variant_t arr) WTF_INTERNAL;
 variant_obj_t
@@ -80,6 +110,14 @@ variant_set_t
 pcvar_set_get_data(purc_variant_t set) WTF_INTERNAL;
 void
 pcvar_adjust_set_by_descendant(purc_variant_t val) WTF_INTERNAL;
+// adjusts the sets for the containers changed in the current batch
+void
+pcvar_adjust_sets_in_batch(void) WTF_INTERNAL;
+// tells the post listeners of a set the pairs of the old and the new members
+// changed, or at the end of the current batch along with the other changes
+void
+pcvar_set_post_changed(purc_variant_t set, size_t nr_vals,
+        purc_variant_t *vals) WTF_INTERNAL;
 
 pcutils_map*
 pcvar_create_rev_update_chain(void) WTF_INTERNAL;
@@ -110,6 +148,12 @@ pcvariant_set_clone(purc_variant_t set, bool recursively) WTF_INTERNAL;
 purc_variant_t
 pcvariant_tuple_clone(purc_variant_t tuple, bool recursively) WTF_INTERNAL;
 
+// make the storage of the members owned by the container before changing it.
+int
+pcvar_arr_unshare(purc_variant_t arr) WTF_INTERNAL;
+int
+pcvar_obj_unshare(purc_variant_t obj) WTF_INTERNAL;
+
 purc_variant_t
 pcvar_variant_from_rev_update_edge(struct pcvar_rev_update_edge *edge);
 
@@ -161,9 +205,9 @@ pcvar_set_build_edge_to_parent(purc_variant_t set,
 struct obj_iterator {
     purc_variant_t                obj;
 
-    struct obj_node              *curr;
-    struct obj_node              *next;
-    struct obj_node              *prev;
+    // NULL if the iteration is over.
+    struct obj_kv                *curr;
+    size_t                        idx;
 };
 
 struct obj_iterator
@@ -175,12 +219,28 @@ pcvar_obj_it_next(struct obj_iterator *it);
 void
 pcvar_obj_it_prev(struct obj_iterator *it);
 
+// the size of the buffer on stack for pcvar_obj_sorted_kvs()
+#define PCVAR_OBJ_NR_KVS_ON_STACK   16
+
+/* Gets the members of an object in the order of keys, for the canonical
+   forms such as stringifying and comparing. Returns `buf` if it has enough
+   room, a new buffer which should be freed by the caller, or NULL if
+   failed to allocate the buffer. */
+struct obj_kv **
+pcvar_obj_sorted_kvs(purc_variant_t obj, struct obj_kv **buf,
+        size_t sz_buf) WTF_INTERNAL;
+
+/* Gets the node of a member which identifies the member in the reverse
+   update chains; the node will be allocated if it is not there. */
+struct obj_node *
+pcvar_obj_kv_node(purc_variant_t obj, struct obj_kv *kv) WTF_INTERNAL;
+
 struct arr_iterator {
     purc_variant_t                arr;
 
-    struct arr_node              *curr;
-    struct arr_node              *next;
-    struct arr_node              *prev;
+    // PURC_VARIANT_INVALID if the iteration is over.
+    purc_variant_t                curr;
+    size_t                        idx;
 };
 
 struct arr_iterator
@@ -194,7 +254,7 @@ pcvar_arr_it_prev(struct arr_iterator *it);
 
 enum set_it_type {
     SET_IT_ARRAY,
-    SET_IT_RBTREE,
+    SET_IT_ORDER,
 };
 
 struct set_iterator {
@@ -267,15 +327,34 @@ pcvar_make_set(variant_set_t data);
 int
 pcvar_set_add(purc_variant_t set, purc_variant_t val);
 
+enum pcvar_set_join_op {
+    PCVAR_SET_JOIN_UNITE,
+    PCVAR_SET_JOIN_INTERSECT,
+    PCVAR_SET_JOIN_SUBTRACT,
+    PCVAR_SET_JOIN_XOR,
+};
+
+// applies the set algebra with the members of `src` (a set or an array)
+// in bulk, and fires one event for each kind of change.
+int
+pcvar_set_join(purc_variant_t set, purc_variant_t src,
+        enum pcvar_set_join_op op);
+
 int
 pcvar_readjust_set(purc_variant_t set, struct set_node *node);
 
+// whether the member of a keyed set has the same values of the unique keys
+// after changed to `_new`, which can not break the uniqueness then.
+bool
+pcvar_set_keys_unchanged(purc_variant_t set, purc_variant_t _old,
+        purc_variant_t _new);
+
 // compare both variant-type and variant-value
 // recursive-implementation, thus caller's responsible for enough stack space
 // except stack space, no extra memory is required
 // when `caseless` is set, use strcasecmp rather than strcmp internally
 // when `unify_number` is set, convert both number-variants into long doubles
-// before doing actuall comparison
+// before doing actuall comparison, and compare them exactly
 int
 pcvar_compare_ex(purc_variant_t l, purc_variant_t r,
         bool caseless, bool unify_number);
@@ -26,17 +26,19 @@
 #include "config.h"
 #include "private/variant.h"
 #include "private/errors.h"
+#include "private/instance.h"
 #include "purc-errors.h"
 #include "variant-internals.h"
 
 
 #include <limits.h>
+#include <stdatomic.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define OBJ_EXTRA_SIZE(data) (sizeof(*data) + \
-        (data->size) * sizeof(struct obj_node))
+#define OBJ_MIN_CAPACITY        4
+#define OBJ_MIN_INDEX_SIZE      (PCVAR_OBJ_MIN_INDEXED * 2)
 
 static inline bool
 grow(purc_variant_t obj, purc_variant_t key, purc_variant_t val,
@@ -127,6 +129,45 @@ pcvar_obj_get_data(purc_variant_t obj)
     return data;
 }
 
+static size_t
+obj_extra_size(variant_obj_t data)
+{
+    // the shared kvs and index are counted by count_shared_kvs().
+    if (data->cow)
+        return sizeof(*data);
+
+    return sizeof(*data) + data->sz_kvs * sizeof(struct obj_kv) +
+        data->sz_index * sizeof(uint32_t) +
+        data->nr_nodes * sizeof(struct obj_node);
+}
+
+/* The kvs and the index shared by the clones are counted once in the
+   statistics, from the time they are shared until an object owns them
+   again. */
+static void
+count_shared_kvs(variant_obj_t data, bool shared)
+{
+    struct purc_variant_stat *stat = &pcinst_current()->variant_heap->stat;
+    size_t size = data->sz_kvs * sizeof(struct obj_kv) +
+        data->sz_index * sizeof(uint32_t);
+
+    if (shared) {
+        stat->sz_mem[PVT(_OBJECT)] += size;
+        stat->sz_total_mem += size;
+    }
+    else {
+        stat->sz_mem[PVT(_OBJECT)] -= size;
+        stat->sz_total_mem -= size;
+    }
+}
+
+static inline void
+refresh_extra(purc_variant_t obj)
+{
+    variant_obj_t data = pcvar_obj_get_data(obj);
+    pcvariant_stat_set_extra_size(obj, obj_extra_size(data));
+}
+
 static purc_variant_t v_object_new_with_capacity(void)
 {
     purc_variant_t var = pcvariant_get(PVT(_OBJECT));
@@ -147,89 +188,445 @@ static purc_variant_t v_object_new_with_capacity(void)
         return PURC_VARIANT_INVALID;
     }
 
-    data->kvs = RB_ROOT;
-
     var->sz_ptr[1]     = (uintptr_t)data;
     var->refc          = 1;
 
-    size_t extra = OBJ_EXTRA_SIZE(data);
-    pcvariant_stat_set_extra_size(var, extra);
+    refresh_extra(var);
 
     return var;
 }
 
-static void
-break_rev_update_chain(purc_variant_t obj, struct obj_node *node)
+/* Makes kvs and index owned by the object; they are copied if they are
+   still shared with the other clones. */
+static int
+obj_unshare(variant_obj_t data)
 {
-    struct pcvar_rev_update_edge edge = {
-        .parent        = obj,
-        .obj_me        = node,
-    };
+    if (data->cow == NULL)
+        return 0;
+
+    if (*data->cow > 1) {
+        struct obj_kv *kvs = NULL;
+        uint32_t *index = NULL;
+
+        if (data->sz_kvs) {
+            kvs = (struct obj_kv *)malloc(data->sz_kvs * sizeof(*kvs));
+            if (!kvs)
+                goto failed;
+            memcpy(kvs, data->kvs, data->nr_kvs * sizeof(*kvs));
+        }
+
+        if (data->index) {
+            index = (uint32_t *)malloc(data->sz_index * sizeof(*index));
+            if (!index) {
+                free(kvs);
+                goto failed;
+            }
+            memcpy(index, data->index, data->sz_index * sizeof(*index));
+        }
+
+        for (size_t i = 0; i < data->nr_kvs; i++) {
+            if (kvs[i].key == PURC_VARIANT_INVALID)
+                continue;
+            purc_variant_ref(kvs[i].key);
+            purc_variant_ref(kvs[i].val);
+        }
+
+        (*data->cow)--;
+        data->kvs = kvs;
+        data->index = index;
+    }
+    else {
+        // the other clones have gone.
+        count_shared_kvs(data, false);
+        free(data->cow);
+    }
+
+    data->cow = NULL;
+    return 0;
 
-    pcvar_break_edge_to_parent(node->val, &edge);
-    pcvar_break_rue_downward(node->val);
+failed:
+    pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+    return -1;
 }
 
-static void
-obj_node_release(purc_variant_t obj, struct obj_node *node)
+/* the stamps are unique in the process, so that a stamp given by one
+   instance never matches the cache of another instance */
+static atomic_uint_least64_t last_obj_stamp;
+
+uint64_t
+pcvar_obj_stamp(purc_variant_t obj)
 {
-    if (!node)
-        return;
+    if (obj->flags & PCVARIANT_FLAG_FROZEN)
+        return 0;
 
-    break_rev_update_chain(obj, node);
+    variant_obj_t data = pcvar_obj_get_data(obj);
+    if (data->stamp == 0) {
+        data->stamp = atomic_fetch_add_explicit(&last_obj_stamp, 1,
+                memory_order_relaxed) + 1;
+    }
 
+    return data->stamp;
+}
+
+int
+pcvar_obj_unshare(purc_variant_t obj)
+{
     variant_obj_t data = pcvar_obj_get_data(obj);
-    PC_ASSERT(data);
+    if (!data || !data->cow)
+        return 0;
+
+    int r = obj_unshare(data);
+    refresh_extra(obj);
+    return r;
+}
+
+static inline bool
+kv_match(struct obj_kv *kv, uint32_t hash, const char *key)
+{
+    return kv->key != PURC_VARIANT_INVALID && kv->hash == hash &&
+        strcmp(purc_variant_get_string_const(kv->key), key) == 0;
+}
 
-    struct rb_root *root = &data->kvs;
-    if (&node->node == root->rb_node || node->node.rb_parent) {
-        --data->size;
-        pcutils_rbtree_erase(&node->node, root);
-        node->node.rb_parent = NULL;
+/* Returns the index of the slot holding the key, or -1 if not found. */
+static ssize_t
+obj_find(variant_obj_t data, uint32_t hash, const char *key)
+{
+    if (data->index == NULL) {
+        for (size_t i = 0; i < data->nr_kvs; i++) {
+            if (kv_match(data->kvs + i, hash, key))
+                return i;
+        }
+
+        return -1;
+    }
+
+    size_t mask = data->sz_index - 1;
+    size_t pos = hash & mask;
+    uint32_t slot;
+    while ((slot = data->index[pos])) {
+        if (kv_match(data->kvs + slot - 1, hash, key))
+            return slot - 1;
+        pos = (pos + 1) & mask;
     }
 
-    PURC_VARIANT_SAFE_CLEAR(node->key);
-    PURC_VARIANT_SAFE_CLEAR(node->val);
+    return -1;
+}
+
+static uint32_t
+atom_hash(purc_atom_t atom)
+{
+    struct pcvariant_heap *heap = pcinst_current()->variant_heap;
+    struct pcvariant_atom_hash *ah;
+
+    ah = heap->atom_hashes + (atom % PCVARIANT_NR_ATOM_HASHES);
+    if (ah->atom != atom) {
+        const char *key = purc_atom_to_string(atom);
+        if (key == NULL)
+            return 0;
+
+        ah->atom = atom;
+        ah->hash = pcvariant_cstr_hash(key);
+    }
+
+    return ah->hash;
+}
+
+/* Returns the index of the slot holding the key identified by the atom,
+   or -1 if not found. The atom is recorded in the slot found by comparing
+   the strings, so the later lookups only compare the integers; this is not
+   done for a frozen object, which may be read by other instances. */
+static ssize_t
+obj_find_by_atom(variant_obj_t data, purc_atom_t atom, bool record)
+{
+    const char *key;
+    ssize_t idx;
+
+    if (data->index == NULL) {
+        for (size_t i = 0; i < data->nr_kvs; i++) {
+            struct obj_kv *kv = data->kvs + i;
+            if (kv->atom == atom && kv->key != PURC_VARIANT_INVALID)
+                return i;
+        }
+
+        key = purc_atom_to_string(atom);
+        if (key == NULL)
+            return -1;
+        idx = obj_find(data, atom_hash(atom), key);
+    }
+    else {
+        // the hash comes from the cache, and the key string is compared
+        // only with the keys having the same hash.
+        uint32_t hash = atom_hash(atom);
+        if (hash == 0)
+            return -1;
+
+        size_t mask = data->sz_index - 1;
+        size_t pos = hash & mask;
+        uint32_t slot;
+        key = NULL;
+        idx = -1;
+        while ((slot = data->index[pos])) {
+            struct obj_kv *kv = data->kvs + slot - 1;
+            if (kv->hash == hash && kv->key != PURC_VARIANT_INVALID) {
+                if (kv->atom == atom) {
+                    idx = slot - 1;
+                    break;
+                }
+
+                if (key == NULL)
+                    key = purc_atom_to_string(atom);
+                if (strcmp(purc_variant_get_string_const(kv->key),
+                            key) == 0) {
+                    idx = slot - 1;
+                    break;
+                }
+            }
+            pos = (pos + 1) & mask;
+        }
+    }
+
+    if (idx >= 0 && record)
+        data->kvs[idx].atom = atom;
+    return idx;
 }
 
 static void
-obj_node_destroy(purc_variant_t obj, struct obj_node *node)
+index_add(variant_obj_t data, size_t idx)
 {
-    if (!node)
-        return;
+    size_t mask = data->sz_index - 1;
+    size_t pos = data->kvs[idx].hash & mask;
+    while (data->index[pos])
+        pos = (pos + 1) & mask;
 
-    obj_node_release(obj, node);
+    data->index[pos] = (uint32_t)(idx + 1);
+}
 
-    free(node);
+static void
+index_del(variant_obj_t data, size_t idx)
+{
+    size_t mask = data->sz_index - 1;
+    size_t pos = data->kvs[idx].hash & mask;
+    while (data->index[pos] != idx + 1) {
+        PC_ASSERT(data->index[pos]);
+        pos = (pos + 1) & mask;
+    }
+
+    /* Shift the following entries back into the hole unless the hole
+       is before their home positions, so no tombstone is needed. */
+    size_t hole = pos;
+    for (;;) {
+        pos = (pos + 1) & mask;
+        uint32_t slot = data->index[pos];
+        if (slot == 0)
+            break;
+
+        size_t home = data->kvs[slot - 1].hash & mask;
+        if (((pos - home) & mask) >= ((pos - hole) & mask)) {
+            data->index[hole] = slot;
+            hole = pos;
+        }
+    }
+
+    data->index[hole] = 0;
 }
 
-static struct obj_node*
-obj_node_create(purc_variant_t k, purc_variant_t v)
+static void
+index_fill(variant_obj_t data)
 {
-    if (k->type != PVT(_STRING)) {
-        pcinst_set_error(PURC_ERROR_INVALID_VALUE);
-        return NULL;
+    memset(data->index, 0, data->sz_index * sizeof(uint32_t));
+    for (size_t i = 0; i < data->nr_kvs; i++) {
+        if (data->kvs[i].key != PURC_VARIANT_INVALID)
+            index_add(data, i);
     }
+}
+
+/* Squeezes the holes out of the slots. */
+static void
+obj_compact(variant_obj_t data)
+{
+    size_t j = 0;
+    for (size_t i = 0; i < data->nr_kvs; i++) {
+        if (data->kvs[i].key == PURC_VARIANT_INVALID)
+            continue;
+
+        if (i != j)
+            data->kvs[j] = data->kvs[i];
+        if (data->kvs[j].node)
+            data->kvs[j].node->idx = j;
+        j++;
+    }
+
+    PC_ASSERT(j == data->size);
+    data->nr_kvs = j;
+
+    if (data->index) {
+        if (j < PCVAR_OBJ_MIN_INDEXED) {
+            free(data->index);
+            data->index = NULL;
+            data->sz_index = 0;
+        }
+        else {
+            index_fill(data);
+        }
+    }
+}
+
+/* Appends a new member and holds the references of the key and the value.
+   Returns the index of the slot, or -1 if failed to allocate memory. */
+static ssize_t
+obj_append(variant_obj_t data, purc_variant_t key, purc_variant_t val,
+        uint32_t hash)
+{
+    if (data->nr_kvs == data->sz_kvs) {
+        if (data->nr_kvs - data->size >= data->nr_kvs / 2 &&
+                data->nr_kvs > data->size) {
+            obj_compact(data);
+        }
+        else {
+            size_t sz = data->sz_kvs ? data->sz_kvs * 2 : OBJ_MIN_CAPACITY;
+            struct obj_kv *kvs;
+            kvs = (struct obj_kv *)realloc(data->kvs, sz * sizeof(*kvs));
+            if (!kvs)
+                goto failed;
+            data->kvs = kvs;
+            data->sz_kvs = sz;
+        }
+    }
+
+    /* keep the load factor of the index not greater than 1/2. */
+    uint32_t *index = NULL;
+    size_t sz_index = 0;
+    if (data->index ? (data->size + 1) * 2 > data->sz_index :
+            data->nr_kvs + 1 >= PCVAR_OBJ_MIN_INDEXED) {
+        sz_index = data->sz_index ? data->sz_index * 2 : OBJ_MIN_INDEX_SIZE;
+        while (sz_index < (data->size + 1) * 2)
+            sz_index *= 2;
+
+        index = (uint32_t *)calloc(sz_index, sizeof(uint32_t));
+        if (!index)
+            goto failed;
+    }
+
+    size_t idx = data->nr_kvs;
+    struct obj_kv *kv = data->kvs + idx;
+    kv->key = purc_variant_ref(key);
+    kv->val = purc_variant_ref(val);
+    kv->node = NULL;
+    kv->hash = hash;
+    kv->atom = 0;
+    data->nr_kvs++;
+    data->size++;
+    data->stamp = 0;
+
+    if (index) {
+        free(data->index);
+        data->index = index;
+        data->sz_index = sz_index;
+        index_fill(data);
+    }
+    else if (data->index) {
+        index_add(data, idx);
+    }
+
+    return idx;
+
+failed:
+    pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+    return -1;
+}
+
+/* Removes the member in the slot; the caller owns the references of
+   the key and the value. */
+static void
+obj_remove_at(variant_obj_t data, size_t idx)
+{
+    struct obj_kv *kv = data->kvs + idx;
+
+    if (data->index)
+        index_del(data, idx);
+
+    if (kv->node) {
+        free(kv->node);
+        data->nr_nodes--;
+    }
+
+    kv->key = PURC_VARIANT_INVALID;
+    kv->val = PURC_VARIANT_INVALID;
+    kv->node = NULL;
+    kv->atom = 0;
+    data->size--;
+    data->stamp = 0;
+
+    /* the trailing holes can be dropped at once. */
+    while (data->nr_kvs > 0 &&
+            data->kvs[data->nr_kvs - 1].key == PURC_VARIANT_INVALID)
+        data->nr_kvs--;
+}
 
-    struct obj_node *node;
-    node = (struct obj_node*)calloc(1, sizeof(*node));
-    if (!node) {
+static struct obj_node *
+obj_materialize_node(variant_obj_t data, size_t idx)
+{
+    struct obj_kv *kv = data->kvs + idx;
+    if (kv->node)
+        return kv->node;
+
+    kv->node = (struct obj_node *)malloc(sizeof(*kv->node));
+    if (!kv->node) {
         pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
         return NULL;
     }
 
-    node->key = purc_variant_ref(k);
-    node->val = purc_variant_ref(v);
+    kv->node->idx = idx;
+    data->nr_nodes++;
+    return kv->node;
+}
+
+struct obj_node *
+pcvar_obj_kv_node(purc_variant_t obj, struct obj_kv *kv)
+{
+    variant_obj_t data = pcvar_obj_get_data(obj);
+    PC_ASSERT(kv >= data->kvs && kv < data->kvs + data->nr_kvs);
+
+    if (kv->node)
+        return kv->node;
+
+    // the node lives in the slot, so the slots have to be owned.
+    size_t idx = kv - data->kvs;
+    if (pcvar_obj_unshare(obj))
+        return NULL;
 
+    struct obj_node *node = obj_materialize_node(data, idx);
+    if (node)
+        refresh_extra(obj);
     return node;
 }
 
+static void
+break_rev_update_chain(purc_variant_t obj, struct obj_kv *kv)
+{
+    // no edge was built if the node has not been materialized.
+    if (kv->node == NULL)
+        return;
+
+    struct pcvar_rev_update_edge edge = {
+        .parent        = obj,
+        .obj_me        = kv->node,
+    };
+
+    pcvar_break_edge_to_parent(kv->val, &edge);
+    pcvar_break_rue_downward(kv->val);
+}
+
 static int
-build_rev_update_chain(purc_variant_t obj, struct obj_node *node)
+build_rev_update_chain(purc_variant_t obj, struct obj_kv *kv)
 {
     if (!pcvar_container_belongs_to_set(obj))
         return 0;
 
+    struct obj_node *node = pcvar_obj_kv_node(obj, kv);
+    if (!node)
+        return -1;
+
     int r;
 
     struct pcvar_rev_update_edge edge = {
@@ -237,16 +634,16 @@ build_rev_update_chain(purc_variant_t obj, struct obj_node *node)
         .obj_me        = node,
     };
 
-    r = pcvar_build_edge_to_parent(node->val, &edge);
+    r = pcvar_build_edge_to_parent(kv->val, &edge);
     if (r == 0) {
-        r = pcvar_build_rue_downward(node->val);
+        r = pcvar_build_rue_downward(kv->val);
     }
 
     return r ? -1 : 0;
 }
 
 static int
-check_shrink(purc_variant_t obj, struct obj_node *node)
+check_shrink(purc_variant_t obj, struct obj_kv *kv)
 {
     if (!pcvar_container_belongs_to_set(obj))
         return 0;
@@ -261,7 +658,7 @@ check_shrink(purc_variant_t obj, struct obj_node *node)
         bool found = false;
         purc_variant_t kk, vv;
         foreach_key_value_in_variant_object(obj, kk, vv) {
-            if (kk == node->key) {
+            if (kk == kv->key) {
                 PC_ASSERT(!found);
                 found = true;
                 continue;
@@ -294,30 +691,12 @@ static int
 v_object_remove(purc_variant_t obj, const char *key, bool silently,
         bool check)
 {
+    PCVARIANT_CHECK_NOT_FROZEN_RET(obj, -1);
+
     variant_obj_t data = pcvar_obj_get_data(obj);
-    struct rb_root *root = &data->kvs;
-    struct rb_node **pnode = &root->rb_node;
-    struct rb_node *parent = NULL;
-    struct rb_node *entry = NULL;
-    while (*pnode) {
-        struct obj_node *node;
-        node = container_of(*pnode, struct obj_node, node);
-        const char *sk = purc_variant_get_string_const(node->key);
-        int ret = strcmp(key, sk);
-
-        parent = *pnode;
-
-        if (ret < 0)
-            pnode = &parent->rb_left;
-        else if (ret > 0)
-            pnode = &parent->rb_right;
-        else{
-            entry = *pnode;
-            break;
-        }
-    }
+    ssize_t idx = obj_find(data, pcvariant_cstr_hash(key), key);
 
-    if (!entry) {
+    if (idx < 0) {
         if (silently)
             return 0;
 
@@ -325,26 +704,27 @@ v_object_remove(purc_variant_t obj, const char *key, bool silently,
         return -1;
     }
 
-    struct obj_node *node;
-    node = container_of(entry, struct obj_node, node);
-    purc_variant_t k = node->key;
-    purc_variant_t v = node->val;
+    if (pcvar_obj_unshare(obj))
+        return -1;
+
+    struct obj_kv *kv = data->kvs + idx;
+    purc_variant_t k = kv->key;
+    purc_variant_t v = kv->val;
 
     do {
         if (check) {
             if (!shrink(obj, k, v, check))
                 break;
 
-            if (check_shrink(obj, node))
+            if (check_shrink(obj, kv))
                 break;
 
-            break_rev_update_chain(obj, node);
+            // the slots may have been reallocated by the checkers.
+            kv = data->kvs + idx;
         }
 
-        --data->size;
-        PC_ASSERT(entry == root->rb_node || entry->rb_parent);
-        pcutils_rbtree_erase(entry, root);
-        entry->rb_parent = NULL;
+        break_rev_update_chain(obj, kv);
+        obj_remove_at(data, idx);
 
         if (check) {
             pcvar_adjust_set_by_descendant(obj);
@@ -352,7 +732,10 @@ v_object_remove(purc_variant_t obj, const char *key, bool silently,
             shrunk(obj, k, v, check);
         }
 
-        obj_node_destroy(obj, node);
+        purc_variant_unref(k);
+        purc_variant_unref(v);
+
+        refresh_extra(obj);
 
         return 0;
     } while (0);
@@ -401,7 +784,7 @@ check_grow(purc_variant_t obj, purc_variant_t k, purc_variant_t v)
 }
 
 static int
-check_change(purc_variant_t obj, struct obj_node *node,
+check_change(purc_variant_t obj, struct obj_kv *kv,
         purc_variant_t k, purc_variant_t v)
 {
     if (!pcvar_container_belongs_to_set(obj))
@@ -417,7 +800,7 @@ check_change(purc_variant_t obj, struct obj_node *node,
         bool found = false;
         purc_variant_t kk, vv;
         foreach_key_value_in_variant_object(obj, kk, vv) {
-            if (node->key == kk) {
+            if (kv->key == kk) {
                 PC_ASSERT(!found);
                 found = true;
                 r = pcvar_obj_set(_new, k, v);
@@ -448,128 +831,88 @@ check_change(purc_variant_t obj, struct obj_node *node,
     return -1;
 }
 
+/* Sets the value of the member in the slot idx, or appends a new member
+   if idx is negative. The atom (if not 0) is recorded in the new slot. */
 static int
-v_object_set(purc_variant_t obj, purc_variant_t key, purc_variant_t val,
-        bool check)
+v_object_set_at(purc_variant_t obj, ssize_t idx, purc_variant_t key,
+        uint32_t hash, purc_atom_t atom, purc_variant_t val, bool check)
 {
-    if (!key || !val) {
-        pcinst_set_error(PURC_ERROR_INVALID_VALUE);
-        return -1;
-    }
+    PCVARIANT_CHECK_NOT_FROZEN_RET(obj, -1);
 
-    const char *sk = purc_variant_get_string_const(key);
+    variant_obj_t data = pcvar_obj_get_data(obj);
 
-    if (purc_variant_is_undefined(val)) {
-        bool silently = true;
-        v_object_remove(obj, sk, silently, check);
+    if (idx >= 0 && data->kvs[idx].val == val) {
+        // NOTE: keep refc intact
         return 0;
     }
 
-    if (key->type != PVT(_STRING)) {
-        pcinst_set_error(PURC_ERROR_INVALID_VALUE);
+    if (pcvar_obj_unshare(obj))
         return -1;
-    }
 
-    variant_obj_t data = pcvar_obj_get_data(obj);
-    PC_ASSERT(data);
+    if (idx < 0) { // new the entry
+        if (check) {
+            if (!grow(obj, key, val, check))
+                return -1;
 
-    struct rb_root *root = &data->kvs;
-    struct rb_node **pnode = &root->rb_node;
-    struct rb_node *parent = NULL;
-    struct rb_node *entry = NULL;
-    while (*pnode) {
-        struct obj_node *node;
-        node = container_of(*pnode, struct obj_node, node);
-        const char *sko = purc_variant_get_string_const(node->key);
-        int ret = strcmp(sk, sko);
-
-        parent = *pnode;
-
-        if (ret < 0)
-            pnode = &parent->rb_left;
-        else if (ret > 0)
-            pnode = &parent->rb_right;
-        else{
-            entry = *pnode;
-            break;
+            if (check_grow(obj, key, val))
+                return -1;
         }
-    }
 
-    if (!entry) { //new the entry
-        struct obj_node *node = obj_node_create(key, val);
-        if (!node)
+        idx = obj_append(data, key, val, hash);
+        if (idx < 0)
             return -1;
+        data->kvs[idx].atom = atom;
 
-        do {
-            if (check) {
-                if (!grow(obj, key, val, check))
-                    break;
-
-                if (check_grow(obj, key, val))
-                    break;
-            }
-
-            entry = &node->node;
-
-            pcutils_rbtree_link_node(entry, parent, pnode);
-            pcutils_rbtree_insert_color(entry, root);
-
-            ++data->size;
-
-            if (check) {
-                if (build_rev_update_chain(obj, node))
-                    break;
-
-                pcvar_adjust_set_by_descendant(obj);
-
-                grown(obj, key, val, check);
+        if (check) {
+            if (build_rev_update_chain(obj, data->kvs + idx)) {
+                break_rev_update_chain(obj, data->kvs + idx);
+                obj_remove_at(data, idx);
+                purc_variant_unref(key);
+                purc_variant_unref(val);
+                refresh_extra(obj);
+                return -1;
             }
 
-            size_t extra = OBJ_EXTRA_SIZE(data);
-            pcvariant_stat_set_extra_size(obj, extra);
-
-            return 0;
-        } while (0);
+            pcvar_adjust_set_by_descendant(obj);
 
-        obj_node_destroy(obj, node);
+            grown(obj, key, val, check);
+        }
 
-        return -1;
-    }
+        refresh_extra(obj);
 
-    struct obj_node *node;
-    node = container_of(entry, struct obj_node, node);
-    if (node->val == val) {
-        // NOTE: keep refc intact
         return 0;
     }
 
+    struct obj_kv *kv = data->kvs + idx;
     do {
-        purc_variant_t ko = node->key;
-        purc_variant_t vo = node->val;
+        purc_variant_t ko = kv->key;
+        purc_variant_t vo = kv->val;
 
         if (check) {
             if (!change(obj, ko, vo, key, val, check))
                 break;
 
-            if (check_change(obj, node, key, val))
+            if (check_change(obj, kv, key, val))
                 break;
 
-            node->key = key;
-            node->val = val;
-            if (build_rev_update_chain(obj, node)) {
-                break_rev_update_chain(obj, node);
-                node->key = ko;
-                node->val = vo;
+            kv = data->kvs + idx;
+            kv->key = key;
+            kv->val = val;
+            if (build_rev_update_chain(obj, kv)) {
+                break_rev_update_chain(obj, kv);
+                kv->key = ko;
+                kv->val = vo;
                 break;
             }
 
-            node->key = ko;
-            node->val = vo;
-            break_rev_update_chain(obj, node);
+            kv->key = ko;
+            kv->val = vo;
+            break_rev_update_chain(obj, kv);
         }
 
-        node->key = purc_variant_ref(key);
-        node->val = purc_variant_ref(val);
+        kv->key = purc_variant_ref(key);
+        kv->val = purc_variant_ref(val);
+        data->stamp = 0;
 
         if (check) {
             pcvar_adjust_set_by_descendant(obj);
@@ -580,8 +923,7 @@ v_object_set(purc_variant_t obj, purc_variant_t key, purc_variant_t val,
         purc_variant_unref(ko);
         purc_variant_unref(vo);
 
-        size_t extra = OBJ_EXTRA_SIZE(data);
-        pcvariant_stat_set_extra_size(obj, extra);
+        refresh_extra(obj);
 
         return 0;
     } while (0);
@@ -589,6 +931,39 @@ v_object_set(purc_variant_t obj, purc_variant_t key, purc_variant_t val,
     return -1;
 }
 
+static int
+v_object_set(purc_variant_t obj, purc_variant_t key, purc_variant_t val,
+        bool check)
+{
+    if (!key || !val) {
+        pcinst_set_error(PURC_ERROR_INVALID_VALUE);
+        return -1;
+    }
+
+    PCVARIANT_CHECK_NOT_FROZEN_RET(obj, -1);
+
+    const char *sk = purc_variant_get_string_const(key);
+
+    if (purc_variant_is_undefined(val)) {
+        bool silently = true;
+        v_object_remove(obj, sk, silently, check);
+        return 0;
+    }
+
+    if (key->type != PVT(_STRING)) {
+        pcinst_set_error(PURC_ERROR_INVALID_VALUE);
+        return -1;
+    }
+
+    variant_obj_t data = pcvar_obj_get_data(obj);
+    PC_ASSERT(data);
+
+    uint32_t hash = pcvariant_string_hash(key);
+    ssize_t idx = obj_find(data, hash, sk);
+
+    return v_object_set_at(obj, idx, key, hash, 0, val, check);
+}
+
 purc_variant_t
 pcvar_make_obj(void)
 {
@@ -647,9 +1022,6 @@ pv_make_object_by_static_ckey_n (bool check, size_t nr_kv_pairs,
     if (!obj)
         return PURC_VARIANT_INVALID;
 
-    variant_obj_t data = pcvar_obj_get_data(obj);
-    PC_ASSERT(data);
-
     do {
         int r;
         if (nr_kv_pairs > 0) {
@@ -667,8 +1039,7 @@ pv_make_object_by_static_ckey_n (bool check, size_t nr_kv_pairs,
                 break;
         }
 
-        size_t extra = OBJ_EXTRA_SIZE(data);
-        pcvariant_stat_set_extra_size(obj, extra);
+        refresh_extra(obj);
 
         return obj;
     } while (0);
@@ -705,9 +1076,6 @@ pv_make_object_n(bool check, size_t nr_kv_pairs,
     if (!obj)
         return PURC_VARIANT_INVALID;
 
-    variant_obj_t data = pcvar_obj_get_data(obj);
-    PC_ASSERT(data);
-
     do {
         if (nr_kv_pairs > 0) {
             purc_variant_t v = value0;
@@ -721,9 +1089,7 @@ pv_make_object_n(bool check, size_t nr_kv_pairs,
                 break;
         }
 
-        variant_obj_t data = pcvar_obj_get_data(obj);
-        size_t extra = OBJ_EXTRA_SIZE(data);
-        pcvariant_stat_set_extra_size(obj, extra);
+        refresh_extra(obj);
 
         return obj;
     } while (0);
@@ -752,14 +1118,32 @@ void pcvariant_object_release (purc_variant_t value)
 {
     variant_obj_t data = pcvar_obj_get_data(value);
 
-    struct rb_root *root = &data->kvs;
-
-    struct rb_node *p, *n;
-    pcutils_rbtree_for_each_safe(pcutils_rbtree_first(root), p, n) {
-        struct obj_node *node;
-        node = container_of(p, struct obj_node, node);
+    if (data->cow) {
+        if (--*data->cow > 0) {
+            // the members are still held by the other clones.
+            data->kvs = NULL;
+            data->nr_kvs = 0;
+            data->index = NULL;
+        }
+        else {
+            count_shared_kvs(data, false);
+            free(data->cow);
+        }
+        data->cow = NULL;
+    }
 
-        obj_node_destroy(value, node);
+    /* Release the members in the reverse order of insertion, so a member
+       can depend on the members added before it, e.g., a native entity
+       holding a listener on a sibling member. */
+    for (size_t i = data->nr_kvs; i > 0; i--) {
+        struct obj_kv *kv = data->kvs + i - 1;
+        if (kv->key == PURC_VARIANT_INVALID)
+            continue;
+
+        break_rev_update_chain(value, kv);
+        free(kv->node);
+        purc_variant_unref(kv->key);
+        purc_variant_unref(kv->val);
     }
 
     if (data->rev_update_chain) {
@@ -767,6 +1151,8 @@ void pcvariant_object_release (purc_variant_t value)
         data->rev_update_chain = NULL;
     }
 
+    free(data->index);
+    free(data->kvs);
     free(data);
 
     value->sz_ptr[1] = (uintptr_t)NULL; // say no to double free
@@ -804,39 +1190,14 @@ purc_variant_object_get_by_ckey(purc_variant_t obj, const char* key)
         PURC_VARIANT_INVALID);
 
     variant_obj_t data = pcvar_obj_get_data(obj);
-    struct rb_root *root = &data->kvs;
-
-    struct rb_node **pnode = &root->rb_node;
-    struct rb_node *parent = NULL;
-    struct rb_node *entry = NULL;
-    while (*pnode) {
-        struct obj_node *node;
-        node = container_of(*pnode, struct obj_node, node);
-        const char *sk = purc_variant_get_string_const(node->key);
-
-        int ret = strcmp(key, sk);
-
-        parent = *pnode;
-
-        if (ret < 0)
-            pnode = &parent->rb_left;
-        else if (ret > 0)
-            pnode = &parent->rb_right;
-        else{
-            entry = *pnode;
-            break;
-        }
-    }
-
-    if (!entry) {
+    ssize_t idx = obj_find(data, pcvariant_cstr_hash(key), key);
+    if (idx < 0) {
         pcinst_set_error(PCVARIANT_ERROR_NOT_FOUND);
 
         return PURC_VARIANT_INVALID;
     }
 
-    struct obj_node *node;
-    node = container_of(entry, struct obj_node, node);
-    return node->val;
+    return data->kvs[idx].val;
 }
 
 bool purc_variant_object_set (purc_variant_t obj,
@@ -852,6 +1213,79 @@ bool purc_variant_object_set (purc_variant_t obj,
     return r ? false : true;
 }
 
+purc_variant_t
+purc_variant_object_get_by_atom(purc_variant_t obj, purc_atom_t key)
+{
+    PCVARIANT_CHECK_FAIL_RET((obj && obj->type==PVT(_OBJECT) &&
+        obj->sz_ptr[1] && key),
+        PURC_VARIANT_INVALID);
+
+    variant_obj_t data = pcvar_obj_get_data(obj);
+    ssize_t idx = obj_find_by_atom(data, key,
+            !(obj->flags & PCVARIANT_FLAG_FROZEN));
+    if (idx < 0) {
+        pcinst_set_error(PCVARIANT_ERROR_NOT_FOUND);
+
+        return PURC_VARIANT_INVALID;
+    }
+
+    return data->kvs[idx].val;
+}
+
+purc_variant_t
+pcvariant_object_get_by_atom_quietly(purc_variant_t obj, purc_atom_t key)
+{
+    if (obj == PURC_VARIANT_INVALID || obj->type != PVT(_OBJECT) ||
+            !obj->sz_ptr[1] || !key)
+        return PURC_VARIANT_INVALID;
+
+    variant_obj_t data = pcvar_obj_get_data(obj);
+    ssize_t idx = obj_find_by_atom(data, key,
+            !(obj->flags & PCVARIANT_FLAG_FROZEN));
+    return (idx < 0) ? PURC_VARIANT_INVALID : data->kvs[idx].val;
+}
+
+bool
+purc_variant_object_set_by_atom(purc_variant_t obj, purc_atom_t key,
+        purc_variant_t value)
+{
+    PCVARIANT_CHECK_FAIL_RET(obj && obj->type==PVT(_OBJECT) &&
+        obj->sz_ptr[1] && key && value,
+        false);
+    PCVARIANT_CHECK_NOT_FROZEN_RET(obj, false);
+
+    const char *sk = purc_atom_to_string(key);
+    if (sk == NULL) {
+        pcinst_set_error(PURC_ERROR_INVALID_VALUE);
+        return false;
+    }
+
+    bool check = true;
+    if (purc_variant_is_undefined(value)) {
+        bool silently = true;
+        v_object_remove(obj, sk, silently, check);
+        return true;
+    }
+
+    variant_obj_t data = pcvar_obj_get_data(obj);
+    ssize_t idx = obj_find_by_atom(data, key, true);
+    if (idx >= 0) {
+        struct obj_kv *kv = data->kvs + idx;
+        return v_object_set_at(obj, idx, kv->key, kv->hash, key, value,
+                check) ? false : true;
+    }
+
+    purc_variant_t k = purc_variant_make_string(sk, false);
+    if (k == PURC_VARIANT_INVALID)
+        return false;
+
+    int r = v_object_set_at(obj, -1, k, pcvariant_string_hash(k), key,
+            value, check);
+    purc_variant_unref(k);
+
+    return r ? false : true;
+}
+
 bool
 purc_variant_object_remove_by_static_ckey(purc_variant_t obj, const char* key,
         bool silently)
@@ -941,8 +1375,7 @@ purc_variant_object_release_iterator (struct purc_variant_object_iterator* it)
 
     it->it.obj  = PURC_VARIANT_INVALID;
     it->it.curr = NULL;
-    it->it.next = NULL;
-    it->it.prev = NULL;
+    it->it.idx  = 0;
 
     free(it);
 }
@@ -973,15 +1406,31 @@ purc_variant_object_iterator_prev (struct purc_variant_object_iterator* it)
     return false;
 }
 
+static struct obj_kv *
+it_kv(struct obj_iterator *it)
+{
+    if (it->curr == NULL)
+        return NULL;
+
+    // the slots may have been reallocated since the iterator moved.
+    variant_obj_t data = pcvar_obj_get_data(it->obj);
+    if (it->idx >= data->nr_kvs ||
+            data->kvs[it->idx].key == PURC_VARIANT_INVALID)
+        return NULL;
+
+    return data->kvs + it->idx;
+}
+
 purc_variant_t
 purc_variant_object_iterator_get_key (struct purc_variant_object_iterator* it)
 {
     PC_ASSERT(it);
 
-    if (it->it.curr == NULL)
+    struct obj_kv *kv = it_kv(&it->it);
+    if (kv == NULL)
         return PURC_VARIANT_INVALID;
 
-    return it->it.curr->key;
+    return kv->key;
 }
 
 purc_variant_t
@@ -989,15 +1438,81 @@ purc_variant_object_iterator_get_value(struct purc_variant_object_iterator* it)
 {
     PC_ASSERT(it);
 
-    if (it->it.curr == NULL)
+    struct obj_kv *kv = it_kv(&it->it);
+    if (kv == NULL)
         return PURC_VARIANT_INVALID;
 
-    return it->it.curr->val;
+    return kv->val;
+}
+
+#if USE(COW_CONTAINER_CLONES)
+static bool
+obj_has_container(variant_obj_t data)
+{
+    for (size_t i = 0; i < data->nr_kvs; i++) {
+        struct obj_kv *kv = data->kvs + i;
+        if (kv->key == PURC_VARIANT_INVALID)
+            continue;
+
+        enum purc_variant_type type = kv->val->type;
+        if (IS_CONTAINER(type) || type == PURC_VARIANT_TYPE_TUPLE)
+            return true;
+    }
+
+    return false;
 }
 
+/* Makes a clone sharing kvs and index with the object. */
+static purc_variant_t
+obj_clone_shared(purc_variant_t obj)
+{
+    variant_obj_t data = pcvar_obj_get_data(obj);
+    if (data->cow == NULL) {
+        data->cow = (size_t *)malloc(sizeof(*data->cow));
+        if (!data->cow) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return PURC_VARIANT_INVALID;
+        }
+
+        *data->cow = 1;
+        count_shared_kvs(data, true);
+        refresh_extra(obj);
+    }
+
+    purc_variant_t var = v_object_new_with_capacity();
+    if (var == PURC_VARIANT_INVALID)
+        return PURC_VARIANT_INVALID;
+
+    variant_obj_t clone = pcvar_obj_get_data(var);
+    clone->kvs = data->kvs;
+    clone->nr_kvs = data->nr_kvs;
+    clone->sz_kvs = data->sz_kvs;
+    clone->size = data->size;
+    clone->index = data->index;
+    clone->sz_index = data->sz_index;
+    clone->cow = data->cow;
+    (*data->cow)++;
+
+    refresh_extra(var);
+    return var;
+}
+#endif
+
 purc_variant_t
 pcvariant_object_clone(purc_variant_t obj, bool recursively)
 {
+#if USE(COW_CONTAINER_CLONES)
+    /* The members of the object in a set hold the reverse update edges
+       keyed by the nodes in the slots, and the containers among the members
+       have to be cloned when cloning recursively. The storage of a frozen
+       object is never shared, for it is read by the other instances. */
+    variant_obj_t data = pcvar_obj_get_data(obj);
+    if (data->size > 0 && data->nr_nodes == 0 &&
+            !(obj->flags & PCVARIANT_FLAG_FROZEN) &&
+            !(recursively && obj_has_container(data)))
+        return obj_clone_shared(obj);
+#endif
+
     purc_variant_t var;
     var = purc_variant_make_object(0,
             PURC_VARIANT_INVALID, PURC_VARIANT_INVALID);
@@ -1039,18 +1554,24 @@ pcvar_object_break_rue_downward(purc_variant_t obj)
     if (!data)
         return;
 
-    struct rb_root *root = &data->kvs;
-    struct rb_node *p = pcutils_rbtree_first(root);
-    for (; p; p = pcutils_rbtree_next(p)) {
-        struct obj_node *node;
-        node = container_of(p, struct obj_node, node);
-        struct pcvar_rev_update_edge edge = {
-            .parent         = obj,
-            .obj_me         = node,
-        };
-        pcvar_break_edge_to_parent(node->val, &edge);
-        pcvar_break_rue_downward(node->val);
+    if (data->nr_nodes == 0)
+        return;
+
+    for (size_t i = 0; i < data->nr_kvs; i++) {
+        struct obj_kv *kv = data->kvs + i;
+        if (kv->key == PURC_VARIANT_INVALID)
+            continue;
+
+        break_rev_update_chain(obj, kv);
+        if (kv->node) {
+            free(kv->node);
+            kv->node = NULL;
+            data->nr_nodes--;
+        }
     }
+
+    PC_ASSERT(data->nr_nodes == 0);
+    refresh_extra(obj);
 }
 
 void
@@ -1076,19 +1597,26 @@ pcvar_object_build_rue_downward(purc_variant_t obj)
     if (!data)
         return 0;
 
-    struct rb_root *root = &data->kvs;
-    struct rb_node *p = pcutils_rbtree_first(root);
-    for (; p; p = pcutils_rbtree_next(p)) {
-        struct obj_node *node;
-        node = container_of(p, struct obj_node, node);
+    if (pcvar_obj_unshare(obj))
+        return -1;
+
+    for (size_t i = 0; i < data->nr_kvs; i++) {
+        struct obj_kv *kv = data->kvs + i;
+        if (kv->key == PURC_VARIANT_INVALID)
+            continue;
+
+        struct obj_node *node = pcvar_obj_kv_node(obj, kv);
+        if (!node)
+            return -1;
+
         struct pcvar_rev_update_edge edge = {
             .parent         = obj,
             .obj_me         = node,
         };
-        int r = pcvar_build_edge_to_parent(node->val, &edge);
+        int r = pcvar_build_edge_to_parent(kv->val, &edge);
         if (r)
             return -1;
-        r = pcvar_build_rue_downward(node->val);
+        r = pcvar_build_rue_downward(kv->val);
         if (r)
             return -1;
     }
@@ -1124,34 +1652,28 @@ pcvar_object_build_edge_to_parent(purc_variant_t obj,
 }
 
 static void
-it_refresh(struct obj_iterator *it, struct rb_node *curr)
+it_seek(struct obj_iterator *it, size_t idx, bool forward)
 {
-    struct rb_node *next  = NULL;
-    struct rb_node *prev  = NULL;
-    if (curr) {
-        next  = pcutils_rbtree_next(curr);
-        prev  = pcutils_rbtree_prev(curr);
-    }
-
-    if (curr) {
-        it->curr = container_of(curr, struct obj_node, node);
-    }
-    else {
-        it->curr = NULL;
-    }
+    variant_obj_t data = pcvar_obj_get_data(it->obj);
 
-    if (next) {
-        it->next = container_of(next, struct obj_node, node);
+    it->curr = NULL;
+    if (forward) {
+        for (; idx < data->nr_kvs; idx++) {
+            if (data->kvs[idx].key != PURC_VARIANT_INVALID)
+                break;
+        }
     }
     else {
-        it->next = NULL;
+        for (; idx < data->nr_kvs; idx--) {
+            if (data->kvs[idx].key != PURC_VARIANT_INVALID)
+                break;
+        }
     }
 
-    if (prev) {
-        it->prev = container_of(prev, struct obj_node, node);
-    }
-    else {
-        it->prev = NULL;
+    // idx wraps around to SIZE_MAX if it goes before the first one.
+    if (idx < data->nr_kvs) {
+        it->curr = data->kvs + idx;
+        it->idx = idx;
     }
 }
 
@@ -1168,10 +1690,7 @@ pcvar_obj_it_first(purc_variant_t obj)
     if (data->size==0)
         return it;
 
-    struct rb_root *root = &data->kvs;
-
-    struct rb_node *first = pcutils_rbtree_first(root);
-    it_refresh(&it, first);
+    it_seek(&it, 0, true);
 
     return it;
 }
@@ -1189,10 +1708,7 @@ pcvar_obj_it_last(purc_variant_t obj)
     if (data->size==0)
         return it;
 
-    struct rb_root *root = &data->kvs;
-
-    struct rb_node *last = pcutils_rbtree_last(root);
-    it_refresh(&it, last);
+    it_seek(&it, data->nr_kvs - 1, false);
 
     return it;
 }
@@ -1203,15 +1719,7 @@ pcvar_obj_it_next(struct obj_iterator *it)
     if (it->curr == NULL)
         return;
 
-    if (it->next) {
-        struct rb_node *next = &it->next->node;
-        it_refresh(it, next);
-    }
-    else {
-        it->curr = NULL;
-        it->next = NULL;
-        it->prev = NULL;
-    }
+    it_seek(it, it->idx + 1, true);
 }
 
 void
@@ -1220,14 +1728,43 @@ pcvar_obj_it_prev(struct obj_iterator *it)
     if (it->curr == NULL)
         return;
 
-    if (it->prev) {
-        struct rb_node *prev = &it->prev->node;
-        it_refresh(it, prev);
+    it_seek(it, it->idx - 1, false);
+}
+
+static int
+cmp_kv_by_key(const void *l, const void *r)
+{
+    const struct obj_kv *lkv = *(const struct obj_kv **)l;
+    const struct obj_kv *rkv = *(const struct obj_kv **)r;
+
+    return strcmp(purc_variant_get_string_const(lkv->key),
+            purc_variant_get_string_const(rkv->key));
+}
+
+struct obj_kv **
+pcvar_obj_sorted_kvs(purc_variant_t obj, struct obj_kv **buf, size_t sz_buf)
+{
+    variant_obj_t data = pcvar_obj_get_data(obj);
+
+    struct obj_kv **kvs = buf;
+    if (data->size > sz_buf) {
+        kvs = (struct obj_kv **)malloc(sizeof(*kvs) * data->size);
+        if (kvs == NULL) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return NULL;
+        }
     }
-    else {
-        it->curr = NULL;
-        it->next = NULL;
-        it->prev = NULL;
+
+    size_t n = 0;
+    for (size_t i = 0; i < data->nr_kvs; i++) {
+        if (data->kvs[i].key != PURC_VARIANT_INVALID)
+            kvs[n++] = data->kvs + i;
     }
+
+    PC_ASSERT(n == data->size);
+    if (n > 1)
+        qsort(kvs, n, sizeof(*kvs), cmp_kv_by_key);
+
+    return kvs;
 }
 
@@ -25,6 +25,7 @@
 #define _GNU_SOURCE       // qsort_r
 
 #include "config.h"
+#include "private/instance.h"
 #include "private/variant.h"
 #include "private/list.h"
 #include "private/hashtable.h"
@@ -39,6 +40,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#define SET_MIN_INDEX_SIZE      8
+#define SET_MAX_STACK_KEYS      4
+
 static bool
 grow(purc_variant_t set, purc_variant_t value,
         bool check)
@@ -115,8 +119,7 @@ changed(purc_variant_t set,
 
     purc_variant_t vals[] = { o, n };
 
-    pcvariant_on_post_fired(set, PCVAR_OPERATION_CHANGE,
-            PCA_TABLESIZE(vals), vals);
+    pcvar_set_post_changed(set, PCA_TABLESIZE(vals), vals);
 }
 
 variant_set_t
@@ -140,6 +143,7 @@ variant_set_get_extra_size(variant_set_t data)
 
     extra += sz_record * count;
     extra += sizeof(struct set_node*)*(data->al.nr);
+    extra += sizeof(struct set_node*)*(data->sz_index + data->sz_order);
 
     return extra;
 }
@@ -150,77 +154,11 @@ pcv_set_set_data(purc_variant_t set, variant_set_t data)
     set->sz_ptr[1]     = (uintptr_t)data;
 }
 
-static int
-obj_node_diff(struct obj_node *l, struct obj_node *r)
-{
-    int diff = 0;
-
-    purc_variant_t lk, rk;
-    lk = l->key;
-    rk = r->key;
-    PC_ASSERT(lk);
-    PC_ASSERT(rk);
-
-    if (lk != rk) {
-        diff = pcvariant_diff(lk, rk);
-        if (diff)
-            return diff;
-    }
-
-    purc_variant_t lv, rv;
-    lv = l->val;
-    rv = r->val;
-    PC_ASSERT(lv);
-    PC_ASSERT(rv);
-
-    if (lv != rv) {
-        diff = pcvariant_diff(lv, rv);
-    }
-
-    return diff;
-}
-
-static int
-variant_set_compare_by_set_keys(purc_variant_t set,
-        purc_variant_t l, purc_variant_t r)
-{
-    PC_ASSERT(set != PURC_VARIANT_INVALID);
-    PC_ASSERT(purc_variant_is_set(set));
-    PC_ASSERT(l != PURC_VARIANT_INVALID);
-    PC_ASSERT(r != PURC_VARIANT_INVALID);
-    PC_ASSERT(pcvariant_is_mutable(l));
-    PC_ASSERT(pcvariant_is_mutable(r));
-
-    int diff;
-
-    struct kv_iterator lit, rit;
-    lit = pcvar_kv_it_first(set, l);
-    rit = pcvar_kv_it_first(set, r);
-    while (1) {
-        struct obj_node *ln = lit.it.curr;
-        struct obj_node *rn = rit.it.curr;
-        if (ln == NULL && rn == NULL)
-            return 0;
-        if (ln == NULL)
-            return -1;
-        if (rn == NULL)
-            return 1;
-
-        diff = obj_node_diff(ln, rn);
-        if (diff)
-            return diff;
-
-        pcvar_kv_it_next(&lit);
-        pcvar_kv_it_next(&rit);
-    }
-}
-
 static int
 variant_set_init(variant_set_t data, const char *unique_key, bool caseless)
 {
     data->caseless = caseless;
 
-    data->elems = RB_ROOT;
     pcutils_array_list_init(&data->al);
 
     if (!unique_key || !*unique_key) {
@@ -305,7 +243,9 @@ break_rev_update_chain(purc_variant_t set, struct set_node *node)
     PC_ASSERT(node);
     PC_ASSERT(node->val);
 
-    if (!pcvariant_is_mutable(node->val))
+    // a frozen member never changes, and no edge was built for it.
+    if (!pcvariant_is_mutable(node->val) ||
+            (node->val->flags & PCVARIANT_FLAG_FROZEN))
         return;
 
     struct pcvar_rev_update_edge edge = {
@@ -318,16 +258,17 @@ break_rev_update_chain(purc_variant_t set, struct set_node *node)
         struct kv_iterator it;
         it = pcvar_kv_it_first(set, node->val);
         while (1) {
-            struct obj_node *on = it.it.curr;
-            if (on == NULL)
+            struct obj_kv *kv = it.it.curr;
+            if (kv == NULL)
                 break;
-            if (pcvariant_is_mutable(on->val)) {
+            // no edge was built for the member if it has no node.
+            if (kv->node && pcvariant_is_mutable(kv->val)) {
                 struct pcvar_rev_update_edge edge = {
                     .parent        = node->val,
-                    .obj_me        = on,
+                    .obj_me        = kv->node,
                 };
-                pcvar_break_edge_to_parent(on->val, &edge);
-                pcvar_break_rue_downward(on->val);
+                pcvar_break_edge_to_parent(kv->val, &edge);
+                pcvar_break_rue_downward(kv->val);
             }
             pcvar_kv_it_next(&it);
         }
@@ -354,25 +295,12 @@ elem_node_revoke_constraints(purc_variant_t set, struct set_node *node)
     break_rev_update_chain(set, node);
 }
 
-struct element_rb_node {
-    struct rb_node     **pnode;
-    struct rb_node      *parent;
-    struct rb_node      *entry;
-};
-
 static int
 _compare_generic(purc_variant_t _new, purc_variant_t _old, bool caseless)
 {
-    purc_vrtcmp_opt_t opt = PCVARIANT_COMPARE_OPT_CASE;
-    if (caseless)
-        opt = PCVARIANT_COMPARE_OPT_CASELESS;
-
-    int diff;
-    diff = purc_variant_compare_ex(_new, _old, opt);
-
-    // FIXME: what if allocation failed internally in purc_variant_compare_ex?
-
-    return diff;
+    /* NOTE: must be consistent with pcvariant_hash64() */
+    bool unify_number = true;
+    return pcvar_compare_ex(_new, _old, caseless, unify_number);
 }
 
 static purc_variant_t
@@ -435,61 +363,178 @@ _compare(purc_variant_t _new, purc_variant_t _old,
     return _compare_by_unique_keys(_new, _old, data);
 }
 
+static struct set_node*
+index_find(variant_set_t data, uint64_t hash, purc_variant_t val)
+{
+    if (data->index == NULL)
+        return NULL;
+
+    size_t mask = data->sz_index - 1;
+    size_t pos = hash & mask;
+    struct set_node *node;
+    while ((node = data->index[pos])) {
+        /* the elements having the same hash are compared then */
+        if (node->hash == hash && _compare(val, node->val, data) == 0)
+            return node;
+        pos = (pos + 1) & mask;
+    }
+
+    return NULL;
+}
+
 static void
-find_element_rb_node(struct element_rb_node *node,
-        purc_variant_t set, purc_variant_t kvs)
+index_add(variant_set_t data, struct set_node *node)
 {
-    variant_set_t data = pcvar_set_get_data(set);
-    struct rb_root *root = &data->elems;
-    struct rb_node **pnode = &root->rb_node;
-    struct rb_node *parent = NULL;
-    struct rb_node *entry = NULL;
-    char md5[33];
-    pcvariant_md5_by_set(md5, kvs, set);
-
-    while (*pnode) {
-        struct set_node *on;
-        on = container_of(*pnode, struct set_node, rbnode);
-        int diff;
-        if (0) {
-            diff = variant_set_compare_by_set_keys(set, kvs, on->val);
-        }
-        else if (0) {
-            diff = pcvariant_diff_by_set(md5, kvs, on->md5, on->val, set);
-        }
-        else {
-            diff = _compare(kvs, on->val, data);
-        }
+    size_t mask = data->sz_index - 1;
+    size_t pos = node->hash & mask;
+    while (data->index[pos])
+        pos = (pos + 1) & mask;
 
-        parent = *pnode;
+    data->index[pos] = node;
+}
 
-        if (diff < 0) {
-            pnode = &parent->rb_left;
-        }
-        else if (diff > 0) {
-            pnode = &parent->rb_right;
-        }
-        else{
-            entry = *pnode;
+static void
+index_del(variant_set_t data, struct set_node *node)
+{
+    size_t mask = data->sz_index - 1;
+    size_t pos = node->hash & mask;
+    while (data->index[pos] != node) {
+        PC_ASSERT(data->index[pos]);
+        pos = (pos + 1) & mask;
+    }
+
+    /* Shift the following entries back into the hole unless the hole
+       is before their home positions, so no tombstone is needed. */
+    size_t hole = pos;
+    for (;;) {
+        pos = (pos + 1) & mask;
+        struct set_node *p = data->index[pos];
+        if (p == NULL)
             break;
+
+        size_t home = p->hash & mask;
+        if (((pos - home) & mask) >= ((pos - hole) & mask)) {
+            data->index[hole] = p;
+            hole = pos;
         }
     }
 
-    node->pnode  = pnode;
-    node->parent = parent;
-    node->entry  = entry;
+    data->index[hole] = NULL;
+}
+
+/* Makes sure that the index can hold `count` elements while keeping
+   the load factor not greater than 1/2. */
+static int
+index_reserve(variant_set_t data, size_t count)
+{
+    if (count * 2 <= data->sz_index)
+        return 0;
+
+    size_t sz_index;
+    sz_index = data->sz_index ? data->sz_index * 2 : SET_MIN_INDEX_SIZE;
+    while (sz_index < count * 2)
+        sz_index *= 2;
+
+    struct set_node **index;
+    index = (struct set_node**)calloc(sz_index, sizeof(*index));
+    if (!index) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+
+    free(data->index);
+    data->index = index;
+    data->sz_index = sz_index;
+
+    struct pcutils_array_list *al = &data->al;
+    struct pcutils_array_list_node *p;
+    array_list_for_each(al, p) {
+        index_add(data, container_of(p, struct set_node, alnode));
+    }
+
+    return 0;
+}
+
+static struct set_node*
+find_element_ex(purc_variant_t set, purc_variant_t kvs, uint64_t *hash)
+{
+    // the members changed in the current batch shall be rehashed first
+    pcvar_adjust_sets_in_batch();
+
+    variant_set_t data = pcvar_set_get_data(set);
+    *hash = pcvariant_hash64_by_set(kvs, set);
+
+    return index_find(data, *hash, kvs);
 }
 
 static struct set_node*
 find_element(purc_variant_t set, purc_variant_t kvs)
 {
-    struct element_rb_node node;
-    find_element_rb_node(&node, set, kvs);
+    uint64_t hash;
+    return find_element_ex(set, kvs, &hash);
+}
+
+#if OS(HURD) || OS(LINUX)
+static int
+cmp_ordered(const void *l, const void *r, void *ud)
+#elif OS(DARWIN) || OS(FREEBSD) || OS(NETBSD) || OS(OPENBSD) || OS(WINDOWS)
+static int
+cmp_ordered(void *ud, const void *l, const void *r)
+#else
+#error Unsupported operating system.
+#endif
+{
+    struct set_node *nl = *(struct set_node**)l;
+    struct set_node *nr = *(struct set_node**)r;
 
-    if (!node.entry)
-        return NULL;
+    return _compare(nl->val, nr->val, (variant_set_t)ud);
+}
+
+struct set_node**
+pcvar_set_ordered_nodes(purc_variant_t set, size_t *nr)
+{
+    pcvar_adjust_sets_in_batch();
+
+    variant_set_t data = pcvar_set_get_data(set);
+    size_t count = pcutils_array_list_length(&data->al);
+
+    *nr = 0;
+    if (data->ordered) {
+        *nr = count;
+        return data->order;
+    }
+
+    if (count > data->sz_order) {
+        struct set_node **order;
+        order = (struct set_node**)realloc(data->order,
+                count * sizeof(*order));
+        if (!order) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return NULL;
+        }
+        data->order = order;
+        data->sz_order = count;
+    }
+
+    struct pcutils_array_list_node *p;
+    array_list_for_each(&data->al, p) {
+        data->order[p->idx] = container_of(p, struct set_node, alnode);
+    }
 
-    return container_of(node.entry, struct set_node, rbnode);
+#if OS(HURD) || OS(LINUX)
+    qsort_r(data->order, count, sizeof(*data->order), cmp_ordered, data);
+#elif OS(DARWIN) || OS(FREEBSD) || OS(NETBSD) || OS(OPENBSD)
+    qsort_r(data->order, count, sizeof(*data->order), data, cmp_ordered);
+#elif OS(WINDOWS)
+    qsort_s(data->order, count, sizeof(*data->order), cmp_ordered, data);
+#endif
+
+    for (size_t i = 0; i < count; i++)
+        data->order[i]->ord = i;
+
+    data->ordered = true;
+    *nr = count;
+    return data->order;
 }
 
 static int
@@ -498,7 +543,9 @@ build_rev_update_chain(purc_variant_t set, struct set_node *node)
     PC_ASSERT(node);
     PC_ASSERT(node->val);
 
-    if (!pcvariant_is_mutable(node->val))
+    // no edge is built in a frozen member, which never changes.
+    if (!pcvariant_is_mutable(node->val) ||
+            (node->val->flags & PCVARIANT_FLAG_FROZEN))
         return 0;
 
     struct pcvar_rev_update_edge edge = {
@@ -513,18 +560,22 @@ build_rev_update_chain(purc_variant_t set, struct set_node *node)
         struct kv_iterator it;
         it = pcvar_kv_it_first(set, node->val);
         while (1) {
-            struct obj_node *on = it.it.curr;
-            if (on == NULL)
+            struct obj_kv *kv = it.it.curr;
+            if (kv == NULL)
                 break;
-            if (pcvariant_is_mutable(on->val)) {
+            if (pcvariant_is_mutable(kv->val)) {
+                struct obj_node *on = pcvar_obj_kv_node(node->val, kv);
+                if (on == NULL)
+                    return -1;
+
                 struct pcvar_rev_update_edge edge = {
                     .parent        = node->val,
                     .obj_me        = on,
                 };
                 int r;
-                r = pcvar_build_edge_to_parent(on->val, &edge);
+                r = pcvar_build_edge_to_parent(kv->val, &edge);
                 if (r == 0) {
-                    r = pcvar_build_rue_downward(on->val);
+                    r = pcvar_build_rue_downward(kv->val);
                 }
                 if (r)
                     return -1;
@@ -573,7 +624,8 @@ elem_node_remove(purc_variant_t set, struct set_node *node)
     variant_set_t data = pcvar_set_get_data(set);
     PC_ASSERT(data);
 
-    pcutils_rbtree_erase(&node->rbnode, &data->elems);
+    index_del(data, node);
+    data->ordered = false;
 
     int r;
     struct pcutils_array_list_node *old;
@@ -646,6 +698,14 @@ variant_set_release_elems(purc_variant_t set, variant_set_t data)
     }
 
     pcutils_array_list_reset(&data->al);
+
+    free(data->index);
+    data->index = NULL;
+    data->sz_index = 0;
+    free(data->order);
+    data->order = NULL;
+    data->sz_order = 0;
+    data->ordered = false;
 }
 
 static void
@@ -665,18 +725,25 @@ variant_set_release(purc_variant_t set, variant_set_t data)
     data->unique_key = NULL;
 }
 
-static purc_variant_t
-variant_set_create_kvs_n(variant_set_t set, purc_variant_t v1, va_list ap)
+/* Collects the values of the unique keys passed to a variadic function;
+   `buf` is used if it can hold them all. */
+static purc_variant_t*
+variant_set_collect_kvs(variant_set_t data, purc_variant_t *buf,
+        size_t sz_buf, purc_variant_t v1, va_list ap)
 {
-    PC_ASSERT(set->keynames);
+    PC_ASSERT(data->keynames);
     PC_ASSERT(v1 != PURC_VARIANT_INVALID);
 
-    purc_variant_t kvs;
-    kvs = pcvar_make_obj();
-    if (kvs == PURC_VARIANT_INVALID)
-        return PURC_VARIANT_INVALID;
+    purc_variant_t *kvs = buf;
+    if (data->nr_keynames > sz_buf) {
+        kvs = (purc_variant_t*)malloc(sizeof(*kvs) * data->nr_keynames);
+        if (kvs == NULL) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return NULL;
+        }
+    }
 
-    for (size_t i=0; i<set->nr_keynames; ++i) {
+    for (size_t i=0; i<data->nr_keynames; ++i) {
         purc_variant_t v;
         if (i == 0)
             v = v1;
@@ -684,39 +751,81 @@ variant_set_create_kvs_n(variant_set_t set, purc_variant_t v1, va_list ap)
             v = va_arg(ap, purc_variant_t);
 
         if (v == PURC_VARIANT_INVALID) {
-            purc_variant_unref(kvs);
+            if (kvs != buf)
+                free(kvs);
             pcinst_set_error(PURC_ERROR_INVALID_VALUE);
-            return PURC_VARIANT_INVALID;
+            return NULL;
         }
-        if (purc_variant_is_undefined(v))
-            continue;
+        kvs[i] = v;
+    }
 
-        const char *sk = set->keynames[i];
-        bool ok;
-        ok = purc_variant_object_set_by_static_ckey(kvs, sk, v);
-        if (!ok) {
-            purc_variant_unref(kvs);
-            return PURC_VARIANT_INVALID;
+    return kvs;
+}
+
+static bool
+match_key_values(variant_set_t data, purc_variant_t val, purc_variant_t *kvs)
+{
+    for (size_t i=0; i<data->nr_keynames; ++i) {
+        purc_variant_t v = PURC_VARIANT_INVALID;
+        if (val->type == PVT(_OBJECT)) {
+            v = purc_variant_object_get_by_ckey(val, data->keynames[i]);
+            if (v == PURC_VARIANT_INVALID)
+                purc_clr_error();
+        }
+
+        // a missing key is taken as undefined
+        if (v == PURC_VARIANT_INVALID) {
+            if (kvs[i]->type != PURC_VARIANT_TYPE_UNDEFINED)
+                return false;
+        }
+        else if (_compare_generic(kvs[i], v, data->caseless)) {
+            return false;
         }
     }
 
-    return kvs;
+    return true;
 }
 
+/* Locates the element by the values of the unique keys in the index
+   directly, without making an object of them to be hashed and compared. */
 static struct set_node*
-variant_set_create_elem_node(purc_variant_t set, purc_variant_t val)
+find_element_by_key_values(purc_variant_t set, purc_variant_t *kvs)
 {
+    pcvar_adjust_sets_in_batch();
+
     variant_set_t data = pcvar_set_get_data(set);
-    PC_ASSERT(data);
+    struct set_node *node = NULL;
+
+    if (data->index) {
+        uint64_t hash = pcvariant_hash64_by_key_values(set, kvs);
+        size_t mask = data->sz_index - 1;
+        size_t pos = hash & mask;
+        while ((node = data->index[pos])) {
+            if (node->hash == hash && match_key_values(data, node->val, kvs))
+                break;
+            pos = (pos + 1) & mask;
+        }
+    }
+
+    struct purc_variant_stat *stat = &pcinst_current()->variant_heap->stat;
+    if (node)
+        stat->nr_set_key_hits++;
+    else
+        stat->nr_set_key_misses++;
+
+    return node;
+}
 
+static struct set_node*
+variant_set_create_elem_node(purc_variant_t val, uint64_t hash)
+{
     struct set_node *_new = (struct set_node*)calloc(1, sizeof(*_new));
     if (!_new) {
         pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
         return NULL;
     }
 
-    pcvariant_md5_by_set(_new->md5, val, set);
-
+    _new->hash = hash;
     _new->alnode.idx = (size_t)-1;
     _new->val = val;
     purc_variant_ref(val);
@@ -772,6 +881,8 @@ static int
 set_remove(purc_variant_t set, struct set_node *node,
         bool check)
 {
+    PCVARIANT_CHECK_NOT_FROZEN_RET(set, -1);
+
     do {
         if (check) {
             if (!shrink(set, node->val, check))
@@ -840,8 +951,7 @@ check_grow(purc_variant_t set, purc_variant_t val)
 
 static int
 insert(purc_variant_t set, variant_set_t data,
-        purc_variant_t val,
-        struct rb_node *parent, struct rb_node **pnode,
+        purc_variant_t val, uint64_t hash,
         bool check)
 {
     struct set_node *node = NULL;
@@ -855,23 +965,24 @@ insert(purc_variant_t set, variant_set_t data,
                 break;
         }
 
-        node = variant_set_create_elem_node(set, val);
+        node = variant_set_create_elem_node(val, hash);
         if (!node)
             break;
 
+        size_t count = pcutils_array_list_length(&data->al);
+        if (index_reserve(data, count + 1))
+            break;
+
         PC_ASSERT(node->alnode.idx == (size_t)-1);
         int r = pcutils_array_list_append(&data->al, &node->alnode);
         if (r)
             break;
         PC_ASSERT(node->alnode.idx != (size_t)-1);
 
-        size_t count = pcutils_array_list_length(&data->al);
-        node->alnode.idx = count - 1;
-
-        struct rb_node *entry = &node->rbnode;
+        node->alnode.idx = count;
 
-        pcutils_rbtree_link_node(entry, parent, pnode);
-        pcutils_rbtree_insert_color(entry, &data->elems);
+        index_add(data, node);
+        data->ordered = false;
 
         if (check) {
             if (!elem_node_setup_constraints(set, node))
@@ -896,16 +1007,14 @@ pcvar_set_add(purc_variant_t set, purc_variant_t val)
     variant_set_t data = pcvar_set_get_data(set);
     PC_ASSERT(data);
 
-    struct element_rb_node rbn;
-    find_element_rb_node(&rbn, set, val);
-
-    if (rbn.entry) {
+    uint64_t hash;
+    if (find_element_ex(set, val, &hash)) {
         purc_set_error(PURC_ERROR_DUPLICATED);
         return -1;
     }
 
     bool check = false;
-    return insert(set, data, val, rbn.parent, rbn.pnode, check);
+    return insert(set, data, val, hash, check);
 }
 
 static int
@@ -959,11 +1068,13 @@ insert_or_replace(purc_variant_t set,
         variant_set_t data, purc_variant_t val, bool overwrite,
         bool check)
 {
-    struct element_rb_node rbn;
-    find_element_rb_node(&rbn, set, val);
+    PCVARIANT_CHECK_NOT_FROZEN_RET(set, -1);
+
+    uint64_t hash;
+    struct set_node *curr = find_element_ex(set, val, &hash);
 
-    if (!rbn.entry) {
-        int r = insert(set, data, val, rbn.parent, rbn.pnode, check);
+    if (!curr) {
+        int r = insert(set, data, val, hash, check);
 
         return r ? -1 : 0;
     }
@@ -975,9 +1086,6 @@ insert_or_replace(purc_variant_t set,
         return -1;
     }
 
-    struct set_node *curr;
-    curr = container_of(rbn.entry, struct set_node, rbnode);
-
     if (curr->val == val)
         return 0;
 
@@ -1048,6 +1156,423 @@ variant_set_add_valsn(purc_variant_t set, variant_set_t data, bool overwrite,
     return i<sz ? -1 : 0;
 }
 
+/*
+ * The set algebra (unite, intersect, subtract and xor) works as a hash
+ * join: the members of the source are hashed once on the unique keys of
+ * the set into a transient table, which merges the members having the same
+ * keys, and every distinct key is probed against the index of the set,
+ * which is kept all the time, so the larger side is never rehashed. The
+ * result is then applied in one pass, and the listeners of the set get one
+ * event for each kind of change carrying all the members involved.
+ */
+struct join_entry {
+    purc_variant_t      val;        // the latest source member of the key
+    purc_variant_t      in;         // the value to put in the set, owned
+    struct set_node    *node;       // the member of the set having the key
+    uint64_t            hash;
+    bool                present;    // whether the key is in the result
+};
+
+struct set_join {
+    purc_variant_t      set;
+    variant_set_t       data;
+    bool                intersect;
+
+    // the entries in the order of the first occurrence in the source
+    struct join_entry  *entries;
+    size_t              nr_entries;
+
+    // open-addressing table of the entries: the position plus one
+    size_t             *slots;
+    size_t              sz_slots;   // always a power of 2
+};
+
+static int
+join_init(struct set_join *join, purc_variant_t set, size_t nr_vals)
+{
+    memset(join, 0, sizeof(*join));
+    join->set = set;
+    join->data = pcvar_set_get_data(set);
+
+    size_t sz_slots = SET_MIN_INDEX_SIZE;
+    while (sz_slots < nr_vals * 2)
+        sz_slots *= 2;
+
+    join->entries = (struct join_entry*)calloc(nr_vals ? nr_vals : 1,
+            sizeof(*join->entries));
+    join->slots = (size_t*)calloc(sz_slots, sizeof(*join->slots));
+    if (!join->entries || !join->slots) {
+        free(join->entries);
+        free(join->slots);
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+    join->sz_slots = sz_slots;
+
+    return 0;
+}
+
+static void
+join_release(struct set_join *join)
+{
+    for (size_t i = 0; i < join->nr_entries; i++)
+        PURC_VARIANT_SAFE_CLEAR(join->entries[i].in);
+
+    free(join->entries);
+    free(join->slots);
+}
+
+static struct join_entry*
+join_find(struct set_join *join, uint64_t hash, purc_variant_t val,
+        size_t *pos)
+{
+    size_t mask = join->sz_slots - 1;
+    size_t slot;
+
+    *pos = hash & mask;
+    while ((slot = join->slots[*pos])) {
+        struct join_entry *entry = join->entries + slot - 1;
+        if (entry->hash == hash &&
+                _compare(val, entry->val, join->data) == 0)
+            return entry;
+        *pos = (*pos + 1) & mask;
+    }
+
+    return NULL;
+}
+
+static struct join_entry*
+join_probe(struct set_join *join, purc_variant_t val)
+{
+    uint64_t hash = pcvariant_hash64_by_set(val, join->set);
+    size_t pos;
+
+    struct join_entry *entry = join_find(join, hash, val, &pos);
+    if (entry)
+        return entry;
+
+    entry = join->entries + join->nr_entries++;
+    entry->val = val;
+    entry->hash = hash;
+    entry->node = index_find(join->data, hash, val);
+    entry->present = (entry->node != NULL);
+    join->slots[pos] = join->nr_entries;
+
+    return entry;
+}
+
+static void
+join_member(struct set_join *join, enum pcvar_set_join_op op,
+        purc_variant_t val)
+{
+    struct join_entry *entry = join_probe(join, val);
+
+    switch (op) {
+    case PCVAR_SET_JOIN_UNITE:
+        entry->val = val;
+        entry->present = true;
+        break;
+
+    case PCVAR_SET_JOIN_INTERSECT:
+        if (entry->node)
+            entry->val = val;
+        break;
+
+    case PCVAR_SET_JOIN_SUBTRACT:
+        entry->present = false;
+        break;
+
+    case PCVAR_SET_JOIN_XOR:
+        if (entry->present) {
+            entry->present = false;
+        }
+        else {
+            entry->val = val;
+            entry->present = true;
+        }
+        break;
+    }
+}
+
+/* Returns true if the member of the set is not in the result; otherwise
+   the value it takes is returned through `in`. */
+static bool
+join_drops_node(struct set_join *join, struct set_node *node,
+        purc_variant_t *in)
+{
+    size_t pos;
+    struct join_entry *entry = join_find(join, node->hash, node->val, &pos);
+
+    if (entry == NULL) {
+        *in = node->val;
+        return join->intersect;
+    }
+
+    *in = entry->in ? entry->in : node->val;
+    return !entry->present;
+}
+
+static bool
+join_drops_alnode(struct pcutils_array_list_node *alnode, void *ud)
+{
+    struct set_node *node = container_of(alnode, struct set_node, alnode);
+    purc_variant_t in;
+
+    return join_drops_node((struct set_join*)ud, node, &in);
+}
+
+static int
+join_check_result(struct set_join *join,
+        struct join_entry **grown, size_t nr_grown)
+{
+    purc_variant_t set = join->set;
+    if (!pcvar_container_belongs_to_set(set))
+        return 0;
+
+    purc_variant_t _new = pcvar_set_clone_struct(set);
+    if (_new == PURC_VARIANT_INVALID)
+        return -1;
+
+    int r = 0;
+    struct pcutils_array_list_node *p;
+    array_list_for_each(&join->data->al, p) {
+        struct set_node *node = container_of(p, struct set_node, alnode);
+        purc_variant_t in;
+        if (join_drops_node(join, node, &in))
+            continue;
+        r = pcvar_set_add(_new, in);
+        if (r)
+            break;
+    }
+
+    for (size_t i = 0; r == 0 && i < nr_grown; i++)
+        r = pcvar_set_add(_new, grown[i]->in);
+
+    if (r == 0)
+        r = pcvar_reverse_check(set, _new);
+
+    PURC_VARIANT_SAFE_CLEAR(_new);
+    return r ? -1 : 0;
+}
+
+static int
+join_apply(struct set_join *join)
+{
+    purc_variant_t set = join->set;
+    variant_set_t data = join->data;
+    struct pcutils_array_list *al = &data->al;
+    size_t count = pcutils_array_list_length(al);
+    size_t nr_max = count + join->nr_entries;
+
+    struct set_node **dropped = NULL;
+    struct join_entry **grown = NULL;
+    purc_variant_t *vals = NULL;
+    size_t nr_dropped = 0, nr_changed = 0, nr_grown = 0;
+    int r = -1;
+
+    dropped = (struct set_node**)malloc(sizeof(*dropped) * (nr_max + 1));
+    grown = (struct join_entry**)malloc(sizeof(*grown) * (nr_max + 1));
+    // the shrunk values, the pairs of the changed values, the grown values
+    vals = (purc_variant_t*)malloc(sizeof(*vals) * (nr_max * 2 + 1));
+    if (!dropped || !grown || !vals) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        goto out;
+    }
+
+    // the values to put in, which shall not belong to another set
+    for (size_t i = 0; i < join->nr_entries; i++) {
+        struct join_entry *entry = join->entries + i;
+        if (!entry->present || entry->val == (entry->node ?
+                    entry->node->val : PURC_VARIANT_INVALID))
+            continue;
+
+        if (pcvar_container_belongs_to_set(entry->val))
+            entry->in = purc_variant_container_clone_recursively(entry->val);
+        else
+            entry->in = purc_variant_ref(entry->val);
+        if (entry->in == PURC_VARIANT_INVALID)
+            goto out;
+
+        if (entry->node)
+            nr_changed++;
+        else
+            grown[nr_grown++] = entry;
+    }
+
+    if (join->intersect) {
+        // the members not matched are dropped too
+        struct pcutils_array_list_node *p;
+        array_list_for_each(al, p) {
+            struct set_node *node = container_of(p, struct set_node, alnode);
+            purc_variant_t in;
+            if (join_drops_node(join, node, &in))
+                dropped[nr_dropped++] = node;
+        }
+    }
+    else {
+        for (size_t i = 0; i < join->nr_entries; i++) {
+            struct join_entry *entry = join->entries + i;
+            if (entry->node && !entry->present)
+                dropped[nr_dropped++] = entry->node;
+        }
+    }
+
+    if (nr_dropped + nr_changed + nr_grown == 0) {
+        r = 0;
+        goto out;
+    }
+
+    purc_variant_t *shrunk_vals = vals;
+    purc_variant_t *changed_vals = shrunk_vals + nr_dropped;
+    purc_variant_t *grown_vals = changed_vals + nr_changed * 2;
+
+    for (size_t i = 0; i < nr_dropped; i++)
+        shrunk_vals[i] = dropped[i]->val;
+
+    size_t n = 0;
+    for (size_t i = 0; i < join->nr_entries; i++) {
+        struct join_entry *entry = join->entries + i;
+        if (entry->node && entry->in) {
+            changed_vals[n++] = entry->node->val;
+            changed_vals[n++] = entry->in;
+        }
+    }
+
+    for (size_t i = 0; i < nr_grown; i++)
+        grown_vals[i] = grown[i]->in;
+
+    if (nr_dropped && !pcvariant_on_pre_fired(set, PCVAR_OPERATION_SHRINK,
+                nr_dropped, shrunk_vals))
+        goto out;
+    if (nr_changed && !pcvariant_on_pre_fired(set, PCVAR_OPERATION_CHANGE,
+                nr_changed * 2, changed_vals))
+        goto out;
+    if (nr_grown && !pcvariant_on_pre_fired(set, PCVAR_OPERATION_GROW,
+                nr_grown, grown_vals))
+        goto out;
+
+    if (join_check_result(join, grown, nr_grown))
+        goto out;
+
+    // the changed old values are held until the listeners are told
+    for (size_t i = 0; i < nr_changed; i++)
+        purc_variant_ref(changed_vals[i * 2]);
+
+    if (nr_dropped) {
+        for (size_t i = 0; i < nr_dropped; i++) {
+            elem_node_revoke_constraints(set, dropped[i]);
+            index_del(data, dropped[i]);
+        }
+        pcutils_array_list_remove_if(al, join_drops_alnode, join);
+    }
+
+    for (size_t i = 0; i < join->nr_entries; i++) {
+        struct join_entry *entry = join->entries + i;
+        if (entry->node && entry->in &&
+                elem_node_replace(set, entry->node, entry->in, true))
+            goto failed;
+    }
+
+    if (nr_grown) {
+        count = pcutils_array_list_length(al);
+        if (pcutils_array_list_expand(al, count + nr_grown) ||
+                index_reserve(data, count + nr_grown)) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            goto failed;
+        }
+
+        for (size_t i = 0; i < nr_grown; i++) {
+            struct set_node *node;
+            node = variant_set_create_elem_node(grown[i]->in, grown[i]->hash);
+            if (!node)
+                goto failed;
+
+            if (pcutils_array_list_append(al, &node->alnode)) {
+                elem_node_destroy(set, node);
+                goto failed;
+            }
+
+            index_add(data, node);
+            if (!elem_node_setup_constraints(set, node))
+                goto failed;
+        }
+    }
+
+    data->ordered = false;
+    pcvar_adjust_set_by_descendant(set);
+
+    if (nr_dropped)
+        pcvariant_on_post_fired(set, PCVAR_OPERATION_SHRINK,
+                nr_dropped, shrunk_vals);
+    if (nr_changed)
+        pcvar_set_post_changed(set, nr_changed * 2, changed_vals);
+    if (nr_grown)
+        pcvariant_on_post_fired(set, PCVAR_OPERATION_GROW,
+                nr_grown, grown_vals);
+
+    r = 0;
+
+failed:
+    for (size_t i = 0; i < nr_changed; i++)
+        purc_variant_unref(changed_vals[i * 2]);
+
+    for (size_t i = 0; i < nr_dropped; i++)
+        elem_node_destroy(set, dropped[i]);
+
+    if (r)
+        data->ordered = false;
+
+out:
+    free(dropped);
+    free(grown);
+    free(vals);
+    return r;
+}
+
+int
+pcvar_set_join(purc_variant_t set, purc_variant_t src,
+        enum pcvar_set_join_op op)
+{
+    PCVARIANT_CHECK_NOT_FROZEN_RET(set, -1);
+
+    size_t nr_vals;
+    if (src->type == PVT(_SET))
+        purc_variant_set_size(src, &nr_vals);
+    else
+        purc_variant_array_size(src, &nr_vals);
+
+    pcvar_adjust_sets_in_batch();
+
+    struct set_join join;
+    if (join_init(&join, set, nr_vals))
+        return -1;
+    join.intersect = (op == PCVAR_SET_JOIN_INTERSECT);
+
+    purc_variant_t v;
+    if (src->type == PVT(_SET)) {
+        foreach_value_in_variant_set_order(src, v) {
+            join_member(&join, op, v);
+        } end_foreach;
+    }
+    else {
+        size_t idx;
+        foreach_value_in_variant_array(src, v, idx) {
+            UNUSED_PARAM(idx);
+            join_member(&join, op, v);
+        } end_foreach;
+    }
+
+    int r = join_apply(&join);
+    join_release(&join);
+
+    if (r == 0) {
+        size_t extra = variant_set_get_extra_size(join.data);
+        pcvariant_stat_set_extra_size(set, extra);
+    }
+
+    return r;
+}
+
 static purc_variant_t
 make_set_0(const char *unique_key, bool caseless)
 {
@@ -1180,16 +1705,19 @@ purc_variant_set_get_member_by_key_values(purc_variant_t set,
         return PURC_VARIANT_INVALID;
     }
 
+    purc_variant_t buf[SET_MAX_STACK_KEYS];
     va_list ap;
     va_start(ap, v1);
-    purc_variant_t kvs = variant_set_create_kvs_n(data, v1, ap);
+    purc_variant_t *kvs = variant_set_collect_kvs(data, buf,
+            PCA_TABLESIZE(buf), v1, ap);
     va_end(ap);
-    if (kvs == PURC_VARIANT_INVALID)
-        return false;
+    if (kvs == NULL)
+        return PURC_VARIANT_INVALID;
 
     struct set_node *p;
-    p = find_element(set, kvs);
-    purc_variant_unref(kvs);
+    p = find_element_by_key_values(set, kvs);
+    if (kvs != buf)
+        free(kvs);
 
     return p ? p->val: PURC_VARIANT_INVALID;
 }
@@ -1207,16 +1735,19 @@ purc_variant_set_remove_member_by_key_values(purc_variant_t set,
         return PURC_VARIANT_INVALID;
     }
 
+    purc_variant_t buf[SET_MAX_STACK_KEYS];
     va_list ap;
     va_start(ap, v1);
-    purc_variant_t kvs = variant_set_create_kvs_n(data, v1, ap);
+    purc_variant_t *kvs = variant_set_collect_kvs(data, buf,
+            PCA_TABLESIZE(buf), v1, ap);
     va_end(ap);
-    if (kvs == PURC_VARIANT_INVALID)
+    if (kvs == NULL)
         return PURC_VARIANT_INVALID;
 
     struct set_node *p;
-    p = find_element(set, kvs);
-    purc_variant_unref(kvs);
+    p = find_element_by_key_values(set, kvs);
+    if (kvs != buf)
+        free(kvs);
 
     if (!p) {
         pcinst_set_error(PCVARIANT_ERROR_NOT_FOUND);
@@ -1319,6 +1850,7 @@ purc_variant_set_set_by_index(purc_variant_t set,
         size_t idx, purc_variant_t val)
 {
     PC_ASSERT(set);
+    PCVARIANT_CHECK_NOT_FROZEN_RET(set, false);
 
     variant_set_t data = pcvar_set_get_data(set);
     size_t count = pcutils_array_list_length(&data->al);
@@ -1346,38 +1878,29 @@ purc_variant_set_set_by_index(purc_variant_t set,
 
 struct purc_variant_set_iterator {
     purc_variant_t      set;
-    struct rb_node     *curr;
-    struct rb_node     *prev, *next;
+    struct set_node    *curr;
+    struct set_node    *prev, *next;
 };
 
 static void
 iterator_refresh(struct purc_variant_set_iterator *it)
 {
-    if (it->curr == NULL) {
-        it->next = NULL;
-        it->prev = NULL;
+    it->next = NULL;
+    it->prev = NULL;
+    if (it->curr == NULL)
         return;
-    }
-    variant_set_t data = pcvar_set_get_data(it->set);
-    size_t count = pcutils_array_list_length(&data->al);
-    if (count==0) {
-        it->next = NULL;
-        it->prev = NULL;
+
+    size_t count;
+    struct set_node **nodes = pcvar_set_ordered_nodes(it->set, &count);
+    if (count == 0)
         return;
-    }
-    struct rb_node *first, *last;
-    first = pcutils_rbtree_first(&data->elems);
-    last  = pcutils_rbtree_last(&data->elems);
-    if (it->curr == first) {
-        it->prev = NULL;
-    } else {
-        it->prev = pcutils_rbtree_prev(it->curr);
-    }
-    if (it->curr == last) {
-        it->next = NULL;
-    } else {
-        it->next = pcutils_rbtree_next(it->curr);
-    }
+
+    size_t ord = it->curr->ord;
+    PC_ASSERT(ord < count && nodes[ord] == it->curr);
+    if (ord > 0)
+        it->prev = nodes[ord - 1];
+    if (ord + 1 < count)
+        it->next = nodes[ord + 1];
 }
 
 struct purc_variant_set_iterator*
@@ -1403,11 +1926,13 @@ purc_variant_set_make_iterator_begin(purc_variant_t set)
     }
     it->set = set;
 
-    struct rb_node *p;
-    p = pcutils_rbtree_first(&data->elems);
-    PC_ASSERT(p);
+    struct set_node **nodes = pcvar_set_ordered_nodes(set, &count);
+    if (count == 0) {
+        free(it);
+        return NULL;
+    }
 
-    it->curr = p;
+    it->curr = nodes[0];
     iterator_refresh(it);
 
     return it;
@@ -1436,11 +1961,13 @@ purc_variant_set_make_iterator_end(purc_variant_t set)
     }
     it->set = set;
 
-    struct rb_node *p;
-    p = pcutils_rbtree_last(&data->elems);
-    PC_ASSERT(p);
+    struct set_node **nodes = pcvar_set_ordered_nodes(set, &count);
+    if (count == 0) {
+        free(it);
+        return NULL;
+    }
 
-    it->curr = p;
+    it->curr = nodes[count - 1];
     iterator_refresh(it);
 
     return it;
@@ -1493,9 +2020,7 @@ purc_variant_set_iterator_get_value(struct purc_variant_set_iterator* it)
         it->set->type==PVT(_SET) && it->curr,
         PURC_VARIANT_INVALID);
 
-    struct set_node *p;
-    p = container_of(it->curr, struct set_node, rbnode);
-    return p->val;
+    return it->curr->val;
 }
 
 void
@@ -1572,6 +2097,7 @@ int pcvariant_set_sort(purc_variant_t value, void *ud,
         int (*cmp)(purc_variant_t l, purc_variant_t r, void *ud))
 {
     PC_ASSERT(value != PURC_VARIANT_INVALID);
+    PCVARIANT_CHECK_NOT_FROZEN_RET(value, -1);
 
     variant_set_t data = pcvar_set_get_data(value);
     struct pcutils_array_list *al = &data->al;
@@ -1716,11 +2242,13 @@ next_node(struct set_iterator *it, struct set_node *curr)
         return container_of(alnode, struct set_node, alnode);
     }
 
-    if (it->it_type == SET_IT_RBTREE) {
-        struct rb_node *p = pcutils_rbtree_next(&curr->rbnode);
-        if (!p)
+    if (it->it_type == SET_IT_ORDER) {
+        size_t count;
+        struct set_node **nodes = pcvar_set_ordered_nodes(it->set, &count);
+        size_t ord = curr->ord + 1;
+        if (ord >= count)
             return NULL;
-        return container_of(p, struct set_node, rbnode);
+        return nodes[ord];
     }
 
     PC_ASSERT(0);
@@ -1750,11 +2278,12 @@ prev_node(struct set_iterator *it, struct set_node *curr)
         return container_of(alnode, struct set_node, alnode);
     }
 
-    if (it->it_type == SET_IT_RBTREE) {
-        struct rb_node *p = pcutils_rbtree_prev(&curr->rbnode);
-        if (!p)
+    if (it->it_type == SET_IT_ORDER) {
+        size_t count;
+        struct set_node **nodes = pcvar_set_ordered_nodes(it->set, &count);
+        if (curr->ord == 0)
             return NULL;
-        return container_of(p, struct set_node, rbnode);
+        return nodes[curr->ord - 1];
     }
 
     PC_ASSERT(0);
@@ -1790,8 +2319,6 @@ pcvar_set_it_first(purc_variant_t set, enum set_it_type it_type)
     if (data == NULL)
         return it;
 
-    struct rb_root *root = &data->elems;
-
     struct pcutils_array_list *arr = &data->al;
     if (arr == NULL)
         return it;
@@ -1808,10 +2335,11 @@ pcvar_set_it_first(purc_variant_t set, enum set_it_type it_type)
         PC_ASSERT(alnode);
         curr = container_of(alnode, struct set_node, alnode);
     }
-    else if (it_type == SET_IT_RBTREE) {
-        struct rb_node *p = pcutils_rbtree_first(root);
-        PC_ASSERT(p);
-        curr = container_of(p, struct set_node, rbnode);
+    else if (it_type == SET_IT_ORDER) {
+        struct set_node **nodes = pcvar_set_ordered_nodes(set, &count);
+        if (count == 0)
+            return it;
+        curr = nodes[0];
     }
     else {
         PC_ASSERT(0);
@@ -1835,8 +2363,6 @@ pcvar_set_it_last(purc_variant_t set, enum set_it_type it_type)
     if (data == NULL)
         return it;
 
-    struct rb_root *root = &data->elems;
-
     struct pcutils_array_list *arr = &data->al;
     if (arr == NULL)
         return it;
@@ -1853,10 +2379,11 @@ pcvar_set_it_last(purc_variant_t set, enum set_it_type it_type)
         PC_ASSERT(alnode);
         curr = container_of(alnode, struct set_node, alnode);
     }
-    else if (it_type == SET_IT_RBTREE) {
-        struct rb_node *p = pcutils_rbtree_last(root);
-        PC_ASSERT(p);
-        curr = container_of(p, struct set_node, rbnode);
+    else if (it_type == SET_IT_ORDER) {
+        struct set_node **nodes = pcvar_set_ordered_nodes(set, &count);
+        if (count == 0)
+            return it;
+        curr = nodes[count - 1];
     }
     else {
         PC_ASSERT(0);
@@ -1925,7 +2452,7 @@ pcvar_kv_it_first(purc_variant_t set, purc_variant_t obj)
     it.it = pcvar_obj_it_first(obj);
 
     while (it.it.curr) {
-        struct obj_node *curr = it.it.curr;
+        struct obj_kv *curr = it.it.curr;
         purc_variant_t key = curr->key;
         const char *sk = purc_variant_get_string_const(key);
         for (size_t i=0; i<data->nr_keynames; ++i) {
@@ -1964,8 +2491,6 @@ pcvar_kv_it_next(struct kv_iterator *it)
 
     if (it->accu >= data->nr_keynames) {
         it->it.curr = NULL;
-        it->it.next = NULL;
-        it->it.prev = NULL;
         return;
     }
 
@@ -1973,7 +2498,7 @@ pcvar_kv_it_next(struct kv_iterator *it)
         pcvar_obj_it_next(&it->it);
         if (it->it.curr == NULL)
             return;
-        struct obj_node *curr = it->it.curr;
+        struct obj_kv *curr = it->it.curr;
         purc_variant_t key = curr->key;
         const char *sk = purc_variant_get_string_const(key);
         for (size_t i=0; i<data->nr_keynames; ++i) {
@@ -2083,6 +2608,17 @@ pcvar_adjust_set_by_edge(purc_variant_t set,
     PC_ASSERT(0);
 }
 
+bool
+pcvar_set_keys_unchanged(purc_variant_t set, purc_variant_t _old,
+        purc_variant_t _new)
+{
+    variant_set_t data = pcvar_set_get_data(set);
+    if (data->unique_key == NULL)
+        return false;
+
+    return _compare_by_unique_keys(_new, _old, data) == 0;
+}
+
 int
 pcvar_readjust_set(purc_variant_t set, struct set_node *node)
 {
@@ -2090,16 +2626,11 @@ pcvar_readjust_set(purc_variant_t set, struct set_node *node)
     PC_ASSERT(purc_variant_is_set(set));
     variant_set_t data = pcvar_set_get_data(set);
 
-    pcutils_rbtree_erase(&node->rbnode, &data->elems);
-
-    struct element_rb_node rbn;
-    find_element_rb_node(&rbn, set, node->val);
-    PC_ASSERT(rbn.entry == NULL);
-
-    struct rb_node *entry = &node->rbnode;
-
-    pcutils_rbtree_link_node(entry, rbn.parent, rbn.pnode);
-    pcutils_rbtree_insert_color(entry, &data->elems);
+    /* the element was changed in place, rehash it */
+    index_del(data, node);
+    node->hash = pcvariant_hash64_by_set(node->val, set);
+    index_add(data, node);
+    data->ordered = false;
 
     return 0;
 }
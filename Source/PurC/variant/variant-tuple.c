@@ -37,6 +37,10 @@ purc_variant_t purc_variant_make_tuple(size_t argc, purc_variant_t *argv)
         return PURC_VARIANT_INVALID;
     }
 
+    vrt->type = PVT(_TUPLE);
+    vrt->flags = 0;
+    vrt->refc = 1;
+
     purc_variant_t *members;
     if (argc < PCVARIANT_MIN_TUPLE_SIZE_USING_EXTRA_SPACE) {
         vrt->size = argc;
@@ -107,6 +111,8 @@ bool purc_variant_tuple_set(purc_variant_t tuple,
     if (members == NULL || idx >= sz)
         return false;
 
+    PCVARIANT_CHECK_NOT_FROZEN_RET(tuple, false);
+
     assert(value);
     /* do not change */
     if (value == members[idx])
@@ -31,6 +31,7 @@
 #include "private/debug.h"
 #include "private/dvobjs.h"
 #include "private/utils.h"
+#include "private/hashtable.h"
 #include "variant-internals.h"
 
 #include <stdlib.h>
@@ -39,6 +40,9 @@
 #include <math.h>
 #include <float.h>
 
+/* this feature needs C11 (stdatomic.h) or above */
+#include <stdatomic.h>
+
 #if OS(LINUX) || OS(UNIX)
     #include <dlfcn.h>
 #endif
@@ -86,7 +90,33 @@ static struct err_msg_seg _variant_err_msgs_seg = {
     variant_err_msgs
 };
 
-#if HAVE(GLIB)
+#if USE(SLAB_FOR_VARIANTS)
+static inline purc_variant *heap_alloc_0(struct pcvariant_heap *heap) {
+    purc_variant *v;
+    v = (purc_variant *)pcvariant_slab_alloc(heap, sizeof(purc_variant));
+    if (v)
+        memset(v, 0, sizeof(purc_variant));
+    return v;
+}
+
+static inline void heap_free(struct pcvariant_heap *heap, purc_variant *v) {
+    pcvariant_slab_free(heap, v);
+}
+
+purc_variant *pcvariant_alloc(void) {
+    struct pcinst *inst = pcinst_current();
+    return (purc_variant *)pcvariant_slab_alloc(inst->variant_heap,
+            sizeof(purc_variant));
+}
+
+purc_variant *pcvariant_alloc_0(void) {
+    return heap_alloc_0(pcinst_current()->variant_heap);
+}
+
+void pcvariant_free(purc_variant *v) {
+    heap_free(pcinst_current()->variant_heap, v);
+}
+#elif HAVE(GLIB)
 purc_variant *pcvariant_alloc(void) {
     return (purc_variant *)g_slice_alloc(sizeof(purc_variant));
 }
@@ -112,6 +142,11 @@ void pcvariant_free(purc_variant *v) {
 }
 #endif
 
+#if !USE(SLAB_FOR_VARIANTS)
+#define heap_alloc_0(heap)      pcvariant_alloc_0()
+#define heap_free(heap, v)      pcvariant_free(v)
+#endif
+
 purc_atom_t pcvariant_atom_grow;
 purc_atom_t pcvariant_atom_shrink;
 purc_atom_t pcvariant_atom_change;
@@ -146,11 +181,21 @@ static void _cleanup_instance(struct pcinst *inst)
     if (heap == NULL)
         return;
 
+    if (heap->batch_changed) {
+        pcutils_map_destroy(heap->batch_changed);
+        heap->batch_changed = NULL;
+    }
+
+    if (heap->batch_set_changes) {
+        pcutils_map_destroy(heap->batch_set_changes);
+        heap->batch_set_changes = NULL;
+    }
+
     /* VWNOTE: do not try to release the extra memory here. */
 #if USE(LOOP_BUFFER_FOR_RESERVED)
     for (int i = 0; i < MAX_RESERVED_VARIANTS; i++) {
         if (heap->v_reserved[i]) {
-            pcvariant_free(heap->v_reserved[i]);
+            heap_free(heap, heap->v_reserved[i]);
             heap->v_reserved[i] = NULL;
         }
     }
@@ -162,7 +207,7 @@ static void _cleanup_instance(struct pcinst *inst)
         purc_variant_t v = list_entry(p, struct purc_variant, reserved);
 
         list_del(p);
-        pcvariant_free(v);
+        heap_free(heap, v);
     }
 #endif
 
@@ -171,6 +216,21 @@ static void _cleanup_instance(struct pcinst *inst)
     assert(heap->v_true.refc == 0);
     assert(heap->v_false.refc == 0);
 
+    if (heap->listeners) {
+        pchash_table_free(heap->listeners);
+    }
+
+#if USE(SHARED_SMALL_INTEGERS)
+    for (size_t i = 0; i < PCA_TABLESIZE(heap->v_ints); i++) {
+        free(heap->v_ints[i]);
+    }
+#endif
+
+#if USE(SLAB_FOR_VARIANTS)
+    /* release all slab pages in one pass */
+    pcvariant_slab_cleanup(heap);
+#endif
+
     free(heap);
     inst->variant_heap = NULL;
     inst->org_vrt_heap = NULL;
@@ -194,24 +254,20 @@ static int _init_instance(struct pcinst *curr_inst,
     inst->variant_heap->v_undefined.type = PURC_VARIANT_TYPE_UNDEFINED;
     inst->variant_heap->v_undefined.refc = 0;
     inst->variant_heap->v_undefined.flags = PCVARIANT_FLAG_NOFREE;
-    // INIT_LIST_HEAD(&inst->variant_heap->v_undefined.listeners);
 
     inst->variant_heap->v_null.type = PURC_VARIANT_TYPE_NULL;
     inst->variant_heap->v_null.refc = 0;
     inst->variant_heap->v_null.flags = PCVARIANT_FLAG_NOFREE;
-    // INIT_LIST_HEAD(&inst->variant_heap->v_null.listeners);
 
     inst->variant_heap->v_false.type = PURC_VARIANT_TYPE_BOOLEAN;
     inst->variant_heap->v_false.refc = 0;
     inst->variant_heap->v_false.flags = PCVARIANT_FLAG_NOFREE;
     inst->variant_heap->v_false.b = false;
-    // INIT_LIST_HEAD(&inst->variant_heap->v_false.listeners);
 
     inst->variant_heap->v_true.type = PURC_VARIANT_TYPE_BOOLEAN;
     inst->variant_heap->v_true.refc = 0;
     inst->variant_heap->v_true.flags = PCVARIANT_FLAG_NOFREE;
     inst->variant_heap->v_true.b = true;
-    // INIT_LIST_HEAD(&inst->variant_heap->v_true.listeners);
 
     /* XXX: there are two values of boolean.  */
     struct purc_variant_stat *stat = &(inst->variant_heap->stat);
@@ -231,6 +287,10 @@ static int _init_instance(struct pcinst *curr_inst,
     INIT_LIST_HEAD(&inst->variant_heap->v_reserved);
 #endif
 
+#if USE(SLAB_FOR_VARIANTS)
+    pcvariant_slab_init(inst->variant_heap);
+#endif
+
     return PURC_ERROR_OK;
 }
 
@@ -344,13 +404,30 @@ purc_variant_t purc_variant_ref (purc_variant_t value)
         return PURC_VARIANT_INVALID;
     }
 
-    value->refc++;
+    /* the frozen variants are referenced by all instances */
+    if (value->flags & PCVARIANT_FLAG_FROZEN)
+        atomic_fetch_add_explicit((atomic_uint *)&value->refc, 1,
+                memory_order_relaxed);
+    else
+        value->refc++;
 
     referenced(value);
 
     return value;
 }
 
+static void
+release_variant(purc_variant_t value)
+{
+    // release the extra memory used by the variant
+    pcvariant_release_fn release_fn = variant_releasers[value->type];
+    if (release_fn)
+        release_fn(value);
+
+    // release the variant itself
+    pcvariant_put(value);
+}
+
 unsigned int purc_variant_unref(purc_variant_t value)
 {
     PC_ASSERT(value);
@@ -364,17 +441,22 @@ unsigned int purc_variant_unref(purc_variant_t value)
     // FIXME: pre or post?
     unreferenced(value);
 
+    if (value->flags & PCVARIANT_FLAG_FROZEN) {
+        unsigned int refc = atomic_fetch_sub_explicit(
+                (atomic_uint *)&value->refc, 1, memory_order_acq_rel) - 1;
+        if (refc == 0 && !(value->flags & PCVARIANT_FLAG_NOFREE)) {
+            struct pcvariant_heap *heap = pcvariant_use_frozen_heap();
+            release_variant(value);
+            pcvariant_restore_heap(heap);
+        }
+        return refc;
+    }
+
     value->refc--;
 
     // VWNOTE: only non-constant values has a releaser
     if (value->refc == 0 && !(value->flags & PCVARIANT_FLAG_NOFREE)) {
-        // release the extra memory used by the variant
-        pcvariant_release_fn release_fn = variant_releasers[value->type];
-        if (release_fn)
-            release_fn(value);
-
-        // release the variant itself
-        pcvariant_put(value);
+        release_variant(value);
         return 0;
     }
 
@@ -398,6 +480,10 @@ const struct purc_variant_stat *purc_variant_usage_stat(void)
     value = &(inst->variant_heap->v_false);
     inst->variant_heap->stat.nr_values[PURC_VARIANT_TYPE_BOOLEAN] += value->refc;
 
+#if USE(SLAB_FOR_VARIANTS)
+    pcvariant_slab_stat(inst->variant_heap, &inst->variant_heap->stat);
+#endif
+
     return &inst->variant_heap->stat;
 }
 
@@ -422,6 +508,72 @@ void pcvariant_stat_set_extra_size(purc_variant_t value, size_t extra_size)
     }
 }
 
+purc_variant_t pcvariant_get_shared_int(enum purc_variant_type type,
+        int64_t i)
+{
+#if USE(SHARED_SMALL_INTEGERS)
+    if (i < PCVARIANT_MIN_SHARED_INT || i > PCVARIANT_MAX_SHARED_INT)
+        return PURC_VARIANT_INVALID;
+
+    int slot;
+    switch (type) {
+    case PURC_VARIANT_TYPE_NUMBER:
+        slot = 0;
+        break;
+    case PURC_VARIANT_TYPE_LONGINT:
+        slot = 1;
+        break;
+    case PURC_VARIANT_TYPE_ULONGINT:
+        if (i < 0)
+            return PURC_VARIANT_INVALID;
+        slot = 2;
+        break;
+    default:
+        return PURC_VARIANT_INVALID;
+    }
+
+    /* VWNOTE: the values in the move heap are never shared,
+       because they will be moved to other instances. */
+    struct pcinst *instance = pcinst_current();
+    struct pcvariant_heap *heap = instance->variant_heap;
+    if (heap != instance->org_vrt_heap)
+        return PURC_VARIANT_INVALID;
+
+    if (heap->v_ints[slot] == NULL) {
+        purc_variant_t ints = calloc(PCVARIANT_NR_SHARED_INTS,
+                sizeof(purc_variant));
+        if (ints == NULL)
+            return PURC_VARIANT_INVALID;
+
+        for (int n = 0; n < PCVARIANT_NR_SHARED_INTS; n++) {
+            int64_t v = PCVARIANT_MIN_SHARED_INT + n;
+            ints[n].type = type;
+            ints[n].flags = PCVARIANT_FLAG_NOFREE;
+            if (type == PURC_VARIANT_TYPE_NUMBER) {
+                ints[n].d = (double)v;
+            }
+            else if (type == PURC_VARIANT_TYPE_LONGINT) {
+                ints[n].size = 8;   // see purc_variant_make_longint()
+                ints[n].i64 = v;
+            }
+            else {
+                ints[n].u64 = (uint64_t)v;
+            }
+        }
+
+        heap->v_ints[slot] = ints;
+    }
+
+    purc_variant_t value = heap->v_ints[slot] + (i - PCVARIANT_MIN_SHARED_INT);
+    value->refc++;
+    return value;
+#else
+    UNUSED_PARAM(type);
+    UNUSED_PARAM(i);
+    return PURC_VARIANT_INVALID;
+#endif
+}
+
 purc_variant_t pcvariant_get(enum purc_variant_type type)
 {
     purc_variant_t value = NULL;
@@ -432,7 +584,7 @@ purc_variant_t pcvariant_get(enum purc_variant_type type)
 #if USE(LOOP_BUFFER_FOR_RESERVED)
     if (heap->headpos == heap->tailpos) {
         // no reserved, allocate one
-        value = pcvariant_alloc_0();
+        value = heap_alloc_0(heap);
         if (value == NULL)
             return PURC_VARIANT_INVALID;
 
@@ -453,7 +605,7 @@ purc_variant_t pcvariant_get(enum purc_variant_type type)
 #else
     if (list_empty(&heap->v_reserved)) {
         // no reserved, allocate one
-        value = pcvariant_alloc_0();
+        value = heap_alloc_0(heap);
         if (value == NULL)
             return PURC_VARIANT_INVALID;
 
@@ -462,9 +614,9 @@ purc_variant_t pcvariant_get(enum purc_variant_type type)
     }
     else {
         value = list_first_entry(&heap->v_reserved, purc_variant, reserved);
-        value->sz_ptr[0] = 0;
-
+        // the list node shares the value union with sz_ptr
         list_del(&value->reserved);
+        value->sz_ptr[0] = 0;
 
         /* VWNOTE: do not forget to set nr_reserved. */
         stat->nr_reserved--;
@@ -475,9 +627,6 @@ purc_variant_t pcvariant_get(enum purc_variant_type type)
     stat->nr_values[type]++;
     stat->nr_total_values++;
 
-    // init listeners
-    INIT_LIST_HEAD(&value->listeners);
-
     return value;
 }
 
@@ -488,8 +637,8 @@ void pcvariant_put(purc_variant_t value)
     struct purc_variant_stat *stat = &(heap->stat);
 
     PC_ASSERT(value);
-    if (IS_CONTAINER(value->type)) {
-        PC_ASSERT(list_empty(&value->listeners));
+    if (value->flags & PCVARIANT_FLAG_LISTENED) {
+        pcvariant_drop_listeners(value);
     }
 
     // set stat information
@@ -501,7 +650,7 @@ void pcvariant_put(purc_variant_t value)
         stat->sz_mem[value->type] -= sizeof(purc_variant);
         stat->sz_total_mem -= sizeof(purc_variant);
 
-        pcvariant_free(value);
+        heap_free(heap, value);
     }
     else {
         heap->v_reserved[heap->headpos] = value;
@@ -515,7 +664,7 @@ void pcvariant_put(purc_variant_t value)
         stat->sz_mem[value->type] -= sizeof(purc_variant);
         stat->sz_total_mem -= sizeof(purc_variant);
 
-        pcvariant_free(value);
+        heap_free(heap, value);
     }
     else {
         list_add_tail(&value->reserved, &heap->v_reserved);
@@ -1633,6 +1782,11 @@ ret:
 purc_variant_t purc_variant_make_from_json_string(const char* json, size_t sz)
 {
     purc_variant_t value;
+
+    value = pcejson_parse_json(json, sz, PCEJSON_DEFAULT_DEPTH);
+    if (value != PURC_VARIANT_INVALID)
+        return value;
+
     purc_rwstream_t rwstream = purc_rwstream_new_from_mem((void*)json, sz);
     if (rwstream == NULL)
         return PURC_VARIANT_INVALID;
@@ -2253,6 +2407,23 @@ stringify_kv(struct stringify_arg *arg, const char *key, purc_variant_t val)
 static void
 stringify_object(struct stringify_arg *arg, purc_variant_t value)
 {
+    /* Stringify the members in the order of keys, so that the result
+       does not depend on the order of insertion. */
+    struct obj_kv *buf[PCVAR_OBJ_NR_KVS_ON_STACK];
+    struct obj_kv **kvs;
+    kvs = pcvar_obj_sorted_kvs(value, buf, PCVAR_OBJ_NR_KVS_ON_STACK);
+    if (kvs) {
+        variant_obj_t data = pcvar_obj_get_data(value);
+        for (size_t i = 0; i < data->size; i++) {
+            const char *sk = purc_variant_get_string_const(kvs[i]->key);
+            stringify_kv(arg, sk, kvs[i]->val);
+        }
+
+        if (kvs != buf)
+            free(kvs);
+        return;
+    }
+
     purc_variant_t k, v;
     foreach_key_value_in_variant_object(value, k, v)
         const char *sk = purc_variant_get_string_const(k);
@@ -2594,12 +2765,17 @@ char* pcvariant_serialize_alloc(char *buf, size_t sz, purc_variant_t val)
 
 char* pcvariant_to_string(purc_variant_t v)
 {
-    purc_rwstream_t rws = purc_rwstream_new_buffer(PRINT_MIN_BUFFER,
-            PRINT_MAX_BUFFER);
+    unsigned int flags = PCVARIANT_SERIALIZE_OPT_PLAIN |
+        PCVARIANT_SERIALIZE_OPT_UNIQKEYS;
+    size_t sz_init = pcvariant_serialize_size_hint(v, flags);
+    if (sz_init < PRINT_MIN_BUFFER)
+        sz_init = PRINT_MIN_BUFFER;
+    else if (sz_init > PRINT_MAX_BUFFER)
+        sz_init = PRINT_MAX_BUFFER;
+
+    purc_rwstream_t rws = purc_rwstream_new_buffer(sz_init, PRINT_MAX_BUFFER);
     size_t len = 0;
-    purc_variant_serialize(v, rws, 0,
-            PCVARIANT_SERIALIZE_OPT_PLAIN | PCVARIANT_SERIALIZE_OPT_UNIQKEYS,
-            &len);
+    purc_variant_serialize(v, rws, 0, flags, &len);
     purc_rwstream_write(rws, "", 1);
     char* buf = (char*)purc_rwstream_get_mem_buffer_ex(rws,
             NULL, NULL, true);
@@ -2848,19 +3024,22 @@ cmp_by_obj(purc_variant_t l, purc_variant_t r,
     rd = (variant_obj_t)r->sz_ptr[1];
     PC_ASSERT(ld);
     PC_ASSERT(rd);
-    struct rb_root *lroot = &ld->kvs;
-    struct rb_root *rroot = &rd->kvs;
-    struct rb_node *lnode = pcutils_rbtree_first(lroot);
-    struct rb_node *rnode = pcutils_rbtree_first(rroot);
-    for (;
-        lnode && rnode;
-        lnode = pcutils_rbtree_next(lnode), rnode = pcutils_rbtree_next(rnode))
-    {
-        struct obj_node *lo, *ro;
-        lo = container_of(lnode, struct obj_node, node);
-        ro = container_of(rnode, struct obj_node, node);
-        PC_ASSERT(lo->key);
-        PC_ASSERT(ro->key);
+
+    // compare the members in the order of keys
+    struct obj_kv *lbuf[PCVAR_OBJ_NR_KVS_ON_STACK];
+    struct obj_kv *rbuf[PCVAR_OBJ_NR_KVS_ON_STACK];
+    struct obj_kv **lkvs, **rkvs;
+    lkvs = pcvar_obj_sorted_kvs(l, lbuf, PCVAR_OBJ_NR_KVS_ON_STACK);
+    rkvs = pcvar_obj_sorted_kvs(r, rbuf, PCVAR_OBJ_NR_KVS_ON_STACK);
+    if (lkvs == NULL || rkvs == NULL) {
+        // out of memory: fall back to compare the sizes only.
+        diff = (ld->size > rd->size) - (ld->size < rd->size);
+        goto done;
+    }
+
+    size_t i;
+    for (i = 0; i < ld->size && i < rd->size; i++) {
+        struct obj_kv *lo = lkvs[i], *ro = rkvs[i];
         const char *lk = purc_variant_get_string_const(lo->key);
         const char *rk = purc_variant_get_string_const(ro->key);
         PC_ASSERT(lk);
@@ -2869,7 +3048,7 @@ cmp_by_obj(purc_variant_t l, purc_variant_t r,
         // NOTE: ignore caseless for keyname
         diff = strcmp(lk, rk);
         if (diff)
-            return diff;
+            goto done;
 
         purc_variant_t lv = lo->val;
         purc_variant_t rv = ro->val;
@@ -2878,15 +3057,22 @@ cmp_by_obj(purc_variant_t l, purc_variant_t r,
 
         diff = pcvar_compare_ex(lv, rv, caseless, unify_number);
         if (diff)
-            return diff;
+            goto done;
     }
 
-    if (lnode)
-        return 1;
-    else if (rnode)
-        return -1;
+    if (i < ld->size)
+        diff = 1;
+    else if (i < rd->size)
+        diff = -1;
     else
-        return 0;
+        diff = 0;
+
+done:
+    if (lkvs && lkvs != lbuf)
+        free(lkvs);
+    if (rkvs && rkvs != rbuf)
+        free(rkvs);
+    return diff;
 }
 
 static int
@@ -2901,23 +3087,10 @@ cmp_by_arr(purc_variant_t l, purc_variant_t r,
     PC_ASSERT(ld);
     PC_ASSERT(rd);
 
-    struct pcutils_array_list *la = &ld->al;
-    struct pcutils_array_list *ra = &rd->al;
-
-    struct pcutils_array_list_node *lnode = pcutils_array_list_get_first(la);
-    struct pcutils_array_list_node *rnode = pcutils_array_list_get_first(ra);
-
-    for (;
-        lnode && rnode;
-        lnode = pcutils_array_list_get(la, lnode->idx + 1),
-        rnode = pcutils_array_list_get(ra, rnode->idx + 1))
-    {
-        struct arr_node *lo, *ro;
-        lo = container_of(lnode, struct arr_node, node);
-        ro = container_of(rnode, struct arr_node, node);
-
-        purc_variant_t lv = lo->val;
-        purc_variant_t rv = ro->val;
+    size_t i;
+    for (i = 0; i < ld->nr && i < rd->nr; i++) {
+        purc_variant_t lv = ld->vals[i];
+        purc_variant_t rv = rd->vals[i];
         PC_ASSERT(lv != PURC_VARIANT_INVALID);
         PC_ASSERT(rv != PURC_VARIANT_INVALID);
 
@@ -2926,9 +3099,9 @@ cmp_by_arr(purc_variant_t l, purc_variant_t r,
             return diff;
     }
 
-    if (lnode)
+    if (i < ld->nr)
         return 1;
-    else if (rnode)
+    else if (i < rd->nr)
         return -1;
     else
         return 0;
@@ -2940,26 +3113,13 @@ cmp_by_set(purc_variant_t l, purc_variant_t r,
 {
     int diff;
 
-    variant_set_t ld, rd;
-    ld = (variant_set_t)l->sz_ptr[1];
-    rd = (variant_set_t)r->sz_ptr[1];
-    PC_ASSERT(ld);
-    PC_ASSERT(rd);
+    size_t lnr, rnr;
+    struct set_node **lnodes = pcvar_set_ordered_nodes(l, &lnr);
+    struct set_node **rnodes = pcvar_set_ordered_nodes(r, &rnr);
 
-    struct rb_root *lroot = &ld->elems;
-    struct rb_root *rroot = &rd->elems;
-    struct rb_node *lnode = pcutils_rbtree_first(lroot);
-    struct rb_node *rnode = pcutils_rbtree_first(rroot);
-    for (;
-        lnode && rnode;
-        lnode = pcutils_rbtree_next(lnode), rnode = pcutils_rbtree_next(rnode))
-    {
-        struct set_node *lo, *ro;
-        lo = container_of(lnode, struct set_node, rbnode);
-        ro = container_of(rnode, struct set_node, rbnode);
-
-        purc_variant_t lv = lo->val;
-        purc_variant_t rv = ro->val;
+    for (size_t i = 0; i < lnr && i < rnr; i++) {
+        purc_variant_t lv = lnodes[i]->val;
+        purc_variant_t rv = rnodes[i]->val;
         PC_ASSERT(lv != PURC_VARIANT_INVALID);
         PC_ASSERT(rv != PURC_VARIANT_INVALID);
 
@@ -2968,9 +3128,9 @@ cmp_by_set(purc_variant_t l, purc_variant_t r,
             return diff;
     }
 
-    if (lnode)
+    if (lnr > rnr)
         return 1;
-    else if (rnode)
+    else if (lnr < rnr)
         return -1;
     else
         return 0;
@@ -3401,7 +3561,10 @@ pcvar_compare_ex(purc_variant_t l, purc_variant_t r,
         PC_ASSERT(!isnan(ldl) && !isinf(ldl));
         PC_ASSERT(!isnan(ldr) && !isinf(ldr));
 
-        if (equal_long_doubles(ldl, ldr))
+        /* The numbers are compared exactly rather than with an epsilon,
+           so that the equal numbers always have the same hash value;
+           see pcvariant_hash64(). */
+        if (ldl == ldr)
             return 0;
 
         if (ldl < ldr)
@@ -3488,7 +3651,7 @@ pcvar_compare_ex(purc_variant_t l, purc_variant_t r,
         case PURC_VARIANT_TYPE_DYNAMIC:
         case PURC_VARIANT_TYPE_NATIVE:
             // NOTE: compare by addresses
-            return memcmp(l->ptr_ptr, r->ptr_ptr, sizeof(void *) * 2) == 0;
+            return memcmp(l->ptr_ptr, r->ptr_ptr, sizeof(void *) * 2);
 
         case PURC_VARIANT_TYPE_OBJECT:
             return cmp_by_obj(l, r, caseless, unify_number);
@@ -3608,108 +3771,228 @@ void pcvariant_md5_ex(char *md5, purc_variant_t val, const char *salt,
     pcutils_bin2hex(md5_digest, MD5_DIGEST_SIZE, md5, uppercase);
 }
 
-void
-pcvariant_md5_by_set(char *md5, purc_variant_t val, purc_variant_t set)
+/* The finalizer of MurmurHash3 */
+static inline uint64_t
+hash64_fmix(uint64_t h)
 {
-    PC_ASSERT(md5);
-    PC_ASSERT(val != PURC_VARIANT_INVALID);
-    PC_ASSERT(set != PURC_VARIANT_INVALID);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
 
-    variant_set_t data = pcvar_set_get_data(set);
-    PC_ASSERT(data);
+static inline uint64_t
+hash64_combine(uint64_t h, uint64_t v)
+{
+    return hash64_fmix(h ^ (v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2)));
+}
 
-    if (data->unique_key == NULL) {
-        pcvariant_md5(md5, val);
-        return;
+/* FNV-1a; ASCII letters are folded if `caseless` is true */
+static uint64_t
+hash64_bytes(const unsigned char *bytes, size_t len, bool caseless)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = bytes[i];
+        if (caseless && c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+        h = (h ^ c) * 0x100000001b3ULL;
     }
 
-    purc_variant_t undefined = purc_variant_make_undefined();
-    PC_ASSERT(undefined);
+    return h;
+}
 
-    if (val->type != PVT(_OBJECT)) {
-        pcvariant_md5(md5, undefined);
-        purc_variant_unref(undefined);
-        return;
+static uint64_t
+hash64_string(purc_variant_t str, bool caseless)
+{
+    if (!caseless)
+        return hash64_fmix(pcvariant_string_hash(str));
+
+    const char *s = purc_variant_get_string_const(str);
+    size_t len = strlen(s);
+    for (size_t i = 0; i < len; i++) {
+        if ((unsigned char)s[i] >= 0x80) {
+            /* fold the non-ASCII characters in the same way as
+               pcutils_strcasecmp() does. */
+            size_t len_new;
+            char *lower = pcutils_strtolower(s, len, &len_new);
+            if (lower == NULL)
+                break;
+            uint64_t h = hash64_bytes((const unsigned char *)lower,
+                    len_new, false);
+            free(lower);
+            return h;
+        }
     }
 
-    pcutils_md5_ctxt ud;
+    return hash64_bytes((const unsigned char *)s, len, true);
+}
 
-    pcutils_md5_begin(&ud);
+/* The hash values of the numbers are calculated from the values casted
+   to double, for the numbers of different types are unified when
+   comparing. */
+static uint64_t
+hash64_number(purc_variant_t num)
+{
+    long double ld = 0;
+    purc_variant_cast_to_longdouble(num, &ld, false);
 
-    struct stringify_arg arg;
-    arg.cb    = do_stringify_md5;
-    arg.arg   = &ud;
-    arg.flags = 0;
+    double d = (double)ld;
+    if (d == 0)
+        d = 0;  // -0.0 and 0.0 are equal
 
-    for (size_t i=0; i<data->nr_keynames; ++i) {
-        purc_variant_t v;
-        v = purc_variant_object_get_by_ckey(val, data->keynames[i]);
-        if (v == PURC_VARIANT_INVALID) {
-            v = undefined;
-        }
-        stringify_kv(&arg, data->keynames[i], v);
-    }
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    return hash64_fmix(bits);
+}
 
-    unsigned char md5_digest[MD5_DIGEST_SIZE];
-    pcutils_md5_end(&ud, md5_digest);
+uint64_t
+pcvariant_hash64(purc_variant_t val, bool caseless)
+{
+    PC_ASSERT(val != PURC_VARIANT_INVALID);
 
-    bool uppercase = true;
-    pcutils_bin2hex(md5_digest, MD5_DIGEST_SIZE, md5, uppercase);
+    uint64_t h = (uint64_t)val->type;
+    uint64_t sum;
+    const unsigned char *bytes;
+    size_t nr_bytes;
+    purc_variant_t k, v;
+    size_t idx;
+
+    switch (val->type) {
+        case PURC_VARIANT_TYPE_UNDEFINED:
+        case PURC_VARIANT_TYPE_NULL:
+            break;
+
+        case PURC_VARIANT_TYPE_BOOLEAN:
+            h = hash64_combine(h, val->b);
+            break;
+
+        case PURC_VARIANT_TYPE_EXCEPTION:
+        case PURC_VARIANT_TYPE_ATOMSTRING:
+            h = hash64_combine(h, val->atom);
+            break;
+
+        case PURC_VARIANT_TYPE_NUMBER:
+        case PURC_VARIANT_TYPE_LONGINT:
+        case PURC_VARIANT_TYPE_ULONGINT:
+        case PURC_VARIANT_TYPE_LONGDOUBLE:
+            h = hash64_combine(PURC_VARIANT_TYPE_NUMBER, hash64_number(val));
+            break;
+
+        case PURC_VARIANT_TYPE_STRING:
+            h = hash64_combine(h, hash64_string(val, caseless));
+            break;
+
+        case PURC_VARIANT_TYPE_BSEQUENCE:
+            bytes = purc_variant_get_bytes_const(val, &nr_bytes);
+            h = hash64_combine(h, hash64_bytes(bytes, nr_bytes, false));
+            break;
+
+        case PURC_VARIANT_TYPE_DYNAMIC:
+        case PURC_VARIANT_TYPE_NATIVE:
+            h = hash64_combine(h, (uint64_t)(uintptr_t)val->ptr_ptr[0]);
+            h = hash64_combine(h, (uint64_t)(uintptr_t)val->ptr_ptr[1]);
+            break;
+
+        case PURC_VARIANT_TYPE_OBJECT:
+            /* the members are compared in the order of keys, so the hash
+               values of the members are summed up. */
+            sum = 0;
+            foreach_key_value_in_variant_object(val, k, v)
+                sum += hash64_combine(hash64_string(k, false),
+                        pcvariant_hash64(v, caseless));
+            end_foreach;
+            h = hash64_combine(h, sum);
+            break;
+
+        case PURC_VARIANT_TYPE_ARRAY:
+            foreach_value_in_variant_array(val, v, idx)
+                (void)idx;
+                h = hash64_combine(h, pcvariant_hash64(v, caseless));
+            end_foreach;
+            break;
+
+        case PURC_VARIANT_TYPE_SET:
+            sum = 0;
+            foreach_value_in_variant_set(val, v)
+                sum += pcvariant_hash64(v, caseless);
+            end_foreach;
+            h = hash64_combine(h, sum);
+            break;
+
+        case PURC_VARIANT_TYPE_TUPLE: {
+            size_t sz;
+            purc_variant_t *members = tuple_members(val, &sz);
+            for (size_t i = 0; i < sz; i++)
+                h = hash64_combine(h, pcvariant_hash64(members[i], caseless));
+            break;
+        }
+
+        default:
+            PC_ASSERT(0);
+            break;
+    }
 
-    purc_variant_unref(undefined);
+    return h;
 }
 
-int
-pcvariant_diff_by_set(const char *md5l, purc_variant_t l,
-        const char *md5r, purc_variant_t r, purc_variant_t set)
+static inline uint64_t
+hash64_key_value(uint64_t h, purc_variant_t v, bool caseless)
 {
-    // TODO: https://gitlab.fmsoft.cn/hvml/hvml-docs/-/blob/master/zh/hvml-spec-v1.0-zh.md#21610-%E9%9B%86%E5%90%88%E5%8F%98%E9%87%8F
+    // a missing key is taken as undefined
+    if (v == PURC_VARIANT_INVALID)
+        return hash64_combine(h, PURC_VARIANT_TYPE_UNDEFINED);
 
-    PC_ASSERT(md5l);
-    PC_ASSERT(l != PURC_VARIANT_INVALID);
-    PC_ASSERT(md5r);
-    PC_ASSERT(r != PURC_VARIANT_INVALID);
+    return hash64_combine(h, pcvariant_hash64(v, caseless));
+}
 
+uint64_t
+pcvariant_hash64_by_set(purc_variant_t val, purc_variant_t set)
+{
+    PC_ASSERT(val != PURC_VARIANT_INVALID);
     PC_ASSERT(set != PURC_VARIANT_INVALID);
 
-    int diff;
-
     variant_set_t data = pcvar_set_get_data(set);
     PC_ASSERT(data);
 
-    if (data->unique_key == NULL) {
-        return pcvariant_diff(l, r);
-    }
+    if (data->unique_key == NULL)
+        return pcvariant_hash64(val, data->caseless);
 
-    diff = strcmp(md5l, md5r);
-    if (diff)
-        return diff;
+    uint64_t h = PURC_VARIANT_TYPE_SET;
+    for (size_t i=0; i<data->nr_keynames; ++i) {
+        purc_variant_t v = PURC_VARIANT_INVALID;
+        if (val->type == PVT(_OBJECT)) {
+            v = purc_variant_object_get_by_ckey(val, data->keynames[i]);
+            if (v == PURC_VARIANT_INVALID)
+                purc_clr_error();
+        }
 
-    purc_variant_t undefined = purc_variant_make_undefined();
-    PC_ASSERT(undefined);
+        h = hash64_key_value(h, v, data->caseless);
+    }
 
-    for (size_t i=0; i<data->nr_keynames; ++i) {
-        purc_variant_t vl = PURC_VARIANT_INVALID;
-        purc_variant_t vr = PURC_VARIANT_INVALID;
+    return h;
+}
 
-        if (l->type == PVT(_OBJECT))
-            vl = purc_variant_object_get_by_ckey(l, data->keynames[i]);
-        if (r->type == PVT(_OBJECT))
-            vr = purc_variant_object_get_by_ckey(r, data->keynames[i]);
+uint64_t
+pcvariant_hash64_by_key_values(purc_variant_t set, purc_variant_t *kvs)
+{
+    PC_ASSERT(set != PURC_VARIANT_INVALID);
 
-        if (vl == PURC_VARIANT_INVALID)
-            vl = undefined;
-        if (vr == PURC_VARIANT_INVALID)
-            vr = undefined;
+    variant_set_t data = pcvar_set_get_data(set);
+    PC_ASSERT(data && data->unique_key);
 
-        diff = pcvariant_diff(vl, vr);
-        if (diff)
-            break;
-    }
+    uint64_t h = PURC_VARIANT_TYPE_SET;
+    for (size_t i=0; i<data->nr_keynames; ++i) {
+        purc_variant_t v = kvs[i];
+        if (v->type == PURC_VARIANT_TYPE_UNDEFINED)
+            v = PURC_VARIANT_INVALID;
 
-    purc_variant_unref(undefined);
+        h = hash64_key_value(h, v, data->caseless);
+    }
 
-    return diff;
+    return h;
 }
 
 bool pcvariant_is_scalar(purc_variant_t v)
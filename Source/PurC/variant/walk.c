@@ -24,6 +24,8 @@
 
 #include "variant-internals.h"
 
+#include <stdlib.h>
+
 static int
 parallel_walk(purc_variant_t l, purc_variant_t r, void *ctxt,
         int (*cb)(purc_variant_t l, purc_variant_t r, void *ctxt));
@@ -32,30 +34,45 @@ static int
 obj_parallel_walk(purc_variant_t l, purc_variant_t r, void *ctxt,
         int (*cb)(purc_variant_t l, purc_variant_t r, void *ctxt))
 {
-    struct obj_iterator lit, rit;
-    lit = pcvar_obj_it_first(l);
-    rit = pcvar_obj_it_first(r);
-
-    while (lit.curr && rit.curr) {
-        int r = cb(lit.curr->key, rit.curr->key, ctxt);
-        if (r)
-            return r;
+    // walk the members in the order of keys, not the order of insertion.
+    struct obj_kv *lbuf[PCVAR_OBJ_NR_KVS_ON_STACK];
+    struct obj_kv *rbuf[PCVAR_OBJ_NR_KVS_ON_STACK];
+    struct obj_kv **lkvs, **rkvs;
+    size_t nl, nr;
+
+    purc_variant_object_size(l, &nl);
+    purc_variant_object_size(r, &nr);
+    lkvs = pcvar_obj_sorted_kvs(l, lbuf, PCVAR_OBJ_NR_KVS_ON_STACK);
+    rkvs = pcvar_obj_sorted_kvs(r, rbuf, PCVAR_OBJ_NR_KVS_ON_STACK);
+
+    int ret = 0;
+    if (lkvs == NULL || rkvs == NULL) {
+        ret = -1;
+        goto done;
+    }
 
-        r = parallel_walk(lit.curr->val, rit.curr->val, ctxt, cb);
-        if (r)
-            return r;
+    size_t i;
+    for (i = 0; i < nl && i < nr; i++) {
+        ret = cb(lkvs[i]->key, rkvs[i]->key, ctxt);
+        if (ret)
+            goto done;
 
-        pcvar_obj_it_next(&lit);
-        pcvar_obj_it_next(&rit);
+        ret = parallel_walk(lkvs[i]->val, rkvs[i]->val, ctxt, cb);
+        if (ret)
+            goto done;
     }
 
-    if (lit.curr == NULL && rit.curr == NULL)
-        return 0;
-
-    if (lit.curr)
-        return parallel_walk(lit.curr->val, PURC_VARIANT_INVALID, ctxt, cb);
-    else
-        return parallel_walk(PURC_VARIANT_INVALID, rit.curr->val, ctxt, cb);
+    if (i < nl)
+        ret = parallel_walk(lkvs[i]->val, PURC_VARIANT_INVALID, ctxt, cb);
+    else if (i < nr)
+        ret = parallel_walk(PURC_VARIANT_INVALID, rkvs[i]->val, ctxt, cb);
+
+done:
+    if (lkvs && lkvs != lbuf)
+        free(lkvs);
+    if (rkvs && rkvs != rbuf)
+        free(rkvs);
+    return ret;
 }
 
 static int
@@ -67,7 +84,7 @@ arr_parallel_walk(purc_variant_t l, purc_variant_t r, void *ctxt,
     rit = pcvar_arr_it_first(r);
 
     while (lit.curr && rit.curr) {
-        int r = parallel_walk(lit.curr->val, rit.curr->val, ctxt, cb);
+        int r = parallel_walk(lit.curr, rit.curr, ctxt, cb);
         if (r)
             return r;
 
@@ -79,16 +96,16 @@ arr_parallel_walk(purc_variant_t l, purc_variant_t r, void *ctxt,
         return 0;
 
     if (lit.curr)
-        return parallel_walk(lit.curr->val, PURC_VARIANT_INVALID, ctxt, cb);
+        return parallel_walk(lit.curr, PURC_VARIANT_INVALID, ctxt, cb);
     else
-        return parallel_walk(PURC_VARIANT_INVALID, rit.curr->val, ctxt, cb);
+        return parallel_walk(PURC_VARIANT_INVALID, rit.curr, ctxt, cb);
 }
 
 static int
 set_parallel_walk(purc_variant_t l, purc_variant_t r, void *ctxt,
         int (*cb)(purc_variant_t l, purc_variant_t r, void *ctxt))
 {
-    enum set_it_type it_type = SET_IT_RBTREE;
+    enum set_it_type it_type = SET_IT_ORDER;
 
     struct set_iterator lit, rit;
     lit = pcvar_set_it_first(l, it_type);
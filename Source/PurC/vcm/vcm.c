@@ -32,10 +32,19 @@
 #include "purc-errors.h"
 #include "purc-rwstream.h"
 #include "private/errors.h"
+#include "private/instance.h"
+#include "private/variant.h"
 #include "private/vcm.h"
 #include "private/stack.h"
 #include "private/interpreter.h"
 #include "private/utils.h"
+#include "private/map.h"
+
+#if HAVE(STDATOMIC_H)           /* { */
+#include <stdatomic.h>
+#else                           /* }{ */
+#error "Not implemented for this platform."
+#endif                          /* } */
 
 #define TREE_NODE(node)              ((struct pctree_node*)(node))
 #define VCM_NODE(node)               ((struct pcvcm_node*)(node))
@@ -69,8 +78,32 @@ void pcvcm_node_serialize_to_rwstream(purc_rwstream_t rws,
 struct pcvcm_node_op {
     cb_find_var find_var;
     void *find_var_ctxt;
+    struct pcvcm_consts *consts;
+    /* the stack for the variable references resolved, if not NULL */
+    struct pcintr_stack *stack;
+};
+
+/* the cache is cleared once it is full, for the values of the nodes
+   destroyed are never used again */
+#define MAX_CACHED_CONSTS    4096
+
+/* the same for the states of the compiled codes */
+#define MAX_CODE_STATES      1024
+
+struct pcvcm_consts {
+    pcutils_map *values;    // key: const_id, val: purc_variant_t
+    pcutils_map *codes;     // key: code id, val: struct pcvcm_code_state *
+    // the nesting level of the codes being evaluated
+    unsigned int nr_running;
 };
 
+/* the identifiers of the folded subtrees and the compiled codes are unique
+   in the process, since a vdom can be shared by the instances */
+static atomic_uintptr_t next_const_id = 1;
+static atomic_uintptr_t next_code_id = 1;
+
+static void free_code_state(void *val);
+
 // expression variable
 struct pcvcm_ev {
     struct pcvcm_node *vcm;
@@ -972,6 +1005,124 @@ void pcvcm_stack_destroy(struct pcvcm_stack *stack)
     free(stack);
 }
 
+static size_t
+fold_constants(struct pcvcm_node *node, size_t *nr_folded)
+{
+    bool constant;
+    switch (node->type) {
+        case PCVCM_NODE_TYPE_UNDEFINED:
+        case PCVCM_NODE_TYPE_OBJECT:
+        case PCVCM_NODE_TYPE_ARRAY:
+        case PCVCM_NODE_TYPE_STRING:
+        case PCVCM_NODE_TYPE_NULL:
+        case PCVCM_NODE_TYPE_BOOLEAN:
+        case PCVCM_NODE_TYPE_NUMBER:
+        case PCVCM_NODE_TYPE_LONG_INT:
+        case PCVCM_NODE_TYPE_ULONG_INT:
+        case PCVCM_NODE_TYPE_LONG_DOUBLE:
+        case PCVCM_NODE_TYPE_BYTE_SEQUENCE:
+        case PCVCM_NODE_TYPE_FUNC_CONCAT_STRING:
+            constant = true;
+            break;
+
+        default:
+            constant = false;
+            break;
+    }
+
+    size_t nr_nodes = 1;
+    size_t nr_folded_children = 0;
+    struct pcvcm_node *child = FIRST_CHILD(node);
+    while (child) {
+        size_t n = fold_constants(child, nr_folded);
+        if (n == 0) {
+            constant = false;
+        }
+        else if (child->const_id) {
+            nr_folded_children += n;
+        }
+        nr_nodes += n;
+        child = NEXT_CHILD(child);
+    }
+
+    if (!constant) {
+        return 0;
+    }
+
+    /* the scalars other than the strings are as cheap to make as to find */
+    if (nr_nodes == 1 && node->type != PCVCM_NODE_TYPE_STRING
+            && node->type != PCVCM_NODE_TYPE_BYTE_SEQUENCE) {
+        return nr_nodes;
+    }
+
+    /* fold the whole subtree instead of the children */
+    child = FIRST_CHILD(node);
+    while (child) {
+        child->const_id = 0;
+        child = NEXT_CHILD(child);
+    }
+
+    node->const_id = atomic_fetch_add(&next_const_id, 1);
+    *nr_folded = *nr_folded - nr_folded_children + nr_nodes;
+    return nr_nodes;
+}
+
+size_t pcvcm_node_fold_constants(struct pcvcm_node *root)
+{
+    size_t nr_folded = 0;
+    if (root) {
+        fold_constants(root, &nr_folded);
+    }
+    return nr_folded;
+}
+
+static void free_const_value(void *val)
+{
+    purc_variant_unref((purc_variant_t)val);
+}
+
+static int comp_const_id(const void *key1, const void *key2)
+{
+    uintptr_t id1 = (uintptr_t)key1;
+    uintptr_t id2 = (uintptr_t)key2;
+    return (id1 > id2) - (id1 < id2);
+}
+
+struct pcvcm_consts *pcvcm_consts_new(void)
+{
+    struct pcvcm_consts *consts = (struct pcvcm_consts*)calloc(1,
+            sizeof(struct pcvcm_consts));
+    if (!consts) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    consts->values = pcutils_map_create(NULL, NULL, NULL, free_const_value,
+            comp_const_id, false);
+    consts->codes = pcutils_map_create(NULL, NULL, NULL, free_code_state,
+            comp_const_id, false);
+    if (!consts->values || !consts->codes) {
+        if (consts->values)
+            pcutils_map_destroy(consts->values);
+        if (consts->codes)
+            pcutils_map_destroy(consts->codes);
+        free(consts);
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    return consts;
+}
+
+void pcvcm_consts_destroy(struct pcvcm_consts *consts)
+{
+    if (consts) {
+        pcutils_map_destroy(consts->values);
+        pcutils_map_destroy(consts->codes);
+        free(consts);
+    }
+}
+
 static
 purc_variant_t pcvcm_node_to_variant(struct pcvcm_node *node,
         struct pcvcm_node_op *ops, bool silently);
@@ -1055,33 +1206,22 @@ out_unref_array:
     return PURC_VARIANT_INVALID;
 }
 
-purc_variant_t pcvcm_node_concat_string_to_variant(struct pcvcm_node *node,
-       struct pcvcm_node_op *ops, bool silently)
+static void
+concat_string_append(purc_rwstream_t rws, purc_variant_t v)
 {
-    purc_rwstream_t rws = purc_rwstream_new_buffer(MIN_BUF_SIZE, MAX_BUF_SIZE);
-    if (!rws) {
-        return PURC_VARIANT_INVALID;
+    // FIXME: stringify or serialize
+    char *buf = NULL;
+    int total = purc_variant_stringify_alloc(&buf, v);
+    if (total) {
+        purc_rwstream_write(rws, buf, total);
     }
+    free(buf);
+}
 
+static purc_variant_t
+concat_string_end(purc_rwstream_t rws)
+{
     purc_variant_t ret_var = PURC_VARIANT_INVALID;
-    struct pcvcm_node *child = FIRST_CHILD(node);
-    while (child) {
-        purc_variant_t v = pcvcm_node_to_variant(child, ops, silently);
-        if (v == PURC_VARIANT_INVALID) {
-            goto out_destroy_rws;
-        }
-
-        // FIXME: stringify or serialize
-        char *buf = NULL;
-        int total = purc_variant_stringify_alloc(&buf, v);
-        if (total) {
-            purc_rwstream_write(rws, buf, total);
-        }
-        free(buf);
-        purc_variant_unref(v);
-
-        child = NEXT_CHILD(child);
-    }
 
     // do not forget tailing-null-terminator
     purc_rwstream_write(rws, "", 1);
@@ -1107,52 +1247,84 @@ purc_variant_t pcvcm_node_concat_string_to_variant(struct pcvcm_node *node,
         }
     }
 
-out_destroy_rws:
-    purc_rwstream_destroy(rws);
     return ret_var;
 }
 
-static
-purc_variant_t pcvcm_node_get_variable_to_variant(struct pcvcm_node *node,
+purc_variant_t pcvcm_node_concat_string_to_variant(struct pcvcm_node *node,
        struct pcvcm_node_op *ops, bool silently)
 {
-    purc_variant_t ret = PURC_VARIANT_INVALID;
-    if (!ops) {
-        goto out;
+    purc_rwstream_t rws = purc_rwstream_new_buffer(MIN_BUF_SIZE, MAX_BUF_SIZE);
+    if (!rws) {
+        return PURC_VARIANT_INVALID;
     }
 
-    struct pcvcm_node *name_node = FIRST_CHILD(node);
-    if (!name_node) {
-        goto out;
-    }
+    purc_variant_t ret_var = PURC_VARIANT_INVALID;
+    struct pcvcm_node *child = FIRST_CHILD(node);
+    while (child) {
+        purc_variant_t v = pcvcm_node_to_variant(child, ops, silently);
+        if (v == PURC_VARIANT_INVALID) {
+            goto out_destroy_rws;
+        }
 
-    purc_variant_t name_var = pcvcm_node_to_variant(name_node, ops,
-            silently);
-    if (name_var == PURC_VARIANT_INVALID) {
-        goto out;
+        concat_string_append(rws, v);
+        purc_variant_unref(v);
+
+        child = NEXT_CHILD(child);
     }
 
+    ret_var = concat_string_end(rws);
+
+out_destroy_rws:
+    purc_rwstream_destroy(rws);
+    return ret_var;
+}
+
+static purc_variant_t
+find_variable(struct pcvcm_node_op *ops, purc_variant_t name_var)
+{
     if (!purc_variant_is_string(name_var)) {
-        goto out_unref_name_var;
+        return PURC_VARIANT_INVALID;
     }
 
     const char *name = purc_variant_get_string_const(name_var);
     size_t nr_name = strlen(name);
     if (!name || nr_name == 0) {
-        goto out_unref_name_var;
+        return PURC_VARIANT_INVALID;
     }
 
     if(!ops->find_var) {
         pcinst_set_error(PCVARIANT_ERROR_NOT_FOUND);
-        goto out_unref_name_var;
+        return PURC_VARIANT_INVALID;
     }
 
-    ret = ops->find_var(ops->find_var_ctxt, name);
+    purc_variant_t ret = ops->find_var(ops->find_var_ctxt, name);
     if (ret) {
         purc_variant_ref(ret);
     }
+    return ret;
+}
+
+static
+purc_variant_t pcvcm_node_get_variable_to_variant(struct pcvcm_node *node,
+       struct pcvcm_node_op *ops, bool silently)
+{
+    purc_variant_t ret = PURC_VARIANT_INVALID;
+    if (!ops) {
+        goto out;
+    }
+
+    struct pcvcm_node *name_node = FIRST_CHILD(node);
+    if (!name_node) {
+        goto out;
+    }
+
+    purc_variant_t name_var = pcvcm_node_to_variant(name_node, ops,
+            silently);
+    if (name_var == PURC_VARIANT_INVALID) {
+        goto out;
+    }
 
-out_unref_name_var:
+    ret = find_variable(ops, name_var);
     purc_variant_unref(name_var);
 
 out:
@@ -1197,16 +1369,91 @@ purc_variant_t call_dvariant_method(purc_variant_t root, purc_variant_t var,
     return PURC_VARIANT_INVALID;
 }
 
+/*
+ * The inline cache of a call site of the compiled code whose name of the
+ * member or the method is a constant: the member of the object last
+ * looked up, and the method of the native entity last called. The method
+ * is cached by the ops of the entity, for property_getter() and
+ * property_setter() only depend on the name. The caches are kept by the
+ * instance in the state of the code, see struct pcvcm_code_state.
+ */
+struct pcvcm_ic {
+    const char             *name;
+
+    purc_variant_t          obj;
+    uint64_t                stamp;
+    purc_variant_t          val;
+
+    struct purc_native_ops *ops;
+    enum method_type        type;
+    purc_nvariant_method    method;
+};
+
+static inline void
+count_member_cache(bool hit)
+{
+    struct purc_variant_stat *stat = &pcinst_current()->variant_heap->stat;
+    if (hit)
+        stat->nr_member_cache_hits++;
+    else
+        stat->nr_member_cache_misses++;
+}
+
+static purc_variant_t
+object_get_member(purc_variant_t obj, purc_variant_t key,
+        struct pcvcm_ic *ic)
+{
+    if (ic == NULL) {
+        return purc_variant_object_get(obj, key);
+    }
+
+    uint64_t stamp = pcvar_obj_stamp(obj);
+    if (stamp && ic->obj == obj && ic->stamp == stamp) {
+        count_member_cache(true);
+        return ic->val;
+    }
+
+    count_member_cache(false);
+    purc_variant_t val = purc_variant_object_get(obj, key);
+    if (val && stamp) {
+        ic->obj = obj;
+        ic->stamp = stamp;
+        ic->val = val;
+    }
+    return val;
+}
+
+static purc_nvariant_method
+native_get_method(struct purc_native_ops *ops, const char *key_name,
+        enum method_type type, struct pcvcm_ic *ic)
+{
+    bool cacheable = ic && key_name && strcmp(key_name, ic->name) == 0;
+    if (cacheable && ic->ops == ops && ic->type == type) {
+        count_member_cache(true);
+        return ic->method;
+    }
+
+    purc_nvariant_method method = (type == GETTER_METHOD) ?
+        ops->property_getter(key_name) :
+        ops->property_setter(key_name);
+    if (cacheable) {
+        count_member_cache(false);
+        ic->ops = ops;
+        ic->type = type;
+        ic->method = method;
+    }
+    return method;
+}
+
 static
 purc_variant_t call_nvariant_method(purc_variant_t var,
         const char *key_name, size_t nr_args, purc_variant_t *argv,
-        enum method_type type, bool silently)
+        enum method_type type, bool silently, struct pcvcm_ic *ic)
 {
     struct purc_native_ops *ops = purc_variant_native_get_ops(var);
     if (ops) {
-        purc_nvariant_method native_func = (type == GETTER_METHOD) ?
-            ops->property_getter(key_name) :
-            ops->property_setter(key_name);
+        purc_nvariant_method native_func = native_get_method(ops, key_name,
+                type, ic);
         if (native_func) {
             return  native_func(purc_variant_native_get_entity(var),
                     nr_args, argv, silently);
@@ -1215,6 +1462,74 @@ purc_variant_t call_nvariant_method(purc_variant_t var,
     return PURC_VARIANT_INVALID;
 }
 
+/*
+ * The dependencies of a value computed by the compiled code: the variables
+ * found and the objects whose members were read. The value is reused while
+ * the variables are bound to the same values and the objects keep their
+ * stamps, which are dropped whenever the objects grow, shrink or change.
+ * The dependencies are referenced, so their addresses are not reused.
+ */
+struct pcvcm_dep {
+    purc_variant_t          value;
+    uint64_t                stamp;  // the stamp of the object, or 0
+    uint32_t                var;    // the index of the variable + 1, or 0
+};
+
+#define MAX_VALUE_DEPS      8
+
+struct pcvcm_deps {
+    struct pcvcm_dep        deps[MAX_VALUE_DEPS];
+    size_t                  nr_deps;
+
+    // false if the value depends on anything else, say a getter
+    bool                    tracked;
+    // true if a container is made, so the value is not to be shared
+    bool                    made;
+};
+
+static void
+release_deps(struct pcvcm_dep *deps, size_t nr)
+{
+    for (size_t i = 0; i < nr; i++) {
+        purc_variant_unref(deps[i].value);
+    }
+}
+
+static void
+add_dep(struct pcvcm_deps *deps, purc_variant_t value, uint64_t stamp,
+        size_t var)
+{
+    if (!deps->tracked)
+        return;
+
+    if (deps->nr_deps == MAX_VALUE_DEPS) {
+        deps->tracked = false;
+        return;
+    }
+
+    struct pcvcm_dep *dep = deps->deps + deps->nr_deps++;
+    dep->value = purc_variant_ref(value);
+    dep->stamp = stamp;
+    dep->var = var;
+}
+
+/* the values whose use does not depend on anything else */
+static bool
+is_scalar(purc_variant_t v)
+{
+    switch (v->type) {
+    case PURC_VARIANT_TYPE_OBJECT:
+    case PURC_VARIANT_TYPE_ARRAY:
+    case PURC_VARIANT_TYPE_SET:
+    case PURC_VARIANT_TYPE_TUPLE:
+    case PURC_VARIANT_TYPE_DYNAMIC:
+    case PURC_VARIANT_TYPE_NATIVE:
+        return false;
+    default:
+        return true;
+    }
+}
+
 static purc_variant_t get_attach_variant(struct pcvcm_node *node)
 {
     return node ? (purc_variant_t)node->attach : PURC_VARIANT_INVALID;
@@ -1273,27 +1588,36 @@ inner_native_wrapper_get_param(purc_variant_t val)
     return purc_variant_object_get_by_ckey(val, KEY_PARAM_NODE);
 }
 
-static
-purc_variant_t pcvcm_node_get_element_to_variant(struct pcvcm_node *node,
-       struct pcvcm_node_op *ops, bool silently)
+/* the members of an object are tracked by the stamp of the object; the
+   other elements may be changed without a stamp, or be got by a getter */
+static void
+track_element(struct pcvcm_deps *deps, purc_variant_t caller_var)
 {
-    purc_variant_t ret_var = PURC_VARIANT_INVALID;
-    struct pcvcm_node *caller_node = FIRST_CHILD(node);
-    if (!caller_node) {
-        goto out;
+    uint64_t stamp = 0;
+    if (purc_variant_is_object(caller_var) &&
+            !is_inner_native_wrapper(caller_var)) {
+        stamp = pcvar_obj_stamp(caller_var);
     }
 
-    purc_variant_t caller_var = pcvcm_node_to_variant(caller_node, ops,
-            silently);
-    if (caller_var == PURC_VARIANT_INVALID) {
-        goto out;
-    }
+    if (stamp)
+        add_dep(deps, caller_var, stamp, 0);
+    else
+        deps->tracked = false;
+}
 
+/* gets the element of the GET_ELEMENT node; consumes the caller and
+   the param */
+static purc_variant_t
+get_element(struct pcvcm_node *node, purc_variant_t caller_var,
+        purc_variant_t param_var, bool silently, struct pcvcm_ic *ic,
+        struct pcvcm_deps *deps)
+{
+    purc_variant_t ret_var = PURC_VARIANT_INVALID;
+    struct pcvcm_node *caller_node = FIRST_CHILD(node);
     struct pcvcm_node *param_node  = NEXT_CHILD(caller_node);
-    purc_variant_t param_var = pcvcm_node_to_variant(param_node, ops,
-            silently);
-    if (param_var == PURC_VARIANT_INVALID) {
-        goto out_unref_caller_var;
+
+    if (deps) {
+        track_element(deps, caller_var);
     }
 
     bool has_index = true;
@@ -1314,7 +1638,7 @@ purc_variant_t pcvcm_node_get_element_to_variant(struct pcvcm_node *node,
         purc_variant_t inner_param = inner_native_wrapper_get_param(caller_var);
         purc_variant_t inner_ret = call_nvariant_method(inner_caller,
                 purc_variant_get_string_const(inner_param), 0, NULL,
-                GETTER_METHOD, silently);
+                GETTER_METHOD, silently, NULL);
         if (inner_ret) {
             purc_variant_unref(caller_var);
             caller_var = inner_ret;
@@ -1322,7 +1646,7 @@ purc_variant_t pcvcm_node_get_element_to_variant(struct pcvcm_node *node,
     }
 
     if (purc_variant_is_object(caller_var)) {
-        purc_variant_t val = purc_variant_object_get(caller_var, param_var);
+        purc_variant_t val = object_get_member(caller_var, param_var, ic);
         if (val == PURC_VARIANT_INVALID) {
             goto out_unref_param_var;
         }
@@ -1333,6 +1657,10 @@ purc_variant_t pcvcm_node_get_element_to_variant(struct pcvcm_node *node,
             goto out_unref_param_var;
         }
 
+        if (deps) {
+            deps->tracked = false;
+        }
+
         if (!is_handle_as_getter(node)) {
             ret_var = val;
             goto out_unref_param_var;
@@ -1418,59 +1746,56 @@ purc_variant_t pcvcm_node_get_element_to_variant(struct pcvcm_node *node,
         }
         ret_var = call_nvariant_method(caller_var,
                 purc_variant_get_string_const(param_var), 0, NULL,
-                GETTER_METHOD, silently);
+                GETTER_METHOD, silently, ic);
         goto out_unref_param_var;
     }
 
 out_unref_param_var:
     purc_variant_unref(param_var);
-out_unref_caller_var:
     purc_variant_unref(caller_var);
-out:
     return ret_var;
 }
 
-purc_variant_t pcvcm_node_call_method_to_variant(struct pcvcm_node *node,
-       struct pcvcm_node_op *ops, enum method_type type, bool silently)
+static
+purc_variant_t pcvcm_node_get_element_to_variant(struct pcvcm_node *node,
+       struct pcvcm_node_op *ops, bool silently)
 {
-    purc_variant_t ret_var = PURC_VARIANT_INVALID;
     struct pcvcm_node *caller_node = FIRST_CHILD(node);
     if (!caller_node) {
-        goto out;
+        return PURC_VARIANT_INVALID;
     }
 
-    purc_variant_t caller_var = pcvcm_node_to_variant(caller_node, ops, silently);
+    purc_variant_t caller_var = pcvcm_node_to_variant(caller_node, ops,
+            silently);
     if (caller_var == PURC_VARIANT_INVALID) {
-        goto out;
+        return PURC_VARIANT_INVALID;
     }
 
-    if (!purc_variant_is_dynamic(caller_var)
-            && !is_inner_native_wrapper(caller_var)) {
-        goto out_unref_caller_var;
+    struct pcvcm_node *param_node  = NEXT_CHILD(caller_node);
+    purc_variant_t param_var = pcvcm_node_to_variant(param_node, ops,
+            silently);
+    if (param_var == PURC_VARIANT_INVALID) {
+        purc_variant_unref(caller_var);
+        return PURC_VARIANT_INVALID;
     }
 
-    purc_variant_t *params = NULL;
-    size_t nr_params = CHILDREN_NUMBER(node) - 1;
-    if (nr_params > 0) {
-        params = (purc_variant_t*)calloc(nr_params, sizeof(purc_variant_t));
-        if (!params) {
-            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
-            goto out_unref_caller_var;
-        }
+    return get_element(node, caller_var, param_var, silently, NULL, NULL);
+}
 
-        int i = 0;
-        struct pcvcm_node *param_node = NEXT_CHILD(caller_node);
-        while (param_node) {
-            purc_variant_t vt = pcvcm_node_to_variant(param_node, ops, silently);
-            if (vt == PURC_VARIANT_INVALID) {
-                goto out_unref_params;
-            }
+static bool
+is_callable(purc_variant_t caller_var)
+{
+    return purc_variant_is_dynamic(caller_var)
+        || is_inner_native_wrapper(caller_var);
+}
 
-            params[i] = vt;
-            i++;
-            param_node = NEXT_CHILD(param_node);
-        }
-    }
+static purc_variant_t
+call_method(struct pcvcm_node *node, purc_variant_t caller_var,
+        size_t nr_params, purc_variant_t *params, enum method_type type,
+        bool silently, struct pcvcm_ic *ic)
+{
+    purc_variant_t ret_var = PURC_VARIANT_INVALID;
+    struct pcvcm_node *caller_node = FIRST_CHILD(node);
 
     if (purc_variant_is_dynamic(caller_var)) {
         ret_var = call_dvariant_method(
@@ -1484,11 +1809,58 @@ purc_variant_t pcvcm_node_call_method_to_variant(struct pcvcm_node *node,
             if (name) {
                 ret_var = call_nvariant_method(nv,
                         purc_variant_get_string_const(name), nr_params,
-                        params, type, silently);
+                        params, type, silently, ic);
             }
         }
     }
 
+    return ret_var;
+}
+
+purc_variant_t pcvcm_node_call_method_to_variant(struct pcvcm_node *node,
+       struct pcvcm_node_op *ops, enum method_type type, bool silently)
+{
+    purc_variant_t ret_var = PURC_VARIANT_INVALID;
+    struct pcvcm_node *caller_node = FIRST_CHILD(node);
+    if (!caller_node) {
+        goto out;
+    }
+
+    purc_variant_t caller_var = pcvcm_node_to_variant(caller_node, ops, silently);
+    if (caller_var == PURC_VARIANT_INVALID) {
+        goto out;
+    }
+
+    if (!is_callable(caller_var)) {
+        goto out_unref_caller_var;
+    }
+
+    purc_variant_t *params = NULL;
+    size_t nr_params = CHILDREN_NUMBER(node) - 1;
+    if (nr_params > 0) {
+        params = (purc_variant_t*)calloc(nr_params, sizeof(purc_variant_t));
+        if (!params) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            goto out_unref_caller_var;
+        }
+
+        int i = 0;
+        struct pcvcm_node *param_node = NEXT_CHILD(caller_node);
+        while (param_node) {
+            purc_variant_t vt = pcvcm_node_to_variant(param_node, ops, silently);
+            if (vt == PURC_VARIANT_INVALID) {
+                goto out_unref_params;
+            }
+
+            params[i] = vt;
+            i++;
+            param_node = NEXT_CHILD(param_node);
+        }
+    }
+
+    ret_var = call_method(node, caller_var, nr_params, params, type,
+            silently, NULL);
+
 out_unref_params:
     for (size_t i = 0; i < nr_params; i++) {
         if (params[i]) {
@@ -1607,10 +1979,52 @@ static bool has_fatal_error()
     return (err == PURC_ERROR_OUT_OF_MEMORY);
 }
 
+static purc_variant_t
+folded_to_variant(struct pcvcm_node *node, struct pcvcm_node_op *ops)
+{
+    purc_variant_t value;
+    pcutils_map *values = ops->consts->values;
+    pcutils_map_entry *entry = pcutils_map_find(values,
+            (const void*)node->const_id);
+    if (entry) {
+        value = (purc_variant_t)entry->val;
+    }
+    else {
+        struct pcvcm_node_op const_ops = {
+            .find_var = ops->find_var,
+            .find_var_ctxt = ops->find_var_ctxt,
+            .consts = NULL,
+        };
+
+        value = pcvcm_node_to_variant(node, &const_ops, false);
+        if (value == PURC_VARIANT_INVALID) {
+            return PURC_VARIANT_INVALID;
+        }
+
+        if (pcutils_map_get_size(values) >= MAX_CACHED_CONSTS) {
+            pcutils_map_clear(values);
+        }
+
+        if (pcutils_map_insert(values, (const void*)node->const_id, value)) {
+            return value;
+        }
+    }
+
+    if (purc_variant_is_object(value) || purc_variant_is_array(value)) {
+        return purc_variant_container_clone_recursively(value);
+    }
+    return purc_variant_ref(value);
+}
+
 purc_variant_t pcvcm_node_to_variant(struct pcvcm_node *node,
         struct pcvcm_node_op *ops, bool silently)
 {
     purc_variant_t ret = PURC_VARIANT_INVALID;
+    if (node->const_id && ops->consts) {
+        ret = folded_to_variant(node, ops);
+        goto done;
+    }
+
     switch(node->type)
     {
         case PCVCM_NODE_TYPE_UNDEFINED:
@@ -1689,6 +2103,7 @@ purc_variant_t pcvcm_node_to_variant(struct pcvcm_node *node,
             break;
     }
 
+done:
     if (ret == PURC_VARIANT_INVALID
             && silently && !has_fatal_error()) {
         ret = purc_variant_make_undefined();
@@ -1705,6 +2120,23 @@ purc_variant_t pcvcm_node_to_variant(struct pcvcm_node *node,
     return ret;
 }
 
+/* the kinds of the variable names, see find_stack_var() */
+enum pcvcm_var_kind {
+    VCM_VAR_NAMED,          // $name
+    VCM_VAR_SYMBOLIZED,     // $?, $2<
+    VCM_VAR_ANCHOR,         // $#anchor?
+};
+
+/* a variable referred by a constant name, resolved by the compiled code */
+struct pcvcm_var_ref {
+    const char             *name;
+    enum pcvcm_var_kind     kind;
+    unsigned int            number;
+    char                    symbol;
+    char                   *anchor;
+    purc_atom_t             atom;
+};
+
 static inline bool is_digit(char c)
 {
     return c >= '0' && c <= '9';
@@ -1743,17 +2175,79 @@ purc_variant_t find_stack_var(void *ctxt, const char *name)
     return pcintr_find_named_var(ctxt, name);
 }
 
+/* the same as find_stack_var(), with the name parsed at compile time */
+static purc_variant_t
+find_stack_var_by_ref(struct pcintr_stack *stack, struct pcvcm_var_ref *ref,
+        struct pcintr_var_cache *cache)
+{
+    switch (ref->kind) {
+    case VCM_VAR_SYMBOLIZED:
+        return pcintr_get_symbolized_var(stack, ref->number, ref->symbol);
+
+    case VCM_VAR_ANCHOR:
+        return pcintr_find_anchor_symbolized_var(stack, ref->anchor,
+                ref->symbol);
+
+    case VCM_VAR_NAMED:
+    default:
+        break;
+    }
+
+    return pcintr_find_named_var_by_atom(stack, ref->atom, cache);
+}
+
+static purc_variant_t
+find_variable_by_ref(struct pcvcm_node_op *ops, struct pcvcm_var_ref *ref,
+        struct pcintr_var_cache *cache)
+{
+    purc_variant_t ret;
+
+    if (ops->stack) {
+        ret = find_stack_var_by_ref(ops->stack, ref, cache);
+    }
+    else if (ops->find_var) {
+        ret = ops->find_var(ops->find_var_ctxt, ref->name);
+    }
+    else {
+        pcinst_set_error(PCVARIANT_ERROR_NOT_FOUND);
+        return PURC_VARIANT_INVALID;
+    }
+
+    if (ret) {
+        purc_variant_ref(ret);
+    }
+    return ret;
+}
+
+static struct pcvcm_consts *
+get_instance_consts(void)
+{
+    struct pcintr_heap *heap = pcintr_get_heap();
+    if (heap && !heap->vcm_consts) {
+        heap->vcm_consts = pcvcm_consts_new();
+    }
+    return heap ? heap->vcm_consts : NULL;
+}
+
 purc_variant_t pcvcm_eval(struct pcvcm_node *tree, struct pcintr_stack *stack,
         bool silently)
 {
     if (stack) {
-        return pcvcm_eval_ex(tree, find_stack_var, stack, silently);
+        return pcvcm_eval_with_consts(tree, get_instance_consts(),
+                find_stack_var, stack, silently);
     }
     return pcvcm_eval_ex(tree, NULL, NULL, silently);
 }
 
 purc_variant_t pcvcm_eval_ex(struct pcvcm_node *tree,
         cb_find_var find_var, void *ctxt, bool silently)
+{
+    return pcvcm_eval_with_consts(tree, NULL, find_var, ctxt, silently);
+}
+
+purc_variant_t pcvcm_eval_with_consts(struct pcvcm_node *tree,
+        struct pcvcm_consts *consts, cb_find_var find_var, void *ctxt,
+        bool silently)
 {
 // #define PRINT_DEBUG
 #ifdef PRINT_DEBUG        /* { */
@@ -1764,6 +2258,7 @@ purc_variant_t pcvcm_eval_ex(struct pcvcm_node *tree,
     struct pcvcm_node_op ops = {
         .find_var = find_var,
         .find_var_ctxt = ctxt,
+        .consts = consts,
     };
 
     if (tree) {
@@ -1781,6 +2276,862 @@ purc_variant_t pcvcm_eval_ex(struct pcvcm_node *tree,
     return ret;
 }
 
+/*
+ * The compiled code: each node is evaluated into a register, the operands
+ * of a node are evaluated into the registers following the one of the node
+ * and consumed by the instruction of the node. The instructions producing
+ * the value of a node do what pcvcm_node_to_variant() does at its end, so
+ * the attached values and the errors are the same as the tree walker.
+ */
+enum pcvcm_opcode {
+    VCM_OP_EVAL_NODE,       // R = the value of the leaf or the folded node
+    VCM_OP_MAKE_OBJECT,     // R = the object of the N pairs in R, R+1...
+    VCM_OP_MAKE_ARRAY,      // R = the array of R ... R+N-1
+    VCM_OP_CONCAT_STRING,   // R = the concatenation of R ... R+N-1
+    VCM_OP_GET_VARIABLE,    // R = the variable named R
+    VCM_OP_FIND_VARIABLE,   // R = the variable of the reference N
+    VCM_OP_GET_ELEMENT,     // R = the element R+1 of R
+    VCM_OP_CHECK_CALLER,    // fail and jump to N if R is not callable
+    VCM_OP_CALL_GETTER,     // R = the getter R called with R+1 ... R+N
+    VCM_OP_CALL_SETTER,     // R = the setter R called with R+1 ... R+N
+    VCM_OP_JUMP_IF_FALSE,   // jump to N if R is false
+    VCM_OP_JUMP_IF_TRUE,    // jump to N if R is true
+    VCM_OP_DROP,            // R = invalid
+    VCM_OP_FAIL,            // R = invalid, with the error N if nonzero
+    VCM_OP_END_NODE,        // R is the value of the node
+};
+
+struct pcvcm_insn {
+    struct pcvcm_node      *node;
+    uint32_t                op;
+    uint32_t                reg;
+    uint32_t                arg;
+    uint32_t                ic;     // the index of the inline cache + 1
+};
+
+/* The code is shared by the instances along with the vdom, so it is never
+   changed once compiled; what an instance learns by evaluating the code is
+   kept in the state of the code by the instance. */
+struct pcvcm_code {
+    // unique in the process, the key of the states kept by the instances
+    uintptr_t               id;
+
+    struct pcvcm_insn      *insns;
+    size_t                  nr_insns;
+    size_t                  sz_insns;
+    size_t                  nr_regs;
+
+    struct pcvcm_var_ref   *vars;
+    size_t                  nr_vars;
+
+    // the constant names of the inline caches
+    const char            **ic_names;
+    size_t                  nr_ics;
+};
+
+struct pcvcm_code_state {
+    // the variables found by the references, one for each
+    struct pcintr_var_cache *var_caches;
+    // the inline caches, one for each
+    struct pcvcm_ic        *ics;
+
+    // the last value and its dependencies, see deps_unchanged()
+    purc_variant_t          last_value;
+    struct pcvcm_dep       *deps;
+    size_t                  nr_deps;
+};
+
+#define MIN_CODE_INSNS      8
+#define NR_LOCAL_REGS       16
+
+static ssize_t
+emit(struct pcvcm_code *code, enum pcvcm_opcode op, struct pcvcm_node *node,
+        size_t reg, size_t arg)
+{
+    if (code->nr_insns == code->sz_insns) {
+        size_t sz = code->sz_insns ? code->sz_insns * 2 : MIN_CODE_INSNS;
+        struct pcvcm_insn *insns = realloc(code->insns,
+                sz * sizeof(struct pcvcm_insn));
+        if (insns == NULL) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return -1;
+        }
+        code->insns = insns;
+        code->sz_insns = sz;
+    }
+
+    struct pcvcm_insn *insn = code->insns + code->nr_insns;
+    insn->node = node;
+    insn->op = op;
+    insn->reg = reg;
+    insn->arg = arg;
+    insn->ic = 0;
+
+    if (code->nr_regs <= reg)
+        code->nr_regs = reg + 1;
+    return code->nr_insns++;
+}
+
+static int
+compile_node(struct pcvcm_code *code, struct pcvcm_node *node, size_t reg);
+
+/* Parses the constant name of a variable as find_stack_var() does.
+   Returns the index of the reference, -1 if the name is left to be
+   parsed when evaluated, or -2 if out of memory. */
+static ssize_t
+resolve_variable(struct pcvcm_code *code, struct pcvcm_node *name_node)
+{
+    if (name_node->type != PCVCM_NODE_TYPE_STRING)
+        return -1;
+
+    const char *name = (const char *)name_node->sz_ptr[1];
+    size_t nr_name = name ? strlen(name) : 0;
+    if (nr_name == 0)
+        return -1;
+
+    struct pcvcm_var_ref ref = { };
+    char last = name[nr_name - 1];
+
+    ref.name = name;
+    if (is_digit(name[0])) {
+        if (is_digit(last))
+            return -1;
+        ref.kind = VCM_VAR_SYMBOLIZED;
+        ref.number = atoi(name);
+        ref.symbol = last;
+    }
+    else if (nr_name == 1 && purc_ispunct(last)) {
+        ref.kind = VCM_VAR_SYMBOLIZED;
+        ref.number = 1;
+        ref.symbol = last;
+    }
+    else if (name[0] == '#') {
+        ref.kind = VCM_VAR_ANCHOR;
+        ref.symbol = last;
+        ref.anchor = strndup(name + 1, nr_name - 2);
+        if (ref.anchor == NULL)
+            goto failed;
+    }
+    else {
+        ref.kind = VCM_VAR_NAMED;
+        ref.atom = purc_atom_from_string(name);
+        if (ref.atom == 0)
+            goto failed;
+    }
+
+    struct pcvcm_var_ref *vars = realloc(code->vars,
+            (code->nr_vars + 1) * sizeof(struct pcvcm_var_ref));
+    if (vars == NULL) {
+        free(ref.anchor);
+        goto failed;
+    }
+
+    code->vars = vars;
+    code->vars[code->nr_vars] = ref;
+    return code->nr_vars++;
+
+failed:
+    pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+    return -2;
+}
+
+/* Adds an inline cache for the constant name of the member or the method
+   in the name node. Returns the index of the cache + 1, 0 if the name is
+   not a constant, or -1 if out of memory. */
+static ssize_t
+new_ic(struct pcvcm_code *code, struct pcvcm_node *name_node)
+{
+    if (name_node == NULL || name_node->type != PCVCM_NODE_TYPE_STRING)
+        return 0;
+
+    const char **names = realloc(code->ic_names,
+            (code->nr_ics + 1) * sizeof(const char *));
+    if (names == NULL) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+
+    code->ic_names = names;
+    names[code->nr_ics] = (const char *)name_node->sz_ptr[1];
+    return ++code->nr_ics;
+}
+
+/* compiles the first nr children of the node into reg, reg+1... */
+static int
+compile_children(struct pcvcm_code *code, struct pcvcm_node *node,
+        size_t nr, size_t reg)
+{
+    struct pcvcm_node *child = FIRST_CHILD(node);
+    for (size_t i = 0; i < nr; i++) {
+        if (compile_node(code, child, reg + i))
+            return -1;
+        child = NEXT_CHILD(child);
+    }
+    return 0;
+}
+
+static int
+compile_call(struct pcvcm_code *code, struct pcvcm_node *node, size_t reg,
+        enum pcvcm_opcode op)
+{
+    struct pcvcm_node *caller_node = FIRST_CHILD(node);
+    if (!caller_node) {
+        return emit(code, VCM_OP_FAIL, node, reg, 0) < 0 ? -1 : 0;
+    }
+
+    if (compile_node(code, caller_node, reg))
+        return -1;
+
+    // the parameters are not evaluated if the caller is not callable
+    ssize_t check = emit(code, VCM_OP_CHECK_CALLER, node, reg, 0);
+    if (check < 0)
+        return -1;
+
+    size_t nr_params = 0;
+    struct pcvcm_node *param_node = NEXT_CHILD(caller_node);
+    while (param_node) {
+        nr_params++;
+        if (compile_node(code, param_node, reg + nr_params))
+            return -1;
+        param_node = NEXT_CHILD(param_node);
+    }
+
+    // the name of the method is the param of the caller
+    ssize_t ic = 0;
+    if (caller_node->type == PCVCM_NODE_TYPE_FUNC_GET_ELEMENT) {
+        struct pcvcm_node *name_node = FIRST_CHILD(caller_node);
+        ic = new_ic(code, name_node ? NEXT_CHILD(name_node) : NULL);
+        if (ic < 0)
+            return -1;
+    }
+
+    ssize_t idx = emit(code, op, node, reg, nr_params);
+    if (idx < 0)
+        return -1;
+
+    code->insns[idx].ic = ic;
+    code->insns[check].arg = code->nr_insns;
+    return 0;
+}
+
+static int
+compile_cjsonee(struct pcvcm_code *code, struct pcvcm_node *node, size_t reg)
+{
+    size_t nr_jumps = 0;
+    size_t nr_children = CHILDREN_NUMBER(node);
+    size_t *jumps = NULL;
+    int ret = -1;
+
+    if (nr_children) {
+        jumps = malloc(sizeof(size_t) * nr_children);
+        if (jumps == NULL) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return -1;
+        }
+    }
+    else if (emit(code, VCM_OP_FAIL, node, reg, 0) < 0) {
+        return -1;
+    }
+
+    ssize_t idx;
+    struct pcvcm_node *curr_node = FIRST_CHILD(node);
+    while (curr_node) {
+        if (is_cjsonee_op(curr_node)) {
+            goto missed;
+        }
+
+        if (compile_node(code, curr_node, reg))
+            goto out;
+
+        struct pcvcm_node *op_node = NEXT_CHILD(curr_node);
+        if (op_node == NULL) {
+            break;
+        }
+
+        if (!is_cjsonee_op(op_node)) {
+            goto missed;
+        }
+
+        curr_node = NEXT_CHILD(op_node);
+        if (op_node->type == PCVCM_NODE_TYPE_CJSONEE_OP_SEMICOLON) {
+            if (!curr_node) {
+                break;
+            }
+        }
+        else {
+            if (!curr_node) {
+                goto missed;
+            }
+
+            idx = emit(code,
+                    op_node->type == PCVCM_NODE_TYPE_CJSONEE_OP_AND ?
+                    VCM_OP_JUMP_IF_FALSE : VCM_OP_JUMP_IF_TRUE,
+                    node, reg, 0);
+            if (idx < 0)
+                goto out;
+            jumps[nr_jumps++] = idx;
+        }
+
+        if (emit(code, VCM_OP_DROP, node, reg, 0) < 0)
+            goto out;
+    }
+    goto end;
+
+missed:
+    if (emit(code, VCM_OP_FAIL, node, reg, PURC_ERROR_ARGUMENT_MISSED) < 0)
+        goto out;
+
+end:
+    for (size_t i = 0; i < nr_jumps; i++) {
+        code->insns[jumps[i]].arg = code->nr_insns;
+    }
+    if (emit(code, VCM_OP_END_NODE, node, reg, 0) < 0)
+        goto out;
+    ret = 0;
+
+out:
+    free(jumps);
+    return ret;
+}
+
+static int
+compile_node(struct pcvcm_code *code, struct pcvcm_node *node, size_t reg)
+{
+    struct pcvcm_node *child;
+    size_t nr;
+    enum pcvcm_opcode op;
+    ssize_t ic = 0;
+
+    if (node->const_id) {
+        goto eval_node;
+    }
+
+    switch (node->type) {
+    case PCVCM_NODE_TYPE_OBJECT:
+        nr = CHILDREN_NUMBER(node) / 2;
+        if (compile_children(code, node, nr * 2, reg))
+            return -1;
+        op = VCM_OP_MAKE_OBJECT;
+        break;
+
+    case PCVCM_NODE_TYPE_ARRAY:
+    case PCVCM_NODE_TYPE_FUNC_CONCAT_STRING:
+        nr = CHILDREN_NUMBER(node);
+        if (compile_children(code, node, nr, reg))
+            return -1;
+        op = (node->type == PCVCM_NODE_TYPE_ARRAY) ?
+            VCM_OP_MAKE_ARRAY : VCM_OP_CONCAT_STRING;
+        break;
+
+    case PCVCM_NODE_TYPE_FUNC_GET_VARIABLE:
+        child = FIRST_CHILD(node);
+        nr = 0;
+        op = VCM_OP_FAIL;
+        if (child) {
+            ssize_t idx = resolve_variable(code, child);
+            if (idx < -1)
+                return -1;
+            if (idx >= 0) {
+                nr = idx;
+                op = VCM_OP_FIND_VARIABLE;
+                break;
+            }
+
+            if (compile_node(code, child, reg))
+                return -1;
+            op = VCM_OP_GET_VARIABLE;
+        }
+        break;
+
+    case PCVCM_NODE_TYPE_FUNC_GET_ELEMENT:
+        child = FIRST_CHILD(node);
+        nr = 0;
+        op = VCM_OP_FAIL;
+        if (child) {
+            if (compile_node(code, child, reg))
+                return -1;
+            child = NEXT_CHILD(child);
+            if (child) {
+                if (compile_node(code, child, reg + 1))
+                    return -1;
+                ic = new_ic(code, child);
+                if (ic < 0)
+                    return -1;
+                op = VCM_OP_GET_ELEMENT;
+            }
+        }
+        break;
+
+    case PCVCM_NODE_TYPE_FUNC_CALL_GETTER:
+        return compile_call(code, node, reg, VCM_OP_CALL_GETTER);
+
+    case PCVCM_NODE_TYPE_FUNC_CALL_SETTER:
+        return compile_call(code, node, reg, VCM_OP_CALL_SETTER);
+
+    case PCVCM_NODE_TYPE_CJSONEE:
+        return compile_cjsonee(code, node, reg);
+
+    default:
+        goto eval_node;
+    }
+
+    ssize_t idx = emit(code, op, node, reg, nr);
+    if (idx < 0)
+        return -1;
+
+    code->insns[idx].ic = ic;
+    return 0;
+
+eval_node:
+    return emit(code, VCM_OP_EVAL_NODE, node, reg, 0) < 0 ? -1 : 0;
+}
+
+struct pcvcm_code *pcvcm_compile(struct pcvcm_node *tree)
+{
+    struct pcvcm_code *code = calloc(1, sizeof(*code));
+    if (code == NULL) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    code->id = atomic_fetch_add(&next_code_id, 1);
+
+    if (tree && compile_node(code, tree, 0)) {
+        pcvcm_code_destroy(code);
+        return NULL;
+    }
+
+    return code;
+}
+
+static void
+drop_last_value(struct pcvcm_code_state *state)
+{
+    if (state->last_value) {
+        purc_variant_unref(state->last_value);
+        state->last_value = PURC_VARIANT_INVALID;
+    }
+
+    release_deps(state->deps, state->nr_deps);
+    free(state->deps);
+    state->deps = NULL;
+    state->nr_deps = 0;
+}
+
+static void free_code_state(void *val)
+{
+    struct pcvcm_code_state *state = (struct pcvcm_code_state *)val;
+    drop_last_value(state);
+    free(state);
+}
+
+static struct pcvcm_code_state *
+new_code_state(struct pcvcm_code *code)
+{
+    struct pcvcm_code_state *state = calloc(1, sizeof(*state) +
+            sizeof(struct pcintr_var_cache) * code->nr_vars +
+            sizeof(struct pcvcm_ic) * code->nr_ics);
+    if (state == NULL)
+        return NULL;
+
+    state->var_caches = (struct pcintr_var_cache *)(state + 1);
+    state->ics = (struct pcvcm_ic *)(state->var_caches + code->nr_vars);
+    for (size_t i = 0; i < code->nr_ics; i++) {
+        state->ics[i].name = code->ic_names[i];
+    }
+    return state;
+}
+
+/* Gets the state of the code kept by the instance, or NULL if it can not
+   be kept, then the code is evaluated without any cache. The states are
+   cleared once they are too many, unless some codes are being evaluated
+   with their states. */
+static struct pcvcm_code_state *
+get_code_state(struct pcvcm_code *code, struct pcvcm_consts *consts)
+{
+    if (consts == NULL)
+        return NULL;
+
+    pcutils_map *codes = consts->codes;
+    pcutils_map_entry *entry = pcutils_map_find(codes, (const void*)code->id);
+    if (entry)
+        return (struct pcvcm_code_state *)entry->val;
+
+    if (pcutils_map_get_size(codes) >= MAX_CODE_STATES) {
+        if (consts->nr_running)
+            return NULL;
+        pcutils_map_clear(codes);
+    }
+
+    struct pcvcm_code_state *state = new_code_state(code);
+    if (state && pcutils_map_insert(codes, (const void*)code->id, state)) {
+        free(state);
+        state = NULL;
+    }
+    return state;
+}
+
+void pcvcm_code_destroy(struct pcvcm_code *code)
+{
+    if (code) {
+        // the states kept by the other instances are left to be cleared
+        struct pcintr_heap *heap = pcintr_get_heap();
+        if (heap && heap->vcm_consts) {
+            pcutils_map_erase(heap->vcm_consts->codes, (void *)code->id);
+        }
+
+        for (size_t i = 0; i < code->nr_vars; i++) {
+            free(code->vars[i].anchor);
+        }
+        free(code->vars);
+        free(code->ic_names);
+        free(code->insns);
+        free(code);
+    }
+}
+
+size_t pcvcm_code_nr_insns(struct pcvcm_code *code)
+{
+    return code->nr_insns;
+}
+
+static void
+release_regs(purc_variant_t *regs, size_t nr)
+{
+    for (size_t i = 0; i < nr; i++) {
+        if (regs[i]) {
+            purc_variant_unref(regs[i]);
+            regs[i] = PURC_VARIANT_INVALID;
+        }
+    }
+}
+
+static purc_variant_t
+make_object(purc_variant_t *regs, size_t nr_pairs)
+{
+    purc_variant_t object = purc_variant_make_object(0,
+            PURC_VARIANT_INVALID, PURC_VARIANT_INVALID);
+    if (object) {
+        for (size_t i = 0; i < nr_pairs; i++) {
+            if (!purc_variant_object_set(object, regs[i * 2],
+                        regs[i * 2 + 1])) {
+                purc_variant_unref(object);
+                object = PURC_VARIANT_INVALID;
+                break;
+            }
+        }
+    }
+
+    release_regs(regs, nr_pairs * 2);
+    return object;
+}
+
+static purc_variant_t
+make_array(purc_variant_t *regs, size_t nr)
+{
+    purc_variant_t array = purc_variant_make_array(0, PURC_VARIANT_INVALID);
+    if (array) {
+        for (size_t i = 0; i < nr; i++) {
+            if (!purc_variant_array_append(array, regs[i])) {
+                purc_variant_unref(array);
+                array = PURC_VARIANT_INVALID;
+                break;
+            }
+        }
+    }
+
+    release_regs(regs, nr);
+    return array;
+}
+
+static purc_variant_t
+concat_string(purc_variant_t *regs, size_t nr)
+{
+    purc_variant_t ret = PURC_VARIANT_INVALID;
+    purc_rwstream_t rws = purc_rwstream_new_buffer(MIN_BUF_SIZE, MAX_BUF_SIZE);
+    if (rws) {
+        for (size_t i = 0; i < nr; i++) {
+            concat_string_append(rws, regs[i]);
+        }
+        ret = concat_string_end(rws);
+        purc_rwstream_destroy(rws);
+    }
+
+    release_regs(regs, nr);
+    return ret;
+}
+
+/* Finds the variables again and checks the stamps of the objects read
+   when the last value was computed. */
+static bool
+deps_unchanged(struct pcvcm_code *code, struct pcvcm_code_state *state,
+        struct pcvcm_node_op *ops)
+{
+    for (size_t i = 0; i < state->nr_deps; i++) {
+        struct pcvcm_dep *dep = state->deps + i;
+        if (dep->var) {
+            purc_variant_t v = find_variable_by_ref(ops,
+                    code->vars + dep->var - 1,
+                    state->var_caches + dep->var - 1);
+            if (v) {
+                purc_variant_unref(v);
+            }
+            if (v != dep->value)
+                return false;
+        }
+        else if (pcvar_obj_stamp(dep->value) != dep->stamp) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Keeps the value for the evaluations to come; a container made by the
+   code is not kept, for the caller may change it. */
+static void
+keep_last_value(struct pcvcm_code_state *state, purc_variant_t value,
+        struct pcvcm_deps *deps)
+{
+    struct pcvcm_dep *kept = NULL;
+
+    if (state == NULL || !deps->tracked ||
+            (deps->made && !is_scalar(value)))
+        goto failed;
+
+    if (deps->nr_deps) {
+        kept = malloc(sizeof(struct pcvcm_dep) * deps->nr_deps);
+        if (kept == NULL)
+            goto failed;
+        memcpy(kept, deps->deps, sizeof(struct pcvcm_dep) * deps->nr_deps);
+    }
+
+    // the code may have been evaluated again by a getter meanwhile
+    drop_last_value(state);
+    state->last_value = purc_variant_ref(value);
+    state->deps = kept;
+    state->nr_deps = deps->nr_deps;
+    return;
+
+failed:
+    release_deps(deps->deps, deps->nr_deps);
+}
+
+static purc_variant_t
+code_eval(struct pcvcm_code *code, struct pcvcm_node_op *ops,
+        struct pcvcm_consts *consts, bool silently)
+{
+    purc_variant_t local_regs[NR_LOCAL_REGS];
+    purc_variant_t *regs = local_regs;
+    purc_variant_t ret = PURC_VARIANT_INVALID;
+
+    if (code->nr_insns == 0) {
+        return silently ? purc_variant_make_undefined() : PURC_VARIANT_INVALID;
+    }
+
+    struct pcvcm_code_state *state = get_code_state(code, consts);
+    if (state && state->last_value) {
+        if (deps_unchanged(code, state, ops))
+            return purc_variant_ref(state->last_value);
+        drop_last_value(state);
+    }
+
+    struct pcvcm_deps deps = { .nr_deps = 0, .tracked = true, .made = false };
+
+    if (code->nr_regs > NR_LOCAL_REGS) {
+        regs = malloc(sizeof(purc_variant_t) * code->nr_regs);
+        if (regs == NULL) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return PURC_VARIANT_INVALID;
+        }
+    }
+    memset(regs, 0, sizeof(purc_variant_t) * code->nr_regs);
+
+    // the state is not cleared by the codes evaluated meanwhile
+    if (consts)
+        consts->nr_running++;
+
+    const struct pcvcm_insn *insns = code->insns;
+    const struct pcvcm_insn *insn = insns;
+    const struct pcvcm_insn *end = insns + code->nr_insns;
+    while (insn < end) {
+        purc_variant_t *r = regs + insn->reg;
+
+        switch (insn->op) {
+        case VCM_OP_EVAL_NODE:
+            *r = pcvcm_node_to_variant(insn->node, ops, silently);
+            if (*r == PURC_VARIANT_INVALID)
+                goto failed;
+            // the failures are given as undefined if silently
+            if (!is_scalar(*r))
+                deps.made = true;
+            else if (silently && purc_variant_is_undefined(*r))
+                deps.tracked = false;
+            insn++;
+            continue;
+
+        case VCM_OP_MAKE_OBJECT:
+            ret = make_object(r, insn->arg);
+            deps.made = true;
+            break;
+
+        case VCM_OP_MAKE_ARRAY:
+            ret = make_array(r, insn->arg);
+            deps.made = true;
+            break;
+
+        case VCM_OP_CONCAT_STRING:
+            // the containers are stringified with their members
+            for (size_t i = 0; i < insn->arg && deps.tracked; i++) {
+                if (!is_scalar(r[i]))
+                    deps.tracked = false;
+            }
+            ret = concat_string(r, insn->arg);
+            break;
+
+        case VCM_OP_GET_VARIABLE:
+            ret = find_variable(ops, *r);
+            release_regs(r, 1);
+            deps.tracked = false;
+            break;
+
+        case VCM_OP_FIND_VARIABLE:
+            ret = find_variable_by_ref(ops, code->vars + insn->arg,
+                    state ? state->var_caches + insn->arg : NULL);
+            if (ret && code->vars[insn->arg].kind == VCM_VAR_NAMED)
+                add_dep(&deps, ret, 0, insn->arg + 1);
+            else
+                deps.tracked = false;
+            break;
+
+        case VCM_OP_GET_ELEMENT:
+            ret = get_element(insn->node, r[0], r[1], silently,
+                    (insn->ic && state) ? state->ics + insn->ic - 1 : NULL,
+                    deps.tracked ? &deps : NULL);
+            r[0] = r[1] = PURC_VARIANT_INVALID;
+            break;
+
+        case VCM_OP_CHECK_CALLER:
+            deps.tracked = false;
+            if (is_callable(*r)) {
+                insn++;
+                continue;
+            }
+            release_regs(r, 1);
+            ret = PURC_VARIANT_INVALID;
+            break;
+
+        case VCM_OP_CALL_GETTER:
+        case VCM_OP_CALL_SETTER:
+            ret = call_method(insn->node, *r, insn->arg, r + 1,
+                    insn->op == VCM_OP_CALL_GETTER ?
+                    GETTER_METHOD : SETTER_METHOD, silently,
+                    (insn->ic && state) ? state->ics + insn->ic - 1 : NULL);
+            release_regs(r, insn->arg + 1);
+            break;
+
+        case VCM_OP_JUMP_IF_FALSE:
+        case VCM_OP_JUMP_IF_TRUE:
+            if (!is_scalar(*r))
+                deps.tracked = false;
+            if (purc_variant_booleanize(*r) ==
+                    (insn->op == VCM_OP_JUMP_IF_TRUE)) {
+                insn = insns + insn->arg;
+            }
+            else {
+                insn++;
+            }
+            continue;
+
+        case VCM_OP_DROP:
+            release_regs(r, 1);
+            insn++;
+            continue;
+
+        case VCM_OP_FAIL:
+            release_regs(r, 1);
+            if (insn->arg) {
+                pcinst_set_error(insn->arg);
+            }
+            ret = PURC_VARIANT_INVALID;
+            break;
+
+        case VCM_OP_END_NODE:
+            ret = *r;
+            break;
+
+        default:
+            PC_ASSERT(0);
+            break;
+        }
+
+        // the same as the end of pcvcm_node_to_variant()
+        if (ret == PURC_VARIANT_INVALID) {
+            deps.tracked = false;
+            if (silently && !has_fatal_error())
+                ret = purc_variant_make_undefined();
+        }
+        insn->node->attach = (uintptr_t)ret;
+
+        *r = ret;
+        if (ret == PURC_VARIANT_INVALID)
+            goto failed;
+
+        if (insn->op == VCM_OP_CHECK_CALLER)
+            insn = insns + insn->arg;
+        else
+            insn++;
+    }
+
+    ret = regs[0];
+    keep_last_value(state, ret, &deps);
+    goto out;
+
+failed:
+    release_regs(regs, code->nr_regs);
+    release_deps(deps.deps, deps.nr_deps);
+    ret = PURC_VARIANT_INVALID;
+
+out:
+    if (consts)
+        consts->nr_running--;
+    if (regs != local_regs)
+        free(regs);
+    return ret;
+}
+
+purc_variant_t pcvcm_code_eval(struct pcvcm_code *code,
+        struct pcintr_stack *stack, bool silently)
+{
+    struct pcvcm_node_op ops = {
+        .find_var = NULL,
+        .find_var_ctxt = NULL,
+        .consts = NULL,
+        .stack = stack,
+    };
+
+    if (stack) {
+        ops.find_var = find_stack_var;
+        ops.find_var_ctxt = stack;
+        ops.consts = get_instance_consts();
+    }
+
+    return code_eval(code, &ops, ops.consts, silently);
+}
+
+purc_variant_t pcvcm_code_eval_ex(struct pcvcm_code *code,
+        cb_find_var find_var, void *ctxt, bool silently)
+{
+    struct pcvcm_node_op ops = {
+        .find_var = find_var,
+        .find_var_ctxt = ctxt,
+        .consts = NULL,
+    };
+
+    // the folded nodes are not used, but the state is kept all the same
+    return code_eval(code, &ops, get_instance_consts(), silently);
+}
+
 static purc_variant_t
 eval_getter(void *native_entity, size_t nr_args, purc_variant_t *argv,
         bool silently)
@@ -81,6 +81,9 @@ struct pcvdom_document {
 
     atomic_ulong            refc;
 
+    // the number of the vcm nodes folded to constants
+    size_t                  nr_folded_vcm_nodes;
+
     unsigned int            quirks:1;
 };
 
@@ -98,6 +101,9 @@ struct pcvdom_attr {
 
     // text/jsonnee/no-value
     struct pcvcm_node        *val;
+
+    // the compiled val, NULL if not compiled
+    struct pcvcm_code        *code;
 };
 
 struct pcvdom_element {
@@ -119,6 +125,9 @@ struct pcvdom_content {
     struct pcvdom_node      node;
 
     struct pcvcm_node      *vcm;
+
+    // the compiled vcm, NULL if not compiled
+    struct pcvcm_code      *code;
 };
 
 struct pcvdom_comment {
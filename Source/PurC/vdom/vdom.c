@@ -328,6 +328,97 @@ pcvdom_document_get_root(struct pcvdom_document *doc)
     return doc->root;
 }
 
+static int
+attr_fold_constants(void *key, void *val, void *ud)
+{
+    UNUSED_PARAM(key);
+    struct pcvdom_attr *attr = (struct pcvdom_attr*)val;
+    size_t *nr_folded = (size_t*)ud;
+
+    *nr_folded += pcvcm_node_fold_constants(attr->val);
+    return 0;
+}
+
+static int
+node_fold_constants(struct pcvdom_node *top, struct pcvdom_node *node,
+        void *ctx)
+{
+    UNUSED_PARAM(top);
+    size_t *nr_folded = (size_t*)ctx;
+
+    if (node->type == PCVDOM_NODE_ELEMENT) {
+        struct pcvdom_element *elem = PCVDOM_ELEMENT_FROM_NODE(node);
+        if (elem->attrs)
+            pcutils_map_traverse(elem->attrs, nr_folded, attr_fold_constants);
+    }
+    else if (node->type == PCVDOM_NODE_CONTENT) {
+        struct pcvdom_content *content = PCVDOM_CONTENT_FROM_NODE(node);
+        *nr_folded += pcvcm_node_fold_constants(content->vcm);
+    }
+
+    return 0;
+}
+
+size_t
+pcvdom_document_fold_constants(struct pcvdom_document *doc)
+{
+    size_t nr_folded = 0;
+    pcvdom_node_traverse(&doc->node, &nr_folded, node_fold_constants);
+
+    doc->nr_folded_vcm_nodes = nr_folded;
+    return nr_folded;
+}
+
+size_t
+pcvdom_document_nr_folded_vcm_nodes(struct pcvdom_document *doc)
+{
+    return doc->nr_folded_vcm_nodes;
+}
+
+static int
+attr_compile_vcm(void *key, void *val, void *ud)
+{
+    UNUSED_PARAM(key);
+    UNUSED_PARAM(ud);
+    struct pcvdom_attr *attr = (struct pcvdom_attr*)val;
+
+    if (attr->val && !attr->code)
+        attr->code = pcvcm_compile(attr->val);
+    return 0;
+}
+
+static int
+node_compile_vcm(struct pcvdom_node *top, struct pcvdom_node *node,
+        void *ctx)
+{
+    UNUSED_PARAM(top);
+    UNUSED_PARAM(ctx);
+
+    if (node->type == PCVDOM_NODE_ELEMENT) {
+        struct pcvdom_element *elem = PCVDOM_ELEMENT_FROM_NODE(node);
+        if (elem->attrs)
+            pcutils_map_traverse(elem->attrs, NULL, attr_compile_vcm);
+    }
+    else if (node->type == PCVDOM_NODE_CONTENT) {
+        struct pcvdom_content *content = PCVDOM_CONTENT_FROM_NODE(node);
+        if (content->vcm && !content->code)
+            content->code = pcvcm_compile(content->vcm);
+    }
+
+    return 0;
+}
+
+void
+pcvdom_document_compile_vcm(struct pcvdom_document *doc)
+{
+    const char *env_value = getenv(PURC_ENVV_VCM_TREE_WALKER);
+    if (env_value && (*env_value == '1' ||
+                pcutils_strcasecmp(env_value, "true") == 0))
+        return;
+
+    pcvdom_node_traverse(&doc->node, NULL, node_compile_vcm);
+}
+
 int
 pcvdom_document_append_comment(struct pcvdom_document *doc,
         struct pcvdom_comment *comment)
@@ -1109,6 +1200,9 @@ element_create(void)
 static void
 content_reset(struct pcvdom_content *content)
 {
+    pcvcm_code_destroy(content->code);
+    content->code = NULL;
+
     if (content->vcm) {
         pcvcm_node_destroy(content->vcm);
         content->vcm= NULL;
@@ -1190,6 +1284,9 @@ attr_reset(struct pcvdom_attr *attr)
     attr->pre_defined = NULL;
     attr->key = NULL;
 
+    pcvcm_code_destroy(attr->code);
+    attr->code = NULL;
+
     pcvcm_node_destroy(attr->val);
     attr->val = NULL;
 }
@@ -1335,10 +1432,8 @@ pcvdom_element_eval_attr_val(pcintr_stack_t stack, pcvdom_element_t element,
     if (!attr)
         return purc_variant_make_undefined();
 
-    struct pcvcm_node           *val = attr->val;
-
     purc_variant_t v;
-    v = pcvcm_eval(val, stack, pcvdom_element_is_silently(element));
+    v = pcvdom_attr_eval(stack, attr, pcvdom_element_is_silently(element));
 #if 0 // VW
     PC_ASSERT(v != PURC_VARIANT_INVALID);
 
@@ -1350,6 +1445,24 @@ pcvdom_element_eval_attr_val(pcintr_stack_t stack, pcvdom_element_t element,
     return v;
 }
 
+purc_variant_t
+pcvdom_attr_eval(pcintr_stack_t stack, struct pcvdom_attr *attr,
+        bool silently)
+{
+    if (attr->code)
+        return pcvcm_code_eval(attr->code, stack, silently);
+    return pcvcm_eval(attr->val, stack, silently);
+}
+
+purc_variant_t
+pcvdom_content_eval(pcintr_stack_t stack, struct pcvdom_content *content,
+        bool silently)
+{
+    if (content->code)
+        return pcvcm_code_eval(content->code, stack, silently);
+    return pcvcm_eval(content->vcm, stack, silently);
+}
+
 #define SILENTLY_ATTR_NAME          "silently"
 #define SILENTLY_ATTR_FULL_NAME     "hvml:silently"
 
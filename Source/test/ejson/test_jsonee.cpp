@@ -329,3 +329,77 @@ std::vector<ejson_test_data> read_ejson_test_data()
 INSTANTIATE_TEST_SUITE_P(ejson, ejson_parser_vcm_eval,
         testing::ValuesIn(read_ejson_test_data()));
 
+
+static bool
+collect_value(void *ctxt, purc_variant_t value)
+{
+    std::vector<std::string> *values = (std::vector<std::string> *)ctxt;
+    char buf[256];
+    purc_rwstream_t rws = purc_rwstream_new_from_mem(buf, sizeof(buf) - 1);
+    size_t len_expected = 0;
+    ssize_t n = purc_variant_serialize(value, rws, 0,
+            PCVARIANT_SERIALIZE_OPT_PLAIN, &len_expected);
+    purc_rwstream_destroy(rws);
+    if (n < 0)
+        return false;
+
+    buf[n] = 0;
+    values->push_back(buf);
+    return true;
+}
+
+TEST(ejson, feed)
+{
+    PurCInstance purc;
+
+    static const char *json = "{\"a\":\"x}\\\"y\"}[1,[2]] 3 \"s t\" "
+        "true\n'q}' {\"b\":[]}";
+    static const char *expected[] = {
+        "{\"a\":\"x}\\\"y\"}", "[1,[2]]", "3", "\"s t\"", "true",
+        "\"q}\"", "{\"b\":[]}",
+    };
+
+    for (size_t step = 1; step <= 7; step++) {
+        std::vector<std::string> values;
+        struct pcejson_feeder *feeder = pcejson_feeder_create(0, 0,
+                collect_value, &values);
+        ASSERT_NE(feeder, nullptr);
+
+        size_t len = strlen(json);
+        for (size_t i = 0; i < len; i += step) {
+            size_t n = (len - i < step) ? len - i : step;
+            ASSERT_EQ(pcejson_feed(feeder, json + i, n), PCEJSON_SUCCESS);
+        }
+        ASSERT_EQ(pcejson_feed_end(feeder), PCEJSON_SUCCESS);
+        pcejson_feeder_destroy(feeder);
+
+        ASSERT_EQ(values.size(), PCA_TABLESIZE(expected));
+        for (size_t i = 0; i < values.size(); i++)
+            ASSERT_STREQ(values[i].c_str(), expected[i]);
+    }
+
+    // newline-delimited JSON
+    std::vector<std::string> values;
+    struct pcejson_feeder *feeder = pcejson_feeder_create(0,
+            PCEJSON_FEED_FLAG_NDJSON, collect_value, &values);
+    ASSERT_NE(feeder, nullptr);
+
+    static const char *lines = "{\"id\": 1}\n\n[1, 2]\r\n\"\xe4\xb8\xad\"\n7";
+    for (const char *p = lines; *p; p++)
+        ASSERT_EQ(pcejson_feed(feeder, p, 1), PCEJSON_SUCCESS);
+    ASSERT_EQ(pcejson_feed_end(feeder), PCEJSON_SUCCESS);
+    pcejson_feeder_destroy(feeder);
+
+    ASSERT_EQ(values.size(), 4);
+    ASSERT_STREQ(values[0].c_str(), "{\"id\":1}");
+    ASSERT_STREQ(values[1].c_str(), "[1,2]");
+    ASSERT_STREQ(values[2].c_str(), "\"\xe4\xb8\xad\"");
+    ASSERT_STREQ(values[3].c_str(), "7");
+
+    // unterminated container
+    feeder = pcejson_feeder_create(0, 0, collect_value, &values);
+    ASSERT_EQ(pcejson_feed(feeder, "[1, 2", 5), PCEJSON_SUCCESS);
+    ASSERT_EQ(pcejson_feed_end(feeder), -1);
+    ASSERT_EQ(purc_get_last_error(), PCEJSON_ERROR_UNEXPECTED_EOF);
+    pcejson_feeder_destroy(feeder);
+}
@@ -74,3 +74,58 @@ TEST(hvml, basic)
     ASSERT_EQ (cleanup, true);
 }
 
+
+TEST(hvml, tokenizer_throughput)
+{
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex (PURC_MODULE_HVML, "cn.fmsoft.hybridos.test",
+            "test_init", &info);
+    ASSERT_EQ (ret, PURC_ERROR_OK);
+
+    std::string hvml = "<!DOCTYPE hvml>\n<hvml target=\"html\">\n<body>\n";
+    for (int i = 0; i < 8192; i++) {
+        std::string id = std::to_string(i);
+        hvml += "  <div class=\"item\" id=\"item-" + id + "\">"
+            "The item in the list, 列表中的项目 " + id + "</div>\n"
+            "  <init as=\"data" + id + "\">\n"
+            "    [ { \"letters\": \"7\", \"class\": \"number\" }, "
+            "{ \"letters\": \"÷\", \"class\": \"c_blue division\" } ]\n"
+            "  </init>\n";
+    }
+    hvml += "</body>\n</hvml>\n";
+
+    size_t nr_chars = 0;
+    for (size_t i = 0; i < hvml.size(); i++) {
+        if ((hvml[i] & 0xC0) != 0x80)
+            nr_chars++;
+    }
+
+    struct pchvml_parser* parser = pchvml_create(0, 32);
+    purc_rwstream_t rws = purc_rwstream_new_from_mem((void*)hvml.c_str(),
+            hvml.size());
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    size_t nr_tokens = 0;
+    struct pchvml_token* token = NULL;
+    while((token = pchvml_next_token(parser, rws)) != NULL) {
+        enum pchvml_token_type type = pchvml_token_get_type(token);
+        pchvml_token_destroy(token);
+        nr_tokens++;
+        if (type == PCHVML_TOKEN_EOF) {
+            break;
+        }
+    }
+
+    double secs = purc_get_elapsed_seconds(&ts, NULL);
+    ASSERT_GT(nr_tokens, 8192U * 4);
+    fprintf(stderr, "%zu chars, %zu tokens: %.1f M chars/s\n",
+            nr_chars, nr_tokens, nr_chars / secs / 1000000);
+
+    purc_rwstream_destroy(rws);
+    pchvml_destroy(parser);
+
+    bool cleanup = purc_cleanup ();
+    ASSERT_EQ (cleanup, true);
+}
@@ -382,6 +382,35 @@ TEST_P(test_vcm_eval, parse_and_serialize)
         ASSERT_STREQ(buf, comp) << "Test Case : "<< get_name();
     }
 
+    // the compiled code must give the same result as the tree walker
+    struct pcvcm_code* code = pcvcm_compile(root);
+    ASSERT_NE(code, nullptr) << "Test Case : "<< get_name();
+
+    // the second run goes through the inline caches filled by the first
+    for (int i = 0; i < 2; i++) {
+        purc_variant_t vt_code = pcvcm_code_eval_ex(code, find_var, &ctxt,
+                false);
+        ASSERT_NE(vt_code, PURC_VARIANT_INVALID) << "Test Case : "<< get_name();
+
+        char buf_code[1024] = {0};
+        purc_rwstream_t code_rws = purc_rwstream_new_from_mem(buf_code,
+                sizeof(buf_code) - 1);
+        ASSERT_NE(code_rws, nullptr) << "Test Case : "<< get_name();
+
+        n = purc_variant_serialize(vt_code, code_rws,
+                0, PCVARIANT_SERIALIZE_OPT_PLAIN, &len_expected);
+        ASSERT_GT(n, 0) << "Test Case : "<< get_name();
+
+        buf_code[n] = 0;
+        if (strcmp(comp, "#####") != 0) {
+            ASSERT_STREQ(buf_code, buf) << "Test Case : "<< get_name();
+        }
+
+        purc_variant_unref(vt_code);
+        purc_rwstream_destroy(code_rws);
+    }
+    pcvcm_code_destroy(code);
+
     purc_variant_unref(obj_set_val_0_k);
     purc_variant_unref(obj_set_val_0_v);
     purc_variant_unref(obj_set_val_0);
@@ -407,6 +436,63 @@ TEST_P(test_vcm_eval, parse_and_serialize)
     pchvml_destroy(parser);
 }
 
+static purc_variant_t find_obj_var(void* ctxt, const char* name)
+{
+    if (strcmp(name, "OBJ") == 0) {
+        return *(purc_variant_t*)ctxt;
+    }
+    return PURC_VARIANT_INVALID;
+}
+
+static void
+expect_code_value(struct pcvcm_code* code, purc_variant_t* obj,
+        const char* expected)
+{
+    purc_variant_t v = pcvcm_code_eval_ex(code, find_obj_var, obj, false);
+    ASSERT_NE(v, PURC_VARIANT_INVALID);
+    ASSERT_STREQ(purc_variant_get_string_const(v), expected);
+    purc_variant_unref(v);
+}
+
+// the last value of a code is reused only if what it read is not changed
+TEST(vcm_code, reuse_last_value)
+{
+    PurCInstance purc(false);
+    ASSERT_TRUE(purc);
+
+    struct pcvcm_node* root = pcvcm_node_new_get_element(
+            pcvcm_node_new_get_variable(pcvcm_node_new_string("OBJ")),
+            pcvcm_node_new_string("name"));
+    struct pcvcm_code* code = pcvcm_compile(root);
+    ASSERT_NE(code, nullptr);
+
+    purc_variant_t one = purc_variant_make_string("one", false);
+    purc_variant_t two = purc_variant_make_string("two", false);
+    purc_variant_t obj = purc_variant_make_object_by_static_ckey(1,
+            "name", one);
+    purc_variant_t other = purc_variant_make_object_by_static_ckey(1,
+            "name", one);
+
+    expect_code_value(code, &obj, "one");
+    expect_code_value(code, &obj, "one");
+
+    // the member is changed
+    purc_variant_object_set_by_static_ckey(obj, "name", two);
+    expect_code_value(code, &obj, "two");
+
+    // the variable is bound to another object
+    expect_code_value(code, &other, "one");
+    expect_code_value(code, &obj, "two");
+
+    pcvcm_code_destroy(code);
+    pcvcm_node_destroy(root);
+
+    purc_variant_unref(other);
+    purc_variant_unref(obj);
+    purc_variant_unref(two);
+    purc_variant_unref(one);
+}
+
 char* read_file (const char* file)
 {
     FILE* fp = fopen (file, "r");
@@ -200,6 +200,72 @@ TEST(stdio_rwstream, read_utf8_char)
 }
 
 
+TEST(stdio_rwstream, read_utf8_chars)
+{
+    char tmp_file[] = "/tmp/rwstream.txt";
+    char buf[] = "This这 is 测。";
+    size_t buf_len = strlen(buf);
+    create_temp_file(tmp_file, buf, buf_len);
+
+    purc_rwstream_t rws = purc_rwstream_new_from_file(tmp_file, "r");
+    ASSERT_NE(rws, nullptr);
+
+    /* a stdio stream is not read ahead of the characters asked for, so
+       the characters may come in several calls */
+    uint32_t chars[16];
+    ssize_t nr = 0;
+    while (nr < 5) {
+        ssize_t ret = purc_rwstream_read_utf8_chars (rws, chars + nr, 5 - nr);
+        ASSERT_GT(ret, 0);
+        nr += ret;
+    }
+    ASSERT_EQ(nr, 5);
+    ASSERT_EQ(chars[0], 'T');
+    ASSERT_EQ(chars[3], 's');
+    ASSERT_EQ(chars[4], 0x8FD9);
+
+    /* the bytes read ahead are not lost for the other operations */
+    off_t pos = purc_rwstream_tell (rws);
+    ASSERT_EQ(pos, 7);
+
+    char read_buf[10] = {0};
+    int read_len = purc_rwstream_read (rws, read_buf, 3);
+    ASSERT_EQ(read_len, 3);
+    ASSERT_STREQ(read_buf, " is");
+
+    nr = 0;
+    while (nr < 3) {
+        ssize_t ret = purc_rwstream_read_utf8_chars (rws, chars + nr, 16);
+        ASSERT_GT(ret, 0);
+        nr += ret;
+    }
+    ASSERT_EQ(nr, 3);
+    ASSERT_EQ(chars[0], ' ');
+    ASSERT_EQ(chars[1], 0x6D4B);
+    ASSERT_EQ(chars[2], 0x3002);
+
+    nr = purc_rwstream_read_utf8_chars (rws, chars, 16);
+    ASSERT_EQ(nr, 0);
+
+    pos = purc_rwstream_seek (rws, 1, SEEK_SET);
+    ASSERT_EQ(pos, 1);
+    nr = purc_rwstream_read_utf8_chars (rws, chars, 1);
+    ASSERT_EQ(nr, 1);
+    ASSERT_EQ(chars[0], 'h');
+
+    pos = purc_rwstream_seek (rws, 1, SEEK_CUR);
+    ASSERT_EQ(pos, 3);
+    nr = purc_rwstream_read_utf8_chars (rws, chars, 1);
+    ASSERT_EQ(nr, 1);
+    ASSERT_EQ(chars[0], 's');
+
+    int ret = purc_rwstream_destroy (rws);
+    ASSERT_EQ(ret, 0);
+
+    remove_temp_file(tmp_file);
+}
+
+
 TEST(stdio_rwstream, seek_tell)
 {
     char tmp_file[] = "/tmp/rwstream.txt";
@@ -464,6 +530,33 @@ TEST(mem_rwstream, read_utf8_char)
 }
 
 
+TEST(mem_rwstream, read_utf8_chars)
+{
+    char buf[] = "This is a long line, 这是一个长行。\xE8\x80This";
+    size_t buf_len = strlen(buf);
+
+    purc_rwstream_t rws = purc_rwstream_new_from_mem (buf, buf_len);
+    ASSERT_NE(rws, nullptr);
+
+    uint32_t chars[64];
+    ssize_t nr = purc_rwstream_read_utf8_chars (rws, chars, 64);
+    ASSERT_EQ(nr, 28);
+    ASSERT_EQ(chars[19], ',');
+    ASSERT_EQ(chars[21], 0x8FD9);
+    ASSERT_EQ(chars[27], 0x3002);
+
+    /* the bad sequence is reported by the next call */
+    nr = purc_rwstream_read_utf8_chars (rws, chars, 64);
+    ASSERT_EQ(nr, -1);
+
+    nr = purc_rwstream_read_utf8_chars (rws, chars, 64);
+    ASSERT_EQ(nr, 3);
+    ASSERT_EQ(chars[0], 'h');
+
+    int ret = purc_rwstream_destroy (rws);
+    ASSERT_EQ(ret, 0);
+}
+
 TEST(mem_rwstream, seek_tell)
 {
     char buf[] = "This is test file. 这是测试文件。";
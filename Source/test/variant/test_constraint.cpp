@@ -1116,3 +1116,136 @@ TEST(constraint, set_change)
     map_destroy();
 }
 
+
+TEST(constraint, batch)
+{
+    PurCInstance purc;
+
+    purc_variant_t set = purc_variant_make_set_by_ckey(0, "id",
+            PURC_VARIANT_INVALID);
+    ASSERT_NE(set, PURC_VARIANT_INVALID);
+
+    purc_variant_t recs[2];
+    for (size_t i = 0; i < PCA_TABLESIZE(recs); i++) {
+        purc_variant_t id = purc_variant_make_ulongint(i);
+        recs[i] = purc_variant_make_object_by_static_ckey(1, "id", id);
+        ASSERT_TRUE(purc_variant_set_add(set, recs[i], false));
+        purc_variant_unref(id);
+    }
+
+    purc_variant_begin_batch();
+
+    // the fields other than the unique keys
+    for (int i = 0; i < 20; i++) {
+        purc_variant_t v = purc_variant_make_longint(i);
+        ASSERT_TRUE(purc_variant_object_set_by_static_ckey(recs[0], "val", v));
+        purc_variant_unref(v);
+    }
+
+    // the uniqueness is still checked at once
+    purc_variant_t id1 = purc_variant_make_ulongint(1);
+    ASSERT_FALSE(purc_variant_object_set_by_static_ckey(recs[0], "id", id1));
+
+    // the set is adjusted before being looked up in the batch
+    purc_variant_t id9 = purc_variant_make_ulongint(9);
+    ASSERT_TRUE(purc_variant_object_set_by_static_ckey(recs[0], "id", id9));
+    ASSERT_EQ(purc_variant_set_get_member_by_key_values(set, id9), recs[0]);
+
+    // nested
+    purc_variant_begin_batch();
+    ASSERT_TRUE(purc_variant_object_set_by_static_ckey(recs[1], "val", id9));
+    ASSERT_FALSE(purc_variant_object_set_by_static_ckey(recs[1], "id", id9));
+    purc_variant_end_batch();
+
+    purc_variant_end_batch();
+
+    purc_variant_t id0 = purc_variant_make_ulongint(0);
+    ASSERT_EQ(purc_variant_set_get_member_by_key_values(set, id0),
+            PURC_VARIANT_INVALID);
+    ASSERT_EQ(purc_variant_set_get_member_by_key_values(set, id9), recs[0]);
+    ASSERT_EQ(purc_variant_set_get_member_by_key_values(set, id1), recs[1]);
+
+    purc_variant_unref(id0);
+    purc_variant_unref(id1);
+    purc_variant_unref(id9);
+    for (size_t i = 0; i < PCA_TABLESIZE(recs); i++)
+        purc_variant_unref(recs[i]);
+    purc_variant_unref(set);
+}
+
+static bool
+count_changes(purc_variant_t src, pcvar_op_t op, void *ctxt,
+        size_t nr_args, purc_variant_t *argv)
+{
+    (void)src;
+    (void)op;
+    (void)argv;
+
+    size_t *counts = (size_t *)ctxt;
+    counts[0]++;            // the events
+    counts[1] += nr_args;   // the old and the new members
+    return true;
+}
+
+static void
+overwrite_record(purc_variant_t set, uint64_t id, int64_t val)
+{
+    purc_variant_t rec = purc_variant_make_object_0();
+    purc_variant_t v = purc_variant_make_ulongint(id);
+    ASSERT_TRUE(purc_variant_object_set_by_static_ckey(rec, "id", v));
+    purc_variant_unref(v);
+
+    v = purc_variant_make_longint(val);
+    ASSERT_TRUE(purc_variant_object_set_by_static_ckey(rec, "val", v));
+    purc_variant_unref(v);
+
+    ASSERT_TRUE(purc_variant_set_add(set, rec, true));
+    purc_variant_unref(rec);
+}
+
+TEST(constraint, batch_events)
+{
+    PurCInstance purc;
+
+    purc_variant_t set = purc_variant_make_set_by_ckey(0, "id",
+            PURC_VARIANT_INVALID);
+    ASSERT_NE(set, PURC_VARIANT_INVALID);
+
+    for (uint64_t i = 0; i < 4; i++)
+        overwrite_record(set, i, 0);
+
+    size_t counts[2] = { 0, 0 };
+    struct pcvar_listener *listener;
+    listener = purc_variant_register_post_listener(set,
+            PCVAR_OPERATION_CHANGE, count_changes, counts);
+    ASSERT_NE(listener, nullptr);
+
+    // one event for every change out of a batch
+    for (uint64_t i = 0; i < 4; i++)
+        overwrite_record(set, i, 1);
+    ASSERT_EQ(counts[0], 4);
+    ASSERT_EQ(counts[1], 8);
+
+    // the records overwritten in a batch, as an <update> does
+    counts[0] = counts[1] = 0;
+    purc_variant_begin_batch();
+    for (uint64_t i = 0; i < 4; i++)
+        overwrite_record(set, i, 2);
+
+    purc_variant_begin_batch();
+    overwrite_record(set, 0, 3);
+    purc_variant_end_batch();
+    ASSERT_EQ(counts[0], 0);
+
+    purc_variant_end_batch();
+    ASSERT_EQ(counts[0], 1);
+    ASSERT_EQ(counts[1], 10);
+
+    // nothing is left to be told
+    purc_variant_begin_batch();
+    purc_variant_end_batch();
+    ASSERT_EQ(counts[0], 1);
+
+    ASSERT_TRUE(purc_variant_revoke_listener(set, listener));
+    purc_variant_unref(set);
+}
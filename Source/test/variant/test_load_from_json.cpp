@@ -26,6 +26,8 @@
 #include "../helpers.h"
 
 #include <stdio.h>
+#include <signal.h>
+#include <unistd.h>
 #include <gtest/gtest.h>
 
 using namespace std;
@@ -271,3 +273,183 @@ std::vector<ejson_test_data> read_ejson_test_data()
 INSTANTIATE_TEST_SUITE_P(ejson, variant_load_from_json,
         testing::ValuesIn(read_ejson_test_data()));
 
+
+static purc_variant_t
+load_by_ejson_parser(const char *json)
+{
+    purc_rwstream_t rws = purc_rwstream_new_from_mem((void *)json,
+            strlen(json));
+    purc_variant_t v = purc_variant_load_from_json_stream(rws);
+    purc_rwstream_destroy(rws);
+    return v;
+}
+
+TEST(variant, json_fast_path)
+{
+    purc_init_ex (PURC_MODULE_VARIANT, "cn.fmsoft.hybridos.test", "variant",
+            NULL);
+
+    const char *strict[] = {
+        "123",
+        "[-0.5e-3]",
+        "\"hello\"",
+        "  [1, 2.5, true, false, null, \"\", [], {}]  ",
+        "{\"a\":{\"b\":[1,{\"c\":\"d\"}]},\"e\":\"\xe4\xb8\xad\xe6\x96\x87\"}",
+        "[\"a\\nb\", \"q\\\"q\", \"s\\/s\", \"\\u4e2d\", \"\\$\"]",
+        "{\"dup\":1, \"dup\":2}",
+    };
+
+    for (size_t i = 0; i < PCA_TABLESIZE(strict); i++) {
+        purc_variant_t fast = pcejson_parse_json(strict[i],
+                strlen(strict[i]), PCEJSON_DEFAULT_DEPTH);
+        ASSERT_NE(fast, PURC_VARIANT_INVALID) << strict[i];
+
+        purc_variant_t slow = load_by_ejson_parser(strict[i]);
+        ASSERT_NE(slow, PURC_VARIANT_INVALID) << strict[i];
+        ASSERT_TRUE(purc_variant_is_equal_to(fast, slow)) << strict[i];
+
+        purc_variant_unref(fast);
+        purc_variant_unref(slow);
+    }
+
+    // left to the eJSON parser
+    const char *extended[] = {
+        "{key:1}",
+        "['single']",
+        "123L",
+        "NaN",
+        "undefined",
+        "\"$TIMERS\"",
+        "[1, 2,]",
+        "[1] [2]",
+        "\"\xff\"",
+    };
+
+    for (size_t i = 0; i < PCA_TABLESIZE(extended); i++) {
+        purc_variant_t fast = pcejson_parse_json(extended[i],
+                strlen(extended[i]), PCEJSON_DEFAULT_DEPTH);
+        ASSERT_EQ(fast, PURC_VARIANT_INVALID) << extended[i];
+    }
+
+    purc_cleanup ();
+}
+
+TEST(variant, json_fast_path_perf)
+{
+    purc_init_ex (PURC_MODULE_VARIANT, "cn.fmsoft.hybridos.test", "variant",
+            NULL);
+
+    std::string json = "[";
+    for (int i = 0; i < 4096; i++) {
+        if (i)
+            json += ",";
+        json += "{\"id\":" + std::to_string(i) +
+            ",\"name\":\"the name of the item in the list\""
+            ",\"price\":12.5,\"tags\":[\"new\",\"hot\"],\"valid\":true}";
+    }
+    json += "]";
+
+    struct timespec ts;
+    double mb = json.size() / 1048576.0;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    purc_variant_t fast = purc_variant_make_from_json_string(json.c_str(),
+            json.size());
+    double t_fast = purc_get_elapsed_seconds(&ts, NULL);
+    ASSERT_NE(fast, PURC_VARIANT_INVALID);
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    purc_variant_t slow = load_by_ejson_parser(json.c_str());
+    double t_slow = purc_get_elapsed_seconds(&ts, NULL);
+    ASSERT_NE(slow, PURC_VARIANT_INVALID);
+
+    ASSERT_TRUE(purc_variant_is_equal_to(fast, slow));
+    fprintf(stderr, "%.2f MB: %.1f MB/s (fast path), %.1f MB/s (eJSON)\n",
+            mb, mb / t_fast, mb / t_slow);
+
+    purc_variant_unref(fast);
+    purc_variant_unref(slow);
+
+    purc_cleanup ();
+}
+
+static void
+check_first_value(purc_variant_t v)
+{
+    ASSERT_NE(v, PURC_VARIANT_INVALID);
+    ASSERT_TRUE(purc_variant_is_array(v));
+    ASSERT_EQ(purc_variant_array_get_size(v), 2);
+    purc_variant_unref(v);
+}
+
+static void
+check_rest(purc_rwstream_t rws)
+{
+    char buf[32];
+    ssize_t nr = purc_rwstream_read(rws, buf, sizeof(buf));
+    ASSERT_EQ(nr, 8);
+    ASSERT_EQ(memcmp(buf, "{\"a\": 3}", 8), 0);
+}
+
+// the data after the value is left in the stream for the caller
+TEST(variant, load_from_json_stream_rest)
+{
+    purc_init_ex (PURC_MODULE_VARIANT, "cn.fmsoft.hybridos.test", "variant",
+            NULL);
+
+    const char *json = "[1, 2] {\"a\": 3}";
+    purc_rwstream_t rws = purc_rwstream_new_from_mem((void *)json,
+            strlen(json));
+    check_first_value(purc_variant_load_from_json_stream(rws));
+    check_rest(rws);
+    purc_rwstream_destroy(rws);
+
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    ASSERT_EQ(write(fds[1], json, strlen(json)), (ssize_t)strlen(json));
+    close(fds[1]);
+
+    rws = purc_rwstream_new_from_unix_fd(fds[0]);
+    check_first_value(purc_variant_load_from_json_stream(rws));
+    check_rest(rws);
+    purc_rwstream_destroy(rws);
+    close(fds[0]);
+
+    purc_cleanup ();
+}
+
+// a pipe is not waited for the data after the value
+TEST(variant, load_from_json_stream_pipe)
+{
+    purc_init_ex (PURC_MODULE_VARIANT, "cn.fmsoft.hybridos.test", "variant",
+            NULL);
+
+    // fail rather than hang if the pipe is waited for
+    alarm(10);
+
+    for (int i = 0; i < 2; i++) {
+        int fds[2];
+        ASSERT_EQ(pipe(fds), 0);
+        ASSERT_EQ(write(fds[1], "[1, 2] ", 7), 7);
+
+        purc_rwstream_t rws;
+        if (i == 0)
+            rws = purc_rwstream_new_from_unix_fd(fds[0]);
+        else
+            rws = purc_rwstream_new_from_fp(fdopen(fds[0], "r"));
+        ASSERT_NE(rws, nullptr);
+
+        check_first_value(purc_variant_load_from_json_stream(rws));
+
+        ASSERT_EQ(write(fds[1], "{\"a\": 3}", 8), 8);
+        close(fds[1]);
+        check_rest(rws);
+
+        purc_rwstream_destroy(rws);
+        if (i == 0)
+            close(fds[0]);
+    }
+
+    alarm(0);
+    purc_cleanup ();
+}
@@ -24,7 +24,9 @@
 #include "private/stringbuilder.h"
 #include "private/utils.h"
 #include "purc-rwstream.h"
+#include "../helpers.h"
 
+#include <math.h>
 #include <stdio.h>
 #include <gtest/gtest.h>
 
@@ -113,6 +115,73 @@ TEST(variant, numberify)
     ASSERT_EQ (cleanup, true);
 }
 
+TEST(variant, numeric_stat)
+{
+    // the instance is cleaned up even if an assertion fails, so that the
+    // failure does not break the following cases.
+    PurCInstance purc(PURC_MODULE_VARIANT, "cn.fmsoft.hybridos.test",
+            "test_init");
+    ASSERT_TRUE(purc);
+
+    // more members than a chunk, and not a multiple of the lanes
+    const size_t nr = 1003;
+    purc_variant_t arr = purc_variant_make_array_0();
+    purc_variant_t set = purc_variant_make_set_by_ckey(0, NULL, NULL);
+    for (size_t i = 0; i < nr; i++) {
+        purc_variant_t v;
+        if (i % 3 == 0)
+            v = purc_variant_make_longint((int64_t)i);
+        else
+            v = purc_variant_make_number((double)i);
+        ASSERT_TRUE(purc_variant_array_append(arr, v));
+        ASSERT_TRUE(purc_variant_set_add(set, v, false));
+        purc_variant_unref(v);
+    }
+
+    struct purc_variant_numeric_stat stat;
+    ASSERT_TRUE(purc_variant_linear_container_numeric_stat(arr, &stat));
+    ASSERT_EQ(stat.count, nr);
+    ASSERT_EQ(stat.sum, (double)(nr * (nr - 1) / 2));
+    ASSERT_EQ(stat.min, 0.0);
+    ASSERT_EQ(stat.max, (double)(nr - 1));
+
+    ASSERT_TRUE(purc_variant_linear_container_numeric_stat(set, &stat));
+    ASSERT_EQ(stat.count, nr);
+    ASSERT_EQ(stat.sum, (double)(nr * (nr - 1) / 2));
+
+    double dot;
+    ASSERT_TRUE(purc_variant_linear_container_dot(arr, set, &dot));
+    ASSERT_EQ(dot, (double)((nr - 1) * nr * (2 * nr - 1) / 6));
+
+    // NaNs are counted, but not summed
+    purc_variant_t nan = purc_variant_make_number(NAN);
+    ASSERT_TRUE(purc_variant_array_append(arr, nan));
+    ASSERT_TRUE(purc_variant_linear_container_numeric_stat(arr, &stat));
+    ASSERT_EQ(stat.count, nr + 1);
+    ASSERT_EQ(stat.sum, (double)(nr * (nr - 1) / 2));
+    ASSERT_EQ(stat.max, (double)(nr - 1));
+
+    ASSERT_FALSE(purc_variant_linear_container_dot(arr, set, &dot));
+    ASSERT_EQ(purc_get_last_error(), PURC_ERROR_INVALID_VALUE);
+
+    purc_variant_t tuple = purc_variant_make_tuple(1, &nan);
+    ASSERT_TRUE(purc_variant_linear_container_numeric_stat(tuple, &stat));
+    ASSERT_EQ(stat.count, 1);
+    ASSERT_EQ(stat.sum, 0.0);
+    ASSERT_TRUE(isnan(stat.min));
+    ASSERT_TRUE(isnan(stat.max));
+
+    purc_variant_t obj = load_variant("{'a':10}");
+    ASSERT_FALSE(purc_variant_linear_container_numeric_stat(obj, &stat));
+    ASSERT_EQ(purc_get_last_error(), PURC_ERROR_WRONG_DATA_TYPE);
+
+    purc_variant_unref(obj);
+    purc_variant_unref(tuple);
+    purc_variant_unref(nan);
+    purc_variant_unref(set);
+    purc_variant_unref(arr);
+}
+
 struct booleanize_record
 {
     bool                       b;
@@ -267,6 +267,84 @@ TEST(variant, serialize_number)
     purc_cleanup ();
 }
 
+// to test: the shortest round-trip formatting of doubles
+TEST(variant, serialize_number_shortest)
+{
+    int ret = purc_init_ex (PURC_MODULE_VARIANT, "cn.fmsoft.hybridos.test",
+            "variant", NULL);
+    ASSERT_EQ (ret, PURC_ERROR_OK);
+
+    static const struct {
+        double d;
+        const char *expected;
+    } cases[] = {
+        { 0.1, "0.1" },
+        { -0.1, "-0.1" },
+        { 0.1 + 0.2, "0.30000000000000004" },
+        { 1.0 / 3, "0.3333333333333333" },
+        { 0.0001, "0.0001" },
+        { 0.00001, "1e-05" },
+        { -1.2345e-78, "-1.2345e-78" },
+        { 1e22, "10000000000000000000000" },
+        { -0.0, "-0" },
+        { 5e-324, "5e-324" },
+    };
+
+    char buf[64];
+    purc_rwstream_t my_rws = purc_rwstream_new_from_mem(buf, sizeof(buf) - 1);
+    ASSERT_NE(my_rws, nullptr);
+
+    for (size_t i = 0; i < PCA_TABLESIZE(cases); i++) {
+        purc_variant_t my_variant = purc_variant_make_number(cases[i].d);
+        ASSERT_NE(my_variant, PURC_VARIANT_INVALID);
+
+        purc_rwstream_seek(my_rws, 0, SEEK_SET);
+        size_t len_expected = 0;
+        ssize_t n = purc_variant_serialize(my_variant, my_rws,
+                0, PCVARIANT_SERIALIZE_OPT_PLAIN, &len_expected);
+        ASSERT_GT(n, 0);
+        ASSERT_EQ((size_t)n, len_expected);
+
+        buf[n] = 0;
+        ASSERT_STREQ(buf, cases[i].expected);
+        ASSERT_EQ(strtod(buf, NULL), cases[i].d);
+        purc_variant_unref(my_variant);
+    }
+
+    /* the escaped characters amid the clean runs */
+    purc_variant_t my_variant = purc_variant_make_string(
+            "abcdefghij\"klmnopqrstuvw\\xyz/0123456789\x01", false);
+    ASSERT_NE(my_variant, PURC_VARIANT_INVALID);
+
+    purc_rwstream_seek(my_rws, 0, SEEK_SET);
+    size_t len_expected = 0;
+    ssize_t n = purc_variant_serialize(my_variant, my_rws,
+            0, PCVARIANT_SERIALIZE_OPT_PLAIN, &len_expected);
+    ASSERT_GT(n, 0);
+
+    buf[n] = 0;
+    ASSERT_STREQ(buf,
+            "\"abcdefghij\\\"klmnopqrstuvw\\\\xyz\\/0123456789\\u0001\"");
+    purc_variant_unref(my_variant);
+
+    /* the size hint covers the values without escaped characters */
+    const char *json = "{\"a\":[1,true,\"xyz\"],\"b\":null}";
+    my_variant = purc_variant_make_from_json_string(json, strlen(json));
+    ASSERT_NE(my_variant, PURC_VARIANT_INVALID);
+
+    purc_rwstream_seek(my_rws, 0, SEEK_SET);
+    n = purc_variant_serialize(my_variant, my_rws,
+            0, PCVARIANT_SERIALIZE_OPT_PLAIN, NULL);
+    ASSERT_GT(n, 0);
+    ASSERT_GT(pcvariant_serialize_size_hint(my_variant,
+                PCVARIANT_SERIALIZE_OPT_PLAIN), (size_t)n);
+    purc_variant_unref(my_variant);
+
+    purc_rwstream_destroy(my_rws);
+
+    purc_cleanup ();
+}
+
 // to test: serialize a long integer
 TEST(variant, serialize_longint)
 {
@@ -994,3 +1072,76 @@ TEST(variant, serialize_object_with_empty_key2)
 
     purc_cleanup ();
 }
+
+TEST(variant, serialize_binary)
+{
+    int ret = purc_init_ex (PURC_MODULE_VARIANT, "cn.fmsoft.hybridos.test",
+            "variant", NULL);
+    ASSERT_EQ (ret, PURC_ERROR_OK);
+
+    purc_variant_t set = purc_variant_make_set_by_ckey(0, "id", NULL);
+    purc_variant_t arr = purc_variant_make_array_0();
+    for (int i = 0; i < 10; i++) {
+        purc_variant_t id = purc_variant_make_longint(-i * 1000);
+        purc_variant_t name = purc_variant_make_string("name", false);
+        purc_variant_t obj = purc_variant_make_object_by_static_ckey(2,
+                "id", id, "name", name);
+        ASSERT_TRUE(purc_variant_set_add(set, obj, false));
+        ASSERT_TRUE(purc_variant_array_append(arr, obj));
+        purc_variant_unref(obj);
+        purc_variant_unref(name);
+        purc_variant_unref(id);
+    }
+
+    const unsigned char bytes[] = { 0x00, 0x01, 0xFF };
+    purc_variant_t members[] = {
+        purc_variant_make_longdouble(1.0L / 3),
+        purc_variant_make_ulongint(UINT64_MAX),
+        purc_variant_make_byte_sequence(bytes, sizeof(bytes)),
+        purc_variant_make_atom_string("atom", false),
+        purc_variant_make_undefined(),
+        set,
+        arr,
+    };
+    purc_variant_t tuple = purc_variant_make_tuple(PCA_TABLESIZE(members),
+            members);
+    ASSERT_NE(tuple, PURC_VARIANT_INVALID);
+    for (size_t i = 0; i < PCA_TABLESIZE(members); i++)
+        purc_variant_unref(members[i]);
+
+    purc_rwstream_t rws = purc_rwstream_new_buffer(1024, 65536);
+    ssize_t n = purc_variant_serialize_binary(tuple, rws);
+    ASSERT_GT(n, 0);
+
+    size_t sz_content;
+    const char *buf = (const char *)purc_rwstream_get_mem_buffer(rws,
+            &sz_content);
+    ASSERT_EQ((size_t)n, sz_content);
+
+    purc_variant_t loaded = purc_variant_load_from_binary(buf, n);
+    ASSERT_NE(loaded, PURC_VARIANT_INVALID);
+    ASSERT_TRUE(purc_variant_is_equal_to(loaded, tuple));
+
+    purc_variant_t v = purc_variant_tuple_get(loaded, 0);
+    long double ld;
+    ASSERT_TRUE(purc_variant_cast_to_longdouble(v, &ld, false));
+    ASSERT_EQ(ld, 1.0L / 3);
+
+    v = purc_variant_tuple_get(loaded, 5);
+    ASSERT_TRUE(purc_variant_is_set(v));
+    purc_variant_t id = purc_variant_make_longint(-9000);
+    purc_variant_t found = purc_variant_set_get_member_by_key_values(v, id);
+    ASSERT_NE(found, PURC_VARIANT_INVALID);
+    purc_variant_unref(id);
+    purc_variant_unref(loaded);
+
+    // truncated data
+    loaded = purc_variant_load_from_binary(buf, n - 1);
+    ASSERT_EQ(loaded, PURC_VARIANT_INVALID);
+    ASSERT_EQ(purc_get_last_error(), PURC_ERROR_BAD_ENCODING);
+
+    purc_rwstream_destroy(rws);
+    purc_variant_unref(tuple);
+
+    purc_cleanup ();
+}
@@ -24,6 +24,7 @@
 
 #include <stdio.h>
 #include <errno.h>
+#include <math.h>
 #include <gtest/gtest.h>
 
 #ifndef MAX
@@ -1579,3 +1580,172 @@ TEST(variant, reuse_buff)
     purc_cleanup ();
 }
 
+
+TEST(variant, slab_stat)
+{
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex(PURC_MODULE_VARIANT, "cn.fmsfot.hvml.test",
+            "variant", &info);
+    ASSERT_EQ (ret, PURC_ERROR_OK);
+
+    const size_t nr_values = 10000;
+    purc_variant_t values[nr_values];
+    const struct purc_variant_stat *stat;
+
+    stat = purc_variant_usage_stat();
+    ASSERT_NE(stat, nullptr);
+    size_t nr_used_before = stat->nr_slab_used_slots;
+
+    for (size_t i = 0; i < nr_values; i++) {
+        // the small integers are shared and take no slot
+        values[i] = purc_variant_make_number(i + 0.5);
+        ASSERT_NE(values[i], PURC_VARIANT_INVALID);
+    }
+
+    stat = purc_variant_usage_stat();
+    ASSERT_GT(stat->nr_slab_pages, 0);
+    ASSERT_EQ(stat->sz_slab_mem,
+            stat->nr_slab_pages * PCVARIANT_SLAB_PAGE_SIZE);
+    ASSERT_GE(stat->nr_slab_used_slots, nr_used_before + nr_values);
+    ASSERT_LE(stat->nr_slab_used_slots, stat->nr_slab_slots);
+
+    size_t nr_pages = 0;
+    for (int i = 0; i < PURC_VARIANT_SLAB_OCCUPANCY_LEVELS; i++) {
+        nr_pages += stat->nr_slab_pages_by_occupancy[i];
+    }
+    ASSERT_EQ(nr_pages, stat->nr_slab_pages);
+    ASSERT_GT(stat->nr_slab_pages_by_occupancy[
+            PURC_VARIANT_SLAB_OCCUPANCY_LEVELS - 1], 0);
+
+    for (size_t i = 0; i < nr_values; i++) {
+        purc_variant_unref(values[i]);
+    }
+
+    stat = purc_variant_usage_stat();
+    ASSERT_LE(stat->nr_slab_used_slots,
+            nr_used_before + stat->nr_max_reserved);
+
+    purc_cleanup ();
+}
+
+TEST(variant, shared_small_integers)
+{
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex(PURC_MODULE_VARIANT, "cn.fmsfot.hvml.test",
+            "variant", &info);
+    ASSERT_EQ (ret, PURC_ERROR_OK);
+
+    const struct purc_variant_stat *stat = purc_variant_usage_stat();
+    size_t nr_total_values = stat->nr_total_values;
+
+    purc_variant_t n1 = purc_variant_make_number(5);
+    purc_variant_t n2 = purc_variant_make_number(5.0);
+    purc_variant_t i1 = purc_variant_make_longint(5);
+    purc_variant_t u1 = purc_variant_make_ulongint(5);
+    ASSERT_EQ(n1, n2);
+    ASSERT_NE(n1, i1);
+    ASSERT_NE(i1, u1);
+    ASSERT_TRUE(purc_variant_is_number(n1));
+    ASSERT_TRUE(purc_variant_is_longint(i1));
+    ASSERT_TRUE(purc_variant_is_ulongint(u1));
+    ASSERT_EQ(purc_variant_ref_count(n1), 2);
+
+    stat = purc_variant_usage_stat();
+    ASSERT_EQ(stat->nr_total_values, nr_total_values);
+
+    double d;
+    ASSERT_TRUE(purc_variant_cast_to_number(n1, &d, false));
+    ASSERT_EQ(d, 5.0);
+    int64_t i64;
+    ASSERT_TRUE(purc_variant_cast_to_longint(i1, &i64, false));
+    ASSERT_EQ(i64, 5);
+
+    // -0.0 keeps its sign
+    purc_variant_t z = purc_variant_make_number(-0.0);
+    ASSERT_TRUE(purc_variant_cast_to_number(z, &d, false));
+    ASSERT_TRUE(signbit(d));
+
+    // the values out of the range or not integral are allocated
+    purc_variant_t big = purc_variant_make_longint(PCVARIANT_MAX_SHARED_INT + 1);
+    purc_variant_t half = purc_variant_make_number(0.5);
+    stat = purc_variant_usage_stat();
+    ASSERT_EQ(stat->nr_total_values, nr_total_values + 3);
+
+    purc_variant_unref(half);
+    purc_variant_unref(big);
+    purc_variant_unref(z);
+    purc_variant_unref(u1);
+    purc_variant_unref(i1);
+    purc_variant_unref(n2);
+    purc_variant_unref(n1);
+
+    stat = purc_variant_usage_stat();
+    ASSERT_EQ(stat->nr_total_values, nr_total_values);
+
+    purc_cleanup ();
+}
+
+TEST(variant, freeze)
+{
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex(PURC_MODULE_VARIANT, "cn.fmsfot.hvml.test",
+            "variant", &info);
+    ASSERT_EQ (ret, PURC_ERROR_OK);
+
+    purc_variant_t str = purc_variant_make_string("bar", false);
+    purc_variant_t num = purc_variant_make_number(2048);
+    purc_variant_t arr = purc_variant_make_array(2, str, num);
+    purc_variant_t obj = purc_variant_make_object_by_static_ckey(2,
+            "name", str, "list", arr);
+    ASSERT_NE(obj, nullptr);
+
+    const struct purc_variant_stat *stat = purc_variant_usage_stat();
+    size_t nr_total_values = stat->nr_total_values;
+
+    // the frozen values are not allocated by the instance
+    purc_variant_t frozen = purc_variant_freeze(obj);
+    ASSERT_NE(frozen, nullptr);
+    ASSERT_NE(frozen, obj);
+    stat = purc_variant_usage_stat();
+    ASSERT_EQ(stat->nr_total_values, nr_total_values);
+
+    ASSERT_FALSE(purc_variant_is_frozen(obj));
+    ASSERT_TRUE(purc_variant_is_frozen(frozen));
+    ASSERT_TRUE(purc_variant_is_equal_to(frozen, obj));
+
+    purc_variant_t list = purc_variant_object_get_by_ckey(frozen, "list");
+    ASSERT_TRUE(purc_variant_is_frozen(list));
+    ASSERT_TRUE(purc_variant_is_frozen(purc_variant_array_get(list, 0)));
+
+    // changing fails
+    ASSERT_FALSE(purc_variant_object_set_by_static_ckey(frozen, "name", num));
+    ASSERT_EQ(purc_get_last_error(), PCVARIANT_ERROR_FROZEN);
+    ASSERT_FALSE(purc_variant_array_append(list, num));
+    ASSERT_EQ(purc_get_last_error(), PCVARIANT_ERROR_FROZEN);
+    ASSERT_FALSE(purc_variant_array_remove(list, 0));
+    ASSERT_EQ(purc_get_last_error(), PCVARIANT_ERROR_FROZEN);
+    ASSERT_EQ(purc_variant_array_get_size(list), 2);
+
+    // freezing again shares the value
+    purc_variant_t again = purc_variant_freeze(frozen);
+    ASSERT_EQ(again, frozen);
+    ASSERT_EQ(purc_variant_ref_count(frozen), 2);
+    purc_variant_unref(again);
+
+    // a clone can be changed
+    purc_variant_t clone = purc_variant_container_clone(frozen);
+    ASSERT_FALSE(purc_variant_is_frozen(clone));
+    ASSERT_TRUE(purc_variant_object_set_by_static_ckey(clone, "name", num));
+    purc_variant_unref(clone);
+
+    purc_variant_unref(frozen);
+    stat = purc_variant_usage_stat();
+    ASSERT_EQ(stat->nr_total_values, nr_total_values);
+
+    purc_variant_unref(obj);
+    purc_variant_unref(arr);
+    purc_variant_unref(num);
+    purc_variant_unref(str);
+
+    purc_cleanup ();
+}
@@ -533,3 +533,196 @@ TEST(variant_array, sort)
     ASSERT_STREQ(inbuf, outbuf);
 }
 
+
+TEST(variant_array, edit_in_set)
+{
+    purc_instance_extra_info info = {};
+    int ret = 0;
+    bool cleanup = false;
+    const struct purc_variant_stat *stat;
+
+    ret = purc_init_ex (PURC_MODULE_VARIANT, "cn.fmsoft.hybridos.test",
+            "test_init", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    stat = purc_variant_usage_stat();
+    ASSERT_NE(stat, nullptr);
+
+    const int ins1[] = { 3, 1, 2 };
+    const int ins2[] = { 9, 2 };
+
+    purc_variant_t set = purc_variant_make_set_by_ckey(0, "name", NULL);
+    ASSERT_NE(set, nullptr);
+
+    purc_variant_t arr;
+    const int *ins[] = { ins1, ins2 };
+    size_t nrs[] = { PCA_TABLESIZE(ins1), PCA_TABLESIZE(ins2) };
+    for (size_t i = 0; i < PCA_TABLESIZE(ins); ++i) {
+        arr = make_array(ins[i], nrs[i]);
+        ASSERT_NE(arr, nullptr);
+        purc_variant_t obj;
+        obj = purc_variant_make_object_by_static_ckey(1, "name", arr);
+        ASSERT_NE(obj, nullptr);
+        ASSERT_TRUE(purc_variant_set_add(set, obj, false));
+        purc_variant_unref(obj);
+        purc_variant_unref(arr);
+    }
+
+    // the array of the first element is now bound to the set.
+    purc_variant_t elem = purc_variant_set_get_by_index(set, 0);
+    ASSERT_NE(elem, nullptr);
+    arr = purc_variant_object_get_by_ckey(elem, "name");
+    ASSERT_NE(arr, nullptr);
+    if (purc_variant_array_get_size(arr) != PCA_TABLESIZE(ins1)) {
+        elem = purc_variant_set_get_by_index(set, 1);
+        arr = purc_variant_object_get_by_ckey(elem, "name");
+    }
+    ASSERT_EQ(purc_variant_array_get_size(arr), PCA_TABLESIZE(ins1));
+
+    char buf[64];
+    int r = pcvariant_array_sort(arr, NULL, cmp);
+    ASSERT_EQ(r, 0);
+    purc_variant_stringify_buff(buf, sizeof(buf), arr);
+    ASSERT_STREQ(buf, "1\n2\n3\n");
+
+    purc_variant_t v = purc_variant_make_longint(9);
+    ASSERT_TRUE(purc_variant_array_insert_before(arr, 1, v));
+    purc_variant_unref(v);
+    ASSERT_TRUE(purc_variant_array_remove(arr, 0));
+    purc_variant_stringify_buff(buf, sizeof(buf), arr);
+    ASSERT_STREQ(buf, "9\n2\n3\n");
+
+    // removing the last member makes the element duplicated.
+    ASSERT_FALSE(purc_variant_array_remove(arr, 2));
+    purc_variant_stringify_buff(buf, sizeof(buf), arr);
+    ASSERT_STREQ(buf, "9\n2\n3\n");
+
+    ASSERT_TRUE(purc_variant_array_remove(arr, 1));
+    purc_variant_stringify_buff(buf, sizeof(buf), arr);
+    ASSERT_STREQ(buf, "9\n3\n");
+
+    purc_variant_unref(set);
+    ASSERT_EQ(stat->nr_values[PVT(_ARRAY)], 0);
+    ASSERT_EQ(stat->nr_values[PVT(_OBJECT)], 0);
+
+    cleanup = purc_cleanup ();
+    ASSERT_EQ (cleanup, true);
+}
+
+TEST(variant_array, memory_per_number)
+{
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex(PURC_MODULE_VARIANT, "cn.fmsoft.hybridos.test",
+            "test_init", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    const size_t nr_members = 1000000;
+    const struct purc_variant_stat *stat = purc_variant_usage_stat();
+    size_t sz_slab = stat->sz_slab_mem;
+
+    purc_variant_t arr = purc_variant_make_array_0();
+    ASSERT_NE(arr, PURC_VARIANT_INVALID);
+    for (size_t i = 0; i < nr_members; i++) {
+        // not integral, so the numbers are not shared
+        purc_variant_t v = purc_variant_make_number(i + 0.5);
+        ASSERT_TRUE(purc_variant_array_append(arr, v));
+        purc_variant_unref(v);
+    }
+
+    // sz_mem[] of numbers does not help here: the temporary numbers of
+    // the positions are recycled from the reserved variants.
+    stat = purc_variant_usage_stat();
+    double per_slot = (stat->sz_slab_mem - sz_slab) / (double)nr_members;
+    fprintf(stderr, "sizeof(purc_variant): %zu; bytes per number in slab "
+            "pages: %.2f\n", sizeof(purc_variant), per_slot);
+
+    // the listeners are not stored in the variants anymore
+    if (sizeof(void *) == 8) {
+        ASSERT_LE(sizeof(purc_variant), 48);
+    }
+    ASSERT_GE(per_slot, (double)sizeof(purc_variant));
+    ASSERT_LT(per_slot, sizeof(purc_variant) * 1.05);
+
+    purc_variant_unref(arr);
+    ASSERT_TRUE(purc_cleanup());
+}
+
+TEST(variant_array, cow_clone)
+{
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex(PURC_MODULE_VARIANT, "cn.fmsoft.hybridos.test",
+            "test_init", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    const struct purc_variant_stat *stat = purc_variant_usage_stat();
+    size_t nr_arrays = stat->nr_values[PVT(_ARRAY)];
+    size_t sz_arrays_0 = stat->sz_mem[PVT(_ARRAY)];
+
+    const size_t nr_members = 100;
+    purc_variant_t arr = purc_variant_make_array_0();
+    ASSERT_NE(arr, PURC_VARIANT_INVALID);
+    for (size_t i = 0; i < nr_members; i++) {
+        purc_variant_t v = purc_variant_make_number(i + 0.5);
+        ASSERT_TRUE(purc_variant_array_append(arr, v));
+        purc_variant_unref(v);
+    }
+
+    stat = purc_variant_usage_stat();
+    size_t sz_arrays = stat->sz_mem[PVT(_ARRAY)];
+
+    // the clone shares the members with the source, which are counted
+    // once.
+    purc_variant_t clone = purc_variant_container_clone(arr);
+    ASSERT_NE(clone, PURC_VARIANT_INVALID);
+    stat = purc_variant_usage_stat();
+    ssize_t sz_clone = (ssize_t)stat->sz_mem[PVT(_ARRAY)] - (ssize_t)sz_arrays;
+    ASSERT_GT(sz_clone, 0);
+    ASSERT_LT(sz_clone, (ssize_t)(nr_members * sizeof(purc_variant_t)));
+
+    purc_variant_t v0 = purc_variant_array_get(arr, 0);
+    purc_variant_t v1 = purc_variant_array_get(arr, 1);
+    ASSERT_EQ(purc_variant_array_get(clone, 0), v0);
+    ASSERT_EQ(v1->refc, 1);
+
+    // the first change splits the members.
+    purc_variant_t v = purc_variant_make_string("changed", false);
+    ASSERT_TRUE(purc_variant_array_set(clone, 0, v));
+    purc_variant_unref(v);
+    ASSERT_EQ(purc_variant_array_get(arr, 0), v0);
+    ASSERT_EQ(purc_variant_array_get(clone, 0), v);
+    ASSERT_EQ(purc_variant_array_get(clone, 1), v1);
+    ASSERT_EQ(v1->refc, 2);
+
+    // the recursive clone of the array without containers is shared too.
+    purc_variant_t deep = purc_variant_container_clone_recursively(arr);
+    ASSERT_NE(deep, PURC_VARIANT_INVALID);
+    ASSERT_EQ(purc_variant_array_get(deep, 1), v1);
+
+    purc_variant_unref(arr);
+    ASSERT_TRUE(purc_variant_array_remove(deep, 0));
+    ASSERT_EQ(purc_variant_array_get(deep, 0), v1);
+    ASSERT_EQ(purc_variant_array_get_size(deep), (ssize_t)nr_members - 1);
+    ASSERT_EQ(purc_variant_array_get_size(clone), (ssize_t)nr_members);
+
+    // the containers among the members are cloned when cloning recursively.
+    ASSERT_TRUE(purc_variant_array_append(clone, deep));
+    purc_variant_t outer = purc_variant_container_clone_recursively(clone);
+    ASSERT_NE(outer, PURC_VARIANT_INVALID);
+    purc_variant_t inner = purc_variant_array_get(outer, nr_members);
+    ASSERT_NE(inner, deep);
+    ASSERT_TRUE(purc_variant_is_equal_to(inner, deep));
+
+    purc_variant_unref(outer);
+    purc_variant_unref(deep);
+    purc_variant_unref(clone);
+
+    // only the reserved variants are still counted as arrays.
+    stat = purc_variant_usage_stat();
+    ASSERT_EQ(stat->nr_values[PVT(_ARRAY)], nr_arrays);
+    ssize_t sz_left = (ssize_t)stat->sz_mem[PVT(_ARRAY)] - (ssize_t)sz_arrays_0;
+    ASSERT_GE(sz_left, 0);
+    ASSERT_EQ(sz_left % sizeof(purc_variant), 0);
+    ASSERT_LE(sz_left, (ssize_t)(stat->nr_reserved * sizeof(purc_variant)));
+
+    ASSERT_TRUE(purc_cleanup());
+}
@@ -28,6 +28,7 @@
 #include <stdio.h>
 #include <errno.h>
 #include <gtest/gtest.h>
+#include <string>
 
 static inline void
 _check_get_by_key_c(purc_variant_t obj, const char *key, purc_variant_t val,
@@ -466,3 +467,300 @@ TEST(object, compare)
     purc_variant_unref(obj2);
 }
 
+
+static char *
+serialize_plain(purc_variant_t v)
+{
+    purc_rwstream_t rws = purc_rwstream_new_buffer(32, 65536);
+    size_t len_expected = 0;
+    purc_variant_serialize(v, rws,
+            0, PCVARIANT_SERIALIZE_OPT_PLAIN, &len_expected);
+    char *buf = (char *)purc_rwstream_get_mem_buffer_ex(rws, NULL, NULL, true);
+    purc_rwstream_destroy(rws);
+    return buf;
+}
+
+/* the keys of the members in the order of iteration */
+static std::string
+keys_in_order(purc_variant_t obj)
+{
+    std::string keys;
+    purc_variant_t k, v;
+    foreach_key_value_in_variant_object(obj, k, v) {
+        (void)v;
+        if (!keys.empty())
+            keys += ",";
+        keys += purc_variant_get_string_const(k);
+    } end_foreach;
+    return keys;
+}
+
+TEST(object, insertion_order)
+{
+    PurCInstance purc;
+
+    purc_variant_t one = purc_variant_make_ulongint(1);
+    purc_variant_t two = purc_variant_make_ulongint(2);
+    purc_variant_t three = purc_variant_make_ulongint(3);
+
+    purc_variant_t obj;
+    obj = purc_variant_make_object_by_static_ckey(3,
+            "zoo", one, "apple", two, "moon", three);
+    ASSERT_NE(obj, PURC_VARIANT_INVALID);
+    ASSERT_EQ(keys_in_order(obj), "zoo,apple,moon");
+
+    // the serializer still gives the members in the order of keys
+    char *buf = serialize_plain(obj);
+    ASSERT_STREQ(buf, "{\"apple\":2,\"moon\":3,\"zoo\":1}");
+    free(buf);
+
+    // changing a value keeps the position of the member
+    ASSERT_TRUE(purc_variant_object_set_by_static_ckey(obj, "zoo", three));
+    ASSERT_EQ(keys_in_order(obj), "zoo,apple,moon");
+
+    // a removed member goes to the end when it is added again
+    ASSERT_TRUE(purc_variant_object_remove_by_static_ckey(obj, "apple",
+                false));
+    ASSERT_TRUE(purc_variant_object_set_by_static_ckey(obj, "apple", one));
+    ASSERT_EQ(keys_in_order(obj), "zoo,moon,apple");
+
+    // iterating backward
+    struct purc_variant_object_iterator *it;
+    it = purc_variant_object_make_iterator_end(obj);
+    ASSERT_NE(it, nullptr);
+    const char *keys[] = { "apple", "moon", "zoo" };
+    size_t n = 0;
+    do {
+        purc_variant_t k = purc_variant_object_iterator_get_key(it);
+        ASSERT_LT(n, PCA_TABLESIZE(keys));
+        ASSERT_STREQ(purc_variant_get_string_const(k), keys[n]);
+        n++;
+    } while (purc_variant_object_iterator_prev(it));
+    purc_variant_object_release_iterator(it);
+    ASSERT_EQ(n, PCA_TABLESIZE(keys));
+
+    // comparing does not depend on the order of insertion
+    purc_variant_t other;
+    other = purc_variant_make_object_by_static_ckey(3,
+            "apple", one, "moon", three, "zoo", three);
+    ASSERT_NE(other, PURC_VARIANT_INVALID);
+    ASSERT_EQ(purc_variant_compare_ex(obj, other,
+                PCVARIANT_COMPARE_OPT_AUTO), 0);
+    ASSERT_TRUE(purc_variant_is_equal_to(obj, other));
+
+    purc_variant_unref(other);
+    purc_variant_unref(obj);
+    purc_variant_unref(one);
+    purc_variant_unref(two);
+    purc_variant_unref(three);
+}
+
+static bool
+set_by_ukey(purc_variant_t obj, size_t n)
+{
+    char key[32];
+    snprintf(key, sizeof(key), "key%zu", n);
+
+    purc_variant_t k = purc_variant_make_string(key, true);
+    purc_variant_t v = purc_variant_make_ulongint(n);
+    bool ok = purc_variant_object_set(obj, k, v);
+    purc_variant_unref(k);
+    purc_variant_unref(v);
+    return ok;
+}
+
+TEST(object, many_members)
+{
+    PurCInstance purc;
+
+    const size_t nr_keys = 200;
+    char key[32];
+
+    purc_variant_t obj = purc_variant_make_object_0();
+    ASSERT_NE(obj, PURC_VARIANT_INVALID);
+
+    for (size_t i = 0; i < nr_keys; i++) {
+        ASSERT_TRUE(set_by_ukey(obj, i));
+    }
+    ASSERT_EQ(purc_variant_object_get_size(obj), (ssize_t)nr_keys);
+
+    // remove the members with even numbers, leaving holes in the slots
+    for (size_t i = 0; i < nr_keys; i += 2) {
+        snprintf(key, sizeof(key), "key%zu", i);
+        ASSERT_TRUE(purc_variant_object_remove_by_static_ckey(obj, key,
+                    false));
+    }
+    ASSERT_EQ(purc_variant_object_get_size(obj), (ssize_t)nr_keys / 2);
+
+    for (size_t i = 0; i < nr_keys; i++) {
+        snprintf(key, sizeof(key), "key%zu", i);
+        purc_variant_t v = purc_variant_object_get_by_ckey(obj, key);
+        if (i % 2) {
+            uint64_t u;
+            ASSERT_NE(v, PURC_VARIANT_INVALID);
+            ASSERT_TRUE(purc_variant_cast_to_ulongint(v, &u, false));
+            ASSERT_EQ(u, i);
+        }
+        else {
+            ASSERT_EQ(v, PURC_VARIANT_INVALID);
+        }
+    }
+
+    // add them back; the slots will be compacted on demand
+    for (size_t i = 0; i < nr_keys; i += 2) {
+        ASSERT_TRUE(set_by_ukey(obj, i));
+    }
+    ASSERT_EQ(purc_variant_object_get_size(obj), (ssize_t)nr_keys);
+
+    // the odd ones come first, then the even ones
+    size_t n = 0;
+    purc_variant_t k, v;
+    foreach_key_value_in_variant_object(obj, k, v) {
+        size_t expected = (n < nr_keys / 2) ?
+            (n * 2 + 1) : ((n - nr_keys / 2) * 2);
+        snprintf(key, sizeof(key), "key%zu", expected);
+        ASSERT_STREQ(purc_variant_get_string_const(k), key);
+
+        uint64_t u;
+        ASSERT_TRUE(purc_variant_cast_to_ulongint(v, &u, false));
+        ASSERT_EQ(u, expected);
+        n++;
+    } end_foreach;
+    ASSERT_EQ(n, nr_keys);
+
+    // remove all but the first one
+    for (size_t i = 1; i < nr_keys; i++) {
+        snprintf(key, sizeof(key), "key%zu", i);
+        ASSERT_TRUE(purc_variant_object_remove_by_static_ckey(obj, key,
+                    false));
+    }
+    ASSERT_EQ(purc_variant_object_get_size(obj), 1);
+    ASSERT_NE(purc_variant_object_get_by_ckey(obj, "key0"),
+            PURC_VARIANT_INVALID);
+    ASSERT_EQ(purc_variant_object_get_by_ckey(obj, "key1"),
+            PURC_VARIANT_INVALID);
+
+    purc_variant_unref(obj);
+}
+
+TEST(object, atom_key)
+{
+    PurCInstance purc;
+
+    const size_t nr_keys = 20;
+    char key[32];
+
+    purc_variant_t obj = purc_variant_make_object_0();
+    ASSERT_NE(obj, PURC_VARIANT_INVALID);
+
+    // the keys set by strings can be got by atoms and vice versa
+    for (size_t i = 0; i < nr_keys; i++) {
+        snprintf(key, sizeof(key), "key%zu", i);
+        purc_variant_t v = purc_variant_make_ulongint(i);
+        if (i % 2) {
+            // the key buffer is reused, so the key can not be static.
+            purc_variant_t k = purc_variant_make_string(key, false);
+            ASSERT_TRUE(purc_variant_object_set(obj, k, v));
+            purc_variant_unref(k);
+        }
+        else {
+            purc_atom_t atom = purc_atom_from_string(key);
+            ASSERT_TRUE(purc_variant_object_set_by_atom(obj, atom, v));
+        }
+        purc_variant_unref(v);
+    }
+    ASSERT_EQ(purc_variant_object_get_size(obj), (ssize_t)nr_keys);
+
+    for (size_t i = 0; i < nr_keys; i++) {
+        snprintf(key, sizeof(key), "key%zu", i);
+        purc_atom_t atom = purc_atom_from_string(key);
+
+        uint64_t u;
+        purc_variant_t v = purc_variant_object_get_by_atom(obj, atom);
+        ASSERT_TRUE(purc_variant_cast_to_ulongint(v, &u, false));
+        ASSERT_EQ(u, i);
+
+        v = purc_variant_object_get_by_ckey(obj, key);
+        ASSERT_TRUE(purc_variant_cast_to_ulongint(v, &u, false));
+        ASSERT_EQ(u, i);
+    }
+
+    // overwrite by atom, then remove by setting undefined
+    purc_atom_t atom = purc_atom_from_string("key3");
+    purc_variant_t v = purc_variant_make_string("three", false);
+    ASSERT_TRUE(purc_variant_object_set_by_atom(obj, atom, v));
+    purc_variant_unref(v);
+    ASSERT_EQ(purc_variant_object_get_size(obj), (ssize_t)nr_keys);
+    v = purc_variant_object_get_by_ckey(obj, "key3");
+    ASSERT_STREQ(purc_variant_get_string_const(v), "three");
+
+    v = purc_variant_make_undefined();
+    ASSERT_TRUE(purc_variant_object_set_by_atom(obj, atom, v));
+    purc_variant_unref(v);
+    ASSERT_EQ(purc_variant_object_get_size(obj), (ssize_t)nr_keys - 1);
+    ASSERT_EQ(purc_variant_object_get_by_atom(obj, atom),
+            PURC_VARIANT_INVALID);
+
+    purc_variant_unref(obj);
+}
+
+TEST(object, cow_clone)
+{
+    PurCInstance purc;
+
+    const size_t nr_keys = 20;
+    char key[32];
+
+    purc_variant_t obj = purc_variant_make_object_0();
+    ASSERT_NE(obj, PURC_VARIANT_INVALID);
+    for (size_t i = 0; i < nr_keys; i++) {
+        snprintf(key, sizeof(key), "key%zu", i);
+        // the key buffer is reused, so the key can not be static.
+        purc_variant_t k = purc_variant_make_string(key, false);
+        purc_variant_t v = purc_variant_make_number(i + 0.5);
+        ASSERT_TRUE(purc_variant_object_set(obj, k, v));
+        purc_variant_unref(k);
+        purc_variant_unref(v);
+    }
+
+    const struct purc_variant_stat *stat = purc_variant_usage_stat();
+    size_t sz_objects = stat->sz_mem[PVT(_OBJECT)];
+
+    // the clone shares the members with the source, which are counted
+    // once.
+    purc_variant_t clone = purc_variant_container_clone(obj);
+    ASSERT_NE(clone, PURC_VARIANT_INVALID);
+    stat = purc_variant_usage_stat();
+    ssize_t sz_clone = (ssize_t)stat->sz_mem[PVT(_OBJECT)] -
+        (ssize_t)sz_objects;
+    ASSERT_GT(sz_clone, 0);
+    ASSERT_LT(sz_clone, (ssize_t)(nr_keys * 2 * sizeof(purc_variant_t)));
+    purc_variant_t v1 = purc_variant_object_get_by_ckey(obj, "key1");
+    ASSERT_EQ(purc_variant_object_get_by_ckey(clone, "key1"), v1);
+    ASSERT_EQ(v1->refc, 1);
+
+    // the first change splits the members.
+    ASSERT_TRUE(purc_variant_object_remove_by_static_ckey(obj, "key0",
+                false));
+    ASSERT_EQ(v1->refc, 2);
+    ASSERT_EQ(purc_variant_object_get_size(obj), (ssize_t)nr_keys - 1);
+    ASSERT_EQ(purc_variant_object_get_size(clone), (ssize_t)nr_keys);
+    ASSERT_NE(purc_variant_object_get_by_ckey(clone, "key0"),
+            PURC_VARIANT_INVALID);
+
+    purc_variant_t v = purc_variant_make_string("changed", false);
+    purc_atom_t atom = purc_atom_from_static_string("key2");
+    purc_variant_t copy = purc_variant_container_clone_recursively(clone);
+    ASSERT_NE(copy, PURC_VARIANT_INVALID);
+    ASSERT_TRUE(purc_variant_object_set_by_atom(copy, atom, v));
+    purc_variant_unref(v);
+    ASSERT_EQ(purc_variant_object_get_by_ckey(copy, "key2"), v);
+    ASSERT_NE(purc_variant_object_get_by_ckey(clone, "key2"), v);
+    ASSERT_EQ(purc_variant_object_get_by_ckey(copy, "key1"), v1);
+
+    purc_variant_unref(clone);
+    purc_variant_unref(copy);
+    ASSERT_EQ(v1->refc, 1);
+
+    purc_variant_unref(obj);
+}
@@ -30,6 +30,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <float.h>
 #include <gtest/gtest.h>
 
 static inline bool
@@ -1112,3 +1113,260 @@ TEST(variant, set)
     }
 }
 
+TEST(set, hash_index)
+{
+    PurCInstance purc;
+
+    // the numbers of different types are unified
+    purc_variant_t set = purc_variant_make_set_by_ckey(0, NULL,
+            PURC_VARIANT_INVALID);
+    ASSERT_NE(set, PURC_VARIANT_INVALID);
+
+    purc_variant_t num = purc_variant_make_number(1.0);
+    purc_variant_t i64 = purc_variant_make_longint(1);
+    purc_variant_t str = purc_variant_make_string("1", false);
+    ASSERT_TRUE(purc_variant_set_add(set, num, false));
+    ASSERT_FALSE(purc_variant_set_add(set, i64, false));
+    ASSERT_TRUE(purc_variant_set_add(set, str, false));
+    ASSERT_EQ(purc_variant_set_get_size(set), 2);
+    purc_variant_unref(str);
+    purc_variant_unref(i64);
+    purc_variant_unref(num);
+
+    // the numbers are compared exactly, as they are hashed
+    if (LDBL_MANT_DIG > DBL_MANT_DIG) {
+        purc_variant_t ld = purc_variant_make_longdouble(1.0L + LDBL_EPSILON);
+        ASSERT_TRUE(purc_variant_set_add(set, ld, false));
+        ASSERT_EQ(purc_variant_set_get_size(set), 3);
+        ASSERT_EQ(pcvariant_set_find(set, ld), ld);
+        purc_variant_unref(ld);
+    }
+    purc_variant_unref(set);
+
+    // the members are located by the values of the unique keys
+    const size_t nr_records = 1000;
+    set = purc_variant_make_set_by_ckey(0, "id", PURC_VARIANT_INVALID);
+    ASSERT_NE(set, PURC_VARIANT_INVALID);
+
+    for (size_t i = 0; i < nr_records; i++) {
+        purc_variant_t id = purc_variant_make_ulongint(i);
+        purc_variant_t val = purc_variant_make_ulongint(i * 2);
+        purc_variant_t rec = purc_variant_make_object_by_static_ckey(2,
+                "id", id, "val", val);
+        ASSERT_TRUE(purc_variant_set_add(set, rec, true));
+        purc_variant_unref(rec);
+        purc_variant_unref(val);
+        purc_variant_unref(id);
+    }
+    ASSERT_EQ(purc_variant_set_get_size(set), (ssize_t)nr_records);
+    ASSERT_TRUE(sanity_check(set));
+
+    for (size_t i = 0; i < nr_records; i += 2) {
+        purc_variant_t id = purc_variant_make_ulongint(i);
+        purc_variant_t rec;
+        rec = purc_variant_set_remove_member_by_key_values(set, id);
+        ASSERT_NE(rec, PURC_VARIANT_INVALID);
+        purc_variant_unref(rec);
+        purc_variant_unref(id);
+    }
+    ASSERT_EQ(purc_variant_set_get_size(set), (ssize_t)nr_records / 2);
+
+    for (size_t i = 0; i < nr_records; i++) {
+        purc_variant_t id = purc_variant_make_number(i);
+        purc_variant_t rec;
+        rec = purc_variant_set_get_member_by_key_values(set, id);
+        purc_variant_unref(id);
+        if (i % 2 == 0) {
+            ASSERT_EQ(rec, PURC_VARIANT_INVALID);
+            purc_clr_error();
+            continue;
+        }
+
+        ASSERT_NE(rec, PURC_VARIANT_INVALID);
+        purc_variant_t val = purc_variant_object_get_by_ckey(rec, "val");
+        uint64_t u;
+        ASSERT_TRUE(purc_variant_cast_to_ulongint(val, &u, false));
+        ASSERT_EQ(u, i * 2);
+    }
+
+    purc_variant_unref(set);
+}
+
+struct set_events {
+    size_t nr_events;
+    size_t nr_grown;
+    size_t nr_shrunk;
+    size_t nr_changed;
+};
+
+static bool
+count_set_events(purc_variant_t src, pcvar_op_t op, void *ctxt,
+        size_t nr_args, purc_variant_t *argv)
+{
+    UNUSED_PARAM(src);
+    UNUSED_PARAM(argv);
+
+    struct set_events *events = (struct set_events*)ctxt;
+    events->nr_events++;
+    switch (op) {
+        case PCVAR_OPERATION_GROW:
+            events->nr_grown += nr_args;
+            break;
+        case PCVAR_OPERATION_SHRINK:
+            events->nr_shrunk += nr_args;
+            break;
+        case PCVAR_OPERATION_CHANGE:
+            events->nr_changed += nr_args / 2;
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+static purc_variant_t
+make_id_records(size_t from, size_t to, size_t step, size_t tag)
+{
+    purc_variant_t arr = purc_variant_make_array(0, PURC_VARIANT_INVALID);
+    for (size_t i = from; i < to; i += step) {
+        purc_variant_t id = purc_variant_make_ulongint(i);
+        purc_variant_t val = purc_variant_make_ulongint(tag);
+        purc_variant_t rec = purc_variant_make_object_by_static_ckey(2,
+                "id", id, "val", val);
+        purc_variant_array_append(arr, rec);
+        purc_variant_unref(rec);
+        purc_variant_unref(val);
+        purc_variant_unref(id);
+    }
+    return arr;
+}
+
+TEST(set, algebra)
+{
+    PurCInstance purc;
+
+    // ids: 0..99
+    purc_variant_t set = purc_variant_make_set_by_ckey(0, "id",
+            PURC_VARIANT_INVALID);
+    purc_variant_t recs = make_id_records(0, 100, 1, 0);
+    ASSERT_TRUE(purc_variant_set_unite(set, recs, false));
+    purc_variant_unref(recs);
+    ASSERT_EQ(purc_variant_set_get_size(set), 100);
+
+    struct set_events events = { };
+    int op = PCVAR_OPERATION_GROW | PCVAR_OPERATION_SHRINK |
+        PCVAR_OPERATION_CHANGE;
+    struct pcvar_listener *listener;
+    listener = purc_variant_register_post_listener(set, (pcvar_op_t)op,
+            count_set_events, &events);
+    ASSERT_NE(listener, nullptr);
+
+    // 50..149: 50 members changed and 50 grown, in two events
+    recs = make_id_records(50, 150, 1, 1);
+    ASSERT_TRUE(purc_variant_set_unite(set, recs, false));
+    purc_variant_unref(recs);
+    ASSERT_EQ(purc_variant_set_get_size(set), 150);
+    ASSERT_EQ(events.nr_events, 2);
+    ASSERT_EQ(events.nr_changed, 50);
+    ASSERT_EQ(events.nr_grown, 50);
+
+    // remove the odd ids
+    events = { };
+    recs = make_id_records(1, 200, 2, 2);
+    ASSERT_TRUE(purc_variant_set_subtract(set, recs, false));
+    purc_variant_unref(recs);
+    ASSERT_EQ(purc_variant_set_get_size(set), 75);
+    ASSERT_EQ(events.nr_events, 1);
+    ASSERT_EQ(events.nr_shrunk, 75);
+
+    // keep the ids in 0..99 only
+    events = { };
+    recs = make_id_records(0, 100, 1, 0);
+    ASSERT_TRUE(purc_variant_set_intersect(set, recs, false));
+    purc_variant_unref(recs);
+    ASSERT_EQ(purc_variant_set_get_size(set), 50);
+    ASSERT_EQ(events.nr_shrunk, 25);
+    ASSERT_EQ(events.nr_changed, 50);     // replaced by the source members
+
+    // toggle the ids in 90..109
+    events = { };
+    recs = make_id_records(90, 110, 1, 3);
+    ASSERT_TRUE(purc_variant_set_xor(set, recs, false));
+    purc_variant_unref(recs);
+    ASSERT_EQ(purc_variant_set_get_size(set), 60);
+    ASSERT_EQ(events.nr_events, 2);
+    ASSERT_EQ(events.nr_shrunk, 5);
+    ASSERT_EQ(events.nr_grown, 15);
+
+    for (size_t i = 0; i < 110; i++) {
+        purc_variant_t id = purc_variant_make_ulongint(i);
+        purc_variant_t rec;
+        rec = purc_variant_set_get_member_by_key_values(set, id);
+        purc_variant_unref(id);
+
+        bool expected = (i < 90) ? (i % 2 == 0) : (i >= 100 || i % 2);
+        ASSERT_EQ(rec != PURC_VARIANT_INVALID, expected) << i;
+        if (!expected)
+            purc_clr_error();
+    }
+
+    purc_variant_revoke_listener(set, listener);
+    purc_variant_unref(set);
+}
+
+TEST(set, key_values)
+{
+    PurCInstance purc;
+
+    purc_variant_t set = purc_variant_make_set_by_ckey(0, "id name",
+            PURC_VARIANT_INVALID);
+    ASSERT_NE(set, PURC_VARIANT_INVALID);
+
+    const size_t nr_records = 100;
+    for (size_t i = 0; i < nr_records; i++) {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "name%zu", i % 10);
+        purc_variant_t id = purc_variant_make_ulongint(i / 10);
+        purc_variant_t name = purc_variant_make_string(buf, false);
+        purc_variant_t rec = purc_variant_make_object_by_static_ckey(2,
+                "id", id, "name", name);
+        ASSERT_TRUE(purc_variant_set_add(set, rec, false));
+        purc_variant_unref(rec);
+        purc_variant_unref(name);
+        purc_variant_unref(id);
+    }
+
+    const struct purc_variant_stat *stat = purc_variant_usage_stat();
+    size_t nr_hits = stat->nr_set_key_hits;
+    size_t nr_misses = stat->nr_set_key_misses;
+
+    purc_variant_t id = purc_variant_make_number(3);   // numbers are unified
+    purc_variant_t name = purc_variant_make_string("name7", false);
+    purc_variant_t rec;
+    rec = purc_variant_set_get_member_by_key_values(set, id, name);
+    ASSERT_NE(rec, PURC_VARIANT_INVALID);
+    ASSERT_STREQ(purc_variant_get_string_const(
+                purc_variant_object_get_by_ckey(rec, "name")), "name7");
+    purc_variant_unref(name);
+
+    name = purc_variant_make_string("name10", false);
+    rec = purc_variant_set_get_member_by_key_values(set, id, name);
+    ASSERT_EQ(rec, PURC_VARIANT_INVALID);
+    purc_variant_unref(name);
+
+    name = purc_variant_make_string("name0", false);
+    rec = purc_variant_set_remove_member_by_key_values(set, id, name);
+    ASSERT_NE(rec, PURC_VARIANT_INVALID);
+    purc_variant_unref(rec);
+    ASSERT_EQ(purc_variant_set_get_size(set), (ssize_t)nr_records - 1);
+    rec = purc_variant_set_get_member_by_key_values(set, id, name);
+    ASSERT_EQ(rec, PURC_VARIANT_INVALID);
+    purc_variant_unref(name);
+    purc_variant_unref(id);
+
+    stat = purc_variant_usage_stat();
+    ASSERT_EQ(stat->nr_set_key_hits - nr_hits, 2);
+    ASSERT_EQ(stat->nr_set_key_misses - nr_misses, 2);
+
+    purc_variant_unref(set);
+}
@@ -151,3 +151,60 @@ TEST(vcm, array)
 
 
 
+
+TEST(vcm, fold_constants)
+{
+    int ret = purc_init_ex(PURC_MODULE_EJSON, "cn.fmsoft.hybridos.test",
+            "vcm_fold", NULL);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    // {"hello": ["world", 1.23], "k": $v}
+    struct pcvcm_node *items[] = {
+        pcvcm_node_new_string("world"),
+        pcvcm_node_new_number(1.23),
+    };
+    struct pcvcm_node *nodes[] = {
+        pcvcm_node_new_string("hello"),
+        pcvcm_node_new_array(PCA_TABLESIZE(items), items),
+        pcvcm_node_new_string("k"),
+        pcvcm_node_new_get_variable(pcvcm_node_new_string("v")),
+    };
+    struct pcvcm_node *root;
+    root = pcvcm_node_new_object(PCA_TABLESIZE(nodes), nodes);
+    ASSERT_NE(root, nullptr);
+
+    // the strings and the array are folded, but not the object
+    size_t nr_folded = pcvcm_node_fold_constants(root);
+    ASSERT_EQ(nr_folded, 6);
+    ASSERT_EQ(root->const_id, 0);
+    ASSERT_NE(nodes[1]->const_id, 0);
+    ASSERT_EQ(items[0]->const_id, 0);
+
+    struct pcvcm_consts *consts = pcvcm_consts_new();
+    ASSERT_NE(consts, nullptr);
+
+    purc_variant_t v1 = pcvcm_eval_with_consts(root, consts, NULL, NULL, true);
+    purc_variant_t v2 = pcvcm_eval_with_consts(root, consts, NULL, NULL, true);
+    ASSERT_NE(v1, PURC_VARIANT_INVALID);
+    ASSERT_NE(v2, PURC_VARIANT_INVALID);
+
+    // the arrays are cloned, the strings in them are shared
+    purc_variant_t a1 = purc_variant_object_get_by_ckey(v1, "hello");
+    purc_variant_t a2 = purc_variant_object_get_by_ckey(v2, "hello");
+    ASSERT_NE(a1, a2);
+    ASSERT_EQ(purc_variant_array_get(a1, 0), purc_variant_array_get(a2, 0));
+    ASSERT_TRUE(purc_variant_is_equal_to(a1, a2));
+
+    purc_variant_t v = purc_variant_make_null();
+    purc_variant_array_append(a1, v);
+    purc_variant_unref(v);
+    ASSERT_EQ(purc_variant_array_get_size(a2), 2);
+
+    purc_variant_unref(v1);
+    purc_variant_unref(v2);
+
+    pcvcm_consts_destroy(consts);
+    pcvcm_node_destroy(root);
+
+    purc_cleanup();
+}